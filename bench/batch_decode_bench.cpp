@@ -0,0 +1,118 @@
+/*
+ * Measures how image decode throughput scales with threads through ImageBatchDecoder. Every image in a directory is
+ * read into memory once and repeated until the batch holds the requested number of jobs, like warming a texture cache.
+ * Outputs are allocated up front from measure(). Reports images/s and decoded MB/s for 1, 2, 4, ... threads up to the
+ * core count, or up to max threads, next to a plain stbi_load_from_memory loop on one thread.
+ *
+ * Usage: batch_decode_bench [image directory] [jobs] [runs] [max threads]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "stb_image.h"
+#include "image_batch_decoder.h"
+
+static double elapsedMs(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void report(const char* name, unsigned int threads, double ms, size_t images, size_t bytes, double baselineMs)
+{
+    std::printf("%-8s %2u threads  %9.1f ms  %8.1f images/s  %8.1f MB/s  %5.2fx\n", name, threads, ms, images * 1000.0 / ms, bytes / 1048576.0 * 1000.0 / ms, baselineMs / ms);
+}
+
+int main(int argc, char* argv[])
+{
+    std::string directory = argc > 1 ? argv[1] : "../textures";
+    size_t jobCount = argc > 2 ? (size_t)atoi(argv[2]) : 256;
+    int runs = argc > 3 ? std::max(1, atoi(argv[3])) : 3;
+    unsigned int maxThreads = argc > 4 ? (unsigned int)std::max(1, atoi(argv[4])) : std::max(1u, std::thread::hardware_concurrency());
+
+    std::vector<std::vector<unsigned char>> files;
+    std::error_code error;
+    for (const auto& entry : std::filesystem::directory_iterator(directory, error))
+    {
+        if (!entry.is_regular_file())
+        {
+            continue;
+        }
+        std::ifstream file(entry.path(), std::ios::binary);
+        std::vector<unsigned char> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        int width, height, channels;
+        if (stbi_info_from_memory(bytes.data(), (int)bytes.size(), &width, &height, &channels))
+        {
+            files.push_back(std::move(bytes));
+        }
+    }
+    if (files.empty())
+    {
+        std::printf("No images in %s\n", directory.c_str());
+        return 1;
+    }
+
+    // RGBA rows padded to 256 bytes, as for upload into pitched staging memory.
+    std::vector<ImageDecodeJob> jobs(jobCount);
+    std::vector<std::vector<unsigned char>> outputs(jobCount);
+    size_t outputBytes = 0;
+    for (size_t i = 0; i < jobCount; i++)
+    {
+        ImageDecodeJob& job = jobs[i];
+        job.source = files[i % files.size()];
+        job.options.channels = 4;
+        job.options.flip = true;
+        ImageBatchDecoder::measure(job);
+        job.options.pitch = ((size_t)job.width * 4 + 255) & ~(size_t)255;
+        outputs[i].resize(ImageBatchDecoder::measure(job));
+        job.output = outputs[i].data();
+        job.capacity = outputs[i].size();
+        outputBytes += (size_t)job.width * job.height * 4;
+    }
+    std::printf("%zu jobs from %zu files in %s, %.1f MB decoded per batch\n", jobCount, files.size(), directory.c_str(), outputBytes / 1048576.0);
+
+    double baselineMs = 1e30;
+    for (int run = 0; run < runs; run++)
+    {
+        auto start = std::chrono::steady_clock::now();
+        for (const ImageDecodeJob& job : jobs)
+        {
+            int width, height, channels;
+            stbi_image_free(stbi_load_from_memory(job.source.data(), (int)job.source.size(), &width, &height, &channels, 4));
+        }
+        baselineMs = std::min(baselineMs, elapsedMs(start));
+    }
+    report("stbi", 1, baselineMs, jobCount, outputBytes, baselineMs);
+
+    std::vector<unsigned int> threadCounts;
+    for (unsigned int threads = 1; threads < maxThreads; threads *= 2)
+    {
+        threadCounts.push_back(threads);
+    }
+    threadCounts.push_back(maxThreads);
+    for (unsigned int threads : threadCounts)
+    {
+        ImageBatchDecoder decoder(threads);
+        double best = 1e30;
+        size_t decoded = 0;
+        for (int run = 0; run < runs; run++)
+        {
+            auto start = std::chrono::steady_clock::now();
+            decoded = decoder.decode(jobs);
+            best = std::min(best, elapsedMs(start));
+        }
+        if (decoded != jobCount)
+        {
+            std::printf("%zu of %zu jobs failed\n", jobCount - decoded, jobCount);
+        }
+        report("batch", threads, best, jobCount, outputBytes, baselineMs);
+    }
+    return 0;
+}
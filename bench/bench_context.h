@@ -0,0 +1,72 @@
+#ifndef BENCH_CONTEXT_H
+#define BENCH_CONTEXT_H
+
+#include <iostream>
+
+#include <GLFW/glfw3.h>
+
+#include "headless_context.h"
+
+// GL 3.2 core context for the benchmarks, current on the creating thread with GLEW initialized. A headless context
+// when the build has a headless backend, so benchmarks run on machines without a display; a hidden GLFW window
+// otherwise. Declare it before any GL object and keep those in an inner scope so they are deleted first.
+class BenchContext
+{
+    public:
+        BenchContext(const char* title, unsigned int width, unsigned int height) : valid(false)
+        {
+#if defined(CLEAN_HEADLESS_EGL) || defined(CLEAN_HEADLESS_OSMESA)
+            (void)title;
+            (void)width;
+            (void)height;
+            valid = context.isValid() && HeadlessContext::initGLEW();
+            if (!valid)
+            {
+                std::cerr << "Failed to create a headless context." << std::endl;
+            }
+#else
+            glfwInit();
+            glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+            glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 2);
+            glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+            glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+            glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+            GLFWwindow* window = glfwCreateWindow(width, height, title, NULL, NULL);
+            if (window == NULL)
+            {
+                std::cerr << "Failed to create GLFW window" << std::endl;
+                return;
+            }
+            glfwMakeContextCurrent(window);
+            glewExperimental = true;
+            if (glewInit() != GLEW_OK)
+            {
+                std::cerr << "Failed to create GLEW." << std::endl;
+                return;
+            }
+            valid = true;
+#endif
+        }
+
+        ~BenchContext()
+        {
+#if !defined(CLEAN_HEADLESS_EGL) && !defined(CLEAN_HEADLESS_OSMESA)
+            glfwTerminate();
+#endif
+        }
+
+        BenchContext(const BenchContext&) = delete;
+        BenchContext& operator=(const BenchContext&) = delete;
+
+        bool isValid() const
+        {
+            return valid;
+        }
+
+    private:
+        bool valid;
+#if defined(CLEAN_HEADLESS_EGL) || defined(CLEAN_HEADLESS_OSMESA)
+        HeadlessContext context;
+#endif
+};
+#endif
@@ -0,0 +1,287 @@
+/*
+ * Benchmark for BufferArena: uploads a few thousand small meshes, a quarter of them exact copies of another, once with
+ * a vertex buffer, index buffer and vertex array per mesh and once into shared arena pages drawn with a base vertex,
+ * one vertex array per page. Reports upload time, frame time, vertex array binds and buffer counts, then releases
+ * every other mesh, prints the arena stats before and after compact() and checks every image against the per-mesh one.
+ *
+ * Usage: buffer_arena_bench [shader directory] [meshes] [frames] [page KB]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#define GLEW_STATIC 1
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "bench_context.h"
+#include "render_target.h"
+#include "shader.h"
+#include "shader_variants.h"
+#include "frame_data.h"
+#include "mesh.h"
+#include "mesh_importer.h"
+#include "buffer_arena.h"
+
+constexpr UniformName U_OBJECT_COLOR("objectColor");
+constexpr UniformName U_MODEL("model");
+constexpr UniformName U_NORMAL_MATRIX("normalMatrix");
+
+const unsigned int WIDTH = 480;
+const unsigned int HEIGHT = 270;
+
+static double elapsedMs(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Small UV sphere laid out like MeshImporter output. A nonzero seed bumps the surface so the mesh is unique.
+static Mesh makeSphere(unsigned int segments, unsigned int seed)
+{
+    Mesh mesh;
+    mesh.Stride = MeshImporter::VERTEX_STRIDE;
+    for (unsigned int r = 0; r <= segments; r++)
+    {
+        float theta = (float)r / segments * 3.14159265f;
+        for (unsigned int s = 0; s <= segments; s++)
+        {
+            float phi = (float)s / segments * 6.28318531f;
+            float x = std::sin(theta) * std::cos(phi), y = std::cos(theta), z = std::sin(theta) * std::sin(phi);
+            float radius = seed ? 1.0f + 0.1f * std::sin(seed * 0.7f + r * 1.3f + s * 2.1f) : 1.0f;
+            mesh.Vertices.insert(mesh.Vertices.end(), { x * radius, y * radius, z * radius, x, y, z, (float)s / segments, 1.0f - (float)r / segments });
+        }
+    }
+    for (unsigned int r = 0; r < segments; r++)
+    {
+        for (unsigned int s = 0; s < segments; s++)
+        {
+            unsigned int a = r * (segments + 1) + s, b = a + segments + 1;
+            mesh.Indices.insert(mesh.Indices.end(), { a, b, a + 1, a + 1, b, b + 1 });
+        }
+    }
+    return mesh;
+}
+
+struct Object
+{
+    Mesh mesh;
+    glm::mat4 model;
+    glm::mat3 normalMatrix;
+    unsigned int vertexArray = 0;
+    bool alive = true;
+};
+
+// Draws every live object and returns the vertex array binds it took. With arenas, objects share the vertex array of
+// their pages, made on first use.
+static unsigned long drawObjects(std::vector<Object>& objects, Shader& shader, bool arena, std::map<std::pair<unsigned int, unsigned int>, unsigned int>& pageArrays)
+{
+    unsigned long before = glStateCache().VertexArrays.issued;
+    shader.use();
+    shader.setVec3(U_OBJECT_COLOR, 1.0f, 0.5f, 0.31f);
+    for (Object& object : objects)
+    {
+        if (!object.alive)
+        {
+            continue;
+        }
+        unsigned int vertexArray = object.vertexArray;
+        if (arena)
+        {
+            unsigned int& shared = pageArrays[std::make_pair(object.mesh.VBO, object.mesh.EBO)];
+            if (shared == 0)
+            {
+                shared = object.mesh.createVertexArray(MeshImporter::vertexAttributes());
+            }
+            vertexArray = shared;
+        }
+        glStateCache().bindVertexArray(vertexArray);
+        shader.setMat4(U_MODEL, object.model);
+        shader.setMat3(U_NORMAL_MATRIX, object.normalMatrix);
+        object.mesh.draw();
+    }
+    return glStateCache().VertexArrays.issued - before;
+}
+
+static void deleteArrays(std::map<std::pair<unsigned int, unsigned int>, unsigned int>& pageArrays)
+{
+    for (auto& entry : pageArrays)
+    {
+        glDeleteVertexArrays(1, &entry.second);
+    }
+    pageArrays.clear();
+    glStateCache().bindVertexArray(0);
+}
+
+// Median frame time in milliseconds; the last frame is left in the target.
+static double renderFrames(std::vector<Object>& objects, Shader& shader, bool arena, std::map<std::pair<unsigned int, unsigned int>, unsigned int>& pageArrays,
+    const RenderTarget& target, int frames, unsigned long& binds)
+{
+    std::vector<double> frameMs;
+    for (int frame = -2; frame < frames; frame++)
+    {
+        auto start = std::chrono::steady_clock::now();
+        target.bind();
+        glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        binds = drawObjects(objects, shader, arena, pageArrays);
+        glFinish();
+        if (frame >= 0)
+        {
+            frameMs.push_back(elapsedMs(start));
+        }
+    }
+    std::sort(frameMs.begin(), frameMs.end());
+    return frameMs[frameMs.size() / 2];
+}
+
+static int maxDifference(const std::vector<unsigned char>& a, const std::vector<unsigned char>& b)
+{
+    int difference = 0;
+    for (size_t i = 0; i < a.size() && i < b.size(); i++)
+    {
+        difference = std::max(difference, std::abs((int)a[i] - (int)b[i]));
+    }
+    return a.size() == b.size() ? difference : 255;
+}
+
+int main(int argc, char* argv[])
+{
+    std::string shaderDir = argc > 1 ? argv[1] : "shaders";
+    unsigned int count = argc > 2 ? (unsigned int)std::max(2, atoi(argv[2])) : 4096;
+    int frames = argc > 3 ? std::max(1, atoi(argv[3])) : 10;
+    size_t pageBytes = argc > 4 ? (size_t)std::max(1, atoi(argv[4])) << 10 : (size_t)4 << 20;
+
+    BenchContext context("buffer_arena_bench", WIDTH, HEIGHT);
+    if (!context.isValid())
+    {
+        return -1;
+    }
+
+    {
+        // A grid of spheres of 4 to 11 segments. Every fourth one repeats the plain sphere of its size.
+        std::vector<Object> objects(count);
+        unsigned int side = (unsigned int)std::ceil(std::sqrt((double)count));
+        size_t vertexBytes = 0, indexBytes = 0;
+        for (unsigned int i = 0; i < count; i++)
+        {
+            objects[i].mesh = makeSphere(4 + i % 8, i % 4 == 0 ? 0 : i);
+            glm::vec3 position((float)(i % side), (float)(i / side), 0.0f);
+            position = (position - glm::vec3((side - 1) * 0.5f, (side - 1) * 0.5f, 0.0f)) * 2.5f;
+            objects[i].model = glm::translate(glm::mat4(1.0f), position);
+            objects[i].normalMatrix = glm::mat3(1.0f);
+            vertexBytes += objects[i].mesh.Vertices.size() * sizeof(float);
+            indexBytes += objects[i].mesh.Indices.size() * sizeof(uint16_t);
+        }
+
+        RenderTarget target(WIDTH, HEIGHT);
+        glEnable(GL_DEPTH_TEST);
+        ShaderVariantCache variants;
+        Shader& shader = variants.get({ shaderDir + "/basic_lighting_vertex_shader.txt", shaderDir + "/basic_lighting_fragment_shader.txt", {} });
+        FrameUniformBuffer frameUniformBuffer;
+        float extent = side * 1.25f;
+        FrameData frameData;
+        frameData.projection = glm::perspective(glm::radians(45.0f), (float)WIDTH / (float)HEIGHT, 0.1f, extent * 8.0f);
+        frameData.view = glm::lookAt(glm::vec3(0.0f, 0.0f, extent * 2.5f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+        frameData.lightPos = glm::vec4(extent, extent, extent * 2.0f, 1.0f);
+        frameData.viewPos = glm::vec4(0.0f, 0.0f, extent * 2.5f, 1.0f);
+        frameData.lightColor = glm::vec4(1.0f);
+        frameUniformBuffer.update(frameData);
+
+        std::cout << "Renderer: " << glGetString(GL_RENDERER) << std::endl;
+        std::printf("%u meshes, %zu vertex bytes, %zu index bytes, %ux%u target, %d frames\n", count, vertexBytes, indexBytes, WIDTH, HEIGHT, frames);
+
+        // A buffer pair and a vertex array per mesh.
+        std::map<std::pair<unsigned int, unsigned int>, unsigned int> pageArrays;
+        auto start = std::chrono::steady_clock::now();
+        for (Object& object : objects)
+        {
+            object.mesh.upload();
+            object.vertexArray = object.mesh.createVertexArray(MeshImporter::vertexAttributes());
+        }
+        glFinish();
+        double separateUploadMs = elapsedMs(start);
+        unsigned long separateBinds = 0;
+        double separateMs = renderFrames(objects, shader, false, pageArrays, target, frames, separateBinds);
+        std::vector<unsigned char> reference, pixels;
+        target.readPixels(reference);
+
+        // Every other mesh released, still drawn from its own buffers, as the reference for the compacted arena.
+        for (unsigned int i = 0; i < count; i += 2)
+        {
+            objects[i].alive = false;
+        }
+        unsigned long halfBinds = 0;
+        renderFrames(objects, shader, false, pageArrays, target, 1, halfBinds);
+        std::vector<unsigned char> halfReference;
+        target.readPixels(halfReference);
+        for (Object& object : objects)
+        {
+            glDeleteVertexArrays(1, &object.vertexArray);
+            object.vertexArray = 0;
+            object.mesh.release();
+            object.alive = true;
+        }
+        glStateCache().bindVertexArray(0);
+
+        // Shared pages, one vertex array per page pair and a base vertex per draw.
+        BufferArena vertexBuffers(pageBytes), indexBuffers(pageBytes);
+        start = std::chrono::steady_clock::now();
+        for (Object& object : objects)
+        {
+            object.mesh.upload(vertexBuffers, indexBuffers);
+        }
+        glFinish();
+        double arenaUploadMs = elapsedMs(start);
+        unsigned long arenaBinds = 0;
+        double arenaMs = renderFrames(objects, shader, true, pageArrays, target, frames, arenaBinds);
+        target.readPixels(pixels);
+        BufferArenaStats vertexStats = vertexBuffers.stats(), indexStats = indexBuffers.stats();
+
+        std::printf("  separate buffers  %5u buffers  %5u vertex arrays  upload %8.2f ms  %8.3f ms/frame  %6lu binds/frame\n", 2 * count, count, separateUploadMs, separateMs, separateBinds);
+        std::printf("  buffer arena      %5zu buffers  %5zu vertex arrays  upload %8.2f ms  %8.3f ms/frame  %6lu binds/frame  pixel error max %d\n",
+            vertexStats.pages + indexStats.pages, pageArrays.size(), arenaUploadMs, arenaMs, arenaBinds, maxDifference(pixels, reference));
+        vertexStats.print(std::cout, "  Vertex buffers");
+        indexStats.print(std::cout, "  Index buffers");
+
+        for (unsigned int i = 0; i < count; i += 2)
+        {
+            objects[i].mesh.release();
+            objects[i].alive = false;
+        }
+        vertexBuffers.stats().print(std::cout, "  Vertex buffers, half released");
+        indexBuffers.stats().print(std::cout, "  Index buffers, half released");
+
+        // Ranges only move within their page, so the page vertex arrays stay valid.
+        start = std::chrono::steady_clock::now();
+        size_t moved = vertexBuffers.compact() + indexBuffers.compact();
+        glFinish();
+        double compactMs = elapsedMs(start);
+        vertexBuffers.stats().print(std::cout, "  Vertex buffers, compacted");
+        indexBuffers.stats().print(std::cout, "  Index buffers, compacted");
+        unsigned long compactBinds = 0;
+        double compactFrameMs = renderFrames(objects, shader, true, pageArrays, target, frames, compactBinds);
+        target.readPixels(pixels);
+        std::printf("  compact moved %zu bytes in %.2f ms; half the meshes draw in %.3f ms/frame with %lu binds, pixel error max %d\n", moved, compactMs,
+            compactFrameMs, compactBinds, maxDifference(pixels, halfReference));
+
+        deleteArrays(pageArrays);
+        for (Object& object : objects)
+        {
+            if (object.alive)
+            {
+                object.mesh.release();
+            }
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,199 @@
+/*
+ * Benchmark for streaming per-frame transforms: a grid of spinning cubes whose model and normal matrices are all
+ * rewritten every frame. Compares one glUniformMatrix call pair per cube with InstanceBuffer streaming through a
+ * FrameRingBuffer, once with buffer orphaning and once persistently mapped with fences, where the transforms are
+ * computed straight into GL memory. Frames are not finished one by one, so the CPU runs ahead of the GPU as in a real
+ * loop and the ring's stalls show how often it had to wait. Every image is checked against the first path's.
+ *
+ * Usage: dynamic_upload_bench [shader directory] [cubes] [frames] [frames in flight]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#define GLEW_STATIC 1
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "bench_context.h"
+#include "render_target.h"
+#include "shader.h"
+#include "shader_variants.h"
+#include "frame_data.h"
+#include "instancing.h"
+#include "cube.h"
+
+constexpr UniformName U_OBJECT_COLOR("objectColor");
+constexpr UniformName U_MODEL("model");
+constexpr UniformName U_NORMAL_MATRIX("normalMatrix");
+
+const unsigned int WIDTH = 480;
+const unsigned int HEIGHT = 270;
+
+// Largest grid still drawn with a uniform update per cube.
+const unsigned int MAX_UNIFORM_CUBES = 20000;
+
+static double elapsedMs(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Transform of cube i at the given frame: a fixed place on a square grid, spinning about its own axis.
+static InstanceData cubeInstance(unsigned int i, unsigned int side, int frame)
+{
+    glm::vec3 position((float)(i % side), (float)(i / side), 0.0f);
+    position = (position - glm::vec3((side - 1) * 0.5f, (side - 1) * 0.5f, 0.0f)) * 1.5f;
+    glm::mat4 model = glm::translate(glm::mat4(1.0f), position);
+    model = glm::rotate(model, frame * 0.05f + i * 0.37f, glm::vec3(0.3f, 1.0f, 0.5f));
+    return makeInstance(glm::scale(model, glm::vec3(0.5f)));
+}
+
+int main(int argc, char* argv[])
+{
+    std::string shaderDir = argc > 1 ? argv[1] : "shaders";
+    unsigned int count = argc > 2 ? (unsigned int)std::max(1, atoi(argv[2])) : 50000;
+    int frames = argc > 3 ? std::max(1, atoi(argv[3])) : 30;
+    unsigned int framesInFlight = argc > 4 ? (unsigned int)std::max(1, atoi(argv[4])) : 3;
+
+    BenchContext context("dynamic_upload_bench", WIDTH, HEIGHT);
+    if (!context.isValid())
+    {
+        return -1;
+    }
+
+    {
+        RenderTarget target(WIDTH, HEIGHT);
+        glEnable(GL_DEPTH_TEST);
+        std::string vertexPath = shaderDir + "/basic_lighting_vertex_shader.txt";
+        std::string fragmentPath = shaderDir + "/basic_lighting_fragment_shader.txt";
+        ShaderVariantCache variants;
+        Shader& instancedShader = variants.get({ vertexPath, fragmentPath, { "INSTANCED" } });
+        Shader& singleShader = variants.get({ vertexPath, fragmentPath, {} });
+
+        // Cube vertex buffer shared by both vertex arrays.
+        unsigned int vertexBuffer;
+        unsigned int arrays[] = { 0, 0 };
+        glGenBuffers(1, &vertexBuffer);
+        glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(CUBE_VERTICES), CUBE_VERTICES, GL_STATIC_DRAW);
+        glGenVertexArrays(2, arrays);
+        for (unsigned int vertexArray : arrays)
+        {
+            glStateCache().bindVertexArray(vertexArray);
+            glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+            glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
+            glEnableVertexAttribArray(0);
+            glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float)));
+            glEnableVertexAttribArray(1);
+        }
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        glStateCache().bindVertexArray(0);
+
+        unsigned int side = (unsigned int)std::ceil(std::sqrt((double)count));
+        float extent = side * 0.75f + 1.0f;
+        FrameUniformBuffer frameUniformBuffer;
+        FrameData frameData;
+        frameData.projection = glm::perspective(glm::radians(45.0f), (float)WIDTH / (float)HEIGHT, 0.1f, extent * 8.0f);
+        frameData.view = glm::lookAt(glm::vec3(0.0f, 0.0f, extent * 2.5f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+        frameData.lightPos = glm::vec4(extent, extent, extent * 2.0f, 1.0f);
+        frameData.viewPos = glm::vec4(0.0f, 0.0f, extent * 2.5f, 1.0f);
+        frameData.lightColor = glm::vec4(1.0f);
+        frameUniformBuffer.update(frameData);
+
+        std::cout << "Renderer: " << glGetString(GL_RENDERER) << std::endl;
+        std::printf("%u cubes, %.1f MB of transforms per frame, %ux%u target, %d frames, %u frames in flight\n", count, count * sizeof(InstanceData) / 1048576.0,
+            WIDTH, HEIGHT, frames, framesInFlight);
+
+        std::vector<unsigned char> reference, pixels;
+        auto report = [&](const char* name, double writeMs, double totalMs, unsigned long stalls)
+        {
+            target.readPixels(pixels);
+            if (reference.empty())
+            {
+                reference = pixels;
+            }
+            int maxDifference = 0;
+            for (size_t i = 0; i < pixels.size(); i++)
+            {
+                maxDifference = std::max(maxDifference, std::abs((int)pixels[i] - (int)reference[i]));
+            }
+            std::printf("  %-20s  write %8.3f ms/frame  total %8.3f ms/frame  %4lu stalls  pixel error max %d\n", name, writeMs / frames, totalMs / frames, stalls, maxDifference);
+        };
+
+        // One model and normal matrix upload per cube.
+        if (count <= MAX_UNIFORM_CUBES)
+        {
+            singleShader.use();
+            singleShader.setVec3(U_OBJECT_COLOR, 1.0f, 0.5f, 0.31f);
+            glStateCache().bindVertexArray(arrays[1]);
+            glFinish();
+            double writeMs = 0.0;
+            auto start = std::chrono::steady_clock::now();
+            for (int frame = 0; frame < frames; frame++)
+            {
+                target.bind();
+                glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
+                glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+                auto writeStart = std::chrono::steady_clock::now();
+                for (unsigned int i = 0; i < count; i++)
+                {
+                    InstanceData instance = cubeInstance(i, side, frame);
+                    singleShader.setMat4(U_MODEL, instance.model);
+                    singleShader.setMat3(U_NORMAL_MATRIX, instance.normalMatrix);
+                    glDrawArrays(GL_TRIANGLES, 0, CUBE_VERTEX_COUNT);
+                }
+                writeMs += elapsedMs(writeStart);
+            }
+            glFinish();
+            report("uniforms per draw", writeMs, elapsedMs(start), 0);
+        }
+
+        // The same frames through the instance ring, orphaned and then persistently mapped.
+        for (bool persistent : { false, true })
+        {
+            InstanceBuffer instances(framesInFlight, persistent);
+            instances.attach(arrays[0]);
+            instancedShader.use();
+            instancedShader.setVec3(U_OBJECT_COLOR, 1.0f, 0.5f, 0.31f);
+            glFinish();
+            double writeMs = 0.0;
+            auto start = std::chrono::steady_clock::now();
+            for (int frame = 0; frame < frames; frame++)
+            {
+                target.bind();
+                glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
+                glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+                auto writeStart = std::chrono::steady_clock::now();
+                InstanceData* memory = instances.map(count);
+                for (unsigned int i = 0; memory && i < count; i++)
+                {
+                    memory[i] = cubeInstance(i, side, frame);
+                }
+                instances.unmap();
+                writeMs += elapsedMs(writeStart);
+                glStateCache().bindVertexArray(arrays[0]);
+                glDrawArraysInstanced(GL_TRIANGLES, 0, CUBE_VERTEX_COUNT, instances.Count);
+            }
+            glFinish();
+            bool mapped = instances.buffer().isPersistent();
+            if (persistent && !mapped)
+            {
+                std::cout << "  ARB_buffer_storage is not supported; the ring falls back to orphaning." << std::endl;
+            }
+            report(mapped ? "persistent ring" : "orphaned buffer", writeMs, elapsedMs(start), instances.buffer().Stalls);
+        }
+
+        glStateCache().bindVertexArray(0);
+        glDeleteVertexArrays(2, arrays);
+        glDeleteBuffers(1, &vertexBuffer);
+    }
+
+    return 0;
+}
@@ -0,0 +1,185 @@
+/*
+ * Benchmark scene for the instanced lighting path: a grid of lit cubes scaled from 1 to 1M instances,
+ * drawn with one glDrawArraysInstanced call, next to one glDrawArrays call per cube for smaller counts.
+ *
+ * Usage: instancing_bench [shader directory] [frames per step]
+ */
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#define GLEW_STATIC 1
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "bench_context.h"
+#include "shader.h"
+#include "shader_variants.h"
+#include "frame_data.h"
+#include "instancing.h"
+#include "cube.h"
+
+constexpr UniformName U_OBJECT_COLOR("objectColor");
+constexpr UniformName U_MODEL("model");
+constexpr UniformName U_NORMAL_MATRIX("normalMatrix");
+
+const int WIDTH = 960;
+const int HEIGHT = 540;
+
+// Place count cubes on a cube-shaped grid centered on the origin.
+static std::vector<InstanceData> makeGrid(unsigned int count)
+{
+    std::vector<InstanceData> instances(count);
+    unsigned int side = (unsigned int)std::ceil(std::cbrt((double)count));
+    for (unsigned int i = 0; i < count; i++)
+    {
+        glm::vec3 position((float)(i % side), (float)((i / side) % side), (float)(i / (side * side)));
+        position = (position - glm::vec3(side * 0.5f)) * 1.5f;
+        instances[i] = makeInstance(glm::scale(glm::translate(glm::mat4(1.0f), position), glm::vec3(0.5f)));
+    }
+    return instances;
+}
+
+static double frameMs(chrono::steady_clock::time_point start, int frames)
+{
+    return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count() / frames;
+}
+
+int main(int argc, char* argv[])
+{
+    string shaderDir = argc > 1 ? argv[1] : "shaders";
+    int frames = argc > 2 ? atoi(argv[2]) : 20;
+
+    BenchContext context("instancing_bench", WIDTH, HEIGHT);
+    if (!context.isValid())
+    {
+        return -1;
+    }
+
+    {
+        // Render into an offscreen framebuffer so hidden-window pixel ownership does not skip fragment work.
+        unsigned int framebuffer, colorBuffer, depthBuffer;
+        glGenFramebuffers(1, &framebuffer);
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        glGenRenderbuffers(1, &colorBuffer);
+        glBindRenderbuffer(GL_RENDERBUFFER, colorBuffer);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, WIDTH, HEIGHT);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorBuffer);
+        glGenRenderbuffers(1, &depthBuffer);
+        glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, WIDTH, HEIGHT);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+        glViewport(0, 0, WIDTH, HEIGHT);
+        glEnable(GL_DEPTH_TEST);
+
+        string vertexPath = shaderDir + "/basic_lighting_vertex_shader.txt";
+        string fragmentPath = shaderDir + "/basic_lighting_fragment_shader.txt";
+        ShaderVariantCache variants;
+        Shader& instancedShader = variants.get({ vertexPath, fragmentPath, { "INSTANCED" } });
+        Shader& singleShader = variants.get({ vertexPath, fragmentPath, {} });
+
+        // Cube vertex buffer shared by both vertex arrays.
+        unsigned int vertexBuffer, instancedArray, singleArray;
+        glGenBuffers(1, &vertexBuffer);
+        glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(CUBE_VERTICES), CUBE_VERTICES, GL_STATIC_DRAW);
+        unsigned int arrays[] = { 0, 0 };
+        glGenVertexArrays(2, arrays);
+        instancedArray = arrays[0];
+        singleArray = arrays[1];
+        for (unsigned int vertexArray : arrays)
+        {
+            glStateCache().bindVertexArray(vertexArray);
+            glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+            glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
+            glEnableVertexAttribArray(0);
+            glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float)));
+            glEnableVertexAttribArray(1);
+        }
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        glStateCache().bindVertexArray(0);
+
+        InstanceBuffer instanceBuffer;
+        instanceBuffer.attach(instancedArray);
+
+        FrameUniformBuffer frameUniformBuffer;
+
+        cout << "renderer: " << glGetString(GL_RENDERER) << endl;
+        cout << "instances   instanced ms/frame   instances/s     per-draw ms/frame" << endl;
+        for (unsigned int count = 1; count <= 1000000; count *= 10)
+        {
+            std::vector<InstanceData> instances = makeGrid(count);
+            instanceBuffer.upload(instances);
+
+            // Pull the camera back far enough to keep the whole grid in view.
+            float extent = std::cbrt((float)count) * 1.5f + 2.0f;
+            FrameData frameData;
+            frameData.projection = glm::perspective(glm::radians(45.0f), (float)WIDTH / (float)HEIGHT, 0.1f, extent * 4.0f);
+            frameData.view = glm::lookAt(glm::vec3(extent, extent, extent * 1.5f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+            frameData.lightPos = glm::vec4(extent, extent * 2.0f, extent, 1.0f);
+            frameData.viewPos = glm::vec4(extent, extent, extent * 1.5f, 1.0f);
+            frameData.lightColor = glm::vec4(1.0f);
+            frameUniformBuffer.update(frameData);
+
+            // One instanced draw for the whole grid.
+            instancedShader.use();
+            instancedShader.setVec3(U_OBJECT_COLOR, 1.0f, 0.5f, 0.31f);
+            glStateCache().bindVertexArray(instancedArray);
+            glFinish();
+            auto start = chrono::steady_clock::now();
+            for (int frame = 0; frame < frames; frame++)
+            {
+                glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+                glDrawArraysInstanced(GL_TRIANGLES, 0, CUBE_VERTEX_COUNT, instanceBuffer.Count);
+                glFinish();
+            }
+            double instancedMs = frameMs(start, frames);
+
+            // One draw per cube, only up to the point where it is clearly hopeless.
+            double singleMs = -1.0;
+            if (count <= 10000)
+            {
+                singleShader.use();
+                singleShader.setVec3(U_OBJECT_COLOR, 1.0f, 0.5f, 0.31f);
+                glStateCache().bindVertexArray(singleArray);
+                glFinish();
+                start = chrono::steady_clock::now();
+                for (int frame = 0; frame < frames; frame++)
+                {
+                    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+                    for (const InstanceData& instance : instances)
+                    {
+                        singleShader.setMat4(U_MODEL, instance.model);
+                        singleShader.setMat3(U_NORMAL_MATRIX, instance.normalMatrix);
+                        glDrawArrays(GL_TRIANGLES, 0, CUBE_VERTEX_COUNT);
+                    }
+                    glFinish();
+                }
+                singleMs = frameMs(start, frames);
+            }
+
+            cout << count << "\t    " << instancedMs << "\t\t " << (count / instancedMs * 1000.0) << "\t ";
+            if (singleMs >= 0.0)
+            {
+                cout << singleMs;
+            }
+            else
+            {
+                cout << "-";
+            }
+            cout << endl;
+        }
+
+        glDeleteVertexArrays(2, arrays);
+        glDeleteBuffers(1, &vertexBuffer);
+        glDeleteRenderbuffers(1, &colorBuffer);
+        glDeleteRenderbuffers(1, &depthBuffer);
+        glDeleteFramebuffers(1, &framebuffer);
+    }
+
+    return 0;
+}
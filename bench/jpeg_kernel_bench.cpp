@@ -0,0 +1,340 @@
+/*
+ * Checks and times the JPEG decoder's kernels in stb_image: the IDCT, YCbCr-to-RGB conversion and the 2x chroma
+ * upsamplers, in their scalar, SSE2 and AVX2 versions. Each kernel first runs on random input and must match the scalar
+ * version byte for byte; then its throughput is reported. Last, whole files are decoded with stbi_set_jpeg_avx2 off and
+ * on, which must give identical pixels.
+ *
+ * Usage: jpeg_kernel_bench [runs] [file.jpg...]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+typedef void (*IDCTKernel)(stbi_uc* out, int outStride, short data[64]);
+typedef void (*ColorKernel)(stbi_uc* out, const stbi_uc* y, const stbi_uc* cb, const stbi_uc* cr, int count, int step);
+typedef stbi_uc* (*ResampleKernel)(stbi_uc* out, stbi_uc* nearRow, stbi_uc* farRow, int width, int hs);
+
+// Image rows are this wide, like a 1920 pixel wide 4:2:0 JPEG, plus some width that is not a multiple of the vectors.
+static const int ROW_WIDTH = 1920 + 13;
+static const int BLOCKS = 4096;
+
+static bool avx2 = false;
+static bool failed = false;
+
+static double elapsedMs(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Best time of several runs of repeat calls of f.
+template <typename F>
+static double bestMs(int runs, int repeat, F f)
+{
+    double best = 1e30;
+    for (int run = 0; run < runs; run++)
+    {
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < repeat; i++)
+        {
+            f();
+        }
+        best = std::min(best, elapsedMs(start));
+    }
+    return best;
+}
+
+static void check(const char* kernel, const std::vector<unsigned char>& reference, const std::vector<unsigned char>& result)
+{
+    size_t mismatches = 0;
+    for (size_t i = 0; i < reference.size(); i++)
+    {
+        mismatches += reference[i] != result[i];
+    }
+    if (mismatches)
+    {
+        std::printf("  %-28s MISMATCH: %zu of %zu bytes differ from the scalar kernel\n", kernel, mismatches, reference.size());
+        failed = true;
+    }
+}
+
+static void report(const char* kernel, double ms, double megapixels, double baselineMs)
+{
+    std::printf("  %-28s %8.3f ms  %9.1f Mpixels/s  %5.2fx\n", kernel, ms, megapixels * 1000.0 / ms, baselineMs / ms);
+}
+
+// Dequantized coefficients as a JPEG holds them: a DC term and AC terms that shrink and thin out with frequency.
+static void randomBlocks(std::mt19937& random, std::vector<short>& coefficients)
+{
+    coefficients.assign(BLOCKS * 64, 0);
+    for (int block = 0; block < BLOCKS; block++)
+    {
+        short* data = coefficients.data() + block * 64;
+        data[0] = (short)((int)(random() % 2048) - 1024);
+        for (int k = 1; k < 64; k++)
+        {
+            int range = 1024 >> (k / 10);
+            if (random() % 64 < (unsigned int)(64 - k))
+            {
+                data[k] = (short)((int)(random() % (2 * range)) - range);
+            }
+        }
+    }
+}
+
+static void benchIDCT(int runs)
+{
+    std::mt19937 random(1);
+    std::vector<short> coefficients;
+    randomBlocks(random, coefficients);
+    // Blocks side by side in rows of 8 pixels, as the decoder writes them.
+    int stride = BLOCKS * 8;
+    std::vector<unsigned char> reference(stride * 8);
+    std::vector<unsigned char> result(stride * 8);
+    STBI_SIMD_ALIGN(short, block[64]);
+
+    auto runSingle = [&](IDCTKernel kernel, std::vector<unsigned char>& out)
+    {
+        for (int i = 0; i < BLOCKS; i++)
+        {
+            // The kernels may use aligned loads, which the decoder's block buffers allow.
+            memcpy(block, coefficients.data() + i * 64, sizeof(block));
+            kernel(out.data() + i * 8, stride, block);
+        }
+    };
+
+    double megapixels = BLOCKS * 64 / 1e6;
+    runSingle(stbi__idct_block, reference);
+    double scalarMs = bestMs(runs, 10, [&]() { runSingle(stbi__idct_block, reference); });
+    std::printf("IDCT, %d blocks\n", BLOCKS);
+    report("scalar", scalarMs, megapixels * 10, scalarMs);
+#ifdef STBI_SSE2
+    runSingle(stbi__idct_simd, result);
+    check("sse2", reference, result);
+    report("sse2", bestMs(runs, 10, [&]() { runSingle(stbi__idct_simd, result); }), megapixels * 10, scalarMs);
+#endif
+#ifdef STBI_AVX2
+    if (avx2)
+    {
+        auto runPairs = [&]()
+        {
+            for (int i = 0; i < BLOCKS; i += 2)
+            {
+                stbi__idct_avx2(result.data() + i * 8, stride, coefficients.data() + i * 64, result.data() + i * 8 + 8, stride, coefficients.data() + i * 64 + 64);
+            }
+        };
+        std::fill(result.begin(), result.end(), 0);
+        runPairs();
+        check("avx2, two blocks per call", reference, result);
+        report("avx2, two blocks per call", bestMs(runs, 10, runPairs), megapixels * 10, scalarMs);
+    }
+#endif
+}
+
+static void benchColor(int runs, int step)
+{
+    std::mt19937 random(2);
+    std::vector<unsigned char> y(ROW_WIDTH), cb(ROW_WIDTH), cr(ROW_WIDTH);
+    for (int i = 0; i < ROW_WIDTH; i++)
+    {
+        y[i] = (unsigned char)random();
+        cb[i] = (unsigned char)random();
+        cr[i] = (unsigned char)random();
+    }
+    // The kernels also write the alpha byte after the last pixel when step is 3.
+    std::vector<unsigned char> reference(ROW_WIDTH * step + 1);
+    std::vector<unsigned char> result(ROW_WIDTH * step + 1);
+    int rows = 1080;
+
+    auto run = [&](ColorKernel kernel, std::vector<unsigned char>& out)
+    {
+        return bestMs(runs, rows, [&]() { kernel(out.data(), y.data(), cb.data(), cr.data(), ROW_WIDTH, step); });
+    };
+
+    double megapixels = (double)ROW_WIDTH * rows / 1e6;
+    stbi__YCbCr_to_RGB_row(reference.data(), y.data(), cb.data(), cr.data(), ROW_WIDTH, step);
+    double scalarMs = run(stbi__YCbCr_to_RGB_row, reference);
+    std::printf("YCbCr to RGB, %d channels, %d rows of %d pixels\n", step, rows, ROW_WIDTH);
+    report("scalar", scalarMs, megapixels, scalarMs);
+#ifdef STBI_SSE2
+    stbi__YCbCr_to_RGB_simd(result.data(), y.data(), cb.data(), cr.data(), ROW_WIDTH, step);
+    check("sse2", reference, result);
+    report(step == 4 ? "sse2" : "sse2 (scalar for 3 channels)", run(stbi__YCbCr_to_RGB_simd, result), megapixels, scalarMs);
+#endif
+#ifdef STBI_AVX2
+    if (avx2)
+    {
+        std::fill(result.begin(), result.end(), 0);
+        stbi__YCbCr_to_RGB_avx2(result.data(), y.data(), cb.data(), cr.data(), ROW_WIDTH, step);
+        check("avx2", reference, result);
+        report("avx2", run(stbi__YCbCr_to_RGB_avx2, result), megapixels, scalarMs);
+    }
+#endif
+}
+
+static void benchResample(int runs, const char* name, int outputScale, ResampleKernel scalar, ResampleKernel sse2, ResampleKernel avx)
+{
+    std::mt19937 random(3);
+    int rows = 540;
+    std::vector<unsigned char> nearRow(ROW_WIDTH), farRow(ROW_WIDTH);
+    for (int i = 0; i < ROW_WIDTH; i++)
+    {
+        nearRow[i] = (unsigned char)random();
+        farRow[i] = (unsigned char)random();
+    }
+    std::vector<unsigned char> reference(ROW_WIDTH * outputScale);
+    std::vector<unsigned char> result(ROW_WIDTH * outputScale);
+
+    // Every input width up to 64 pixels, for the vector tails and the edge pixels, then the long row.
+    auto verify = [&](const char* kernel, ResampleKernel resample)
+    {
+        for (int width = 1; width <= ROW_WIDTH; width = width < 64 ? width + 1 : ROW_WIDTH + 1)
+        {
+            std::fill(reference.begin(), reference.end(), 0);
+            std::fill(result.begin(), result.end(), 0);
+            memcpy(reference.data(), scalar(reference.data(), nearRow.data(), farRow.data(), width, 2), width * outputScale);
+            memcpy(result.data(), resample(result.data(), nearRow.data(), farRow.data(), width, 2), width * outputScale);
+            check(kernel, reference, result);
+        }
+    };
+
+    auto run = [&](ResampleKernel resample)
+    {
+        return bestMs(runs, rows, [&]() { resample(result.data(), nearRow.data(), farRow.data(), ROW_WIDTH, 2); });
+    };
+
+    double megapixels = (double)ROW_WIDTH * outputScale * rows / 1e6;
+    double scalarMs = run(scalar);
+    std::printf("Upsample %s, %d rows of %d pixels\n", name, rows, ROW_WIDTH);
+    report("scalar", scalarMs, megapixels, scalarMs);
+    if (sse2)
+    {
+        verify("sse2", sse2);
+        report("sse2", run(sse2), megapixels, scalarMs);
+    }
+    if (avx)
+    {
+        verify("avx2", avx);
+        report("avx2", run(avx), megapixels, scalarMs);
+    }
+}
+
+static bool readFile(const std::string& path, std::vector<unsigned char>& bytes)
+{
+    FILE* file = std::fopen(path.c_str(), "rb");
+    if (!file)
+    {
+        return false;
+    }
+    unsigned char buffer[65536];
+    for (size_t read; (read = std::fread(buffer, 1, sizeof(buffer), file)) > 0;)
+    {
+        bytes.insert(bytes.end(), buffer, buffer + read);
+    }
+    std::fclose(file);
+    return true;
+}
+
+static void benchFile(const std::string& path, int runs)
+{
+    std::vector<unsigned char> bytes;
+    if (!readFile(path, bytes))
+    {
+        std::printf("%s: cannot open\n", path.c_str());
+        return;
+    }
+    int width, height, channels;
+    if (!stbi_info_from_memory(bytes.data(), (int)bytes.size(), &width, &height, &channels))
+    {
+        std::printf("%s: %s\n", path.c_str(), stbi_failure_reason());
+        return;
+    }
+    std::printf("%s: %dx%d, %d channels\n", path.c_str(), width, height, channels);
+
+    for (int requested : { 0, 4 })
+    {
+        std::vector<unsigned char> pixels[2];
+        double ms[2];
+        for (int useAVX2 = 0; useAVX2 < 2; useAVX2++)
+        {
+            stbi_set_jpeg_avx2(useAVX2);
+            ms[useAVX2] = bestMs(runs, 1, [&]()
+            {
+                unsigned char* decoded = stbi_load_from_memory(bytes.data(), (int)bytes.size(), &width, &height, &channels, requested);
+                if (decoded)
+                {
+                    pixels[useAVX2].assign(decoded, decoded + (size_t)width * height * (requested ? requested : channels));
+                    stbi_image_free(decoded);
+                }
+            });
+        }
+        stbi_set_jpeg_avx2(1);
+        bool same = !pixels[0].empty() && pixels[0] == pixels[1];
+        failed |= !same;
+        std::printf("  %d channels  sse2 %8.2f ms   avx2 %8.2f ms   %5.2fx   %s\n", requested ? requested : channels, ms[0], ms[1], ms[0] / ms[1], same ? "identical" : "DIFFERENT");
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    int runs = argc > 1 ? std::max(1, atoi(argv[1])) : 5;
+    std::vector<std::string> paths;
+    for (int i = 2; i < argc; i++)
+    {
+        paths.push_back(argv[i]);
+    }
+    if (paths.empty())
+    {
+        paths.push_back("../textures/wall.jpg");
+    }
+
+#ifdef STBI_AVX2
+    avx2 = stbi__avx2_available() != 0;
+#endif
+    if (!avx2)
+    {
+        std::printf("AVX2 kernels are not available on this build or CPU, timing the others only\n");
+    }
+
+    benchIDCT(runs);
+    benchColor(runs, 4);
+    benchColor(runs, 3);
+    ResampleKernel hv2SSE2 = NULL;
+    ResampleKernel hv2AVX2 = NULL;
+    ResampleKernel h2AVX2 = NULL;
+    ResampleKernel v2AVX2 = NULL;
+#ifdef STBI_SSE2
+    hv2SSE2 = stbi__resample_row_hv_2_simd;
+#endif
+#ifdef STBI_AVX2
+    if (avx2)
+    {
+        hv2AVX2 = stbi__resample_row_hv_2_avx2;
+        h2AVX2 = stbi__resample_row_h_2_avx2;
+        v2AVX2 = stbi__resample_row_v_2_avx2;
+    }
+#endif
+    benchResample(runs, "2x2 (4:2:0)", 2, stbi__resample_row_hv_2, hv2SSE2, hv2AVX2);
+    benchResample(runs, "2x1 (4:2:2)", 2, stbi__resample_row_h_2, NULL, h2AVX2);
+    benchResample(runs, "1x2 (4:4:0)", 1, stbi__resample_row_v_2, NULL, v2AVX2);
+
+    for (const std::string& path : paths)
+    {
+        benchFile(path, runs);
+    }
+
+    if (failed)
+    {
+        std::printf("Kernels do not match\n");
+        return 1;
+    }
+    return 0;
+}
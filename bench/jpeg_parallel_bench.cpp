@@ -0,0 +1,138 @@
+/*
+ * Measures how much restart-interval parallel decoding (stbi_set_jpeg_parallel) cuts the latency of decoding one large
+ * JPEG. Each file is decoded from memory serially and then on 1, 2, 4, ... threads up to the core count, or up to max
+ * threads, and every result must match the serial pixels. Only baseline files with restart markers are split; others
+ * are reported as decoding serially.
+ *
+ * Usage: jpeg_parallel_bench [runs] [max threads] [file.jpg...]
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "stb_image.h"
+#include "parallel_for.h"
+
+struct Runner
+{
+    unsigned int threads;
+    std::atomic<int> tasks;
+};
+
+// parallelForCallback, counting the tasks so files without restart markers can be told apart.
+static void runTasks(void* user, int count, void (*task)(void* arg, int index), void* arg)
+{
+    Runner* runner = (Runner*)user;
+    runner->tasks += count;
+    parallelForCallback(&runner->threads, count, task, arg);
+}
+
+static double elapsedMs(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Best time of several decodes, keeping the pixels of the last one.
+static double decode(const std::vector<unsigned char>& bytes, int runs, std::vector<unsigned char>& pixels)
+{
+    double best = 1e30;
+    for (int run = 0; run < runs; run++)
+    {
+        int width, height, channels;
+        auto start = std::chrono::steady_clock::now();
+        unsigned char* decoded = stbi_load_from_memory(bytes.data(), (int)bytes.size(), &width, &height, &channels, 0);
+        best = std::min(best, elapsedMs(start));
+        if (!decoded)
+        {
+            pixels.clear();
+            return best;
+        }
+        pixels.assign(decoded, decoded + (size_t)width * height * channels);
+        stbi_image_free(decoded);
+    }
+    return best;
+}
+
+static bool readFile(const std::string& path, std::vector<unsigned char>& bytes)
+{
+    FILE* file = std::fopen(path.c_str(), "rb");
+    if (!file)
+    {
+        return false;
+    }
+    unsigned char buffer[65536];
+    for (size_t read; (read = std::fread(buffer, 1, sizeof(buffer), file)) > 0;)
+    {
+        bytes.insert(bytes.end(), buffer, buffer + read);
+    }
+    std::fclose(file);
+    return true;
+}
+
+int main(int argc, char* argv[])
+{
+    int runs = argc > 1 ? std::max(1, atoi(argv[1])) : 5;
+    unsigned int maxThreads = argc > 2 ? (unsigned int)std::max(1, atoi(argv[2])) : std::max(1u, std::thread::hardware_concurrency());
+    std::vector<std::string> paths;
+    for (int i = 3; i < argc; i++)
+    {
+        paths.push_back(argv[i]);
+    }
+    if (paths.empty())
+    {
+        paths.push_back("../textures/wall.jpg");
+    }
+
+    std::vector<unsigned int> threadCounts;
+    for (unsigned int threads = 1; threads < maxThreads; threads *= 2)
+    {
+        threadCounts.push_back(threads);
+    }
+    threadCounts.push_back(maxThreads);
+
+    bool mismatch = false;
+    for (const std::string& path : paths)
+    {
+        std::vector<unsigned char> bytes;
+        int width, height, channels;
+        if (!readFile(path, bytes) || !stbi_info_from_memory(bytes.data(), (int)bytes.size(), &width, &height, &channels))
+        {
+            std::printf("%s: cannot read\n", path.c_str());
+            continue;
+        }
+        double megapixels = (double)width * height / 1e6;
+
+        std::vector<unsigned char> serial;
+        stbi_set_jpeg_parallel(NULL, NULL);
+        double serialMs = decode(bytes, runs, serial);
+        std::printf("%s: %dx%d, %d channels\n", path.c_str(), width, height, channels);
+        std::printf("  serial      %9.2f ms  %8.1f Mpixels/s\n", serialMs, megapixels * 1000.0 / serialMs);
+
+        for (unsigned int threads : threadCounts)
+        {
+            Runner runner;
+            runner.threads = threads;
+            runner.tasks = 0;
+            stbi_set_jpeg_parallel(runTasks, &runner);
+            std::vector<unsigned char> pixels;
+            double ms = decode(bytes, runs, pixels);
+            stbi_set_jpeg_parallel(NULL, NULL);
+            if (runner.tasks == 0)
+            {
+                std::printf("  no restart intervals to split, decoded serially\n");
+                break;
+            }
+            bool same = pixels == serial;
+            mismatch |= !same;
+            std::printf("  %2u threads  %9.2f ms  %8.1f Mpixels/s  %5.2fx  %d chunks per decode  %s\n", threads, ms, megapixels * 1000.0 / ms,
+                serialMs / ms, runner.tasks / runs, same ? "identical" : "DIFFERENT");
+        }
+    }
+    return mismatch ? 1 : 0;
+}
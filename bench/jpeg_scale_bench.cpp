@@ -0,0 +1,150 @@
+/*
+ * Compares decoding JPEGs at 1/2, 1/4 and 1/8 scale inside stb_image (stbi_set_jpeg_scale_on_load) with decoding at
+ * full size and box-filtering the pixels down. Reports the best of several runs of each, the speedup, and the PSNR
+ * between the two results. Progressive files gain most at 1/8, where their AC scans are skipped.
+ *
+ * Usage: jpeg_scale_bench [runs] [file.jpg...]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "stb_image.h"
+
+struct Image
+{
+    int width;
+    int height;
+    int channels;
+    std::vector<unsigned char> pixels;
+};
+
+static double elapsedMs(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static bool decode(const std::vector<unsigned char>& file, int scale, Image& image)
+{
+    stbi_set_jpeg_scale_on_load_thread(scale);
+    unsigned char* pixels = stbi_load_from_memory(file.data(), (int)file.size(), &image.width, &image.height, &image.channels, 0);
+    stbi_set_jpeg_scale_on_load_thread(1);
+    if (!pixels)
+    {
+        return false;
+    }
+    image.pixels.assign(pixels, pixels + (size_t)image.width * image.height * image.channels);
+    stbi_image_free(pixels);
+    return true;
+}
+
+// Average scale x scale blocks. Blocks on the right and bottom edges average the pixels they have, like the scaled decode.
+static void downsample(const Image& source, int scale, Image& result)
+{
+    result.width = (source.width + scale - 1) / scale;
+    result.height = (source.height + scale - 1) / scale;
+    result.channels = source.channels;
+    result.pixels.resize((size_t)result.width * result.height * result.channels);
+    for (int y = 0; y < result.height; y++)
+    {
+        int y1 = std::min(y * scale + scale, source.height);
+        for (int x = 0; x < result.width; x++)
+        {
+            int x1 = std::min(x * scale + scale, source.width);
+            int count = (y1 - y * scale) * (x1 - x * scale);
+            for (int c = 0; c < source.channels; c++)
+            {
+                int sum = 0;
+                for (int sy = y * scale; sy < y1; sy++)
+                {
+                    for (int sx = x * scale; sx < x1; sx++)
+                    {
+                        sum += source.pixels[((size_t)sy * source.width + sx) * source.channels + c];
+                    }
+                }
+                result.pixels[((size_t)y * result.width + x) * result.channels + c] = (unsigned char)((sum + count / 2) / count);
+            }
+        }
+    }
+}
+
+static double psnr(const Image& a, const Image& b)
+{
+    double error = 0.0;
+    for (size_t i = 0; i < a.pixels.size(); i++)
+    {
+        double difference = (double)a.pixels[i] - b.pixels[i];
+        error += difference * difference;
+    }
+    error /= a.pixels.size();
+    return error == 0.0 ? INFINITY : 10.0 * log10(255.0 * 255.0 / error);
+}
+
+static void run(const std::string& path, int runs)
+{
+    FILE* file = std::fopen(path.c_str(), "rb");
+    if (!file)
+    {
+        std::printf("%s: cannot open\n", path.c_str());
+        return;
+    }
+    std::vector<unsigned char> bytes;
+    unsigned char buffer[65536];
+    for (size_t read; (read = std::fread(buffer, 1, sizeof(buffer), file)) > 0;)
+    {
+        bytes.insert(bytes.end(), buffer, buffer + read);
+    }
+    std::fclose(file);
+
+    Image full;
+    if (!decode(bytes, 1, full))
+    {
+        std::printf("%s: %s\n", path.c_str(), stbi_failure_reason());
+        return;
+    }
+    std::printf("%s: %dx%d, %d channels, %.1f KB\n", path.c_str(), full.width, full.height, full.channels, bytes.size() / 1024.0);
+
+    for (int scale : { 2, 4, 8 })
+    {
+        Image decoded, scaled, reference;
+        double fullMs = INFINITY;
+        double scaledMs = INFINITY;
+        for (int i = 0; i < runs; i++)
+        {
+            auto start = std::chrono::steady_clock::now();
+            decode(bytes, 1, decoded);
+            downsample(decoded, scale, reference);
+            fullMs = std::min(fullMs, elapsedMs(start));
+
+            start = std::chrono::steady_clock::now();
+            decode(bytes, scale, scaled);
+            scaledMs = std::min(scaledMs, elapsedMs(start));
+        }
+        std::printf("  1/%d  %5dx%-5d  full decode + downsample %8.2f ms   scaled decode %8.2f ms   %5.2fx   PSNR %.2f dB\n",
+            scale, scaled.width, scaled.height, fullMs, scaledMs, fullMs / scaledMs, psnr(scaled, reference));
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    int runs = argc > 1 ? std::max(1, atoi(argv[1])) : 5;
+    std::vector<std::string> paths;
+    for (int i = 2; i < argc; i++)
+    {
+        paths.push_back(argv[i]);
+    }
+    if (paths.empty())
+    {
+        paths.push_back("../textures/wall.jpg");
+    }
+    for (const std::string& path : paths)
+    {
+        run(path, runs);
+    }
+    return 0;
+}
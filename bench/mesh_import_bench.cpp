@@ -0,0 +1,262 @@
+/*
+ * Measures MeshImporter throughput in MB/s on OBJ, glTF and GLB files for 1, 2, 4, ... threads up to the core count, or up
+ * to max threads. Every thread count must build the same mesh. OBJ files are also read with a line-by-line std::istream
+ * parser that only collects the numbers, the usual approach the importer replaces. Each mesh is then written as a .mesh
+ * file and loaded back the way the mesh cache does, mapped and copied once as glBufferData would. Without files, a UV
+ * sphere of about 1.2 million triangles is written to the temp directory as .obj, as .gltf with a .bin buffer and as .glb.
+ *
+ * Usage: mesh_import_bench [runs] [max threads] [file.obj|file.gltf|file.glb...]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <GL/glew.h>
+#include "mesh_importer.h"
+#include "mesh_file.h"
+
+static double elapsedMs(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Parse an OBJ with getline and operator>>, keeping every number but building no mesh.
+static size_t readObjWithStreams(const std::string& path)
+{
+    std::ifstream file(path);
+    std::vector<float> values;
+    std::vector<long> indices;
+    std::string line, tag, corner;
+    while (std::getline(file, line))
+    {
+        std::istringstream fields(line);
+        fields >> tag;
+        if (tag == "v" || tag == "vn" || tag == "vt")
+        {
+            float value;
+            while (fields >> value)
+            {
+                values.push_back(value);
+            }
+        }
+        else if (tag == "f")
+        {
+            while (fields >> corner)
+            {
+                std::istringstream parts(corner);
+                std::string part;
+                while (std::getline(parts, part, '/'))
+                {
+                    indices.push_back(part.empty() ? 0 : std::stol(part));
+                }
+            }
+        }
+    }
+    return values.size() + indices.size();
+}
+
+// Write a UV sphere with normals and texture coordinates as sphere.obj, sphere.gltf + sphere.bin and sphere.glb.
+static std::vector<std::string> writeSphere(const std::filesystem::path& directory, unsigned int rings, unsigned int segments)
+{
+    std::vector<float> positions, normals, texcoords;
+    for (unsigned int r = 0; r <= rings; r++)
+    {
+        float theta = (float)r / rings * 3.14159265f;
+        for (unsigned int s = 0; s <= segments; s++)
+        {
+            float phi = (float)s / segments * 6.28318531f;
+            float x = std::sin(theta) * std::cos(phi), y = std::cos(theta), z = std::sin(theta) * std::sin(phi);
+            positions.insert(positions.end(), { x, y, z });
+            normals.insert(normals.end(), { x, y, z });
+            texcoords.insert(texcoords.end(), { (float)s / segments, 1.0f - (float)r / rings });
+        }
+    }
+    std::vector<uint32_t> indices;
+    for (unsigned int r = 0; r < rings; r++)
+    {
+        for (unsigned int s = 0; s < segments; s++)
+        {
+            uint32_t a = r * (segments + 1) + s, b = a + segments + 1;
+            indices.insert(indices.end(), { a, a + 1, b, b, a + 1, b + 1 });
+        }
+    }
+
+    std::vector<std::string> paths;
+    std::string obj;
+    char line[256];
+    size_t vertexCount = positions.size() / 3;
+    for (size_t v = 0; v < vertexCount; v++)
+    {
+        obj.append(line, (size_t)std::snprintf(line, sizeof(line), "v %.6f %.6f %.6f\n", positions[v * 3], positions[v * 3 + 1], positions[v * 3 + 2]));
+        obj.append(line, (size_t)std::snprintf(line, sizeof(line), "vt %.6f %.6f\n", texcoords[v * 2], texcoords[v * 2 + 1]));
+        obj.append(line, (size_t)std::snprintf(line, sizeof(line), "vn %.6f %.6f %.6f\n", normals[v * 3], normals[v * 3 + 1], normals[v * 3 + 2]));
+    }
+    // Quads, so the importer also fans faces into triangles.
+    for (size_t i = 0; i < indices.size(); i += 6)
+    {
+        uint32_t a = indices[i] + 1, b = indices[i + 1] + 1, c = indices[i + 5] + 1, d = indices[i + 2] + 1;
+        obj.append(line, (size_t)std::snprintf(line, sizeof(line), "f %u/%u/%u %u/%u/%u %u/%u/%u %u/%u/%u\n", a, a, a, b, b, b, c, c, c, d, d, d));
+    }
+    paths.push_back((directory / "sphere.obj").string());
+    std::ofstream(paths.back(), std::ios::binary).write(obj.data(), obj.size());
+
+    std::vector<unsigned char> binary;
+    auto append = [&binary](const void* data, size_t size) { binary.insert(binary.end(), (const unsigned char*)data, (const unsigned char*)data + size); };
+    append(positions.data(), positions.size() * sizeof(float));
+    append(normals.data(), normals.size() * sizeof(float));
+    append(texcoords.data(), texcoords.size() * sizeof(float));
+    append(indices.data(), indices.size() * sizeof(uint32_t));
+    size_t normalOffset = positions.size() * sizeof(float), texcoordOffset = normalOffset * 2, indexOffset = texcoordOffset + texcoords.size() * sizeof(float);
+    auto json = [&](const char* uri)
+    {
+        char text[2048];
+        std::snprintf(text, sizeof(text),
+            "{\"asset\":{\"version\":\"2.0\"},\"scene\":0,\"scenes\":[{\"nodes\":[0]}],\"nodes\":[{\"mesh\":0}],"
+            "\"meshes\":[{\"primitives\":[{\"attributes\":{\"POSITION\":0,\"NORMAL\":1,\"TEXCOORD_0\":2},\"indices\":3}]}],"
+            "\"accessors\":[{\"bufferView\":0,\"componentType\":5126,\"count\":%zu,\"type\":\"VEC3\"},{\"bufferView\":1,\"componentType\":5126,\"count\":%zu,\"type\":\"VEC3\"},"
+            "{\"bufferView\":2,\"componentType\":5126,\"count\":%zu,\"type\":\"VEC2\"},{\"bufferView\":3,\"componentType\":5125,\"count\":%zu,\"type\":\"SCALAR\"}],"
+            "\"bufferViews\":[{\"buffer\":0,\"byteOffset\":0,\"byteLength\":%zu},{\"buffer\":0,\"byteOffset\":%zu,\"byteLength\":%zu},"
+            "{\"buffer\":0,\"byteOffset\":%zu,\"byteLength\":%zu},{\"buffer\":0,\"byteOffset\":%zu,\"byteLength\":%zu}],"
+            "\"buffers\":[{%s\"byteLength\":%zu}]}",
+            vertexCount, vertexCount, vertexCount, indices.size(), normalOffset, normalOffset, normalOffset, texcoordOffset, indexOffset - texcoordOffset,
+            indexOffset, indices.size() * sizeof(uint32_t), uri, binary.size());
+        return std::string(text);
+    };
+    paths.push_back((directory / "sphere.gltf").string());
+    std::ofstream((directory / "sphere.bin").string(), std::ios::binary).write((const char*)binary.data(), binary.size());
+    std::string gltf = json("\"uri\":\"sphere.bin\",");
+    std::ofstream(paths.back(), std::ios::binary).write(gltf.data(), gltf.size());
+
+    // GLB: header, JSON chunk padded with spaces, BIN chunk.
+    std::string glbJson = json("");
+    glbJson.resize((glbJson.size() + 3) & ~(size_t)3, ' ');
+    uint32_t header[5] = { 0x46546C67, 2, (uint32_t)(12 + 8 + glbJson.size() + 8 + binary.size()), (uint32_t)glbJson.size(), 0x4E4F534A };
+    uint32_t binaryHeader[2] = { (uint32_t)binary.size(), 0x004E4942 };
+    paths.push_back((directory / "sphere.glb").string());
+    std::ofstream glb(paths.back(), std::ios::binary);
+    glb.write((const char*)header, sizeof(header));
+    glb.write(glbJson.data(), glbJson.size());
+    glb.write((const char*)binaryHeader, sizeof(binaryHeader));
+    glb.write((const char*)binary.data(), binary.size());
+    return paths;
+}
+
+int main(int argc, char* argv[])
+{
+    int runs = argc > 1 ? std::max(1, atoi(argv[1])) : 3;
+    unsigned int maxThreads = argc > 2 ? (unsigned int)std::max(1, atoi(argv[2])) : std::max(1u, std::thread::hardware_concurrency());
+    std::vector<std::string> paths;
+    for (int i = 3; i < argc; i++)
+    {
+        paths.push_back(argv[i]);
+    }
+    if (paths.empty())
+    {
+        std::filesystem::path directory = std::filesystem::temp_directory_path() / "mesh_import_bench";
+        std::filesystem::create_directories(directory);
+        auto start = std::chrono::steady_clock::now();
+        paths = writeSphere(directory, 768, 768);
+        std::printf("Wrote a test sphere to %s in %.0f ms\n", directory.string().c_str(), elapsedMs(start));
+    }
+
+    std::vector<unsigned int> threadCounts;
+    for (unsigned int threads = 1; threads < maxThreads; threads *= 2)
+    {
+        threadCounts.push_back(threads);
+    }
+    threadCounts.push_back(maxThreads);
+
+    std::filesystem::path meshDirectory = std::filesystem::temp_directory_path() / "mesh_import_bench";
+    std::filesystem::create_directories(meshDirectory);
+    bool mismatch = false;
+    for (const std::string& path : paths)
+    {
+        MeshImportOptions options;
+        options.optimize = false;
+        options.threads = 1;
+        Mesh reference;
+        MeshImportStats stats;
+        if (!MeshImporter::import(path, reference, options, &stats))
+        {
+            continue;
+        }
+        std::printf("%s: %.1f MB, %zu vertices, %zu triangles\n", path.c_str(), stats.fileBytes / 1048576.0, stats.vertexCount, stats.triangleCount);
+
+        std::string extension = std::filesystem::path(path).extension().string();
+        if (extension == ".obj" || extension == ".OBJ")
+        {
+            double best = 1e30;
+            for (int run = 0; run < runs; run++)
+            {
+                auto start = std::chrono::steady_clock::now();
+                readObjWithStreams(path);
+                best = std::min(best, elapsedMs(start));
+            }
+            std::printf("  istream     %9.1f ms  %8.1f MB/s  (numbers only, no mesh)\n", best, stats.fileBytes / 1048576.0 * 1000.0 / best);
+        }
+
+        double oneThreadMs = 0.0;
+        for (unsigned int threads : threadCounts)
+        {
+            options.threads = threads;
+            double best = 1e30;
+            Mesh mesh;
+            for (int run = 0; run < runs; run++)
+            {
+                MeshImporter::import(path, mesh, options, &stats);
+                best = std::min(best, stats.importMs);
+            }
+            oneThreadMs = threads == 1 ? best : oneThreadMs;
+            bool same = mesh.Vertices == reference.Vertices && mesh.Indices == reference.Indices;
+            mismatch |= !same;
+            std::printf("  %2u threads  %9.1f ms  %8.1f MB/s  %5.2fx  %s\n", threads, best, stats.fileBytes / 1048576.0 * 1000.0 / best,
+                oneThreadMs > 0.0 ? oneThreadMs / best : 1.0, same ? "identical" : "DIFFERENT");
+        }
+
+        options.optimize = true;
+        options.threads = maxThreads;
+        Mesh optimized;
+        MeshImporter::import(path, optimized, options, &stats);
+        std::printf("  optimize    %9.1f ms  ACMR %.3f -> %.3f\n", stats.optimizeMs, MeshOptimizer::computeACMR(reference.Indices, reference.vertexCount()),
+            MeshOptimizer::computeACMR(optimized.Indices, optimized.vertexCount()));
+
+        // Load the optimized mesh back from a mesh file: map it, check the header and copy the data once, which is all
+        // the CPU work glBufferData does on it.
+        MeshFile cooked;
+        std::string meshPath = (meshDirectory / std::filesystem::path(path).filename()).string() + ".mesh";
+        if (!cooked.assign(optimized, MeshImporter::vertexAttributes()) || !cooked.write(meshPath))
+        {
+            continue;
+        }
+        double best = 1e30;
+        std::vector<unsigned char> vertices, indices;
+        for (int run = 0; run < runs; run++)
+        {
+            auto start = std::chrono::steady_clock::now();
+            MeshFile file;
+            if (!file.open(meshPath))
+            {
+                mismatch = true;
+                break;
+            }
+            vertices.assign(file.vertexData().begin(), file.vertexData().end());
+            indices.assign(file.indexData().begin(), file.indexData().end());
+            best = std::min(best, elapsedMs(start));
+        }
+        bool same = vertices.size() == optimized.Vertices.size() * sizeof(float) && std::memcmp(vertices.data(), optimized.Vertices.data(), vertices.size()) == 0;
+        mismatch |= !same;
+        std::printf("  mesh file   %9.1f ms  %8.1f MB/s  %5.1fx faster than %u threads, %zu bytes  %s\n", best, cooked.bytes().size() / 1048576.0 * 1000.0 / best,
+            (stats.importMs + stats.optimizeMs) / best, maxThreads, cooked.bytes().size(), same ? "identical" : "DIFFERENT");
+    }
+    return mismatch ? 1 : 0;
+}
@@ -0,0 +1,91 @@
+/*
+ * Reports vertex count, memory and ACMR of unindexed meshes before and after welding and vertex cache optimization,
+ * and how long the optimization takes. Runs on the cube and on UV spheres of increasing size, with triangles shuffled
+ * to mimic the poor ordering of many exported meshes.
+ *
+ * Usage: mesh_optimize_bench
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#define GLEW_STATIC 1
+#include <GL/glew.h>
+
+#include "mesh.h"
+#include "cube.h"
+
+using namespace std;
+
+// Unindexed UV sphere with position and normal per vertex, triangles in random order.
+static vector<float> makeSphere(unsigned int rings, unsigned int segments)
+{
+    vector<float> triangles;
+    auto vertex = [&](unsigned int ring, unsigned int segment)
+    {
+        float theta = (float)ring / rings * 3.14159265f;
+        float phi = (float)segment / segments * 6.28318531f;
+        float x = sinf(theta) * cosf(phi), y = cosf(theta), z = sinf(theta) * sinf(phi);
+        float v[6] = { x * 0.5f, y * 0.5f, z * 0.5f, x, y, z };
+        triangles.insert(triangles.end(), v, v + 6);
+    };
+    for (unsigned int r = 0; r < rings; r++)
+    {
+        for (unsigned int s = 0; s < segments; s++)
+        {
+            vertex(r, s); vertex(r + 1, s); vertex(r + 1, s + 1);
+            vertex(r, s); vertex(r + 1, s + 1); vertex(r, s + 1);
+        }
+    }
+
+    // Shuffle whole triangles.
+    size_t triangleFloats = 18;
+    size_t triangleCount = triangles.size() / triangleFloats;
+    vector<size_t> order(triangleCount);
+    for (size_t i = 0; i < triangleCount; i++)
+    {
+        order[i] = i;
+    }
+    shuffle(order.begin(), order.end(), mt19937(42));
+    vector<float> shuffled(triangles.size());
+    for (size_t i = 0; i < triangleCount; i++)
+    {
+        copy(triangles.begin() + order[i] * triangleFloats, triangles.begin() + (order[i] + 1) * triangleFloats, shuffled.begin() + i * triangleFloats);
+    }
+    return shuffled;
+}
+
+static void run(const char* name, const float* data, size_t vertexCount)
+{
+    MeshStats before, after;
+    auto start = chrono::steady_clock::now();
+    Mesh mesh = Mesh::fromTriangles(data, vertexCount, 6, &before, &after);
+    double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+    // ACMR of the welded mesh in its original triangle order, to separate welding from reordering.
+    vector<float> welded;
+    vector<unsigned int> weldedIndices = MeshOptimizer::weld(data, vertexCount, 6, welded);
+    float weldedAcmr = MeshOptimizer::computeACMR(weldedIndices, welded.size() / 6);
+
+    cout << name << " (" << vertexCount / 3 << " triangles, optimized in " << ms << " ms)" << endl;
+    before.print(cout, "  before   ");
+    cout << "  welded    ACMR " << weldedAcmr << " in original order" << endl;
+    after.print(cout, "  after    ");
+    cout << "  memory   " << (double)(after.vertexBytes + after.indexBytes) / (before.vertexBytes + before.indexBytes) * 100.0 << "% of unindexed" << endl;
+}
+
+int main()
+{
+    run("cube", CUBE_VERTICES, CUBE_VERTEX_COUNT);
+    for (unsigned int rings : { 16u, 64u, 256u, 1024u })
+    {
+        vector<float> sphere = makeSphere(rings, rings * 2);
+        string name = "sphere " + to_string(rings) + "x" + to_string(rings * 2);
+        run(name.c_str(), sphere.data(), sphere.size() / 6);
+    }
+    return 0;
+}
@@ -0,0 +1,192 @@
+/*
+ * Benchmark for texture streaming: renders the cube scene while every image in a directory is loaded, and reports
+ * how long frames take while uploads are in flight.
+ *
+ *   sync    stbi_load and glTexImage2D on the render thread, one image per frame (the old Shader texture path)
+ *   client  TextureCache decoding on workers, uploading from client memory on the render thread
+ *   pbo     TextureCache decoding on workers into a ring of mapped pixel unpack buffers
+ *
+ * Files with identical contents are loaded only once by TextureCache, so use distinct images.
+ *
+ * Usage: texture_stream_bench [image directory] [shader directory] [decode threads]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#define GLEW_STATIC 1
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "stb_image.h"
+#include "bench_context.h"
+#include "render_target.h"
+#include "texture_cache.h"
+#include "scene.h"
+
+const unsigned int WIDTH = 960;
+const unsigned int HEIGHT = 540;
+
+struct RunResult
+{
+    std::vector<double> frameMs;
+    double loadMs;
+};
+
+static bool isImage(const std::filesystem::path& path)
+{
+    std::string extension = path.extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+    return extension == ".jpg" || extension == ".jpeg" || extension == ".png" || extension == ".tga" || extension == ".bmp";
+}
+
+static double elapsedMs(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Render one frame and wait for it, so the time includes the GPU work and any upload the driver serialized with it.
+static double renderFrame(Scene& scene, Camera& camera, RenderTarget& target)
+{
+    auto start = std::chrono::steady_clock::now();
+    target.bind();
+    scene.render(camera, (float)WIDTH / (float)HEIGHT);
+    glFinish();
+    return elapsedMs(start);
+}
+
+// Load and upload one image per frame on the render thread.
+static RunResult runSync(const std::vector<std::string>& files, Scene& scene, Camera& camera, RenderTarget& target)
+{
+    RunResult result;
+    std::vector<unsigned int> textures;
+    auto start = std::chrono::steady_clock::now();
+    for (const std::string& file : files)
+    {
+        auto frameStart = std::chrono::steady_clock::now();
+        int width, height, channels;
+        unsigned char* pixels = stbi_load(file.c_str(), &width, &height, &channels, 0);
+        if (pixels)
+        {
+            const GLenum formats[] = { GL_RED, GL_RG, GL_RGB, GL_RGBA };
+            unsigned int texture;
+            glGenTextures(1, &texture);
+            glStateCache().bindTexture(0, texture);
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+            glTexImage2D(GL_TEXTURE_2D, 0, formats[channels - 1], width, height, 0, formats[channels - 1], GL_UNSIGNED_BYTE, pixels);
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+            glGenerateMipmap(GL_TEXTURE_2D);
+            stbi_image_free(pixels);
+            textures.push_back(texture);
+        }
+        renderFrame(scene, camera, target);
+        result.frameMs.push_back(elapsedMs(frameStart));
+    }
+    result.loadMs = elapsedMs(start);
+
+    for (unsigned int texture : textures)
+    {
+        glStateCache().forgetTexture(texture);
+    }
+    glDeleteTextures((GLsizei)textures.size(), textures.data());
+    return result;
+}
+
+// Request every image up front and keep rendering until the cache has uploaded all of them.
+static RunResult runCache(const std::vector<std::string>& files, unsigned int threads, unsigned int streamingSlots, Scene& scene, Camera& camera, RenderTarget& target)
+{
+    RunResult result;
+    TextureCache cache(threads, 8 * 1024 * 1024, streamingSlots);
+    auto start = std::chrono::steady_clock::now();
+    std::vector<const Texture*> textures;
+    for (const std::string& file : files)
+    {
+        textures.push_back(&cache.get(file));
+    }
+
+    bool loading = true;
+    while (loading)
+    {
+        auto frameStart = std::chrono::steady_clock::now();
+        cache.update();
+        renderFrame(scene, camera, target);
+        result.frameMs.push_back(elapsedMs(frameStart));
+        loading = std::any_of(textures.begin(), textures.end(), [](const Texture* texture) { return !texture->Ready && !texture->Failed; });
+    }
+    result.loadMs = elapsedMs(start);
+    return result;
+}
+
+static void report(const char* label, RunResult result)
+{
+    std::vector<double>& ms = result.frameMs;
+    std::sort(ms.begin(), ms.end());
+    double sum = 0.0;
+    for (double value : ms)
+    {
+        sum += value;
+    }
+    std::printf("%-7s all loaded in %8.1f ms over %5zu frames. Frame ms: %7.3f average, %7.3f p95, %7.3f max\n",
+        label, result.loadMs, ms.size(), sum / ms.size(), ms[(size_t)(ms.size() * 0.95)], ms.back());
+}
+
+int main(int argc, char* argv[])
+{
+    std::string imageDir = argc > 1 ? argv[1] : "textures";
+    std::string shaderDir = argc > 2 ? argv[2] : "shaders";
+    unsigned int threads = argc > 3 ? (unsigned int)atoi(argv[3]) : 0;
+
+    std::vector<std::string> files;
+    std::error_code error;
+    for (const auto& entry : std::filesystem::directory_iterator(imageDir, error))
+    {
+        if (entry.is_regular_file() && isImage(entry.path()))
+        {
+            files.push_back(entry.path().string());
+        }
+    }
+    std::sort(files.begin(), files.end());
+    if (files.empty())
+    {
+        std::cerr << "No images found in " << imageDir << std::endl;
+        return -1;
+    }
+
+    BenchContext context("texture_stream_bench", WIDTH, HEIGHT);
+    if (!context.isValid())
+    {
+        return -1;
+    }
+
+    std::cout << "Renderer: " << glGetString(GL_RENDERER) << std::endl;
+    std::cout << files.size() << " images from " << imageDir << std::endl;
+    {
+        Scene scene(NULL, NULL, shaderDir);
+        RenderTarget target(WIDTH, HEIGHT);
+        Camera camera(glm::vec3(0.0f, 0.0f, 3.0f));
+
+        // Warm up the pipeline so the first run does not pay for shader and driver setup.
+        for (int i = 0; i < 10; i++)
+        {
+            renderFrame(scene, camera, target);
+        }
+        std::vector<double> idle;
+        for (int i = 0; i < 100; i++)
+        {
+            idle.push_back(renderFrame(scene, camera, target));
+        }
+        report("idle", { idle, 0.0 });
+
+        report("sync", runSync(files, scene, camera, target));
+        report("client", runCache(files, threads, 0, scene, camera, target));
+        report("pbo", runCache(files, threads, 4, scene, camera, target));
+    }
+
+    return 0;
+}
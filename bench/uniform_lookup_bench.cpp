@@ -0,0 +1,119 @@
+/*
+ * Microbenchmark comparing per-call uniform lookups by string with the prehashed location table in Shader.
+ *
+ * Usage: uniform_lookup_bench [shader directory] [iterations]
+ */
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+
+#define GLEW_STATIC 1
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "bench_context.h"
+#include "shader.h"
+
+// Camera and lighting values live in the FrameData block, so these are the per-program uniforms left.
+constexpr UniformName U_OBJECT_COLOR("objectColor");
+constexpr UniformName U_MODEL("model");
+
+// Previous setter path: build a string from the literal and query the driver on every call.
+static void setVec3ByString(unsigned int program, const string &name, const glm::vec3 &value)
+{
+    glUniform3fv(glGetUniformLocation(program, name.c_str()), 1, &value[0]);
+}
+
+static void setMat4ByString(unsigned int program, const string &name, const glm::mat4 &mat)
+{
+    glUniformMatrix4fv(glGetUniformLocation(program, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+}
+
+static double elapsedNs(chrono::steady_clock::time_point start, long calls)
+{
+    return chrono::duration<double, nano>(chrono::steady_clock::now() - start).count() / calls;
+}
+
+int main(int argc, char* argv[])
+{
+    string shaderDir = argc > 1 ? argv[1] : "shaders";
+    long iterations = argc > 2 ? atol(argv[2]) : 200000;
+
+    BenchContext context("uniform_lookup_bench", 64, 64);
+    if (!context.isValid())
+    {
+        return -1;
+    }
+
+    string vertexPath = shaderDir + "/basic_lighting_vertex_shader.txt";
+    string fragmentPath = shaderDir + "/basic_lighting_fragment_shader.txt";
+    Shader shader(vertexPath.c_str(), fragmentPath.c_str());
+    shader.use();
+
+    glm::vec3 color(1.0f, 0.5f, 0.31f);
+    glm::mat4 mat(1.0f);
+    const long callsPerIteration = 2;
+
+    // Lookup only, string path.
+    volatile int sink = 0;
+    auto start = chrono::steady_clock::now();
+    for (long i = 0; i < iterations; i++)
+    {
+        sink += glGetUniformLocation(shader.ID, string("objectColor").c_str());
+        sink += glGetUniformLocation(shader.ID, string("model").c_str());
+    }
+    double lookupString = elapsedNs(start, iterations * callsPerIteration);
+
+    // Lookup only, prehashed handles.
+    start = chrono::steady_clock::now();
+    for (long i = 0; i < iterations; i++)
+    {
+        sink += shader.getUniformLocation(U_OBJECT_COLOR);
+        sink += shader.getUniformLocation(U_MODEL);
+    }
+    double lookupHandle = elapsedNs(start, iterations * callsPerIteration);
+
+    // Full setter, string path. Values change every call so the shadow copies in Shader never skip.
+    start = chrono::steady_clock::now();
+    for (long i = 0; i < iterations; i++)
+    {
+        color.x = (float)i;
+        mat[3][0] = (float)i;
+        setVec3ByString(shader.ID, "objectColor", color);
+        setMat4ByString(shader.ID, "model", mat);
+    }
+    glFinish();
+    double setString = elapsedNs(start, iterations * callsPerIteration);
+
+    // Full setter, prehashed handles.
+    start = chrono::steady_clock::now();
+    for (long i = 0; i < iterations; i++)
+    {
+        color.x = (float)i;
+        mat[3][0] = (float)i;
+        shader.setVec3(U_OBJECT_COLOR, color);
+        shader.setMat4(U_MODEL, mat);
+    }
+    glFinish();
+    double setHandle = elapsedNs(start, iterations * callsPerIteration);
+
+    // Full setter, prehashed handles, same values every call so the shadow copies skip the GL call.
+    start = chrono::steady_clock::now();
+    for (long i = 0; i < iterations; i++)
+    {
+        shader.setVec3(U_OBJECT_COLOR, color);
+        shader.setMat4(U_MODEL, mat);
+    }
+    glFinish();
+    double setRedundant = elapsedNs(start, iterations * callsPerIteration);
+
+    cout << "renderer: " << glGetString(GL_RENDERER) << endl;
+    cout << "lookup  string+glGetUniformLocation: " << lookupString << " ns/call" << endl;
+    cout << "lookup  prehashed handle:            " << lookupHandle << " ns/call" << endl;
+    cout << "setter  string path:                 " << setString << " ns/call" << endl;
+    cout << "setter  prehashed handle:            " << setHandle << " ns/call" << endl;
+    cout << "setter  prehashed handle, redundant: " << setRedundant << " ns/call" << endl;
+
+    return 0;
+}
@@ -0,0 +1,149 @@
+/*
+ * Benchmark for quantized vertex formats: renders a dense sphere through Scene with every combination of position and
+ * normal format a mesh file can hold, and reports the bytes per vertex, the frame time and how far each image is from
+ * the one rendered with float vertices. The sphere has position, normal and texture coordinate like an imported mesh,
+ * and the render target is small, so vertex fetch rather than shading dominates the frame.
+ *
+ * Usage: vertex_format_bench [shader directory] [segments] [frames] [WIDTHxHEIGHT]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#define GLEW_STATIC 1
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "bench_context.h"
+#include "render_target.h"
+#include "mesh_file.h"
+#include "mesh_importer.h"
+#include "scene.h"
+
+static double elapsedMs(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// UV sphere of radius 1 laid out like MeshImporter output, with segments x segments quads.
+static Mesh makeSphere(unsigned int segments)
+{
+    Mesh mesh;
+    mesh.Stride = MeshImporter::VERTEX_STRIDE;
+    for (unsigned int r = 0; r <= segments; r++)
+    {
+        float theta = (float)r / segments * 3.14159265f;
+        for (unsigned int s = 0; s <= segments; s++)
+        {
+            float phi = (float)s / segments * 6.28318531f;
+            float x = std::sin(theta) * std::cos(phi), y = std::cos(theta), z = std::sin(theta) * std::sin(phi);
+            mesh.Vertices.insert(mesh.Vertices.end(), { x, y, z, x, y, z, (float)s / segments, 1.0f - (float)r / segments });
+        }
+    }
+    for (unsigned int r = 0; r < segments; r++)
+    {
+        for (unsigned int s = 0; s < segments; s++)
+        {
+            unsigned int a = r * (segments + 1) + s, b = a + segments + 1;
+            mesh.Indices.insert(mesh.Indices.end(), { a, b, a + 1, a + 1, b, b + 1 });
+        }
+    }
+    mesh.Indices = MeshOptimizer::optimizeVertexCache(mesh.Indices, mesh.vertexCount());
+    MeshOptimizer::optimizeVertexFetch(mesh.Indices, mesh.Vertices, mesh.Stride);
+    return mesh;
+}
+
+int main(int argc, char* argv[])
+{
+    std::string shaderDir = argc > 1 ? argv[1] : "shaders";
+    unsigned int segments = argc > 2 ? (unsigned int)std::max(4, atoi(argv[2])) : 1024;
+    int frames = argc > 3 ? std::max(1, atoi(argv[3])) : 20;
+    unsigned int width = 320, height = 180;
+    if (argc > 4 && (std::sscanf(argv[4], "%ux%u", &width, &height) != 2 || width == 0 || height == 0))
+    {
+        std::cerr << "Usage: " << argv[0] << " [shader directory] [segments] [frames] [WIDTHxHEIGHT]" << std::endl;
+        return -1;
+    }
+
+    BenchContext context("vertex_format_bench", width, height);
+    if (!context.isValid())
+    {
+        return -1;
+    }
+
+    Mesh sphere = makeSphere(segments);
+    std::cout << "Renderer: " << glGetString(GL_RENDERER) << std::endl;
+    std::printf("Sphere: %zu vertices, %zu triangles, %ux%u target, %d frames per format\n", sphere.vertexCount(), sphere.Indices.size() / 3, width, height, frames);
+
+    const VertexFormat formats[] = {
+        { POSITION_FLOAT, NORMAL_FLOAT },
+        { POSITION_HALF, NORMAL_FLOAT },
+        { POSITION_SNORM16, NORMAL_FLOAT },
+        { POSITION_FLOAT, NORMAL_OCTAHEDRAL },
+        { POSITION_FLOAT, NORMAL_INT_2_10_10_10 },
+        { POSITION_HALF, NORMAL_OCTAHEDRAL },
+        { POSITION_SNORM16, NORMAL_OCTAHEDRAL },
+        { POSITION_SNORM16, NORMAL_INT_2_10_10_10 },
+    };
+    std::vector<unsigned char> reference;
+    double referenceMs = 0.0;
+    uint32_t referenceStride = 0;
+    for (const VertexFormat& format : formats)
+    {
+        MeshFile file;
+        if (!file.assign(sphere, MeshImporter::vertexAttributes(), format))
+        {
+            return -1;
+        }
+        std::vector<unsigned char> pixels;
+        std::vector<double> frameMs;
+        {
+            Scene scene(NULL, NULL, shaderDir, &file);
+            RenderTarget target(width, height);
+            Camera camera(glm::vec3(0.0f, 0.0f, 3.0f));
+            for (int frame = -3; frame < frames; frame++)
+            {
+                auto start = std::chrono::steady_clock::now();
+                target.bind();
+                scene.render(camera, (float)width / (float)height);
+                glFinish();
+                if (frame >= 0)
+                {
+                    frameMs.push_back(elapsedMs(start));
+                }
+            }
+            target.readPixels(pixels);
+        }
+
+        std::sort(frameMs.begin(), frameMs.end());
+        double median = frameMs[frameMs.size() / 2];
+        uint32_t stride = file.header().stride;
+        int maxDifference = 0;
+        double sumDifference = 0.0;
+        if (reference.empty())
+        {
+            reference = pixels;
+            referenceMs = median;
+            referenceStride = stride;
+        }
+        for (size_t i = 0; i < pixels.size(); i++)
+        {
+            int difference = std::abs((int)pixels[i] - (int)reference[i]);
+            maxDifference = std::max(maxDifference, difference);
+            sumDifference += difference;
+        }
+        char name[64];
+        std::snprintf(name, sizeof(name), "%s + %s", VertexFormat::positionName(format.position), VertexFormat::normalName(format.normal));
+        std::printf("  %-22s %2u bytes/vertex (%3.0f%%)  %6.1f MB  %8.3f ms/frame (%+5.1f%%)  pixel error max %3d, mean %.4f\n", name, stride,
+            100.0 * stride / referenceStride, file.vertexData().size() / 1048576.0, median, 100.0 * (median - referenceMs) / referenceMs,
+            maxDifference, sumDifference / pixels.size());
+    }
+
+    return 0;
+}
@@ -0,0 +1,317 @@
+#ifndef ASSET_ARCHIVE_H
+#define ASSET_ARCHIVE_H
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+#include <filesystem>
+
+#include "byte_span.h"
+#include "mapped_file.h"
+
+// A packed file of shaders, textures and meshes, memory-mapped so reading an asset is a lookup instead of an open, a
+// read and a close. Assets are named by their path relative to the directory holding the archive, so with the archive
+// at ../assets.pak, "../shaders/basic_vertex_shader.txt" finds the entry "shaders/basic_vertex_shader.txt".
+// Layout: a header, an index of entries sorted by the 64-bit FNV-1a hash of their name, the names, then the contents
+// of each asset aligned to ALIGNMENT bytes. read() falls back to loose files, so a missing archive or asset only costs
+// the syscalls it saves.
+class AssetArchive
+{
+    public:
+        static constexpr size_t ALIGNMENT = 64;
+
+        // A file to pack: its name in the archive and where to read it from.
+        struct Source
+        {
+            std::string name;
+            std::string path;
+        };
+
+        AssetArchive() : index(NULL), count(0), names(NULL)
+        {
+        }
+
+        ~AssetArchive()
+        {
+            close();
+        }
+
+        AssetArchive(const AssetArchive&) = delete;
+        AssetArchive& operator=(const AssetArchive&) = delete;
+
+        // Map an archive and check its index. Returns false, leaving the archive closed, if it is missing or malformed.
+        bool open(const std::string& path)
+        {
+            close();
+            if (!mappedFile.open(path))
+            {
+                std::cout << "ERROR::ASSET_ARCHIVE::NOT_OPENED " << path << std::endl;
+                return false;
+            }
+            if (!validate())
+            {
+                std::cout << "ERROR::ASSET_ARCHIVE::MALFORMED " << path << std::endl;
+                close();
+                return false;
+            }
+            root = std::filesystem::path(path).parent_path().lexically_normal();
+            return true;
+        }
+
+        void close()
+        {
+            mappedFile.close();
+            index = NULL;
+            count = 0;
+            names = NULL;
+        }
+
+        bool isOpen() const
+        {
+            return mappedFile.isOpen();
+        }
+
+        // Number of assets in the archive.
+        size_t size() const
+        {
+            return count;
+        }
+
+        // Point contents at an asset inside the mapping. Returns false if the archive is closed or has no such asset.
+        // Safe to call from any thread while the archive stays open.
+        bool find(const std::string& path, ByteSpan& contents) const
+        {
+            if (!mappedFile.isOpen())
+            {
+                return false;
+            }
+            std::string name = entryName(path);
+            if (name.empty())
+            {
+                return false;
+            }
+            uint64_t hash = hashName(name);
+            const Entry* end = index + count;
+            const Entry* entry = std::lower_bound(index, end, hash, [](const Entry& entry, uint64_t hash) { return entry.hash < hash; });
+            if (entry == end || entry->hash != hash || name.compare(0, std::string::npos, names + entry->nameOffset, entry->nameSize) != 0)
+            {
+                return false;
+            }
+            contents = ByteSpan(mappedFile.data() + entry->offset, (size_t)entry->size);
+            return true;
+        }
+
+        // Returns true if the archive or the file system has the asset.
+        bool exists(const std::string& path) const
+        {
+            ByteSpan contents;
+            std::error_code error;
+            return find(path, contents) || std::filesystem::is_regular_file(path, error);
+        }
+
+        // Point contents at an asset: inside the mapping if the archive has it, otherwise at the file read into storage.
+        // Returns false if neither has it.
+        bool read(const std::string& path, std::vector<unsigned char>& storage, ByteSpan& contents) const
+        {
+            if (find(path, contents))
+            {
+                return true;
+            }
+            return readFile(path, storage, contents);
+        }
+
+        // Read a loose file into storage and point contents at it, bypassing the archive.
+        static bool readFile(const std::string& path, std::vector<unsigned char>& storage, ByteSpan& contents)
+        {
+            std::ifstream file(path, std::ios::binary | std::ios::ate);
+            if (!file)
+            {
+                return false;
+            }
+            storage.resize((size_t)file.tellg());
+            file.seekg(0);
+            if (!file.read((char*)storage.data(), storage.size()))
+            {
+                return false;
+            }
+            contents = storage;
+            return true;
+        }
+
+        // Pack files into an archive, written through a temporary file so a running program never maps a partial one.
+        // Returns false if a file cannot be read or two names hash alike.
+        static bool write(const std::string& path, const std::vector<Source>& sources)
+        {
+            std::vector<uint64_t> hashes(sources.size());
+            std::vector<size_t> order(sources.size());
+            for (size_t i = 0; i < sources.size(); i++)
+            {
+                hashes[i] = hashName(sources[i].name);
+                order[i] = i;
+            }
+            std::sort(order.begin(), order.end(), [&hashes](size_t a, size_t b) { return hashes[a] < hashes[b]; });
+
+            Header header;
+            memcpy(header.magic, MAGIC, sizeof(header.magic));
+            header.version = VERSION;
+            header.count = (uint32_t)sources.size();
+            header.namesOffset = sizeof(Header) + sources.size() * sizeof(Entry);
+
+            // Read every file first so a missing one leaves no archive behind.
+            std::vector<Entry> entries(sources.size());
+            std::vector<std::vector<unsigned char>> contents(sources.size());
+            std::string nameTable;
+            for (size_t i = 0; i < order.size(); i++)
+            {
+                const Source& source = sources[order[i]];
+                if (i > 0 && hashes[order[i]] == hashes[order[i - 1]])
+                {
+                    std::cout << "ERROR::ASSET_ARCHIVE::NAME_COLLISION " << source.name << std::endl;
+                    return false;
+                }
+                ByteSpan file;
+                if (!readFile(source.path, contents[i], file))
+                {
+                    std::cout << "ERROR::ASSET_ARCHIVE::FILE_NOT_READ " << source.path << std::endl;
+                    return false;
+                }
+                entries[i].hash = hashes[order[i]];
+                entries[i].size = file.size();
+                entries[i].nameOffset = (uint32_t)nameTable.size();
+                entries[i].nameSize = (uint32_t)source.name.size();
+                nameTable += source.name;
+            }
+            header.namesSize = nameTable.size();
+            uint64_t offset = header.namesOffset + header.namesSize;
+            for (Entry& entry : entries)
+            {
+                entry.offset = align(offset);
+                offset = entry.offset + entry.size;
+            }
+
+            bool written = writeFileAtomically(path, [&](std::ostream& file)
+            {
+                file.write((const char*)&header, sizeof(header));
+                file.write((const char*)entries.data(), entries.size() * sizeof(Entry));
+                file.write(nameTable.data(), nameTable.size());
+                uint64_t end = header.namesOffset + header.namesSize;
+                const char padding[ALIGNMENT] = {};
+                for (size_t i = 0; i < entries.size(); i++)
+                {
+                    file.write(padding, entries[i].offset - end);
+                    file.write((const char*)contents[i].data(), contents[i].size());
+                    end = entries[i].offset + entries[i].size;
+                }
+            });
+            if (!written)
+            {
+                std::cout << "ERROR::ASSET_ARCHIVE::WRITE_FAILED " << path << std::endl;
+                return false;
+            }
+            return true;
+        }
+
+    private:
+        static constexpr char MAGIC[8] = { 'C', 'L', 'E', 'A', 'N', 'P', 'A', 'K' };
+        static constexpr uint32_t VERSION = 1;
+
+        struct Header
+        {
+            char magic[8];
+            uint32_t version;
+            uint32_t count;
+            uint64_t namesOffset;
+            uint64_t namesSize;
+        };
+
+        struct Entry
+        {
+            uint64_t hash;
+            uint64_t offset;
+            uint64_t size;
+            uint32_t nameOffset;
+            uint32_t nameSize;
+        };
+
+        MappedFile mappedFile;
+        const Entry* index;
+        size_t count;
+        const char* names;
+        std::filesystem::path root;
+
+        static uint64_t hashName(const std::string& name)
+        {
+            uint64_t hash = 14695981039346656037ull;
+            for (char c : name)
+            {
+                hash = (hash ^ (uint8_t)c) * 1099511628211ull;
+            }
+            return hash;
+        }
+
+        static uint64_t align(uint64_t offset)
+        {
+            return (offset + ALIGNMENT - 1) & ~(uint64_t)(ALIGNMENT - 1);
+        }
+
+        // Name of the entry for a path: the path relative to the archive's directory, with forward slashes.
+        // Empty if the path is outside that directory.
+        std::string entryName(const std::string& path) const
+        {
+            std::filesystem::path normal = std::filesystem::path(path).lexically_normal();
+            std::filesystem::path relative = root.empty() ? normal : normal.lexically_relative(root);
+            std::string name = relative.generic_string();
+            if (name.empty() || name == "." || name.compare(0, 2, "..") == 0 || relative.is_absolute())
+            {
+                return "";
+            }
+            return name;
+        }
+
+        // Check that the header, index and names are in bounds and that every asset lies inside the file.
+        bool validate()
+        {
+            const unsigned char* mapping = mappedFile.data();
+            size_t mappingSize = mappedFile.size();
+            Header header;
+            if (mappingSize < sizeof(Header))
+            {
+                return false;
+            }
+            memcpy(&header, mapping, sizeof(header));
+            if (memcmp(header.magic, MAGIC, sizeof(header.magic)) != 0 || header.version != VERSION)
+            {
+                return false;
+            }
+            uint64_t indexEnd = sizeof(Header) + (uint64_t)header.count * sizeof(Entry);
+            if (indexEnd > header.namesOffset || header.namesOffset > mappingSize || header.namesSize > mappingSize - header.namesOffset)
+            {
+                return false;
+            }
+            index = (const Entry*)(mapping + sizeof(Header));
+            count = header.count;
+            names = (const char*)mapping + header.namesOffset;
+            for (size_t i = 0; i < count; i++)
+            {
+                const Entry& entry = index[i];
+                if (entry.offset > mappingSize || entry.size > mappingSize - entry.offset || (uint64_t)entry.nameOffset + entry.nameSize > header.namesSize || (i > 0 && index[i - 1].hash >= entry.hash))
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+};
+
+// The archive that shader and texture loads look in before the file system. Closed until open() is called.
+inline AssetArchive& assetArchive()
+{
+    static AssetArchive archive;
+    return archive;
+}
+#endif
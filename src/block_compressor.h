@@ -0,0 +1,738 @@
+#ifndef BLOCK_COMPRESSOR_H
+#define BLOCK_COMPRESSOR_H
+
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+#include <cmath>
+#include <cfloat>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+// AVX2 index selection is compiled for AVX2 on its own and picked at run time, so the build still only needs SSE2.
+// x64 only; 64-bit MinGW is left out because GCC there does not keep the stack 32-byte aligned for ymm spills.
+#if (defined(__x86_64__) || defined(_M_X64)) && !defined(__MINGW32__)
+#define BLOCK_COMPRESSOR_AVX2
+#include <immintrin.h>
+#if defined(__GNUC__) || defined(__clang__)
+#define BLOCK_COMPRESSOR_AVX2_TARGET __attribute__((target("avx2")))
+#else
+#include <intrin.h>
+#define BLOCK_COMPRESSOR_AVX2_TARGET
+#endif
+#endif
+
+#include "compressed_texture.h"
+#include "parallel_for.h"
+
+// Block formats written by BlockCompressor.
+enum BlockFormat
+{
+    // RGB in 8 bytes per 4x4 block. Alpha is dropped.
+    BLOCK_BC1,
+    // RGBA: a BC4 alpha block followed by a BC1 color block, 16 bytes per block.
+    BLOCK_BC3,
+    // One channel in 8 bytes per block.
+    BLOCK_BC4,
+    // Two channels as two BC4 blocks, 16 bytes per block.
+    BLOCK_BC5
+};
+
+// Speed and quality presets.
+enum CompressionQuality
+{
+    // Endpoints from the bounding box of each block.
+    QUALITY_FAST,
+    // Endpoints from the principal axis of each block, refined once by least squares.
+    QUALITY_NORMAL,
+    // Least-squares refinement until the error stops improving, and a search around the BC4 endpoints.
+    QUALITY_HIGH
+};
+
+struct CompressionStats
+{
+    // Peak signal-to-noise ratio in dB of the decoded blocks against the source, over every level and the channels
+    // the format keeps. Infinite for a lossless result.
+    double Psnr;
+    double Milliseconds;
+    size_t Blocks;
+};
+
+// CPU encoder for BC1, BC3, BC4 and BC5, used to cook textures ahead of time or on first load.
+// Rows of blocks of every mip level are spread over a pool of threads that each take the next unclaimed row, so large
+// and small levels balance out. Picking the palette entry for each pixel, where most of the time goes, uses AVX2 when the
+// CPU has it and SSE2 otherwise. Mip levels come from MipGenerator.
+class BlockCompressor
+{
+    public:
+        unsigned int Threads;
+        CompressionQuality Quality;
+
+        // 0 threads uses every core.
+        BlockCompressor(unsigned int threads = 0, CompressionQuality quality = QUALITY_NORMAL)
+            : Threads(threads > 0 ? threads : std::max(1u, std::thread::hardware_concurrency())), Quality(quality)
+        {
+        }
+
+        // Format that keeps every channel of an image as the texture cache uploads it: RED, RG, RGB or RGBA.
+        static BlockFormat formatForChannels(int channels)
+        {
+            const BlockFormat formats[] = { BLOCK_BC4, BLOCK_BC5, BLOCK_BC1, BLOCK_BC3 };
+            return formats[std::min(std::max(channels, 1), 4) - 1];
+        }
+
+        static GLenum glFormat(BlockFormat format)
+        {
+            const GLenum formats[] = { GL_COMPRESSED_RGB_S3TC_DXT1_EXT, GL_COMPRESSED_RGBA_S3TC_DXT5_EXT, GL_COMPRESSED_RED_RGTC1, GL_COMPRESSED_RG_RGTC2 };
+            return formats[format];
+        }
+
+        // Compress every level of an uncompressed chain, such as one built by MipGenerator.
+        void compress(const MipChain& source, BlockFormat format, MipChain& texture, CompressionStats* stats = NULL) const
+        {
+            auto start = std::chrono::steady_clock::now();
+            texture.InternalFormat = glFormat(format);
+            texture.Format = 0;
+            texture.Width = source.Width;
+            texture.Height = source.Height;
+            texture.Levels.clear();
+            size_t size = 0;
+            for (const MipLevel& level : source.Levels)
+            {
+                size_t levelSize = (size_t)((level.width + 3) / 4) * ((level.height + 3) / 4) * blockBytes(format);
+                texture.Levels.push_back({ level.width, level.height, size, levelSize });
+                size += levelSize;
+            }
+            texture.Data.assign(size, 0);
+
+            // One task per row of blocks, largest level first.
+            std::vector<std::pair<size_t, int>> rows;
+            for (size_t level = 0; level < texture.Levels.size(); level++)
+            {
+                for (int y = 0; y < texture.Levels[level].height; y += 4)
+                {
+                    rows.push_back({ level, y });
+                }
+            }
+            std::vector<double> rowErrors(rows.size(), 0.0);
+            parallelFor(Threads, rows.size(), [&](size_t row)
+            {
+                size_t level = rows[row].first;
+                rowErrors[row] = compressRow(source, level, rows[row].second, format, texture.Data.data() + texture.Levels[level].offset);
+            });
+
+            if (stats)
+            {
+                double error = 0.0;
+                size_t samples = 0;
+                stats->Blocks = 0;
+                for (double rowError : rowErrors)
+                {
+                    error += rowError;
+                }
+                for (const MipLevel& level : texture.Levels)
+                {
+                    samples += (size_t)level.width * level.height * channelCount(format);
+                    stats->Blocks += level.size / blockBytes(format);
+                }
+                double mse = error / samples;
+                stats->Psnr = mse > 0.0 ? 10.0 * log10(255.0 * 255.0 / mse) : INFINITY;
+                stats->Milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            }
+        }
+
+    private:
+        // Pixels of one block with channels stored apart, so four or eight pixels fit in one vector register.
+        struct BlockPixels
+        {
+            float channel[4][16];
+        };
+
+        static size_t blockBytes(BlockFormat format)
+        {
+            return format == BLOCK_BC1 || format == BLOCK_BC4 ? 8 : 16;
+        }
+
+        static int channelCount(BlockFormat format)
+        {
+            const int counts[] = { 3, 4, 1, 2 };
+            return counts[format];
+        }
+
+        // Encode one row of blocks and return the summed squared error of the decoded pixels inside the image.
+        double compressRow(const MipChain& source, size_t levelIndex, int y, BlockFormat format, unsigned char* output) const
+        {
+            const MipLevel& level = source.Levels[levelIndex];
+            int channels = formatChannels(source.Format);
+            const unsigned char* image = source.Data.data() + level.offset;
+            double error = 0.0;
+            int blocksPerRow = (level.width + 3) / 4;
+            unsigned char* block = output + (size_t)(y / 4) * blocksPerRow * blockBytes(format);
+            for (int x = 0; x < level.width; x += 4, block += blockBytes(format))
+            {
+                // Blocks past the right or bottom edge repeat the last column or row.
+                BlockPixels pixels;
+                for (int i = 0; i < 16; i++)
+                {
+                    int px = std::min(x + i % 4, level.width - 1);
+                    int py = std::min(y + i / 4, level.height - 1);
+                    const unsigned char* pixel = image + py * rowBytes(level.width, channels) + px * channels;
+                    for (int c = 0; c < 4; c++)
+                    {
+                        pixels.channel[c][i] = c < channels ? pixel[c] : c == 3 ? 255.0f : 0.0f;
+                    }
+                }
+
+                switch (format)
+                {
+                    case BLOCK_BC1:
+                        encodeBC1(pixels, block);
+                        break;
+                    case BLOCK_BC3:
+                        encodeBC4(pixels.channel[3], block);
+                        encodeBC1(pixels, block + 8);
+                        break;
+                    case BLOCK_BC4:
+                        encodeBC4(pixels.channel[0], block);
+                        break;
+                    case BLOCK_BC5:
+                        encodeBC4(pixels.channel[0], block);
+                        encodeBC4(pixels.channel[1], block + 8);
+                        break;
+                }
+
+                unsigned char decoded[16][4];
+                decodeBlock(block, format, decoded);
+                for (int i = 0; i < 16; i++)
+                {
+                    if (x + i % 4 >= level.width || y + i / 4 >= level.height)
+                    {
+                        continue;
+                    }
+                    for (int c = 0; c < channelCount(format); c++)
+                    {
+                        double difference = decoded[i][c] - pixels.channel[c][i];
+                        error += difference * difference;
+                    }
+                }
+            }
+            return error;
+        }
+
+        // Pick the nearest palette entry for each pixel over the first channels channels. Returns the summed squared error.
+        static float selectIndices(const BlockPixels& pixels, int channels, const float palette[][4], int paletteSize, unsigned char indices[16])
+        {
+#if defined(BLOCK_COMPRESSOR_AVX2)
+            static const bool avx2 = hasAVX2();
+            if (avx2)
+            {
+                return selectIndicesAVX2(pixels, channels, palette, paletteSize, indices);
+            }
+#endif
+            float total = 0.0f;
+#if defined(__SSE2__) || defined(_M_X64)
+            for (int i = 0; i < 16; i += 4)
+            {
+                __m128 best = _mm_set1_ps(FLT_MAX);
+                __m128i bestIndex = _mm_setzero_si128();
+                for (int p = 0; p < paletteSize; p++)
+                {
+                    __m128 distance = _mm_setzero_ps();
+                    for (int c = 0; c < channels; c++)
+                    {
+                        __m128 difference = _mm_sub_ps(_mm_loadu_ps(&pixels.channel[c][i]), _mm_set1_ps(palette[p][c]));
+                        distance = _mm_add_ps(distance, _mm_mul_ps(difference, difference));
+                    }
+                    __m128i closer = _mm_castps_si128(_mm_cmplt_ps(distance, best));
+                    best = _mm_min_ps(distance, best);
+                    bestIndex = _mm_or_si128(_mm_andnot_si128(closer, bestIndex), _mm_and_si128(closer, _mm_set1_epi32(p)));
+                }
+                alignas(16) int lanes[4];
+                alignas(16) float errors[4];
+                _mm_store_si128((__m128i*)lanes, bestIndex);
+                _mm_store_ps(errors, best);
+                for (int k = 0; k < 4; k++)
+                {
+                    indices[i + k] = (unsigned char)lanes[k];
+                    total += errors[k];
+                }
+            }
+#else
+            for (int i = 0; i < 16; i++)
+            {
+                float best = FLT_MAX;
+                for (int p = 0; p < paletteSize; p++)
+                {
+                    float distance = 0.0f;
+                    for (int c = 0; c < channels; c++)
+                    {
+                        float difference = pixels.channel[c][i] - palette[p][c];
+                        distance += difference * difference;
+                    }
+                    if (distance < best)
+                    {
+                        best = distance;
+                        indices[i] = (unsigned char)p;
+                    }
+                }
+                total += best;
+            }
+#endif
+            return total;
+        }
+
+#if defined(BLOCK_COMPRESSOR_AVX2)
+        // True if the CPU and the OS support AVX2.
+        static bool hasAVX2()
+        {
+#if defined(__GNUC__) || defined(__clang__)
+            // Also checks that the OS saves the ymm registers.
+            return __builtin_cpu_supports("avx2");
+#else
+            int info[4];
+            __cpuid(info, 0);
+            if (info[0] < 7)
+            {
+                return false;
+            }
+            __cpuid(info, 1);
+            // OSXSAVE and AVX, and the OS saves the xmm and ymm state.
+            if ((info[2] & 0x18000000) != 0x18000000 || (_xgetbv(0) & 6) != 6)
+            {
+                return false;
+            }
+            __cpuidex(info, 7, 0);
+            return ((info[1] >> 5) & 1) != 0;
+#endif
+        }
+
+        // selectIndices() on eight pixels at a time.
+        BLOCK_COMPRESSOR_AVX2_TARGET static float selectIndicesAVX2(const BlockPixels& pixels, int channels, const float palette[][4], int paletteSize, unsigned char indices[16])
+        {
+            float total = 0.0f;
+            for (int i = 0; i < 16; i += 8)
+            {
+                __m256 best = _mm256_set1_ps(FLT_MAX);
+                __m256i bestIndex = _mm256_setzero_si256();
+                for (int p = 0; p < paletteSize; p++)
+                {
+                    __m256 distance = _mm256_setzero_ps();
+                    for (int c = 0; c < channels; c++)
+                    {
+                        __m256 difference = _mm256_sub_ps(_mm256_loadu_ps(&pixels.channel[c][i]), _mm256_set1_ps(palette[p][c]));
+                        distance = _mm256_add_ps(distance, _mm256_mul_ps(difference, difference));
+                    }
+                    __m256 closer = _mm256_cmp_ps(distance, best, _CMP_LT_OQ);
+                    best = _mm256_min_ps(distance, best);
+                    bestIndex = _mm256_blendv_epi8(bestIndex, _mm256_set1_epi32(p), _mm256_castps_si256(closer));
+                }
+                alignas(32) int lanes[8];
+                alignas(32) float errors[8];
+                _mm256_store_si256((__m256i*)lanes, bestIndex);
+                _mm256_store_ps(errors, best);
+                for (int k = 0; k < 8; k++)
+                {
+                    indices[i + k] = (unsigned char)lanes[k];
+                    total += errors[k];
+                }
+            }
+            return total;
+        }
+#endif
+
+        static uint16_t pack565(const float color[3])
+        {
+            int r = (int)(std::min(std::max(color[0], 0.0f), 255.0f) * 31.0f / 255.0f + 0.5f);
+            int g = (int)(std::min(std::max(color[1], 0.0f), 255.0f) * 63.0f / 255.0f + 0.5f);
+            int b = (int)(std::min(std::max(color[2], 0.0f), 255.0f) * 31.0f / 255.0f + 0.5f);
+            return (uint16_t)((r << 11) | (g << 5) | b);
+        }
+
+        static void unpack565(uint16_t color, int rgb[3])
+        {
+            int r = (color >> 11) & 31;
+            int g = (color >> 5) & 63;
+            int b = color & 31;
+            rgb[0] = (r << 3) | (r >> 2);
+            rgb[1] = (g << 2) | (g >> 4);
+            rgb[2] = (b << 3) | (b >> 2);
+        }
+
+        // Four-color BC1 palette, rounded the way decoders round it.
+        static void paletteBC1(uint16_t color0, uint16_t color1, float palette[4][4])
+        {
+            int c0[3], c1[3];
+            unpack565(color0, c0);
+            unpack565(color1, c1);
+            for (int c = 0; c < 3; c++)
+            {
+                palette[0][c] = (float)c0[c];
+                palette[1][c] = (float)c1[c];
+                palette[2][c] = (float)((2 * c0[c] + c1[c]) / 3);
+                palette[3][c] = (float)((c0[c] + 2 * c1[c]) / 3);
+            }
+        }
+
+        // Endpoints along the axis of greatest variance, or the bounding box diagonal for QUALITY_FAST.
+        void fitColorEndpoints(const BlockPixels& pixels, float low[3], float high[3]) const
+        {
+            float minimum[3], maximum[3], mean[3];
+            for (int c = 0; c < 3; c++)
+            {
+                minimum[c] = *std::min_element(pixels.channel[c], pixels.channel[c] + 16);
+                maximum[c] = *std::max_element(pixels.channel[c], pixels.channel[c] + 16);
+                mean[c] = 0.0f;
+                for (int i = 0; i < 16; i++)
+                {
+                    mean[c] += pixels.channel[c][i] / 16.0f;
+                }
+            }
+
+            if (Quality == QUALITY_FAST)
+            {
+                std::copy(minimum, minimum + 3, low);
+                std::copy(maximum, maximum + 3, high);
+            }
+            else
+            {
+                float covariance[6] = { 0.0f };
+                for (int i = 0; i < 16; i++)
+                {
+                    float r = pixels.channel[0][i] - mean[0];
+                    float g = pixels.channel[1][i] - mean[1];
+                    float b = pixels.channel[2][i] - mean[2];
+                    covariance[0] += r * r;
+                    covariance[1] += r * g;
+                    covariance[2] += r * b;
+                    covariance[3] += g * g;
+                    covariance[4] += g * b;
+                    covariance[5] += b * b;
+                }
+
+                // Power iteration from the bounding box diagonal.
+                float axis[3] = { maximum[0] - minimum[0], maximum[1] - minimum[1], maximum[2] - minimum[2] };
+                for (int iteration = 0; iteration < 8; iteration++)
+                {
+                    float next[3] =
+                    {
+                        covariance[0] * axis[0] + covariance[1] * axis[1] + covariance[2] * axis[2],
+                        covariance[1] * axis[0] + covariance[3] * axis[1] + covariance[4] * axis[2],
+                        covariance[2] * axis[0] + covariance[4] * axis[1] + covariance[5] * axis[2]
+                    };
+                    float length = std::max(std::max(fabsf(next[0]), fabsf(next[1])), fabsf(next[2]));
+                    if (length < 1e-6f)
+                    {
+                        break;
+                    }
+                    for (int c = 0; c < 3; c++)
+                    {
+                        axis[c] = next[c] / length;
+                    }
+                }
+
+                float lowest = 0.0f, highest = 0.0f;
+                float lengthSquared = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+                if (lengthSquared > 1e-12f)
+                {
+                    for (int i = 0; i < 16; i++)
+                    {
+                        float t = ((pixels.channel[0][i] - mean[0]) * axis[0] + (pixels.channel[1][i] - mean[1]) * axis[1] + (pixels.channel[2][i] - mean[2]) * axis[2]) / lengthSquared;
+                        lowest = std::min(lowest, t);
+                        highest = std::max(highest, t);
+                    }
+                }
+                for (int c = 0; c < 3; c++)
+                {
+                    low[c] = mean[c] + axis[c] * lowest;
+                    high[c] = mean[c] + axis[c] * highest;
+                }
+            }
+
+            // Pull the endpoints in slightly: the outermost pixels are rarely worth an endpoint of their own.
+            for (int c = 0; c < 3; c++)
+            {
+                float inset = (high[c] - low[c]) / 16.0f;
+                low[c] += inset;
+                high[c] -= inset;
+            }
+        }
+
+        // Write a four-color BC1 block for two endpoints and return its error.
+        static float buildBC1(const BlockPixels& pixels, uint16_t color0, uint16_t color1, unsigned char indices[16], unsigned char* block)
+        {
+            // color0 > color1 selects four-color mode. Equal endpoints use index 0 for every pixel, which is valid either way.
+            if (color0 < color1)
+            {
+                std::swap(color0, color1);
+            }
+            float palette[4][4];
+            paletteBC1(color0, color1, palette);
+            float error = selectIndices(pixels, 3, palette, 4, indices);
+            uint32_t bits = 0;
+            for (int i = 0; i < 16; i++)
+            {
+                bits |= (uint32_t)(color0 == color1 ? 0 : indices[i]) << (i * 2);
+            }
+            memcpy(block, &color0, 2);
+            memcpy(block + 2, &color1, 2);
+            memcpy(block + 4, &bits, 4);
+            return error;
+        }
+
+        // Solve for the endpoints that minimize the error of the current indices.
+        static bool refineEndpoints(const BlockPixels& pixels, const unsigned char indices[16], float low[3], float high[3])
+        {
+            const float weights[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+            float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+            float ax[3] = { 0.0f }, bx[3] = { 0.0f };
+            for (int i = 0; i < 16; i++)
+            {
+                float a = weights[indices[i]];
+                float b = 1.0f - a;
+                aa += a * a;
+                ab += a * b;
+                bb += b * b;
+                for (int c = 0; c < 3; c++)
+                {
+                    ax[c] += a * pixels.channel[c][i];
+                    bx[c] += b * pixels.channel[c][i];
+                }
+            }
+            float determinant = aa * bb - ab * ab;
+            if (fabsf(determinant) < 1e-6f)
+            {
+                return false;
+            }
+            for (int c = 0; c < 3; c++)
+            {
+                high[c] = (ax[c] * bb - bx[c] * ab) / determinant;
+                low[c] = (bx[c] * aa - ax[c] * ab) / determinant;
+            }
+            return true;
+        }
+
+        void encodeBC1(const BlockPixels& pixels, unsigned char* block) const
+        {
+            float low[3], high[3];
+            fitColorEndpoints(pixels, low, high);
+            unsigned char indices[16];
+            uint16_t color0 = pack565(high);
+            uint16_t color1 = pack565(low);
+            float error = buildBC1(pixels, color0, color1, indices, block);
+
+            int iterations = Quality == QUALITY_FAST ? 0 : Quality == QUALITY_NORMAL ? 1 : 8;
+            for (int iteration = 0; iteration < iterations && error > 0.0f; iteration++)
+            {
+                // buildBC1 may have swapped the endpoints, so read them back from the block.
+                memcpy(&color0, block, 2);
+                memcpy(&color1, block + 2, 2);
+                if (color0 == color1 || !refineEndpoints(pixels, indices, low, high))
+                {
+                    break;
+                }
+                uint16_t refined0 = pack565(high);
+                uint16_t refined1 = pack565(low);
+                if ((refined0 == color0 && refined1 == color1) || (refined0 == color1 && refined1 == color0))
+                {
+                    break;
+                }
+                unsigned char candidate[8];
+                unsigned char candidateIndices[16];
+                float candidateError = buildBC1(pixels, refined0, refined1, candidateIndices, candidate);
+                if (candidateError >= error)
+                {
+                    break;
+                }
+                error = candidateError;
+                memcpy(block, candidate, 8);
+                memcpy(indices, candidateIndices, 16);
+            }
+        }
+
+        // BC4 palette: eight interpolated values if value0 > value1, otherwise six plus 0 and 255.
+        static void paletteBC4(int value0, int value1, float palette[8][4])
+        {
+            palette[0][0] = (float)value0;
+            palette[1][0] = (float)value1;
+            if (value0 > value1)
+            {
+                for (int i = 1; i < 7; i++)
+                {
+                    palette[i + 1][0] = (float)(((7 - i) * value0 + i * value1) / 7);
+                }
+            }
+            else
+            {
+                for (int i = 1; i < 5; i++)
+                {
+                    palette[i + 1][0] = (float)(((5 - i) * value0 + i * value1) / 5);
+                }
+                palette[6][0] = 0.0f;
+                palette[7][0] = 255.0f;
+            }
+        }
+
+        static float buildBC4(const BlockPixels& pixels, int value0, int value1, unsigned char* block)
+        {
+            float palette[8][4];
+            paletteBC4(value0, value1, palette);
+            unsigned char indices[16];
+            float error = selectIndices(pixels, 1, palette, 8, indices);
+            uint64_t bits = 0;
+            for (int i = 0; i < 16; i++)
+            {
+                bits |= (uint64_t)indices[i] << (i * 3);
+            }
+            block[0] = (unsigned char)value0;
+            block[1] = (unsigned char)value1;
+            for (int i = 0; i < 6; i++)
+            {
+                block[2 + i] = (unsigned char)(bits >> (i * 8));
+            }
+            return error;
+        }
+
+        void encodeBC4(const float values[16], unsigned char* block) const
+        {
+            BlockPixels pixels;
+            std::copy(values, values + 16, pixels.channel[0]);
+            int minimum = (int)*std::min_element(values, values + 16);
+            int maximum = (int)*std::max_element(values, values + 16);
+
+            // Eight-value mode spans the whole range.
+            float error = buildBC4(pixels, maximum, minimum, block);
+
+            // Six-value mode gets 0 and 255 for free, so its endpoints only need to span the values in between.
+            if (Quality != QUALITY_FAST && error > 0.0f && (minimum == 0 || maximum == 255))
+            {
+                int low = 255, high = 0;
+                for (int i = 0; i < 16; i++)
+                {
+                    int value = (int)values[i];
+                    if (value != 0 && value != 255)
+                    {
+                        low = std::min(low, value);
+                        high = std::max(high, value);
+                    }
+                }
+                if (low > high)
+                {
+                    low = high = 0;
+                }
+                unsigned char candidate[8];
+                float candidateError = buildBC4(pixels, low, high, candidate);
+                if (candidateError < error)
+                {
+                    error = candidateError;
+                    memcpy(block, candidate, 8);
+                }
+            }
+
+            // Try endpoints near the current ones; the interpolated values often fit better slightly inside the range.
+            if (Quality == QUALITY_HIGH && error > 0.0f)
+            {
+                int value0 = block[0];
+                int value1 = block[1];
+                for (int delta0 = -2; delta0 <= 2; delta0++)
+                {
+                    for (int delta1 = -2; delta1 <= 2; delta1++)
+                    {
+                        int candidate0 = std::min(std::max(value0 + delta0, 0), 255);
+                        int candidate1 = std::min(std::max(value1 + delta1, 0), 255);
+                        // Stay in the same mode.
+                        if ((candidate0 > candidate1) != (value0 > value1))
+                        {
+                            continue;
+                        }
+                        unsigned char candidate[8];
+                        float candidateError = buildBC4(pixels, candidate0, candidate1, candidate);
+                        if (candidateError < error)
+                        {
+                            error = candidateError;
+                            memcpy(block, candidate, 8);
+                        }
+                    }
+                }
+            }
+        }
+
+        static void decodeBC1(const unsigned char* block, unsigned char pixels[16][4], bool fourColor)
+        {
+            uint16_t color0, color1;
+            uint32_t bits;
+            memcpy(&color0, block, 2);
+            memcpy(&color1, block + 2, 2);
+            memcpy(&bits, block + 4, 4);
+            int c0[3], c1[3];
+            unpack565(color0, c0);
+            unpack565(color1, c1);
+            int palette[4][3];
+            for (int c = 0; c < 3; c++)
+            {
+                palette[0][c] = c0[c];
+                palette[1][c] = c1[c];
+                if (fourColor || color0 > color1)
+                {
+                    palette[2][c] = (2 * c0[c] + c1[c]) / 3;
+                    palette[3][c] = (c0[c] + 2 * c1[c]) / 3;
+                }
+                else
+                {
+                    palette[2][c] = (c0[c] + c1[c]) / 2;
+                    palette[3][c] = 0;
+                }
+            }
+            for (int i = 0; i < 16; i++)
+            {
+                int index = (bits >> (i * 2)) & 3;
+                for (int c = 0; c < 3; c++)
+                {
+                    pixels[i][c] = (unsigned char)palette[index][c];
+                }
+            }
+        }
+
+        static void decodeBC4(const unsigned char* block, unsigned char pixels[16][4], int channel)
+        {
+            float palette[8][4];
+            paletteBC4(block[0], block[1], palette);
+            uint64_t bits = 0;
+            for (int i = 0; i < 6; i++)
+            {
+                bits |= (uint64_t)block[2 + i] << (i * 8);
+            }
+            for (int i = 0; i < 16; i++)
+            {
+                pixels[i][channel] = (unsigned char)palette[(bits >> (i * 3)) & 7][0];
+            }
+        }
+
+        // Decode a block into RGBA, for measuring the error. Channels the format does not store are left unset.
+        static void decodeBlock(const unsigned char* block, BlockFormat format, unsigned char pixels[16][4])
+        {
+            switch (format)
+            {
+                case BLOCK_BC1:
+                    decodeBC1(block, pixels, false);
+                    break;
+                case BLOCK_BC3:
+                    // The color block of BC3 is always decoded in four-color mode.
+                    decodeBC1(block + 8, pixels, true);
+                    decodeBC4(block, pixels, 3);
+                    break;
+                case BLOCK_BC4:
+                    decodeBC4(block, pixels, 0);
+                    break;
+                case BLOCK_BC5:
+                    decodeBC4(block, pixels, 0);
+                    decodeBC4(block + 8, pixels, 1);
+                    break;
+            }
+        }
+};
+#endif
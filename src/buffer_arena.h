@@ -0,0 +1,499 @@
+#ifndef BUFFER_ARENA_H
+#define BUFFER_ARENA_H
+
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <iostream>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+// A sub-allocated part of a BufferArena page.
+struct BufferRange
+{
+    // The page's GL buffer.
+    unsigned int buffer;
+    // Bytes from the start of the buffer.
+    size_t offset;
+    size_t size;
+};
+
+// Memory use of a BufferArena.
+struct BufferArenaStats
+{
+    size_t pages = 0;
+    size_t capacityBytes = 0;
+    size_t usedBytes = 0;
+    size_t freeBytes = 0;
+    size_t freeBlocks = 0;
+    size_t largestFreeBlock = 0;
+    // Live allocations, counting shared ones once.
+    size_t allocations = 0;
+    // Uploads answered with an existing allocation of identical contents, and the bytes they did not take.
+    size_t dedupedUploads = 0;
+    size_t dedupedBytes = 0;
+
+    // 0 when all free space is in one block, approaching 1 as it splinters into blocks too small to use.
+    float fragmentation() const
+    {
+        return freeBytes ? 1.0f - (float)largestFreeBlock / (float)freeBytes : 0.0f;
+    }
+
+    void print(std::ostream& out, const char* label) const
+    {
+        out << label << ": " << allocations << " allocations in " << pages << " pages, " << usedBytes << " of " << capacityBytes << " bytes used, "
+            << freeBlocks << " free blocks (largest " << largestFreeBlock << ", fragmentation " << fragmentation() << "), "
+            << dedupedUploads << " uploads deduplicated (" << dedupedBytes << " bytes)" << std::endl;
+    }
+};
+
+// Hands out ranges of a few large GL buffers instead of a buffer per object, so meshes share buffers and vertex arrays
+// and the driver tracks a handful of objects. Each page keeps a best-fit free list that merges neighbouring blocks on
+// release. Uploads whose contents match a live allocation share it, counted by reference. Allocations are identified
+// by handles because compact() moves them; look up range() when drawing rather than keeping the offset.
+// Buffers are created through the copy targets, so an arena of index data never disturbs the bound vertex array.
+class BufferArena
+{
+    public:
+        typedef uint32_t Handle;
+        static constexpr Handle INVALID_HANDLE = 0;
+
+        // Bytes per page. Larger uploads get a page of their own.
+        size_t PageBytes;
+
+        BufferArena(size_t pageBytes = 4 << 20) : PageBytes(pageBytes), dedupedUploads(0), dedupedBytes(0)
+        {
+            // Handle 0 is never given out.
+            allocations.emplace_back();
+        }
+
+        ~BufferArena()
+        {
+            for (Page& page : pages)
+            {
+                glDeleteBuffers(1, &page.buffer);
+            }
+        }
+
+        BufferArena(const BufferArena&) = delete;
+        BufferArena& operator=(const BufferArena&) = delete;
+
+        // Copy size bytes into the arena at an offset that is a multiple of alignment, which need not be a power of two:
+        // a vertex stride keeps every mesh at a whole base vertex. Returns INVALID_HANDLE for an empty upload.
+        Handle upload(const void* data, size_t size, size_t alignment = 4)
+        {
+            if (size == 0)
+            {
+                return INVALID_HANDLE;
+            }
+            alignment = std::max<size_t>(1, alignment);
+            uint64_t key = hashBytes(data, size) ^ (uint64_t)size * 0x9E3779B97F4A7C15ull ^ (uint64_t)alignment;
+            auto shared = contents.find(key);
+            if (shared != contents.end())
+            {
+                Allocation& allocation = allocations[shared->second];
+                if (allocation.size == size && allocation.alignment == alignment && sameContents(allocation, data, size))
+                {
+                    allocation.references++;
+                    dedupedUploads++;
+                    dedupedBytes += size;
+                    return shared->second;
+                }
+            }
+
+            uint32_t pageIndex;
+            size_t offset;
+            allocate(size, alignment, pageIndex, offset);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, pages[pageIndex].buffer);
+            glBufferSubData(GL_COPY_WRITE_BUFFER, offset, size, data);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+            Handle handle;
+            if (!freeHandles.empty())
+            {
+                handle = freeHandles.back();
+                freeHandles.pop_back();
+            }
+            else
+            {
+                handle = (Handle)allocations.size();
+                allocations.emplace_back();
+            }
+            Allocation& allocation = allocations[handle];
+            allocation.page = pageIndex;
+            allocation.offset = offset;
+            allocation.size = size;
+            allocation.alignment = alignment;
+            allocation.references = 1;
+            allocation.key = key;
+            contents.emplace(key, handle);
+            return handle;
+        }
+
+        // Drop one reference to an allocation. Its range returns to the free list when the last one is gone.
+        void release(Handle handle)
+        {
+            if (handle == INVALID_HANDLE || handle >= allocations.size() || allocations[handle].references == 0)
+            {
+                return;
+            }
+            Allocation& allocation = allocations[handle];
+            if (--allocation.references > 0)
+            {
+                return;
+            }
+            auto shared = contents.find(allocation.key);
+            if (shared != contents.end() && shared->second == handle)
+            {
+                contents.erase(shared);
+            }
+            Page& page = pages[allocation.page];
+            addFreeBlock(page, allocation.offset, allocation.size);
+            freeHandles.push_back(handle);
+        }
+
+        BufferRange range(Handle handle) const
+        {
+            const Allocation& allocation = allocations[handle];
+            return { pages[allocation.page].buffer, allocation.offset, allocation.size };
+        }
+
+        // Slide the allocations of every page to its start, in offset order, so the free space of each page becomes one
+        // block at its end, and delete pages left empty. Allocations stay in their page, so buffer names and the vertex
+        // arrays built on them stay valid; only offsets change. Returns the number of bytes copied on the GPU.
+        size_t compact()
+        {
+            std::vector<std::vector<Handle>> live(pages.size());
+            for (Handle handle = 1; handle < allocations.size(); handle++)
+            {
+                if (allocations[handle].references > 0)
+                {
+                    live[allocations[handle].page].push_back(handle);
+                }
+            }
+
+            size_t moved = 0;
+            unsigned int scratch = 0;
+            for (uint32_t pageIndex = 0; pageIndex < pages.size(); pageIndex++)
+            {
+                Page& page = pages[pageIndex];
+                if (page.buffer == 0)
+                {
+                    continue;
+                }
+                if (live[pageIndex].empty())
+                {
+                    glDeleteBuffers(1, &page.buffer);
+                    page = Page();
+                    continue;
+                }
+
+                std::vector<Handle>& handles = live[pageIndex];
+                std::sort(handles.begin(), handles.end(), [this](Handle a, Handle b) { return allocations[a].offset < allocations[b].offset; });
+                std::vector<size_t> targets(handles.size());
+                size_t end = 0;
+                bool moves = false;
+                for (size_t i = 0; i < handles.size(); i++)
+                {
+                    const Allocation& allocation = allocations[handles[i]];
+                    targets[i] = alignUp(end, allocation.alignment);
+                    end = targets[i] + allocation.size;
+                    moves |= targets[i] != allocation.offset;
+                }
+                if (!moves)
+                {
+                    continue;
+                }
+
+                // Ranges may overlap their targets, and a buffer cannot be copied onto itself where they do, so pack into
+                // a scratch buffer and copy the packed data back in one go.
+                if (scratch == 0)
+                {
+                    glGenBuffers(1, &scratch);
+                }
+                glBindBuffer(GL_COPY_READ_BUFFER, page.buffer);
+                glBindBuffer(GL_COPY_WRITE_BUFFER, scratch);
+                glBufferData(GL_COPY_WRITE_BUFFER, end, NULL, GL_STREAM_COPY);
+                for (size_t i = 0; i < handles.size(); i++)
+                {
+                    Allocation& allocation = allocations[handles[i]];
+                    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, allocation.offset, targets[i], allocation.size);
+                    allocation.offset = targets[i];
+                }
+                glBindBuffer(GL_COPY_READ_BUFFER, scratch);
+                glBindBuffer(GL_COPY_WRITE_BUFFER, page.buffer);
+                glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, end);
+                moved += end * 2;
+
+                page.freeByOffset.clear();
+                page.freeBySize.clear();
+                if (end < page.capacity)
+                {
+                    addFreeBlock(page, end, page.capacity - end);
+                }
+            }
+            glBindBuffer(GL_COPY_READ_BUFFER, 0);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+            if (scratch)
+            {
+                glDeleteBuffers(1, &scratch);
+            }
+            return moved;
+        }
+
+        BufferArenaStats stats() const
+        {
+            BufferArenaStats result;
+            for (const Page& page : pages)
+            {
+                if (page.buffer == 0)
+                {
+                    continue;
+                }
+                result.pages++;
+                result.capacityBytes += page.capacity;
+                for (const auto& block : page.freeByOffset)
+                {
+                    result.freeBytes += block.second;
+                    result.freeBlocks++;
+                    result.largestFreeBlock = std::max(result.largestFreeBlock, block.second);
+                }
+            }
+            for (Handle handle = 1; handle < allocations.size(); handle++)
+            {
+                if (allocations[handle].references > 0)
+                {
+                    result.allocations++;
+                    result.usedBytes += allocations[handle].size;
+                }
+            }
+            result.dedupedUploads = dedupedUploads;
+            result.dedupedBytes = dedupedBytes;
+            return result;
+        }
+
+    private:
+        struct Page
+        {
+            unsigned int buffer = 0;
+            size_t capacity = 0;
+            // Free blocks by offset, to merge neighbours, and by size, to find the best fit.
+            std::map<size_t, size_t> freeByOffset;
+            std::multimap<size_t, size_t> freeBySize;
+        };
+
+        struct Allocation
+        {
+            uint32_t page = 0;
+            size_t offset = 0;
+            size_t size = 0;
+            size_t alignment = 1;
+            // 0 for unused handles.
+            uint32_t references = 0;
+            uint64_t key = 0;
+        };
+
+        std::vector<Page> pages;
+        std::vector<Allocation> allocations;
+        std::vector<Handle> freeHandles;
+        // Live allocations by a hash of their contents, size and alignment. A colliding upload with other contents is
+        // stored but not entered here.
+        std::unordered_map<uint64_t, Handle> contents;
+        // Read-back buffer for sameContents().
+        std::vector<unsigned char> scratch;
+        size_t dedupedUploads;
+        size_t dedupedBytes;
+
+        // Read an allocation back and compare it with data, so a hash collision uploads separately instead of drawing
+        // another mesh's data. Only runs when the hash, size and alignment already match.
+        bool sameContents(const Allocation& allocation, const void* data, size_t size)
+        {
+            scratch.resize(size);
+            glBindBuffer(GL_COPY_READ_BUFFER, pages[allocation.page].buffer);
+            glGetBufferSubData(GL_COPY_READ_BUFFER, allocation.offset, size, scratch.data());
+            glBindBuffer(GL_COPY_READ_BUFFER, 0);
+            return std::memcmp(scratch.data(), data, size) == 0;
+        }
+
+        static size_t alignUp(size_t offset, size_t alignment)
+        {
+            return (offset + alignment - 1) / alignment * alignment;
+        }
+
+        // 64-bit hash of the contents, eight bytes per step. It only finds candidates; sameContents() confirms them.
+        static uint64_t hashBytes(const void* data, size_t size)
+        {
+            const unsigned char* bytes = (const unsigned char*)data;
+            uint64_t hash = 14695981039346656037ull;
+            size_t i = 0;
+            for (; i + 8 <= size; i += 8)
+            {
+                uint64_t word;
+                std::memcpy(&word, bytes + i, sizeof(word));
+                hash = (hash ^ word) * 0x9E3779B97F4A7C15ull;
+                hash ^= hash >> 29;
+            }
+            for (; i < size; i++)
+            {
+                hash = (hash ^ bytes[i]) * 1099511628211ull;
+            }
+            return hash ^ (hash >> 32);
+        }
+
+        // Find the smallest free block that holds size bytes at the alignment, making a new page when none does.
+        void allocate(size_t size, size_t alignment, uint32_t& pageIndex, size_t& offset)
+        {
+            // A block this large always fits, whatever padding the alignment needs at its start.
+            size_t needed = size + alignment - 1;
+            for (uint32_t i = 0; i < pages.size(); i++)
+            {
+                Page& page = pages[i];
+                auto block = page.freeBySize.lower_bound(needed);
+                if (page.buffer != 0 && block != page.freeBySize.end())
+                {
+                    size_t blockOffset = block->second;
+                    size_t blockSize = block->first;
+                    removeFreeBlock(page, blockOffset, blockSize);
+                    offset = alignUp(blockOffset, alignment);
+                    if (offset > blockOffset)
+                    {
+                        addFreeBlock(page, blockOffset, offset - blockOffset);
+                    }
+                    if (offset + size < blockOffset + blockSize)
+                    {
+                        addFreeBlock(page, offset + size, blockOffset + blockSize - offset - size);
+                    }
+                    pageIndex = i;
+                    return;
+                }
+            }
+
+            // Reuse the slot of a page deleted by compact() so handles never see page indices shift.
+            pageIndex = (uint32_t)pages.size();
+            for (uint32_t i = 0; i < pages.size(); i++)
+            {
+                if (pages[i].buffer == 0)
+                {
+                    pageIndex = i;
+                    break;
+                }
+            }
+            if (pageIndex == pages.size())
+            {
+                pages.emplace_back();
+            }
+            Page& page = pages[pageIndex];
+            page.capacity = std::max(PageBytes, size);
+            glGenBuffers(1, &page.buffer);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, page.buffer);
+            glBufferData(GL_COPY_WRITE_BUFFER, page.capacity, NULL, GL_STATIC_DRAW);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+            offset = 0;
+            if (size < page.capacity)
+            {
+                addFreeBlock(page, size, page.capacity - size);
+            }
+        }
+
+        // Return a block to a page's free list, merged with the free blocks on either side.
+        static void addFreeBlock(Page& page, size_t offset, size_t size)
+        {
+            auto next = page.freeByOffset.lower_bound(offset);
+            if (next != page.freeByOffset.begin())
+            {
+                auto previous = std::prev(next);
+                if (previous->first + previous->second == offset)
+                {
+                    offset = previous->first;
+                    size += previous->second;
+                    removeFreeBlock(page, previous->first, previous->second);
+                }
+            }
+            next = page.freeByOffset.lower_bound(offset);
+            if (next != page.freeByOffset.end() && offset + size == next->first)
+            {
+                size += next->second;
+                removeFreeBlock(page, next->first, next->second);
+            }
+            page.freeByOffset.emplace(offset, size);
+            page.freeBySize.emplace(size, offset);
+        }
+
+        static void removeFreeBlock(Page& page, size_t offset, size_t size)
+        {
+            page.freeByOffset.erase(offset);
+            auto sizes = page.freeBySize.equal_range(size);
+            for (auto it = sizes.first; it != sizes.second; ++it)
+            {
+                if (it->second == offset)
+                {
+                    page.freeBySize.erase(it);
+                    break;
+                }
+            }
+        }
+};
+
+// The vertex and index ranges of one mesh in a pair of arenas. Offsets are looked up on every draw, so the mesh keeps
+// drawing correctly after either arena is compacted. Vertex ranges are aligned to the stride, which lets every mesh in
+// a page share one vertex array built at offset 0 and draw with a base vertex.
+struct ArenaGeometry
+{
+    BufferArena* vertexArena = NULL;
+    BufferArena* indexArena = NULL;
+    BufferArena::Handle vertices = BufferArena::INVALID_HANDLE;
+    BufferArena::Handle indices = BufferArena::INVALID_HANDLE;
+    // Bytes per vertex.
+    size_t stride = 0;
+
+    void upload(BufferArena& vertexBuffers, const void* vertexData, size_t vertexBytes, size_t vertexStride, BufferArena& indexBuffers, const void* indexData, size_t indexBytes, size_t indexSize)
+    {
+        vertexArena = &vertexBuffers;
+        indexArena = &indexBuffers;
+        stride = vertexStride;
+        vertices = vertexArena->upload(vertexData, vertexBytes, stride);
+        indices = indexArena->upload(indexData, indexBytes, indexSize);
+    }
+
+    void release()
+    {
+        if (vertexArena)
+        {
+            vertexArena->release(vertices);
+            indexArena->release(indices);
+        }
+        *this = ArenaGeometry();
+    }
+
+    bool isUploaded() const
+    {
+        return vertexArena != NULL;
+    }
+
+    unsigned int vertexBuffer() const
+    {
+        return vertexArena->range(vertices).buffer;
+    }
+
+    unsigned int indexBuffer() const
+    {
+        return indexArena->range(indices).buffer;
+    }
+
+    // Draw with a vertex array made on vertexBuffer() and indexBuffer().
+    void draw(GLsizei count, GLenum indexType, GLsizei instanceCount = 1) const
+    {
+        void* first = (void*)(uintptr_t)indexArena->range(indices).offset;
+        GLint baseVertex = (GLint)(vertexArena->range(vertices).offset / stride);
+        if (instanceCount == 1)
+        {
+            glDrawElementsBaseVertex(GL_TRIANGLES, count, indexType, first, baseVertex);
+        }
+        else
+        {
+            glDrawElementsInstancedBaseVertex(GL_TRIANGLES, count, indexType, first, instanceCount, baseVertex);
+        }
+    }
+};
+#endif
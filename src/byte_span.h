@@ -0,0 +1,58 @@
+#ifndef BYTE_SPAN_H
+#define BYTE_SPAN_H
+
+#include <vector>
+#include <cstddef>
+
+// A read-only view of bytes owned elsewhere, such as a mapped asset archive or a file read into a vector.
+// Converts implicitly from a vector, so loaders can take either without copying.
+class ByteSpan
+{
+    public:
+        ByteSpan() : bytes(NULL), length(0)
+        {
+        }
+
+        ByteSpan(const unsigned char* bytes, size_t length) : bytes(bytes), length(length)
+        {
+        }
+
+        ByteSpan(const std::vector<unsigned char>& vector) : bytes(vector.data()), length(vector.size())
+        {
+        }
+
+        const unsigned char* data() const
+        {
+            return bytes;
+        }
+
+        size_t size() const
+        {
+            return length;
+        }
+
+        bool empty() const
+        {
+            return length == 0;
+        }
+
+        const unsigned char* begin() const
+        {
+            return bytes;
+        }
+
+        const unsigned char* end() const
+        {
+            return bytes + length;
+        }
+
+        const unsigned char& operator[](size_t index) const
+        {
+            return bytes[index];
+        }
+
+    private:
+        const unsigned char* bytes;
+        size_t length;
+};
+#endif
@@ -11,6 +11,7 @@
  */
 
 #include <iostream>
+#include <chrono>
 
 #define GLEW_STATIC 1   // This allows linking with Static Library on Windows, without DLL.
 #include <GL/glew.h>    // Include GLEW - OpenGL Extension Wrangler.
@@ -20,10 +21,11 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
-#define STB_IMAGE_IMPLEMENTATION
-#include "stb_image.h"
 #include "shader.h"
+#include "shader_watcher.h"
 #include "camera.h"
+#include "scene.h"
+#include "headless_renderer.h"
 
 // Adjust viewport on window resize.
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
@@ -35,6 +37,12 @@ void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
 // Detect user inputs.
 void processInput(GLFWwindow *window);
 
+// Open a window and render interactively, showing the mesh at meshPath in place of the cube if it is not empty.
+int runWindow(const std::string& meshPath, VertexFormat vertexFormat);
+
+// Read command line options. Returns false on invalid arguments.
+bool parseArguments(int argc, char* argv[], bool& headless, HeadlessOptions& options, std::string& archivePath);
+
 // Define screen width and height.
 const unsigned int SCREEN_WIDTH = 960;
 const unsigned int SCREEN_HEIGHT = 540;
@@ -52,11 +60,41 @@ float lastFrame = 0.0f;
 // Create a canera object.
 Camera camera(glm::vec3(0.0f, 0.0f, 3.0f));
 
-// Define variables for light object.
-glm::vec3 lightPos(1.2f, 1.0f, 2.0f);
-
 int main(int argc, char*argv[])
 {
+    bool headless = false;
+    HeadlessOptions options;
+    std::string archivePath;
+    if (!parseArguments(argc, argv, headless, options, archivePath))
+    {
+        std::cerr << "Usage: " << argv[0] << " [--assets FILE] [--mesh FILE.obj|.gltf|.glb|.mesh [--position-format float|half|snorm16] [--normal-format float|octahedral|2_10_10_10]] [--headless [--frames N] [--camera-script FILE] [--output DIR] [--size WIDTHxHEIGHT] [--threads N]]" << std::endl;
+        return -1;
+    }
+
+    // Read shaders and textures from an archive built by cook_assets if one is given, and from loose files otherwise.
+    // The archive is never picked up on its own: it shadows the loose files, so edits to them would be ignored.
+    if (!archivePath.empty() && assetArchive().open(archivePath))
+    {
+        std::cout << "Mapped " << assetArchive().size() << " assets from " << archivePath << std::endl;
+    }
+
+    // Render offscreen without a display.
+    if (headless)
+    {
+        return HeadlessRenderer::run(options);
+    }
+    return runWindow(options.meshPath, options.vertexFormat);
+}
+
+int runWindow(const std::string& meshPath, VertexFormat vertexFormat)
+{
+    // Load the model before opening the window so a bad file fails fast. Text formats are parsed once and mapped from the cache afterwards.
+    MeshFile model;
+    if (!meshPath.empty() && !HeadlessRenderer::loadMesh(meshPath, "../mesh_cache", vertexFormat, model))
+    {
+        return -1;
+    }
+
     // Initialize GLFW and OpenGL version.
     glfwInit();
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3); 
@@ -92,173 +130,127 @@ int main(int argc, char*argv[])
         return -1;
     }
 
-    const char* vertexShaderPath = "../shaders/basic_lighting_vertex_shader.txt";
-    const char* fragmentShaderPath = "../shaders/basic_lighting_fragment_shader.txt";
-    const char* lightCubeVertexShaderPath = "../shaders/light_cube_vertex_shader.txt";
-    const char* lightCubeFragmentShaderPath = "../shaders/light_cube_fragment_shader.txt";
-    Shader light_shader_program(vertexShaderPath, fragmentShaderPath);
-    Shader light_cube_shader_program(lightCubeVertexShaderPath, lightCubeFragmentShaderPath);
-
-    float vertices[] = {
-        -0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,
-         0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,
-         0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,
-         0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,
-        -0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,
-        -0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,
-
-        -0.5f, -0.5f,  0.5f,  0.0f,  0.0f,  1.0f,
-         0.5f, -0.5f,  0.5f,  0.0f,  0.0f,  1.0f,
-         0.5f,  0.5f,  0.5f,  0.0f,  0.0f,  1.0f,
-         0.5f,  0.5f,  0.5f,  0.0f,  0.0f,  1.0f,
-        -0.5f,  0.5f,  0.5f,  0.0f,  0.0f,  1.0f,
-        -0.5f, -0.5f,  0.5f,  0.0f,  0.0f,  1.0f,
-
-        -0.5f,  0.5f,  0.5f, -1.0f,  0.0f,  0.0f,
-        -0.5f,  0.5f, -0.5f, -1.0f,  0.0f,  0.0f,
-        -0.5f, -0.5f, -0.5f, -1.0f,  0.0f,  0.0f,
-        -0.5f, -0.5f, -0.5f, -1.0f,  0.0f,  0.0f,
-        -0.5f, -0.5f,  0.5f, -1.0f,  0.0f,  0.0f,
-        -0.5f,  0.5f,  0.5f, -1.0f,  0.0f,  0.0f,
-
-         0.5f,  0.5f,  0.5f,  1.0f,  0.0f,  0.0f,
-         0.5f,  0.5f, -0.5f,  1.0f,  0.0f,  0.0f,
-         0.5f, -0.5f, -0.5f,  1.0f,  0.0f,  0.0f,
-         0.5f, -0.5f, -0.5f,  1.0f,  0.0f,  0.0f,
-         0.5f, -0.5f,  0.5f,  1.0f,  0.0f,  0.0f,
-         0.5f,  0.5f,  0.5f,  1.0f,  0.0f,  0.0f,
-
-        -0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f,
-         0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f,
-         0.5f, -0.5f,  0.5f,  0.0f, -1.0f,  0.0f,
-         0.5f, -0.5f,  0.5f,  0.0f, -1.0f,  0.0f,
-        -0.5f, -0.5f,  0.5f,  0.0f, -1.0f,  0.0f,
-        -0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f,
-
-        -0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,
-         0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,
-         0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,
-         0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,
-        -0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,
-        -0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f
-    };
-
-
-    // Create a vertex array.
-    GLuint vertexArrayObject;
-    glGenVertexArrays(1, &vertexArrayObject);
-    glBindVertexArray(vertexArrayObject);
-
-    // Create a vertex buffer.
-    GLuint vertexBufferObject;
-    glGenBuffers(1, &vertexBufferObject);
-    
-    // Copy vertices in vertex buffer.
-    glBindBuffer(GL_ARRAY_BUFFER, vertexBufferObject);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-
-    // Set the vertex attributes pointers.
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3*sizeof(float)));
-    glEnableVertexAttribArray(1);
-
-    // Unbind vertex buffer.
-    glBindBuffer(GL_ARRAY_BUFFER, 0); 
-    // Unbind vertex array.
-    glBindVertexArray(0);
-
-    // Create a vertex array for the light cube.
-    GLuint lightVertexArrayObject;
-    glGenVertexArrays(1, &lightVertexArrayObject);
-    glBindVertexArray(lightVertexArrayObject);
-
-    // Create a vertex buffer for the light cube.
-    GLuint lightVertexBufferObject;
-    glGenBuffers(1, &lightVertexBufferObject);
-    
-    // Copy vertices in vertex buffer for the light cube.
-    glBindBuffer(GL_ARRAY_BUFFER, lightVertexBufferObject);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-
-    // Set the vertex attributes pointers for the light cube.
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-
-    // Unbind vertex buffer.
-    glBindBuffer(GL_ARRAY_BUFFER, 0); 
-    // Unbind vertex array.
-    glBindVertexArray(0); 
-
-    // Enable depth testing.
-    glEnable(GL_DEPTH_TEST);
-
-    // Entering Main Loop.
-    while(!glfwWindowShouldClose(window))
+    // GL objects live in this scope so they are deleted before the context.
     {
-
-        // Update variables that keep track of time.
-        currentFrame = (float) glfwGetTime();
-        deltaTime = currentFrame - lastFrame;
-        lastFrame = currentFrame;
-
-        // Set default pixel color.
-        glClearColor(0.1, 0.1, 0.1, 1.0f);
-
-        // Clear color an depth buffer.
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-        // Activate shader program.
-        light_shader_program.use();
-        light_shader_program.setVec3("objectColor", 1.0f, 0.5f, 0.31f);
-        light_shader_program.setVec3("lightColor", 1.0f, 1.0f, 1.0f);
-        light_shader_program.setVec3("lightPos", lightPos);
-        light_shader_program.setVec3("viewPos", camera.Position);
-
-        // Define view and projection transformations.
-        glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCREEN_WIDTH / (float)SCREEN_HEIGHT, 0.1f, 100.0f);
-        glm::mat4 view = camera.GetViewMatrix();
-        light_shader_program.setMat4("projection", projection);
-        light_shader_program.setMat4("view", view);
-
-        // Define world transformation.
-        glm::mat4 model = glm::mat4(1.0f);
-        light_shader_program.setMat4("model", model);
-
-        // Render an object.
-        glBindVertexArray(vertexArrayObject);
-        glDrawArrays(GL_TRIANGLES, 0, 36);
-
-
-        // Draw light cube.
-        light_cube_shader_program.use();
-        light_cube_shader_program.setMat4("projection", projection);
-        light_cube_shader_program.setMat4("view", view);
-        model = glm::mat4(1.0f);
-        model = glm::translate(model, lightPos);
-        model = glm::scale(model, glm::vec3(0.2f));
-        light_cube_shader_program.setMat4("model", model);
-
-        glBindVertexArray(lightVertexArrayObject);
-        glDrawArrays(GL_TRIANGLES, 0, 36);
-
-        // Process user input.
-        processInput(window);
-
-        // End frame.
-        glfwSwapBuffers(window);
-        
-        // Detect inputs.
-        glfwPollEvents();
+        // Reuse linked program binaries from previous launches when the driver supports it.
+        ProgramBinaryCache programCache("../shader_cache");
+
+        // Rebuild programs when their sources are edited.
+        ShaderWatcher shaderWatcher("../shaders");
+
+        Scene scene(&programCache, &shaderWatcher, "../shaders", model.isOpen() ? &model : NULL);
+        std::cout << "Shader startup: " << scene.ShaderStartupMs << " ms (" << programCache.Hits << " from cache, " << programCache.Misses << " compiled)" << std::endl;
+        scene.CubeStatsBefore.print(std::cout, "Cube before");
+        scene.CubeStatsAfter.print(std::cout, "Cube after");
+        scene.VertexBuffers.stats().print(std::cout, "Vertex buffers");
+        scene.IndexBuffers.stats().print(std::cout, "Index buffers");
+
+        // Entering Main Loop.
+        while(!glfwWindowShouldClose(window))
+        {
+            // Swap in shaders that were edited since the last frame.
+            shaderWatcher.update();
+
+            // Update variables that keep track of time.
+            currentFrame = (float) glfwGetTime();
+            deltaTime = currentFrame - lastFrame;
+            lastFrame = currentFrame;
+
+            scene.render(camera, (float)SCREEN_WIDTH / (float)SCREEN_HEIGHT);
+
+            // Process user input.
+            processInput(window);
+
+            // End frame.
+            glfwSwapBuffers(window);
+            
+            // Detect inputs.
+            glfwPollEvents();
+        }
     }
     
+    // Report how many state changes were dropped as redundant.
+    GLStateCache& state = glStateCache();
+    std::cout << "Uniform calls: " << state.Uniforms.issued << " issued, " << state.Uniforms.skipped << " skipped" << std::endl;
+    std::cout << "Program binds: " << state.Programs.issued << " issued, " << state.Programs.skipped << " skipped" << std::endl;
+    std::cout << "Vertex array binds: " << state.VertexArrays.issued << " issued, " << state.VertexArrays.skipped << " skipped" << std::endl;
+    std::cout << "Texture binds: " << state.Textures.issued << " issued, " << state.Textures.skipped << " skipped" << std::endl;
+
     // Shutdown GLFW.
     glfwTerminate();
     
 	return 0;
 }
 
+bool parseArguments(int argc, char* argv[], bool& headless, HeadlessOptions& options, std::string& archivePath)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        std::string argument = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (argument == "--headless")
+        {
+            headless = true;
+        }
+        else if (argument == "--assets" && hasValue)
+        {
+            archivePath = argv[++i];
+        }
+        else if (argument == "--mesh" && hasValue)
+        {
+            options.meshPath = argv[++i];
+        }
+        else if (argument == "--position-format" && hasValue)
+        {
+            if (!options.vertexFormat.setPosition(argv[++i]))
+            {
+                return false;
+            }
+        }
+        else if (argument == "--normal-format" && hasValue)
+        {
+            if (!options.vertexFormat.setNormal(argv[++i]))
+            {
+                return false;
+            }
+        }
+        else if (argument == "--frames" && hasValue)
+        {
+            if (std::sscanf(argv[++i], "%u", &options.frames) != 1)
+            {
+                return false;
+            }
+        }
+        else if (argument == "--camera-script" && hasValue)
+        {
+            options.cameraScript = argv[++i];
+        }
+        else if (argument == "--output" && hasValue)
+        {
+            options.outputDirectory = argv[++i];
+        }
+        else if (argument == "--threads" && hasValue)
+        {
+            if (std::sscanf(argv[++i], "%u", &options.threads) != 1)
+            {
+                return false;
+            }
+        }
+        else if (argument == "--size" && hasValue)
+        {
+            if (std::sscanf(argv[++i], "%ux%u", &options.width, &options.height) != 2 || options.width == 0 || options.height == 0)
+            {
+                return false;
+            }
+        }
+        else
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
 // Adjust viewport on window resize.
 void framebuffer_size_callback(GLFWwindow* window, int width, int height)
 {
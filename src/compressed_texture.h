@@ -0,0 +1,322 @@
+#ifndef COMPRESSED_TEXTURE_H
+#define COMPRESSED_TEXTURE_H
+
+#include <string>
+#include <vector>
+#include <iostream>
+#include <cstdint>
+#include <cstring>
+#include <cctype>
+#include <algorithm>
+
+#include "mip_chain.h"
+#include "byte_span.h"
+
+// Reads KTX 1.1 and DDS containers holding 2D BC1, BC3, BC4, BC5, BC7 or ETC2 mip chains, ready for
+// glCompressedTexImage2D without decoding. KTX files may also hold uncompressed 8-bit RED, RG, RGB or RGBA levels.
+// Cube maps, arrays and volume textures are rejected.
+class CompressedTextureLoader
+{
+    public:
+        // Returns true if the file name ends in .ktx or .dds.
+        static bool isContainer(const std::string& path)
+        {
+            return hasExtension(path, ".ktx") || hasExtension(path, ".dds");
+        }
+
+        // Parse a container already in memory, read from a file or mapped from an asset archive. The format of the file is picked by its extension.
+        static bool parse(const std::string& path, const ByteSpan& bytes, MipChain& texture)
+        {
+            bool parsed = hasExtension(path, ".ktx") ? parseKTX(bytes, texture) : parseDDS(bytes, texture);
+            if (!parsed)
+            {
+                std::cout << "ERROR::COMPRESSED_TEXTURE::UNSUPPORTED_CONTAINER " << path << std::endl;
+            }
+            return parsed;
+        }
+
+        // Bytes per 4x4 block, or 0 for formats this loader does not know.
+        static size_t blockBytes(GLenum format)
+        {
+            switch (format)
+            {
+                case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+                case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT:
+                case GL_COMPRESSED_SRGB_S3TC_DXT1_EXT:
+                case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT:
+                case GL_COMPRESSED_RED_RGTC1:
+                case GL_COMPRESSED_RGB8_ETC2:
+                case GL_COMPRESSED_SRGB8_ETC2:
+                case GL_COMPRESSED_RGB8_PUNCHTHROUGH_ALPHA1_ETC2:
+                    return 8;
+                case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+                case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT:
+                case GL_COMPRESSED_RG_RGTC2:
+                case GL_COMPRESSED_RGBA_BPTC_UNORM:
+                case GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM:
+                case GL_COMPRESSED_RGBA8_ETC2_EAC:
+                case GL_COMPRESSED_SRGB8_ALPHA8_ETC2_EAC:
+                    return 16;
+            }
+            return 0;
+        }
+
+        // Uncompressed base format of a compressed format, as KTX headers record it.
+        static GLenum baseFormat(GLenum format)
+        {
+            switch (format)
+            {
+                case GL_COMPRESSED_RED_RGTC1:
+                    return GL_RED;
+                case GL_COMPRESSED_RG_RGTC2:
+                    return GL_RG;
+                case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+                case GL_COMPRESSED_SRGB_S3TC_DXT1_EXT:
+                case GL_COMPRESSED_RGB8_ETC2:
+                case GL_COMPRESSED_SRGB8_ETC2:
+                    return GL_RGB;
+            }
+            return GL_RGBA;
+        }
+
+        // Returns true if the driver can sample the compressed format. Only reads the GLEW extension flags, so any thread may call it after glewInit.
+        static bool isSupported(GLenum format)
+        {
+            switch (format)
+            {
+                case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+                case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT:
+                case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+                    return GLEW_EXT_texture_compression_s3tc;
+                case GL_COMPRESSED_SRGB_S3TC_DXT1_EXT:
+                case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT:
+                case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT:
+                    return GLEW_EXT_texture_compression_s3tc && GLEW_EXT_texture_sRGB;
+                case GL_COMPRESSED_RED_RGTC1:
+                case GL_COMPRESSED_RG_RGTC2:
+                    // Core since 3.0.
+                    return true;
+                case GL_COMPRESSED_RGBA_BPTC_UNORM:
+                case GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM:
+                    return GLEW_VERSION_4_2 || GLEW_ARB_texture_compression_bptc;
+                case GL_COMPRESSED_RGB8_ETC2:
+                case GL_COMPRESSED_SRGB8_ETC2:
+                case GL_COMPRESSED_RGB8_PUNCHTHROUGH_ALPHA1_ETC2:
+                case GL_COMPRESSED_RGBA8_ETC2_EAC:
+                case GL_COMPRESSED_SRGB8_ALPHA8_ETC2_EAC:
+                    return GLEW_VERSION_4_3 || GLEW_ARB_ES3_compatibility;
+            }
+            return false;
+        }
+
+    private:
+        static bool hasExtension(const std::string& path, const char* extension)
+        {
+            size_t length = strlen(extension);
+            if (path.size() < length)
+            {
+                return false;
+            }
+            for (size_t i = 0; i < length; i++)
+            {
+                if (tolower((unsigned char)path[path.size() - length + i]) != extension[i])
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        static uint32_t read32(const ByteSpan& bytes, size_t offset)
+        {
+            uint32_t value;
+            memcpy(&value, &bytes[offset], sizeof(value));
+            return value;
+        }
+
+        // Byte size of one level of a chain.
+        static size_t levelSize(const MipChain& texture, int width, int height)
+        {
+            if (!texture.isCompressed())
+            {
+                return rowBytes(width, formatChannels(texture.Format)) * height;
+            }
+            return (size_t)((width + 3) / 4) * (size_t)((height + 3) / 4) * blockBytes(texture.InternalFormat);
+        }
+
+        // Fill levels for a tightly packed mip chain that starts at offset. Returns false if the data is too short.
+        static bool addPackedLevels(MipChain& texture, size_t offset, unsigned int levelCount, size_t available)
+        {
+            int width = texture.Width;
+            int height = texture.Height;
+            for (unsigned int level = 0; level < levelCount; level++)
+            {
+                size_t size = levelSize(texture, width, height);
+                if (offset + size > available)
+                {
+                    return false;
+                }
+                texture.Levels.push_back({ width, height, offset, size });
+                offset += size;
+                width = width > 1 ? width / 2 : 1;
+                height = height > 1 ? height / 2 : 1;
+            }
+            return true;
+        }
+
+        // Copy the bytes from the first to the last level into Data, so level offsets start at 0 and the headers are dropped.
+        static void keepLevelData(const ByteSpan& bytes, MipChain& texture)
+        {
+            size_t first = texture.Levels.front().offset;
+            size_t end = texture.Levels.back().offset + texture.Levels.back().size;
+            texture.Data.assign(bytes.begin() + first, bytes.begin() + end);
+            for (MipLevel& level : texture.Levels)
+            {
+                level.offset -= first;
+            }
+        }
+
+        static bool parseKTX(const ByteSpan& bytes, MipChain& texture)
+        {
+            static const unsigned char IDENTIFIER[12] = { 0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', 0x1A, '\n' };
+            const size_t HEADER_SIZE = 64;
+            if (bytes.size() < HEADER_SIZE || memcmp(bytes.data(), IDENTIFIER, sizeof(IDENTIFIER)) != 0)
+            {
+                return false;
+            }
+            // Files written on a machine with the other byte order would need swapping; none of our targets are big-endian.
+            if (read32(bytes, 12) != 0x04030201)
+            {
+                return false;
+            }
+            uint32_t glType = read32(bytes, 16);
+            texture.Format = read32(bytes, 24);
+            texture.InternalFormat = read32(bytes, 28);
+            texture.Width = (int)read32(bytes, 36);
+            texture.Height = (int)read32(bytes, 40);
+            uint32_t depth = read32(bytes, 44);
+            uint32_t arrayElements = read32(bytes, 48);
+            uint32_t faces = read32(bytes, 52);
+            uint32_t levelCount = std::max(1u, read32(bytes, 56));
+            uint32_t keyValueBytes = read32(bytes, 60);
+            // Compressed files have no type or format. Uncompressed ones need 8-bit channels.
+            bool compressed = glType == 0 && texture.Format == 0 && blockBytes(texture.InternalFormat) > 0;
+            bool uncompressed = glType == GL_UNSIGNED_BYTE && (texture.Format == GL_RED || texture.Format == GL_RG || texture.Format == GL_RGB || texture.Format == GL_RGBA);
+            if (!(compressed || uncompressed) || depth > 1 || arrayElements > 0 || faces != 1 || texture.Width <= 0 || texture.Height <= 0)
+            {
+                return false;
+            }
+
+            // Each level is prefixed with its size and padded to 4 bytes.
+            size_t offset = HEADER_SIZE + keyValueBytes;
+            int width = texture.Width;
+            int height = texture.Height;
+            for (uint32_t level = 0; level < levelCount; level++)
+            {
+                if (offset + 4 > bytes.size())
+                {
+                    return false;
+                }
+                size_t size = read32(bytes, offset);
+                offset += 4;
+                if (size != levelSize(texture, width, height) || offset + size > bytes.size())
+                {
+                    return false;
+                }
+                texture.Levels.push_back({ width, height, offset, size });
+                offset += (size + 3) & ~(size_t)3;
+                width = width > 1 ? width / 2 : 1;
+                height = height > 1 ? height / 2 : 1;
+            }
+            keepLevelData(bytes, texture);
+            return true;
+        }
+
+        static bool parseDDS(const ByteSpan& bytes, MipChain& texture)
+        {
+            const size_t HEADER_SIZE = 4 + 124;
+            if (bytes.size() < HEADER_SIZE || memcmp(bytes.data(), "DDS ", 4) != 0)
+            {
+                return false;
+            }
+            texture.Height = (int)read32(bytes, 12);
+            texture.Width = (int)read32(bytes, 16);
+            uint32_t levelCount = std::max(1u, read32(bytes, 28));
+            uint32_t pixelFlags = read32(bytes, 80);
+            uint32_t fourCC = read32(bytes, 84);
+            uint32_t caps2 = read32(bytes, 112);
+            const uint32_t DDPF_FOURCC = 0x4;
+            const uint32_t DDPF_ALPHAPIXELS = 0x1;
+            const uint32_t DDSCAPS2_CUBEMAP_OR_VOLUME = 0x200 | 0x200000;
+            if (!(pixelFlags & DDPF_FOURCC) || (caps2 & DDSCAPS2_CUBEMAP_OR_VOLUME) || texture.Width <= 0 || texture.Height <= 0)
+            {
+                return false;
+            }
+
+            size_t offset = HEADER_SIZE;
+            texture.InternalFormat = 0;
+            texture.Format = 0;
+            if (fourCC == makeFourCC("DX10"))
+            {
+                // Extended header with a DXGI format.
+                if (bytes.size() < HEADER_SIZE + 20)
+                {
+                    return false;
+                }
+                uint32_t dxgiFormat = read32(bytes, HEADER_SIZE);
+                uint32_t dimension = read32(bytes, HEADER_SIZE + 4);
+                uint32_t arraySize = read32(bytes, HEADER_SIZE + 12);
+                const uint32_t DIMENSION_TEXTURE2D = 3;
+                if (dimension != DIMENSION_TEXTURE2D || arraySize > 1)
+                {
+                    return false;
+                }
+                texture.InternalFormat = formatFromDXGI(dxgiFormat);
+                offset += 20;
+            }
+            else if (fourCC == makeFourCC("DXT1"))
+            {
+                texture.InternalFormat = (pixelFlags & DDPF_ALPHAPIXELS) ? GL_COMPRESSED_RGBA_S3TC_DXT1_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+            }
+            else if (fourCC == makeFourCC("DXT5"))
+            {
+                texture.InternalFormat = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+            }
+            else if (fourCC == makeFourCC("ATI1") || fourCC == makeFourCC("BC4U"))
+            {
+                texture.InternalFormat = GL_COMPRESSED_RED_RGTC1;
+            }
+            else if (fourCC == makeFourCC("ATI2") || fourCC == makeFourCC("BC5U"))
+            {
+                texture.InternalFormat = GL_COMPRESSED_RG_RGTC2;
+            }
+            if (texture.InternalFormat == 0 || !addPackedLevels(texture, offset, levelCount, bytes.size()))
+            {
+                return false;
+            }
+            keepLevelData(bytes, texture);
+            return true;
+        }
+
+        static uint32_t makeFourCC(const char* code)
+        {
+            return (uint32_t)(uint8_t)code[0] | ((uint32_t)(uint8_t)code[1] << 8) | ((uint32_t)(uint8_t)code[2] << 16) | ((uint32_t)(uint8_t)code[3] << 24);
+        }
+
+        static GLenum formatFromDXGI(uint32_t format)
+        {
+            switch (format)
+            {
+                case 71: return GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;        // DXGI_FORMAT_BC1_UNORM
+                case 72: return GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT;  // DXGI_FORMAT_BC1_UNORM_SRGB
+                case 77: return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;        // DXGI_FORMAT_BC3_UNORM
+                case 78: return GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT;  // DXGI_FORMAT_BC3_UNORM_SRGB
+                case 80: return GL_COMPRESSED_RED_RGTC1;                 // DXGI_FORMAT_BC4_UNORM
+                case 83: return GL_COMPRESSED_RG_RGTC2;                  // DXGI_FORMAT_BC5_UNORM
+                case 98: return GL_COMPRESSED_RGBA_BPTC_UNORM;           // DXGI_FORMAT_BC7_UNORM
+                case 99: return GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM;     // DXGI_FORMAT_BC7_UNORM_SRGB
+            }
+            return 0;
+        }
+};
+#endif
@@ -0,0 +1,57 @@
+#ifndef FRAME_DATA_H
+#define FRAME_DATA_H
+
+#include <cstddef>
+
+#include <glm/glm.hpp>
+
+// Binding point of the FrameData uniform block. Every program that declares the block is attached to it after linking.
+const unsigned int FRAME_DATA_BINDING = 0;
+
+// CPU mirror of the std140 FrameData uniform block declared in the shaders. vec3 values are stored as vec4 to match std140 alignment.
+struct FrameData
+{
+    glm::mat4 projection;
+    glm::mat4 view;
+    glm::vec4 lightPos;
+    glm::vec4 viewPos;
+    glm::vec4 lightColor;
+};
+
+// Keep the struct in sync with the std140 layout of the block.
+static_assert(offsetof(FrameData, projection) == 0, "FrameData.projection must be at offset 0");
+static_assert(offsetof(FrameData, view) == 64, "FrameData.view must be at offset 64");
+static_assert(offsetof(FrameData, lightPos) == 128, "FrameData.lightPos must be at offset 128");
+static_assert(offsetof(FrameData, viewPos) == 144, "FrameData.viewPos must be at offset 144");
+static_assert(offsetof(FrameData, lightColor) == 160, "FrameData.lightColor must be at offset 160");
+static_assert(sizeof(FrameData) == 176, "FrameData must match the std140 block size");
+
+// Uniform buffer holding the FrameData block, bound once to FRAME_DATA_BINDING and shared by all programs.
+class FrameUniformBuffer
+{
+    public:
+        unsigned int ID;
+
+        FrameUniformBuffer()
+        {
+            glGenBuffers(1, &ID);
+            glBindBuffer(GL_UNIFORM_BUFFER, ID);
+            glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameData), NULL, GL_DYNAMIC_DRAW);
+            glBindBuffer(GL_UNIFORM_BUFFER, 0);
+            glBindBufferBase(GL_UNIFORM_BUFFER, FRAME_DATA_BINDING, ID);
+        }
+
+        ~FrameUniformBuffer()
+        {
+            glDeleteBuffers(1, &ID);
+        }
+
+        // Upload the data for this frame with a single call.
+        void update(const FrameData& data)
+        {
+            glBindBuffer(GL_UNIFORM_BUFFER, ID);
+            glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(FrameData), &data);
+            glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        }
+};
+#endif
@@ -0,0 +1,206 @@
+#ifndef FRAME_RING_BUFFER_H
+#define FRAME_RING_BUFFER_H
+
+#include <vector>
+#include <iostream>
+#include <cstdint>
+#include <algorithm>
+
+// Buffer for data rewritten every frame, such as instance transforms and per-draw constants, split into one region per
+// frame in flight. Each frame writes its region while the GPU may still be reading the previous ones, and a fence per
+// region keeps the CPU from overwriting data before the frame that read it has finished. With ARB_buffer_storage the
+// buffer stays persistently mapped, so a frame's data is written straight into GL memory with no calls at all;
+// otherwise the buffer is orphaned and mapped once per frame, leaving the driver to keep old storage alive.
+class FrameRingBuffer
+{
+    public:
+        // Bytes each frame can write.
+        size_t FrameBytes;
+
+        // Frames started and number of times beginFrame() had to wait for the GPU to finish with a region.
+        unsigned long Frames;
+        unsigned long Stalls;
+
+        // frameBytes may be 0 and set later with reserve(). persistentMapping false forces the orphaning path.
+        FrameRingBuffer(GLenum target, size_t frameBytes, unsigned int framesInFlight = 3, bool persistentMapping = true)
+            : FrameBytes(0), Frames(0), Stalls(0), target(target), buffer(0), memory(NULL), current(0), used(0), writing(false)
+        {
+            persistent = persistentMapping && (GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage);
+            fences.assign(persistent ? (framesInFlight ? framesInFlight : 1) : 1, (GLsync)0);
+            reserve(frameBytes);
+        }
+
+        ~FrameRingBuffer()
+        {
+            destroy();
+        }
+
+        FrameRingBuffer(const FrameRingBuffer&) = delete;
+        FrameRingBuffer& operator=(const FrameRingBuffer&) = delete;
+
+        // Make room for at least frameBytes per frame. Growing replaces the buffer, so its name changes and anything
+        // pointing at it has to be set up again. Call outside beginFrame() and endFrame().
+        void reserve(size_t frameBytes)
+        {
+            if (frameBytes <= FrameBytes)
+            {
+                return;
+            }
+            // Grow geometrically so a count that creeps up every frame does not replace the buffer every frame.
+            size_t bytes = std::max(frameBytes, FrameBytes * 2);
+            destroy();
+            FrameBytes = bytes;
+            glGenBuffers(1, &buffer);
+            glBindBuffer(target, buffer);
+            if (persistent)
+            {
+                GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+                glBufferStorage(target, FrameBytes * fences.size(), NULL, flags);
+                memory = (unsigned char*)glMapBufferRange(target, 0, FrameBytes * fences.size(), flags);
+                if (!memory)
+                {
+                    std::cout << "ERROR::FRAME_RING_BUFFER::MAP_FAILED" << std::endl;
+                }
+            }
+            else
+            {
+                glBufferData(target, FrameBytes, NULL, GL_STREAM_DRAW);
+            }
+            glBindBuffer(target, 0);
+        }
+
+        // Start writing the next frame's region, waiting if the GPU is still reading it. Fences the commands issued
+        // since the previous beginFrame(), so call it before writing a frame's data, after the last frame's draws.
+        void beginFrame()
+        {
+            if (persistent)
+            {
+                if (Frames > 0)
+                {
+                    fences[current] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+                    current = (current + 1) % (unsigned int)fences.size();
+                }
+                wait(fences[current]);
+            }
+            else
+            {
+                // Orphan the storage the last frame's draws read and map fresh storage without synchronizing.
+                glBindBuffer(target, buffer);
+                glBufferData(target, FrameBytes, NULL, GL_STREAM_DRAW);
+                memory = (unsigned char*)glMapBufferRange(target, 0, FrameBytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+                glBindBuffer(target, 0);
+                if (!memory)
+                {
+                    std::cout << "ERROR::FRAME_RING_BUFFER::MAP_FAILED" << std::endl;
+                }
+            }
+            used = 0;
+            writing = true;
+            Frames++;
+        }
+
+        // Writable space for size bytes of this frame, aligned to alignment, which must be a power of two. Offset
+        // receives the position in bufferID() for vertex attribute pointers or glBindBufferRange. Returns NULL when the
+        // frame's region is full or no frame was begun.
+        unsigned char* allocate(size_t size, size_t alignment, size_t& offset)
+        {
+            size_t start = (used + alignment - 1) & ~(alignment - 1);
+            if (!writing || !memory || start + size > FrameBytes)
+            {
+                return NULL;
+            }
+            used = start + size;
+            offset = regionOffset() + start;
+            return memory + regionOffset() + start;
+        }
+
+        // Finish this frame's writes. Call before drawing with them.
+        void endFrame()
+        {
+            if (!persistent && memory)
+            {
+                glBindBuffer(target, buffer);
+                glUnmapBuffer(target);
+                glBindBuffer(target, 0);
+                memory = NULL;
+            }
+            writing = false;
+        }
+
+        unsigned int bufferID() const
+        {
+            return buffer;
+        }
+
+        unsigned int framesInFlight() const
+        {
+            return (unsigned int)fences.size();
+        }
+
+        bool isPersistent() const
+        {
+            return persistent;
+        }
+
+    private:
+        GLenum target;
+        bool persistent;
+        unsigned int buffer;
+        unsigned char* memory;
+        // One fence per region, set when the region's frame is over.
+        std::vector<GLsync> fences;
+        unsigned int current;
+        size_t used;
+        bool writing;
+
+        size_t regionOffset() const
+        {
+            return persistent ? current * FrameBytes : 0;
+        }
+
+        void wait(GLsync& fence)
+        {
+            if (!fence)
+            {
+                return;
+            }
+            if (glClientWaitSync(fence, 0, 0) == GL_TIMEOUT_EXPIRED)
+            {
+                Stalls++;
+                // Flush so the fence is sure to be reached, then block until it is.
+                while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000ull) == GL_TIMEOUT_EXPIRED)
+                {
+                }
+            }
+            glDeleteSync(fence);
+            fence = 0;
+        }
+
+        void destroy()
+        {
+            for (GLsync& fence : fences)
+            {
+                if (fence)
+                {
+                    glDeleteSync(fence);
+                    fence = 0;
+                }
+            }
+            if (buffer)
+            {
+                if (memory)
+                {
+                    glBindBuffer(target, buffer);
+                    glUnmapBuffer(target);
+                    glBindBuffer(target, 0);
+                }
+                glDeleteBuffers(1, &buffer);
+            }
+            buffer = 0;
+            memory = NULL;
+            current = 0;
+            used = 0;
+            writing = false;
+        }
+};
+#endif
@@ -0,0 +1,123 @@
+#ifndef GL_STATE_H
+#define GL_STATE_H
+
+// Number of GL calls that were sent to the driver and number that were skipped because they would not change anything.
+struct StateCounters
+{
+    unsigned long issued;
+    unsigned long skipped;
+
+    StateCounters() : issued(0), skipped(0) {}
+};
+
+// Remembers the currently bound program, vertex array and textures and drops binds that would not change them.
+// Every bind of these objects has to go through the cache, otherwise it falls out of sync with the context.
+class GLStateCache
+{
+    public:
+        // Savings per kind of call.
+        StateCounters Programs;
+        StateCounters VertexArrays;
+        StateCounters Textures;
+        StateCounters Uniforms;
+
+        GLStateCache()
+        {
+            reset();
+        }
+
+        // Forget everything, e.g. after code outside the cache changed bindings.
+        void reset()
+        {
+            program = UNKNOWN;
+            vertexArray = UNKNOWN;
+            activeUnit = UNKNOWN;
+            for (unsigned int i = 0; i < MAX_UNITS; i++)
+            {
+                textures[i] = UNKNOWN;
+            }
+        }
+
+        void useProgram(unsigned int id)
+        {
+            if (program == id)
+            {
+                Programs.skipped++;
+                return;
+            }
+            glUseProgram(id);
+            program = id;
+            Programs.issued++;
+        }
+
+        // Call before deleting a program. GL names are reused, so a new program could get the same ID.
+        void forgetProgram(unsigned int id)
+        {
+            if (program == id)
+            {
+                program = UNKNOWN;
+            }
+        }
+
+        void bindVertexArray(unsigned int id)
+        {
+            if (vertexArray == id)
+            {
+                VertexArrays.skipped++;
+                return;
+            }
+            glBindVertexArray(id);
+            vertexArray = id;
+            VertexArrays.issued++;
+        }
+
+        // Bind a 2D texture to a texture unit.
+        void bindTexture(unsigned int unit, unsigned int id)
+        {
+            if (unit < MAX_UNITS && textures[unit] == id)
+            {
+                Textures.skipped++;
+                return;
+            }
+            if (activeUnit != unit)
+            {
+                glActiveTexture(GL_TEXTURE0 + unit);
+                activeUnit = unit;
+            }
+            glBindTexture(GL_TEXTURE_2D, id);
+            if (unit < MAX_UNITS)
+            {
+                textures[unit] = id;
+            }
+            Textures.issued++;
+        }
+
+        // Call before deleting a texture.
+        void forgetTexture(unsigned int id)
+        {
+            for (unsigned int i = 0; i < MAX_UNITS; i++)
+            {
+                if (textures[i] == id)
+                {
+                    textures[i] = UNKNOWN;
+                }
+            }
+        }
+
+    private:
+        static constexpr unsigned int UNKNOWN = 0xFFFFFFFFu;
+        static constexpr unsigned int MAX_UNITS = 32;
+
+        unsigned int program;
+        unsigned int vertexArray;
+        unsigned int activeUnit;
+        unsigned int textures[MAX_UNITS];
+};
+
+// State cache of the GL context current on this thread. Each rendering thread owns its own context.
+inline GLStateCache& glStateCache()
+{
+    thread_local GLStateCache cache;
+    return cache;
+}
+#endif
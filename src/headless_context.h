@@ -0,0 +1,167 @@
+#ifndef HEADLESS_CONTEXT_H
+#define HEADLESS_CONTEXT_H
+
+#include <iostream>
+#include <vector>
+
+#if defined(CLEAN_HEADLESS_EGL)
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#elif defined(CLEAN_HEADLESS_OSMESA)
+#include <GL/osmesa.h>
+#endif
+
+// OpenGL context without a window or display, for render nodes and CI machines. Drawing goes to framebuffer objects.
+// Uses EGL surfaceless when built with CLEAN_HEADLESS_EGL and OSMesa when built with CLEAN_HEADLESS_OSMESA; both work
+// with Mesa's llvmpipe on machines without a GPU. Each context is current on the thread that created it, so one
+// thread per context can render in parallel.
+class HeadlessContext
+{
+    public:
+        // Create a core profile context of at least the given version and make it current on this thread.
+        HeadlessContext(int major = 3, int minor = 2) : valid(false)
+        {
+#if defined(CLEAN_HEADLESS_EGL)
+            display = EGL_NO_DISPLAY;
+            context = EGL_NO_CONTEXT;
+            valid = createEGL(major, minor);
+#elif defined(CLEAN_HEADLESS_OSMESA)
+            context = NULL;
+            valid = createOSMesa(major, minor);
+#else
+            std::cout << "ERROR::HEADLESS::NOT_AVAILABLE built without CLEAN_HEADLESS_EGL or CLEAN_HEADLESS_OSMESA" << std::endl;
+#endif
+        }
+
+        ~HeadlessContext()
+        {
+#if defined(CLEAN_HEADLESS_EGL)
+            if (context != EGL_NO_CONTEXT)
+            {
+                eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+                eglDestroyContext(display, context);
+            }
+            eglReleaseThread();
+#elif defined(CLEAN_HEADLESS_OSMESA)
+            if (context)
+            {
+                OSMesaDestroyContext(context);
+            }
+#endif
+        }
+
+        HeadlessContext(const HeadlessContext&) = delete;
+        HeadlessContext& operator=(const HeadlessContext&) = delete;
+
+        // Returns true if the context was created and is current.
+        bool isValid() const
+        {
+            return valid;
+        }
+
+        // Returns true if GLEW loaded the entry points. Call once per process after the first context is current.
+        // GLEW also probes GLX, which fails without an X display; that is expected here.
+        static bool initGLEW()
+        {
+            glewExperimental = true;
+            GLenum result = glewInit();
+#ifdef GLEW_ERROR_NO_GLX_DISPLAY
+            if (result == GLEW_ERROR_NO_GLX_DISPLAY)
+            {
+                return true;
+            }
+#endif
+            return result == GLEW_OK;
+        }
+
+    private:
+        bool valid;
+
+#if defined(CLEAN_HEADLESS_EGL)
+        EGLDisplay display;
+        EGLContext context;
+
+        bool createEGL(int major, int minor)
+        {
+            // Prefer Mesa's surfaceless platform, which needs neither a display server nor a GPU device.
+            PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+            if (getPlatformDisplay)
+            {
+                display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+            }
+            if (display == EGL_NO_DISPLAY)
+            {
+                display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+            }
+            // Initializing an already initialized display is allowed, so every thread can do it.
+            if (display == EGL_NO_DISPLAY || !eglInitialize(display, NULL, NULL))
+            {
+                std::cout << "ERROR::HEADLESS::EGL_DISPLAY 0x" << std::hex << eglGetError() << std::dec << std::endl;
+                return false;
+            }
+            if (!eglBindAPI(EGL_OPENGL_API))
+            {
+                std::cout << "ERROR::HEADLESS::EGL_NO_OPENGL_API" << std::endl;
+                return false;
+            }
+
+            // No surface is ever created, so any config that supports desktop GL will do.
+            const EGLint configAttributes[] = { EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE };
+            EGLConfig config;
+            EGLint configCount = 0;
+            if (!eglChooseConfig(display, configAttributes, &config, 1, &configCount) || configCount == 0)
+            {
+                config = (EGLConfig)0;
+            }
+
+            const EGLint contextAttributes[] = {
+                EGL_CONTEXT_MAJOR_VERSION, major,
+                EGL_CONTEXT_MINOR_VERSION, minor,
+                EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+                EGL_NONE
+            };
+            context = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttributes);
+            if (context == EGL_NO_CONTEXT)
+            {
+                std::cout << "ERROR::HEADLESS::EGL_CONTEXT 0x" << std::hex << eglGetError() << std::dec << std::endl;
+                return false;
+            }
+            if (!eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context))
+            {
+                std::cout << "ERROR::HEADLESS::EGL_MAKE_CURRENT 0x" << std::hex << eglGetError() << std::dec << std::endl;
+                return false;
+            }
+            return true;
+        }
+#elif defined(CLEAN_HEADLESS_OSMESA)
+        OSMesaContext context;
+        // OSMesa needs a color buffer to make a context current even though drawing goes to framebuffer objects.
+        std::vector<unsigned char> buffer;
+
+        bool createOSMesa(int major, int minor)
+        {
+            const int attributes[] = {
+                OSMESA_FORMAT, OSMESA_RGBA,
+                OSMESA_DEPTH_BITS, 0,
+                OSMESA_PROFILE, OSMESA_CORE_PROFILE,
+                OSMESA_CONTEXT_MAJOR_VERSION, major,
+                OSMESA_CONTEXT_MINOR_VERSION, minor,
+                0
+            };
+            context = OSMesaCreateContextAttribs(attributes, NULL);
+            if (!context)
+            {
+                std::cout << "ERROR::HEADLESS::OSMESA_CONTEXT" << std::endl;
+                return false;
+            }
+            buffer.resize(4);
+            if (!OSMesaMakeCurrent(context, buffer.data(), GL_UNSIGNED_BYTE, 1, 1))
+            {
+                std::cout << "ERROR::HEADLESS::OSMESA_MAKE_CURRENT" << std::endl;
+                return false;
+            }
+            return true;
+        }
+#endif
+};
+#endif
@@ -0,0 +1,253 @@
+#ifndef HEADLESS_RENDERER_H
+#define HEADLESS_RENDERER_H
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <algorithm>
+#include <filesystem>
+#include <cstdio>
+
+#include <glm/glm.hpp>
+
+#include "headless_context.h"
+#include "render_target.h"
+#include "image_writer.h"
+#include "scene.h"
+#include "mesh_cache.h"
+
+// Camera state for one frame of a camera script.
+struct CameraKey
+{
+    glm::vec3 position;
+    float yaw;
+    float pitch;
+    float zoom;
+};
+
+// Settings of a headless run, normally filled from the command line.
+struct HeadlessOptions
+{
+    unsigned int width = 960;
+    unsigned int height = 540;
+    // Number of frames. With a camera script, 0 renders every line of the script.
+    unsigned int frames = 0;
+    // Optional file with one "x y z yaw pitch [zoom]" line per frame. Empty lines and lines starting with # are skipped.
+    std::string cameraScript;
+    // Directory for frame_NNNNN.ppm images. Nothing is written when empty.
+    std::string outputDirectory;
+    // Frames are split across this many threads, each with its own context.
+    unsigned int threads = 1;
+    // OBJ, glTF or .mesh file drawn in place of the cube. Loaded once through the mesh cache and uploaded by every thread.
+    std::string meshPath;
+    std::string shaderDirectory = "../shaders";
+    std::string cacheDirectory = "../shader_cache";
+    std::string meshCacheDirectory = "../mesh_cache";
+    // Position and normal storage of meshes imported into the mesh cache.
+    VertexFormat vertexFormat;
+};
+
+// Renders the scene into offscreen framebuffers without a window, for render nodes and CI benchmarks.
+// Prints the render time of every frame and a summary.
+class HeadlessRenderer
+{
+    public:
+        // Returns the process exit code.
+        static int run(HeadlessOptions options)
+        {
+            std::vector<CameraKey> script;
+            if (!options.cameraScript.empty())
+            {
+                if (!loadCameraScript(options.cameraScript, script))
+                {
+                    return -1;
+                }
+                options.frames = options.frames == 0 ? (unsigned int)script.size() : std::min(options.frames, (unsigned int)script.size());
+            }
+            else if (options.frames == 0)
+            {
+                options.frames = 1;
+            }
+            options.threads = std::max(1u, std::min(options.threads, options.frames));
+
+            MeshFile model;
+            if (!options.meshPath.empty() && !loadMesh(options.meshPath, options.meshCacheDirectory, options.vertexFormat, model))
+            {
+                return -1;
+            }
+
+            if (!options.outputDirectory.empty())
+            {
+                std::error_code error;
+                std::filesystem::create_directories(options.outputDirectory, error);
+            }
+
+            // Frames are interleaved across threads so each thread gets a similar share of the script.
+            std::vector<double> frameMs(options.frames, 0.0);
+            std::atomic<bool> failed(false);
+            std::vector<std::thread> workers;
+            auto start = std::chrono::steady_clock::now();
+            for (unsigned int t = 0; t < options.threads; t++)
+            {
+                workers.emplace_back([&, t]()
+                {
+                    if (!renderFrames(options, script, model.isOpen() ? &model : NULL, t, frameMs))
+                    {
+                        failed = true;
+                    }
+                });
+            }
+            for (std::thread& worker : workers)
+            {
+                worker.join();
+            }
+            double totalMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            if (failed)
+            {
+                return -1;
+            }
+
+            for (unsigned int frame = 0; frame < options.frames; frame++)
+            {
+                std::printf("Frame %u: %.3f ms\n", frame, frameMs[frame]);
+            }
+            double sum = 0.0;
+            for (double ms : frameMs)
+            {
+                sum += ms;
+            }
+            std::printf("Rendered %u frames at %ux%u on %u threads in %.1f ms (%.1f frames/s). Per frame: %.3f ms average, %.3f min, %.3f max\n",
+                options.frames, options.width, options.height, options.threads, totalMs, options.frames * 1000.0 / totalMs,
+                sum / options.frames, *std::min_element(frameMs.begin(), frameMs.end()), *std::max_element(frameMs.begin(), frameMs.end()));
+            return 0;
+        }
+
+        static bool loadCameraScript(const std::string& path, std::vector<CameraKey>& keys)
+        {
+            std::ifstream file(path);
+            if (!file)
+            {
+                std::cout << "ERROR::HEADLESS::CAMERA_SCRIPT_NOT_READ " << path << std::endl;
+                return false;
+            }
+            std::string line;
+            int lineNumber = 0;
+            while (std::getline(file, line))
+            {
+                lineNumber++;
+                size_t start = line.find_first_not_of(" \t\r");
+                if (start == std::string::npos || line[start] == '#')
+                {
+                    continue;
+                }
+                std::istringstream fields(line);
+                CameraKey key;
+                key.zoom = ZOOM;
+                if (!(fields >> key.position.x >> key.position.y >> key.position.z >> key.yaw >> key.pitch))
+                {
+                    std::cout << "ERROR::HEADLESS::CAMERA_SCRIPT_MALFORMED " << path << ":" << lineNumber << std::endl;
+                    return false;
+                }
+                fields >> key.zoom;
+                keys.push_back(key);
+            }
+            if (keys.empty())
+            {
+                std::cout << "ERROR::HEADLESS::CAMERA_SCRIPT_EMPTY " << path << std::endl;
+                return false;
+            }
+            return true;
+        }
+
+        // Load a model through a mesh cache in cacheDirectory and report where it came from, its vertex size and how long it took.
+        static bool loadMesh(const std::string& path, const std::string& cacheDirectory, VertexFormat format, MeshFile& model)
+        {
+            auto start = std::chrono::steady_clock::now();
+            MeshCache meshCache(cacheDirectory, format);
+            MeshImportStats importStats;
+            if (!meshCache.load(path, model, MeshImportOptions(), &importStats))
+            {
+                return false;
+            }
+            double loadMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            if (meshCache.Misses)
+            {
+                importStats.print(std::cout, path);
+            }
+            const MeshFileHeader& header = model.header();
+            std::cout << "Mesh: " << header.vertexCount << " vertices, " << header.indexCount / 3 << " triangles, " << header.stride << " bytes per vertex ("
+                << VertexFormat::positionName((PositionFormat)header.positionFormat) << " positions, " << VertexFormat::normalName((NormalFormat)header.normalFormat)
+                << " normals), " << model.bytes().size() << " bytes " << (model.isMapped() ? "mapped" : "built") << " in " << loadMs << " ms"
+                << (meshCache.Hits ? " from the mesh cache" : "") << std::endl;
+            return true;
+        }
+
+    private:
+        // Render every frame with index thread + k * threads in a context owned by the calling thread.
+        static bool renderFrames(const HeadlessOptions& options, const std::vector<CameraKey>& script, const MeshFile* model, unsigned int thread, std::vector<double>& frameMs)
+        {
+            HeadlessContext context;
+            if (!context.isValid())
+            {
+                return false;
+            }
+            static std::once_flag glewOnce;
+            static bool glewReady = false;
+            std::call_once(glewOnce, []() { glewReady = HeadlessContext::initGLEW(); });
+            if (!glewReady)
+            {
+                std::cout << "ERROR::HEADLESS::GLEW_INIT_FAILED" << std::endl;
+                return false;
+            }
+
+            // Each thread has its own cache object; entries on disk are shared.
+            ProgramBinaryCache programCache(options.cacheDirectory);
+            Scene scene(&programCache, NULL, options.shaderDirectory, model);
+            if (thread == 0)
+            {
+                std::cout << "Renderer: " << glGetString(GL_RENDERER) << ", GL " << glGetString(GL_VERSION) << std::endl;
+                std::cout << "Shader startup: " << scene.ShaderStartupMs << " ms (" << programCache.Hits << " from cache, " << programCache.Misses << " compiled)" << std::endl;
+                scene.VertexBuffers.stats().print(std::cout, "Vertex buffers");
+                scene.IndexBuffers.stats().print(std::cout, "Index buffers");
+            }
+
+            RenderTarget target(options.width, options.height);
+            std::vector<unsigned char> pixels;
+            Camera camera(glm::vec3(0.0f, 0.0f, 3.0f));
+            float aspect = (float)options.width / (float)options.height;
+            for (unsigned int frame = thread; frame < options.frames; frame += options.threads)
+            {
+                if (!script.empty())
+                {
+                    const CameraKey& key = script[frame];
+                    camera = Camera(key.position, glm::vec3(0.0f, 1.0f, 0.0f), key.yaw, key.pitch);
+                    camera.Zoom = key.zoom;
+                }
+
+                // Reading the pixels back waits for the frame, so the time covers the whole render.
+                auto frameStart = std::chrono::steady_clock::now();
+                target.bind();
+                scene.render(camera, aspect);
+                target.readPixels(pixels);
+                frameMs[frame] = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frameStart).count();
+
+                if (!options.outputDirectory.empty())
+                {
+                    char name[32];
+                    std::snprintf(name, sizeof(name), "/frame_%05u.ppm", frame);
+                    if (!writePPM(options.outputDirectory + name, pixels.data(), options.width, options.height))
+                    {
+                        return false;
+                    }
+                }
+            }
+            return true;
+        }
+};
+#endif
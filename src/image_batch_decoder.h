@@ -0,0 +1,257 @@
+#ifndef IMAGE_BATCH_DECODER_H
+#define IMAGE_BATCH_DECODER_H
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <algorithm>
+#include <cstring>
+
+#include "byte_span.h"
+#include "parallel_for.h"
+#include "stb_image.h"
+
+// Per-image settings of a batch decode.
+struct ImageDecodeOptions
+{
+    // Channels to decode to, 1 to 4, or 0 for the channels stored in the file.
+    int channels = 0;
+    // Store the bottom row first, as glTexImage2D expects.
+    bool flip = false;
+    // Decode JPEGs at 1/scale of their size: 1, 2, 4 or 8. Other formats ignore it.
+    int scale = 1;
+    // Bytes from the start of one output row to the next, or 0 for tightly packed rows.
+    size_t pitch = 0;
+};
+
+// One image of a batch: encoded bytes in, pixels out into memory owned by the caller.
+struct ImageDecodeJob
+{
+    ByteSpan source;
+    ImageDecodeOptions options;
+    unsigned char* output = NULL;
+    size_t capacity = 0;
+
+    // Set by measure() and decode(): the size and channels of the pixels, and why decoding failed, or NULL.
+    int width = 0;
+    int height = 0;
+    int channels = 0;
+    const char* error = NULL;
+};
+
+// Decodes many images in parallel on a pool of threads, each job with its own options, straight into preallocated
+// output. stb_image's global flip setting is ignored and its failure reason is per thread, so batches are safe to
+// run next to other decoding. Size the outputs with measure(), which reads only the headers.
+// Batches with fewer jobs than threads give each job the spare threads, which split baseline JPEGs with restart
+// markers and decode the pieces concurrently, so one large atlas still uses every core.
+class ImageBatchDecoder
+{
+    public:
+        // Start the decode threads. 0 uses one per core.
+        ImageBatchDecoder(unsigned int threadCount = 0) : jobs(NULL), jobCount(0), jobThreads(1), next(0), remaining(0), active(0), generation(0), running(true)
+        {
+            if (threadCount == 0)
+            {
+                threadCount = std::max(1u, std::thread::hardware_concurrency());
+            }
+            for (unsigned int i = 0; i < threadCount; i++)
+            {
+                workers.emplace_back(&ImageBatchDecoder::workLoop, this);
+            }
+        }
+
+        ~ImageBatchDecoder()
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                running = false;
+            }
+            wake.notify_all();
+            for (std::thread& worker : workers)
+            {
+                worker.join();
+            }
+        }
+
+        ImageBatchDecoder(const ImageBatchDecoder&) = delete;
+        ImageBatchDecoder& operator=(const ImageBatchDecoder&) = delete;
+
+        unsigned int threadCount() const
+        {
+            return (unsigned int)workers.size();
+        }
+
+        // Fill in the size and channels a job will decode to from the file header. Returns the output bytes it needs,
+        // or 0 if the header cannot be read.
+        static size_t measure(ImageDecodeJob& job)
+        {
+            int width, height, channels;
+            if (!stbi_info_from_memory(job.source.data(), (int)job.source.size(), &width, &height, &channels))
+            {
+                job.error = stbi_failure_reason();
+                return 0;
+            }
+            int scale = isJPEG(job.source) ? jpegScale(job.options.scale) : 1;
+            job.width = (width + scale - 1) / scale;
+            job.height = (height + scale - 1) / scale;
+            job.channels = job.options.channels ? job.options.channels : channels;
+            return outputSize(job);
+        }
+
+        // Decode every job, returning when all are done. Returns the number decoded; the others have error set.
+        // Calls from several threads are run one batch after another.
+        size_t decode(ImageDecodeJob* batch, size_t count)
+        {
+            if (count == 0)
+            {
+                return 0;
+            }
+            // Start the largest files first, so one big image does not finish alone at the end.
+            std::vector<size_t> order(count);
+            for (size_t i = 0; i < count; i++)
+            {
+                order[i] = i;
+            }
+            std::stable_sort(order.begin(), order.end(), [batch](size_t a, size_t b) { return batch[a].source.size() > batch[b].source.size(); });
+
+            std::lock_guard<std::mutex> batchLock(batchMutex);
+            std::unique_lock<std::mutex> lock(mutex);
+            // Threads that woke up too late for the last batch may still be looking at it.
+            done.wait(lock, [this]() { return active == 0; });
+            jobs = batch;
+            jobOrder.swap(order);
+            jobCount = count;
+            jobThreads = (unsigned int)std::max<size_t>(1, workers.size() / count);
+            next = 0;
+            remaining = count;
+            generation++;
+            wake.notify_all();
+
+            done.wait(lock, [this]() { return remaining == 0 && active == 0; });
+            jobs = NULL;
+            jobCount = 0;
+            size_t decoded = 0;
+            for (size_t i = 0; i < count; i++)
+            {
+                decoded += batch[i].error == NULL;
+            }
+            return decoded;
+        }
+
+        size_t decode(std::vector<ImageDecodeJob>& batch)
+        {
+            return decode(batch.data(), batch.size());
+        }
+
+    private:
+        std::vector<std::thread> workers;
+        // Serializes decode() calls.
+        std::mutex batchMutex;
+
+        // Shared with the decode threads.
+        std::mutex mutex;
+        std::condition_variable wake;
+        std::condition_variable done;
+        ImageDecodeJob* jobs;
+        std::vector<size_t> jobOrder;
+        size_t jobCount;
+        // Threads each job may decode on.
+        unsigned int jobThreads;
+        std::atomic<size_t> next;
+        size_t remaining;
+        // Threads inside a batch. The batch fields only change while this is 0.
+        unsigned int active;
+        unsigned int generation;
+        bool running;
+
+        static bool isJPEG(const ByteSpan& source)
+        {
+            return source.size() >= 2 && source[0] == 0xFF && source[1] == 0xD8;
+        }
+
+        static int jpegScale(int scale)
+        {
+            return scale >= 8 ? 8 : scale >= 4 ? 4 : scale >= 2 ? 2 : 1;
+        }
+
+        static size_t rowSize(const ImageDecodeJob& job)
+        {
+            return (size_t)job.width * job.channels;
+        }
+
+        static size_t outputSize(const ImageDecodeJob& job)
+        {
+            size_t pitch = job.options.pitch ? job.options.pitch : rowSize(job);
+            return pitch * (job.height - 1) + rowSize(job);
+        }
+
+        // Decode one job on the calling decode thread, with threads - 1 helpers for JPEG restart intervals, and copy its
+        // rows into the output.
+        static void decodeJob(ImageDecodeJob& job, unsigned int threads)
+        {
+            job.error = NULL;
+            stbi_set_jpeg_scale_on_load_thread(job.options.scale);
+            stbi_set_jpeg_parallel_thread(threads > 1 ? parallelForCallback : NULL, &threads);
+            int channels;
+            unsigned char* pixels = stbi_load_from_memory(job.source.data(), (int)job.source.size(), &job.width, &job.height, &channels, job.options.channels);
+            if (!pixels)
+            {
+                job.error = stbi_failure_reason();
+                return;
+            }
+            job.channels = job.options.channels ? job.options.channels : channels;
+            size_t row = rowSize(job);
+            size_t pitch = job.options.pitch ? job.options.pitch : row;
+            if (pitch < row || !job.output || outputSize(job) > job.capacity)
+            {
+                job.error = "output too small";
+            }
+            else
+            {
+                for (int y = 0; y < job.height; y++)
+                {
+                    int target = job.options.flip ? job.height - 1 - y : y;
+                    memcpy(job.output + target * pitch, pixels + y * row, row);
+                }
+            }
+            stbi_image_free(pixels);
+        }
+
+        void workLoop()
+        {
+            // Jobs flip while copying rows, so stb_image must never flip on these threads.
+            stbi_set_flip_vertically_on_load_thread(0);
+            unsigned int seen = 0;
+            while (true)
+            {
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    wake.wait(lock, [this, seen]() { return !running || generation != seen; });
+                    if (!running)
+                    {
+                        return;
+                    }
+                    seen = generation;
+                    active++;
+                }
+
+                size_t finished = 0;
+                for (size_t i = next++; i < jobCount; i = next++)
+                {
+                    decodeJob(jobs[jobOrder[i]], jobThreads);
+                    finished++;
+                }
+
+                std::lock_guard<std::mutex> lock(mutex);
+                remaining -= finished;
+                active--;
+                if (active == 0)
+                {
+                    done.notify_all();
+                }
+            }
+        }
+};
+#endif
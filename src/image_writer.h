@@ -0,0 +1,64 @@
+#ifndef IMAGE_WRITER_H
+#define IMAGE_WRITER_H
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iostream>
+#include <cstdint>
+
+#include "compressed_texture.h"
+#include "mapped_file.h"
+
+// Write 8-bit RGB pixels as a binary PPM, which most image tools and ffmpeg read directly.
+// Rows are stored bottom row first, as glReadPixels returns them, and flipped while writing.
+inline bool writePPM(const std::string& path, const unsigned char* pixels, unsigned int width, unsigned int height)
+{
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file << "P6\n" << width << " " << height << "\n255\n";
+    size_t rowSize = (size_t)width * 3;
+    for (unsigned int y = height; y > 0; y--)
+    {
+        file.write((const char*)pixels + (y - 1) * rowSize, rowSize);
+    }
+    file.close();
+    if (!file)
+    {
+        std::cout << "ERROR::IMAGE_WRITER::WRITE_FAILED " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// Write a mip chain as a KTX 1.1 file that CompressedTextureLoader reads back. An existing file is only replaced once
+// the new one is complete.
+inline bool writeKTX(const std::string& path, const MipChain& texture)
+{
+    static const unsigned char IDENTIFIER[12] = { 0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', 0x1A, '\n' };
+    // Endianness, type, type size, format, internal format, base format, size, depth, array elements, faces, levels, key/value bytes.
+    GLenum type = texture.isCompressed() ? 0 : GL_UNSIGNED_BYTE;
+    GLenum baseFormat = texture.isCompressed() ? CompressedTextureLoader::baseFormat(texture.InternalFormat) : texture.Format;
+    uint32_t header[13] = { 0x04030201, type, 1, texture.Format, texture.InternalFormat, baseFormat,
+        (uint32_t)texture.Width, (uint32_t)texture.Height, 0, 0, 1, (uint32_t)texture.Levels.size(), 0 };
+    bool written = writeFileAtomically(path, [&](std::ostream& file)
+    {
+        file.write((const char*)IDENTIFIER, sizeof(IDENTIFIER));
+        file.write((const char*)header, sizeof(header));
+        for (const MipLevel& level : texture.Levels)
+        {
+            // Levels are padded to 4 bytes.
+            const char padding[3] = { 0, 0, 0 };
+            uint32_t size = (uint32_t)level.size;
+            file.write((const char*)&size, sizeof(size));
+            file.write((const char*)texture.Data.data() + level.offset, level.size);
+            file.write(padding, (4 - level.size % 4) % 4);
+        }
+    });
+    if (!written)
+    {
+        std::cout << "ERROR::IMAGE_WRITER::WRITE_FAILED " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+#endif
@@ -0,0 +1,135 @@
+#ifndef INSTANCING_H
+#define INSTANCING_H
+
+#include <vector>
+#include <cstddef>
+#include <cstring>
+#include <algorithm>
+
+#include <glm/glm.hpp>
+
+#include "frame_ring_buffer.h"
+
+// First vertex attribute location used by per-instance data. Must match the INSTANCED path of basic_lighting_vertex_shader.txt.
+const unsigned int INSTANCE_MODEL_LOCATION = 2;
+const unsigned int INSTANCE_NORMAL_MATRIX_LOCATION = 6;
+
+// Per-instance attributes: the model matrix and the matching normal matrix.
+struct InstanceData
+{
+    glm::mat4 model;
+    glm::mat3 normalMatrix;
+};
+
+static_assert(sizeof(InstanceData) == sizeof(float) * (16 + 9), "InstanceData must be tightly packed");
+
+// Matrix that transforms normals by a model matrix: the inverse transpose of its upper 3x3 part.
+inline glm::mat3 normalMatrix(const glm::mat4& model)
+{
+    return glm::transpose(glm::inverse(glm::mat3(model)));
+}
+
+inline InstanceData makeInstance(const glm::mat4& model)
+{
+    InstanceData instance;
+    instance.model = model;
+    instance.normalMatrix = normalMatrix(model);
+    return instance;
+}
+
+// InstanceData streamed through a FrameRingBuffer and advanced once per instance, to draw many copies of a mesh with
+// one call. Each frame's instances go to a fresh region of the ring, so rewriting every transform each frame never
+// waits for draws that are still reading the last ones.
+class InstanceBuffer
+{
+    public:
+        // Number of instances in the current frame.
+        unsigned int Count;
+
+        InstanceBuffer(unsigned int framesInFlight = 3, bool persistentMapping = true) : Count(0), ring(GL_ARRAY_BUFFER, 0, framesInFlight, persistentMapping), offset(0)
+        {
+        }
+
+        // Add the per-instance attributes to a vertex array. They point at the current frame's instances after every unmap().
+        void attach(unsigned int vertexArray)
+        {
+            vertexArrays.push_back(vertexArray);
+            glStateCache().bindVertexArray(vertexArray);
+            for (unsigned int i = 0; i < 4; i++)
+            {
+                glEnableVertexAttribArray(INSTANCE_MODEL_LOCATION + i);
+                glVertexAttribDivisor(INSTANCE_MODEL_LOCATION + i, 1);
+            }
+            for (unsigned int i = 0; i < 3; i++)
+            {
+                glEnableVertexAttribArray(INSTANCE_NORMAL_MATRIX_LOCATION + i);
+                glVertexAttribDivisor(INSTANCE_NORMAL_MATRIX_LOCATION + i, 1);
+            }
+            glStateCache().bindVertexArray(0);
+            if (ring.bufferID())
+            {
+                point(vertexArray);
+            }
+        }
+
+        // Start a frame with room for count instances and return the memory to write them to, in one pass. With
+        // persistent mapping this is GL memory, so nothing is copied again. Call once per frame, then unmap() before drawing.
+        InstanceData* map(unsigned int count)
+        {
+            ring.reserve(std::max<size_t>(count, 1) * sizeof(InstanceData));
+            ring.beginFrame();
+            Count = count;
+            return (InstanceData*)ring.allocate(count * sizeof(InstanceData), sizeof(float), offset);
+        }
+
+        // Finish the frame's instances and point the attached vertex arrays at them.
+        void unmap()
+        {
+            ring.endFrame();
+            for (unsigned int vertexArray : vertexArrays)
+            {
+                point(vertexArray);
+            }
+        }
+
+        // Replace the instance data with a copy of instances. Call once per frame.
+        void upload(const std::vector<InstanceData>& instances)
+        {
+            InstanceData* memory = map((unsigned int)instances.size());
+            if (memory)
+            {
+                std::memcpy(memory, instances.data(), instances.size() * sizeof(InstanceData));
+            }
+            unmap();
+        }
+
+        const FrameRingBuffer& buffer() const
+        {
+            return ring;
+        }
+
+    private:
+        FrameRingBuffer ring;
+        // Start of the current frame's instances in the ring.
+        size_t offset;
+        std::vector<unsigned int> vertexArrays;
+
+        // The offset changes every frame and the buffer when the ring grows, so the pointers are set again each time.
+        void point(unsigned int vertexArray)
+        {
+            glStateCache().bindVertexArray(vertexArray);
+            glBindBuffer(GL_ARRAY_BUFFER, ring.bufferID());
+            // A matrix attribute takes one location per column.
+            for (unsigned int i = 0; i < 4; i++)
+            {
+                glVertexAttribPointer(INSTANCE_MODEL_LOCATION + i, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (void*)(offset + offsetof(InstanceData, model) + i * sizeof(glm::vec4)));
+            }
+            for (unsigned int i = 0; i < 3; i++)
+            {
+                glVertexAttribPointer(INSTANCE_NORMAL_MATRIX_LOCATION + i, 3, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (void*)(offset + offsetof(InstanceData, normalMatrix) + i * sizeof(glm::vec3)));
+            }
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+            glStateCache().bindVertexArray(0);
+        }
+};
+#endif
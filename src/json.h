@@ -0,0 +1,323 @@
+#ifndef JSON_H
+#define JSON_H
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <cstdint>
+#include <cstring>
+
+#include "number_parser.h"
+
+// A parsed JSON document, small enough for asset headers such as a glTF scene description. Objects keep their members in
+// file order and are searched linearly, which is faster than a map for the handful of keys a glTF object has.
+// Looking up a missing key or index returns a null value, so optional fields read as value["a"]["b"].numberOr(0). Built by JsonParser.
+struct JsonValue
+{
+    enum Type { NUL, BOOLEAN, NUMBER, STRING, ARRAY, OBJECT };
+
+    Type type = NUL;
+    bool boolean = false;
+    double number = 0.0;
+    std::string string;
+    std::vector<JsonValue> items;
+    std::vector<std::pair<std::string, JsonValue>> members;
+
+    bool isNull() const
+    {
+        return type == NUL;
+    }
+
+    // Number of array items or object members.
+    size_t size() const
+    {
+        return type == ARRAY ? items.size() : type == OBJECT ? members.size() : 0;
+    }
+
+    const JsonValue& operator[](size_t index) const
+    {
+        return type == ARRAY && index < items.size() ? items[index] : null();
+    }
+
+    // Without this a literal 0 would be as good a match for the key overload.
+    const JsonValue& operator[](int index) const
+    {
+        return index >= 0 ? (*this)[(size_t)index] : null();
+    }
+
+    const JsonValue& operator[](const char* key) const
+    {
+        if (type == OBJECT)
+        {
+            for (const auto& member : members)
+            {
+                if (member.first == key)
+                {
+                    return member.second;
+                }
+            }
+        }
+        return null();
+    }
+
+    double numberOr(double fallback) const
+    {
+        return type == NUMBER ? number : fallback;
+    }
+
+    // The number as an integer, or fallback if it is missing, fractional or out of range.
+    int64_t integerOr(int64_t fallback) const
+    {
+        if (type != NUMBER || number != (double)(int64_t)number || number < -9.0e15 || number > 9.0e15)
+        {
+            return fallback;
+        }
+        return (int64_t)number;
+    }
+
+    const std::string& stringOr(const std::string& fallback) const
+    {
+        return type == STRING ? string : fallback;
+    }
+
+    static const JsonValue& null()
+    {
+        static const JsonValue value;
+        return value;
+    }
+};
+
+// Recursive descent JSON parser. Strings are decoded to UTF-8 and numbers go through NumberParser, so the C locale does not matter.
+class JsonParser
+{
+    public:
+        // Parse a whole document. Returns false on malformed input or nesting deeper than MAX_DEPTH.
+        static bool parse(const char* text, size_t length, JsonValue& value)
+        {
+            const char* end = text + length;
+            value = JsonValue();
+            if (!parseValue(text, end, value, 0))
+            {
+                return false;
+            }
+            skipSpace(text, end);
+            return text == end;
+        }
+
+    private:
+        static constexpr int MAX_DEPTH = 256;
+
+        static void skipSpace(const char*& p, const char* end)
+        {
+            while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r'))
+            {
+                p++;
+            }
+        }
+
+        static bool parseLiteral(const char*& p, const char* end, const char* literal)
+        {
+            size_t length = strlen(literal);
+            if ((size_t)(end - p) < length || memcmp(p, literal, length) != 0)
+            {
+                return false;
+            }
+            p += length;
+            return true;
+        }
+
+        static bool parseValue(const char*& p, const char* end, JsonValue& value, int depth)
+        {
+            skipSpace(p, end);
+            if (p == end || depth > MAX_DEPTH)
+            {
+                return false;
+            }
+            switch (*p)
+            {
+                case '{':
+                    value.type = JsonValue::OBJECT;
+                    p++;
+                    skipSpace(p, end);
+                    if (p < end && *p == '}')
+                    {
+                        p++;
+                        return true;
+                    }
+                    while (true)
+                    {
+                        skipSpace(p, end);
+                        value.members.emplace_back();
+                        auto& member = value.members.back();
+                        if (!parseString(p, end, member.first))
+                        {
+                            return false;
+                        }
+                        skipSpace(p, end);
+                        if (p == end || *p++ != ':' || !parseValue(p, end, member.second, depth + 1))
+                        {
+                            return false;
+                        }
+                        skipSpace(p, end);
+                        if (p < end && *p == ',')
+                        {
+                            p++;
+                            continue;
+                        }
+                        return p < end && *p++ == '}';
+                    }
+                case '[':
+                    value.type = JsonValue::ARRAY;
+                    p++;
+                    skipSpace(p, end);
+                    if (p < end && *p == ']')
+                    {
+                        p++;
+                        return true;
+                    }
+                    while (true)
+                    {
+                        value.items.emplace_back();
+                        if (!parseValue(p, end, value.items.back(), depth + 1))
+                        {
+                            return false;
+                        }
+                        skipSpace(p, end);
+                        if (p < end && *p == ',')
+                        {
+                            p++;
+                            continue;
+                        }
+                        return p < end && *p++ == ']';
+                    }
+                case '"':
+                    value.type = JsonValue::STRING;
+                    return parseString(p, end, value.string);
+                case 't':
+                    value.type = JsonValue::BOOLEAN;
+                    value.boolean = true;
+                    return parseLiteral(p, end, "true");
+                case 'f':
+                    value.type = JsonValue::BOOLEAN;
+                    return parseLiteral(p, end, "false");
+                case 'n':
+                    return parseLiteral(p, end, "null");
+                default:
+                    value.type = JsonValue::NUMBER;
+                    return NumberParser::parseDouble(p, end, value.number);
+            }
+        }
+
+        static bool parseHex(const char*& p, const char* end, unsigned int& code)
+        {
+            if (end - p < 4)
+            {
+                return false;
+            }
+            code = 0;
+            for (int i = 0; i < 4; i++, p++)
+            {
+                char c = *p;
+                unsigned int digit = c >= '0' && c <= '9' ? c - '0' : c >= 'a' && c <= 'f' ? c - 'a' + 10 : c >= 'A' && c <= 'F' ? c - 'A' + 10 : 16;
+                if (digit == 16)
+                {
+                    return false;
+                }
+                code = code * 16 + digit;
+            }
+            return true;
+        }
+
+        static bool parseString(const char*& p, const char* end, std::string& string)
+        {
+            if (p == end || *p != '"')
+            {
+                return false;
+            }
+            p++;
+            while (p < end && *p != '"')
+            {
+                // Copy runs without escapes in one go.
+                const char* run = p;
+                while (p < end && *p != '"' && *p != '\\')
+                {
+                    p++;
+                }
+                string.append(run, p);
+                if (p == end || *p == '"')
+                {
+                    break;
+                }
+                if (++p == end)
+                {
+                    return false;
+                }
+                char escape = *p++;
+                switch (escape)
+                {
+                    case '"': case '\\': case '/': string += escape; break;
+                    case 'b': string += '\b'; break;
+                    case 'f': string += '\f'; break;
+                    case 'n': string += '\n'; break;
+                    case 'r': string += '\r'; break;
+                    case 't': string += '\t'; break;
+                    case 'u':
+                    {
+                        unsigned int code;
+                        if (!parseHex(p, end, code))
+                        {
+                            return false;
+                        }
+                        // Join a surrogate pair into one code point.
+                        unsigned int low;
+                        if (code >= 0xD800 && code < 0xDC00 && end - p >= 6 && p[0] == '\\' && p[1] == 'u')
+                        {
+                            const char* q = p + 2;
+                            if (parseHex(q, end, low) && low >= 0xDC00 && low < 0xE000)
+                            {
+                                code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                                p = q;
+                            }
+                        }
+                        appendUtf8(string, code);
+                        break;
+                    }
+                    default:
+                        return false;
+                }
+            }
+            if (p == end)
+            {
+                return false;
+            }
+            p++;
+            return true;
+        }
+
+        static void appendUtf8(std::string& string, unsigned int code)
+        {
+            if (code < 0x80)
+            {
+                string += (char)code;
+            }
+            else if (code < 0x800)
+            {
+                string += (char)(0xC0 | (code >> 6));
+                string += (char)(0x80 | (code & 0x3F));
+            }
+            else if (code < 0x10000)
+            {
+                string += (char)(0xE0 | (code >> 12));
+                string += (char)(0x80 | ((code >> 6) & 0x3F));
+                string += (char)(0x80 | (code & 0x3F));
+            }
+            else
+            {
+                string += (char)(0xF0 | (code >> 18));
+                string += (char)(0x80 | ((code >> 12) & 0x3F));
+                string += (char)(0x80 | ((code >> 6) & 0x3F));
+                string += (char)(0x80 | (code & 0x3F));
+            }
+        }
+};
+#endif
@@ -0,0 +1,175 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <string>
+#include <cstddef>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <filesystem>
+#include <random>
+
+#include "byte_span.h"
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// A whole file mapped read-only into memory, so loaders can parse it in place instead of reading it into a buffer first.
+// Pages are read on first touch and shared with the page cache. Unmapped on close() or destruction.
+class MappedFile
+{
+    public:
+        MappedFile() : mapping(NULL), mappingSize(0)
+        {
+        }
+
+        ~MappedFile()
+        {
+            close();
+        }
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        MappedFile(MappedFile&& other) : mapping(other.mapping), mappingSize(other.mappingSize)
+        {
+            other.mapping = NULL;
+            other.mappingSize = 0;
+        }
+
+        MappedFile& operator=(MappedFile&& other)
+        {
+            if (this != &other)
+            {
+                close();
+                mapping = other.mapping;
+                mappingSize = other.mappingSize;
+                other.mapping = NULL;
+                other.mappingSize = 0;
+            }
+            return *this;
+        }
+
+        // Map a file. Returns false, leaving the file closed, if it is missing or empty.
+        bool open(const std::string& path)
+        {
+            close();
+#ifdef _WIN32
+            HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+            if (file == INVALID_HANDLE_VALUE)
+            {
+                return false;
+            }
+            LARGE_INTEGER size;
+            HANDLE view = NULL;
+            if (GetFileSizeEx(file, &size) && size.QuadPart > 0)
+            {
+                view = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+            }
+            CloseHandle(file);
+            if (!view)
+            {
+                return false;
+            }
+            mapping = (const unsigned char*)MapViewOfFile(view, FILE_MAP_READ, 0, 0, 0);
+            CloseHandle(view);
+            mappingSize = mapping ? (size_t)size.QuadPart : 0;
+#else
+            int file = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            if (file < 0)
+            {
+                return false;
+            }
+            struct stat status;
+            void* view = MAP_FAILED;
+            if (fstat(file, &status) == 0 && status.st_size > 0)
+            {
+                view = mmap(NULL, (size_t)status.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+            }
+            // The mapping keeps the file alive, so no descriptor stays open.
+            ::close(file);
+            if (view == MAP_FAILED)
+            {
+                return false;
+            }
+            mapping = (const unsigned char*)view;
+            mappingSize = (size_t)status.st_size;
+#endif
+            return mapping != NULL;
+        }
+
+        void close()
+        {
+            if (mapping)
+            {
+#ifdef _WIN32
+                UnmapViewOfFile(mapping);
+#else
+                munmap((void*)mapping, mappingSize);
+#endif
+            }
+            mapping = NULL;
+            mappingSize = 0;
+        }
+
+        bool isOpen() const
+        {
+            return mapping != NULL;
+        }
+
+        const unsigned char* data() const
+        {
+            return mapping;
+        }
+
+        size_t size() const
+        {
+            return mappingSize;
+        }
+
+        ByteSpan bytes() const
+        {
+            return ByteSpan(mapping, mappingSize);
+        }
+
+    private:
+        const unsigned char* mapping;
+        size_t mappingSize;
+};
+
+// Write a file through write() under a unique temporary name, then rename it over path. An interrupted write never
+// leaves a truncated file, and threads or processes writing the same path never share a temporary file. Returns false,
+// removing the temporary file, if writing or renaming fails.
+inline bool writeFileAtomically(const std::string& path, const std::function<void(std::ostream&)>& write)
+{
+    std::string tempPath = path + "." + std::to_string(std::random_device()()) + ".tmp";
+    std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+    write(file);
+    file.close();
+    std::error_code error;
+    if (file)
+    {
+        std::filesystem::rename(tempPath, path, error);
+    }
+    if (!file || error)
+    {
+        std::remove(tempPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+inline bool writeFileAtomically(const std::string& path, const ByteSpan& bytes)
+{
+    return writeFileAtomically(path, [&bytes](std::ostream& file) { file.write((const char*)bytes.data(), bytes.size()); });
+}
+#endif
@@ -0,0 +1,204 @@
+#ifndef MESH_H
+#define MESH_H
+
+#include <vector>
+#include <iostream>
+#include <cstdint>
+
+#include "gl_state.h"
+#include "mesh_optimizer.h"
+#include "buffer_arena.h"
+
+// One vertex attribute inside an interleaved vertex.
+struct VertexAttribute
+{
+    unsigned int location;
+    int components;
+    // Offset from the start of the vertex, in floats.
+    unsigned int offset;
+};
+
+// Vertex and index counts, memory use and transform cost of a mesh.
+struct MeshStats
+{
+    size_t vertexCount;
+    size_t indexCount;
+    size_t vertexBytes;
+    size_t indexBytes;
+    float acmr;
+
+    void print(std::ostream& out, const char* label) const
+    {
+        out << label << ": " << vertexCount << " vertices, " << indexCount << " indices, "
+            << (vertexBytes + indexBytes) << " bytes (" << vertexBytes << " vertex + " << indexBytes << " index), ACMR " << acmr << std::endl;
+    }
+};
+
+// Indexed triangle mesh with interleaved float vertices. One vertex and one index buffer are shared by every vertex array made from it.
+class Mesh
+{
+    public:
+        std::vector<float> Vertices;
+        std::vector<unsigned int> Indices;
+        // Floats per vertex.
+        unsigned int Stride;
+
+        // GL objects, 0 until upload() is called.
+        unsigned int VBO;
+        unsigned int EBO;
+        // GL_UNSIGNED_SHORT when every index fits, GL_UNSIGNED_INT otherwise.
+        GLenum IndexType;
+        // Ranges of shared arena pages holding the buffers when uploaded into arenas. VBO and EBO are then the pages.
+        ArenaGeometry Geometry;
+
+        // Build an optimized indexed mesh from an unindexed triangle list: weld duplicate vertices, reorder triangles for the
+        // post-transform cache and reorder vertices for fetch locality. Stats before and after are returned through the optional pointers.
+        static Mesh fromTriangles(const float* data, size_t vertexCount, unsigned int stride, MeshStats* before = NULL, MeshStats* after = NULL)
+        {
+            Mesh mesh;
+            mesh.Stride = stride;
+            if (before)
+            {
+                // Unindexed: every vertex is transformed and stored once per use.
+                before->vertexCount = vertexCount;
+                before->indexCount = 0;
+                before->vertexBytes = vertexCount * stride * sizeof(float);
+                before->indexBytes = 0;
+                before->acmr = 3.0f;
+            }
+
+            std::vector<unsigned int> indices = MeshOptimizer::weld(data, vertexCount, stride, mesh.Vertices);
+            mesh.Indices = MeshOptimizer::optimizeVertexCache(indices, mesh.vertexCount());
+            MeshOptimizer::optimizeVertexFetch(mesh.Indices, mesh.Vertices, stride);
+
+            if (after)
+            {
+                *after = mesh.stats();
+            }
+            return mesh;
+        }
+
+        Mesh() : Stride(0), VBO(0), EBO(0), IndexType(GL_UNSIGNED_INT)
+        {
+        }
+
+        size_t vertexCount() const
+        {
+            return Stride ? Vertices.size() / Stride : 0;
+        }
+
+        MeshStats stats() const
+        {
+            MeshStats result;
+            result.vertexCount = vertexCount();
+            result.indexCount = Indices.size();
+            result.vertexBytes = Vertices.size() * sizeof(float);
+            result.indexBytes = Indices.size() * (vertexCount() <= 0x10000 ? sizeof(uint16_t) : sizeof(uint32_t));
+            result.acmr = MeshOptimizer::computeACMR(Indices, vertexCount());
+            return result;
+        }
+
+        // Upload into ranges of shared arena pages instead of buffers of its own. Identical data already in an arena is
+        // shared. Indices are stored as 16 bits when possible.
+        void upload(BufferArena& vertexArena, BufferArena& indexArena)
+        {
+            size_t stride = Stride * sizeof(float);
+            if (vertexCount() <= 0x10000)
+            {
+                std::vector<uint16_t> shortIndices(Indices.begin(), Indices.end());
+                Geometry.upload(vertexArena, Vertices.data(), Vertices.size() * sizeof(float), stride, indexArena, shortIndices.data(), shortIndices.size() * sizeof(uint16_t), sizeof(uint16_t));
+                IndexType = GL_UNSIGNED_SHORT;
+            }
+            else
+            {
+                Geometry.upload(vertexArena, Vertices.data(), Vertices.size() * sizeof(float), stride, indexArena, Indices.data(), Indices.size() * sizeof(uint32_t), sizeof(uint32_t));
+                IndexType = GL_UNSIGNED_INT;
+            }
+            VBO = Geometry.vertexBuffer();
+            EBO = Geometry.indexBuffer();
+        }
+
+        // Create the vertex and index buffers. Indices are stored as 16 bits when possible.
+        void upload()
+        {
+            glGenBuffers(1, &VBO);
+            glBindBuffer(GL_ARRAY_BUFFER, VBO);
+            glBufferData(GL_ARRAY_BUFFER, Vertices.size() * sizeof(float), Vertices.data(), GL_STATIC_DRAW);
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+            // The element buffer binding is part of VAO state, so only bind it while no VAO is bound.
+            glStateCache().bindVertexArray(0);
+            glGenBuffers(1, &EBO);
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+            if (vertexCount() <= 0x10000)
+            {
+                std::vector<uint16_t> shortIndices(Indices.begin(), Indices.end());
+                glBufferData(GL_ELEMENT_ARRAY_BUFFER, shortIndices.size() * sizeof(uint16_t), shortIndices.data(), GL_STATIC_DRAW);
+                IndexType = GL_UNSIGNED_SHORT;
+            }
+            else
+            {
+                glBufferData(GL_ELEMENT_ARRAY_BUFFER, Indices.size() * sizeof(uint32_t), Indices.data(), GL_STATIC_DRAW);
+                IndexType = GL_UNSIGNED_INT;
+            }
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+        }
+
+        // Delete the GL buffers, or give the arena ranges back. Vertex arrays made from this mesh must not be drawn afterwards.
+        void release()
+        {
+            if (Geometry.isUploaded())
+            {
+                Geometry.release();
+            }
+            else
+            {
+                glDeleteBuffers(1, &VBO);
+                glDeleteBuffers(1, &EBO);
+            }
+            VBO = 0;
+            EBO = 0;
+        }
+
+        // Make a vertex array that reads the given attributes from the shared buffers. Meshes in the same arena pages with
+        // the same layout can share one.
+        unsigned int createVertexArray(const std::vector<VertexAttribute>& attributes) const
+        {
+            unsigned int vertexArray;
+            glGenVertexArrays(1, &vertexArray);
+            glStateCache().bindVertexArray(vertexArray);
+            glBindBuffer(GL_ARRAY_BUFFER, VBO);
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+            for (const VertexAttribute& attribute : attributes)
+            {
+                glVertexAttribPointer(attribute.location, attribute.components, GL_FLOAT, GL_FALSE, Stride * sizeof(float), (void*)(attribute.offset * sizeof(float)));
+                glEnableVertexAttribArray(attribute.location);
+            }
+            glStateCache().bindVertexArray(0);
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+            return vertexArray;
+        }
+
+        // Draw the mesh with the currently bound vertex array.
+        void draw() const
+        {
+            if (Geometry.isUploaded())
+            {
+                Geometry.draw((GLsizei)Indices.size(), IndexType);
+                return;
+            }
+            glDrawElements(GL_TRIANGLES, (GLsizei)Indices.size(), IndexType, (void*)0);
+        }
+
+        void drawInstanced(unsigned int instanceCount) const
+        {
+            if (Geometry.isUploaded())
+            {
+                Geometry.draw((GLsizei)Indices.size(), IndexType, instanceCount);
+                return;
+            }
+            glDrawElementsInstanced(GL_TRIANGLES, (GLsizei)Indices.size(), IndexType, (void*)0, instanceCount);
+        }
+};
+#endif
@@ -0,0 +1,120 @@
+#ifndef MESH_CACHE_H
+#define MESH_CACHE_H
+
+#include <string>
+#include <iostream>
+#include <cstdint>
+#include <cstdio>
+#include <cctype>
+#include <algorithm>
+#include <filesystem>
+
+#include "mesh_file.h"
+#include "mesh_importer.h"
+
+// Keeps a mesh file for every OBJ or glTF file loaded, so later launches map the binary mesh instead of parsing text.
+// Entries are named after the source path and rebuilt when the source's size or modification time changes.
+class MeshCache
+{
+    public:
+        // Directory holding the cache entries. An empty directory disables the cache.
+        std::string Directory;
+
+        // How imported meshes store their positions and normals. Each format has its own entries.
+        VertexFormat Format;
+
+        // Number of meshes mapped from the cache and number that had to be imported.
+        unsigned int Hits;
+        unsigned int Misses;
+
+        MeshCache(const std::string& directory = "", VertexFormat format = VertexFormat()) : Directory(directory), Format(format), Hits(0), Misses(0)
+        {
+        }
+
+        // Load a mesh for drawing with GpuMesh. A .mesh file is mapped directly, in whatever format it was cooked. Any other
+        // file is mapped from its cache entry when that is current, and otherwise imported with MeshImporter, stored in
+        // Format and written to the cache. Returns false, printing why, if the file cannot be loaded.
+        bool load(const std::string& path, MeshFile& file, const MeshImportOptions& options = MeshImportOptions(), MeshImportStats* stats = NULL)
+        {
+            if (isMeshFile(path))
+            {
+                if (!file.open(path))
+                {
+                    std::cout << "ERROR::MESH_CACHE::INVALID_MESH_FILE " << path << std::endl;
+                    return false;
+                }
+                return true;
+            }
+
+            std::error_code error;
+            uint64_t sourceSize = std::filesystem::file_size(path, error);
+            int64_t sourceTime = error ? 0 : (int64_t)std::filesystem::last_write_time(path, error).time_since_epoch().count();
+            std::string entry = Directory.empty() || error ? std::string() : entryPath(path, options);
+            if (!entry.empty() && file.open(entry))
+            {
+                if (file.header().sourceSize == sourceSize && file.header().sourceTime == sourceTime)
+                {
+                    Hits++;
+                    return true;
+                }
+                file.close();
+            }
+
+            Misses++;
+            Mesh mesh;
+            MeshImportStats importStats;
+            if (!MeshImporter::import(path, mesh, options, &importStats))
+            {
+                return false;
+            }
+            if (stats)
+            {
+                *stats = importStats;
+            }
+            if (!file.assign(mesh, MeshImporter::vertexAttributes(), Format, sourceSize, sourceTime))
+            {
+                std::cout << "ERROR::MESH_CACHE::NOT_ENCODED " << path << std::endl;
+                return false;
+            }
+
+            // A failed write only costs the next launch another import, so the mesh stays usable from memory.
+            if (!entry.empty())
+            {
+                std::filesystem::create_directories(Directory, error);
+                file.write(entry);
+            }
+            return true;
+        }
+
+        // Returns true if the file name ends in .mesh.
+        static bool isMeshFile(const std::string& path)
+        {
+            std::string extension = std::filesystem::path(path).extension().string();
+            std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+            return extension == ".mesh";
+        }
+
+    private:
+        static uint64_t hashBytes(uint64_t hash, const char* data, size_t size)
+        {
+            for (size_t i = 0; i < size; i++)
+            {
+                hash = (hash ^ (uint8_t)data[i]) * 1099511628211ull;
+            }
+            return hash;
+        }
+
+        // The entry is keyed on the absolute source path and on the options and format that change the stored mesh.
+        std::string entryPath(const std::string& path, const MeshImportOptions& options) const
+        {
+            std::error_code error;
+            std::string absolute = std::filesystem::absolute(path, error).lexically_normal().string();
+            uint64_t hash = hashBytes(14695981039346656037ull, absolute.data(), absolute.size());
+            char settings[3] = { options.optimize ? '1' : '0', (char)('0' + Format.position), (char)('0' + Format.normal) };
+            hash = hashBytes(hash, settings, sizeof(settings));
+            char name[32];
+            std::snprintf(name, sizeof(name), "%016llx.mesh", (unsigned long long)hash);
+            return Directory + "/" + name;
+        }
+};
+#endif
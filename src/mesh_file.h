@@ -0,0 +1,508 @@
+#ifndef MESH_FILE_H
+#define MESH_FILE_H
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iostream>
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+#include <cmath>
+#include <algorithm>
+#include <filesystem>
+
+#include "mesh.h"
+#include "mapped_file.h"
+#include "byte_span.h"
+#include "vertex_quantizer.h"
+
+// One attribute of a mesh file vertex, with the arguments glVertexAttribPointer takes.
+struct MeshFileAttribute
+{
+    uint32_t location;
+    uint32_t components;
+    // GL component type, such as GL_FLOAT.
+    uint32_t type;
+    uint32_t normalized;
+    // Offset from the start of the vertex, in bytes.
+    uint32_t offset;
+};
+
+// Fixed size header at the start of a mesh file. Every field is little endian.
+struct MeshFileHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    // Size and modification time of the file the mesh was built from, so MeshCache can tell when an entry is stale. 0 if unknown.
+    uint64_t sourceSize;
+    int64_t sourceTime;
+    uint64_t vertexCount;
+    uint64_t indexCount;
+    // Byte offsets of the vertex and index data from the start of the file.
+    uint64_t vertexOffset;
+    uint64_t indexOffset;
+    // Bytes per vertex.
+    uint32_t stride;
+    // GL_UNSIGNED_SHORT or GL_UNSIGNED_INT.
+    uint32_t indexType;
+    uint32_t attributeCount;
+    // Bounding box of the positions, so nothing has to read the vertices to place the mesh.
+    float boundsMin[3];
+    float boundsMax[3];
+    // A NormalFormat. Octahedral normals need the matching shader variant.
+    uint32_t normalFormat;
+    MeshFileAttribute attributes[8];
+    // Dequantization transform: model space position = stored position * positionScale + positionOffset.
+    float positionScale[3];
+    float positionOffset[3];
+    // A PositionFormat.
+    uint32_t positionFormat;
+    uint32_t reserved;
+};
+
+static_assert(sizeof(MeshFileHeader) == 288, "the mesh file header layout is part of the file format");
+
+// A versioned binary mesh holding vertex and index data exactly as the GL buffers store them, with the vertex layout
+// that describes them. Opening one maps the file and checks the header; the data is handed to glBufferData straight
+// from the mapping by GpuMesh, with no per-vertex work on the CPU. Files come from assign() and write(), normally
+// through MeshCache or the mesh_cooker tool. Any file is checked before use, including every index against the vertex
+// count, so a corrupt or foreign file cannot make the GPU read outside the vertex buffer.
+class MeshFile
+{
+    public:
+        static constexpr uint32_t MAGIC = 0x48534D43; // "CMSH"
+        static constexpr uint32_t VERSION = 2;
+        static constexpr unsigned int MAX_ATTRIBUTES = 8;
+        // Vertex and index data start on this boundary.
+        static constexpr size_t DATA_ALIGNMENT = 64;
+
+        // Map a mesh file and check its header. Returns false, leaving the file closed, if it is missing, truncated, of
+        // another version or inconsistent.
+        bool open(const std::string& path)
+        {
+            close();
+            if (!mappedFile.open(path) || !validate(mappedFile.bytes()))
+            {
+                mappedFile.close();
+                return false;
+            }
+            contents = mappedFile.bytes();
+            return true;
+        }
+
+        // Build a mesh file in memory from an indexed float mesh. Attributes are given in floats, as for Mesh::createVertexArray.
+        // The first one must be the position and sets the bounds. The three component attributes at locations 0 and 1
+        // are stored as format's position and normal, and every other attribute as GL_FLOAT. Indices are stored as 16
+        // bits when every one fits, like Mesh::upload() does.
+        bool assign(const Mesh& mesh, const std::vector<VertexAttribute>& attributes, VertexFormat format = VertexFormat(), uint64_t sourceSize = 0, int64_t sourceTime = 0)
+        {
+            close();
+            size_t vertexCount = mesh.vertexCount();
+            if (mesh.Stride == 0 || mesh.Indices.empty() || attributes.empty() || attributes.size() > MAX_ATTRIBUTES)
+            {
+                return false;
+            }
+
+            MeshFileHeader header = {};
+            header.magic = MAGIC;
+            header.version = VERSION;
+            header.sourceSize = sourceSize;
+            header.sourceTime = sourceTime;
+            header.vertexCount = vertexCount;
+            header.indexCount = mesh.Indices.size();
+            header.indexType = vertexCount <= 0x10000 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+            header.attributeCount = (uint32_t)attributes.size();
+            header.positionFormat = format.position;
+            header.normalFormat = format.normal;
+            // Vertices are copied as they are when the layout keeps every float in place.
+            bool verbatim = true;
+            for (size_t i = 0; i < attributes.size(); i++)
+            {
+                if (attributes[i].components < 1 || attributes[i].components > 4 || attributes[i].offset + attributes[i].components > mesh.Stride)
+                {
+                    return false;
+                }
+                MeshFileAttribute& attribute = header.attributes[i];
+                attribute = { attributes[i].location, (uint32_t)attributes[i].components, GL_FLOAT, GL_FALSE, header.stride };
+                switch (encoding(attributes[i]))
+                {
+                    case ENCODE_POSITION:
+                        attribute.type = format.position == POSITION_HALF ? GL_HALF_FLOAT : format.position == POSITION_SNORM16 ? GL_SHORT : GL_FLOAT;
+                        header.stride += (uint32_t)VertexQuantizer::positionBytes(format.position);
+                        break;
+                    case ENCODE_NORMAL:
+                        attribute.type = format.normal == NORMAL_OCTAHEDRAL ? GL_SHORT : format.normal == NORMAL_INT_2_10_10_10 ? GL_INT_2_10_10_10_REV : GL_FLOAT;
+                        attribute.components = format.normal == NORMAL_OCTAHEDRAL ? 2 : format.normal == NORMAL_INT_2_10_10_10 ? 4 : 3;
+                        attribute.normalized = format.normal != NORMAL_FLOAT;
+                        header.stride += (uint32_t)VertexQuantizer::normalBytes(format.normal);
+                        break;
+                    case ENCODE_FLOAT:
+                        header.stride += attribute.components * sizeof(float);
+                        break;
+                }
+                verbatim &= attribute.type == GL_FLOAT && attribute.offset == attributes[i].offset * sizeof(float);
+            }
+
+            const VertexAttribute& position = attributes[0];
+            for (int axis = 0; axis < 3; axis++)
+            {
+                header.boundsMin[axis] = vertexCount ? INFINITY : 0.0f;
+                header.boundsMax[axis] = vertexCount ? -INFINITY : 0.0f;
+            }
+            for (size_t v = 0; v < vertexCount; v++)
+            {
+                for (int axis = 0; axis < std::min(position.components, 3); axis++)
+                {
+                    float value = mesh.Vertices[v * mesh.Stride + position.offset + axis];
+                    header.boundsMin[axis] = std::min(header.boundsMin[axis], value);
+                    header.boundsMax[axis] = std::max(header.boundsMax[axis], value);
+                }
+            }
+            VertexQuantizer::dequantization(format.position, header.boundsMin, header.boundsMax, header.positionScale, header.positionOffset);
+
+            size_t vertexBytes = vertexCount * header.stride;
+            size_t indexBytes = header.indexCount * indexSize(header.indexType);
+            header.vertexOffset = align(sizeof(MeshFileHeader));
+            header.indexOffset = align(header.vertexOffset + vertexBytes);
+            storage.assign(header.indexOffset + indexBytes, 0);
+            std::memcpy(storage.data(), &header, sizeof(header));
+            if (verbatim && header.stride == mesh.Stride * sizeof(float))
+            {
+                std::memcpy(storage.data() + header.vertexOffset, mesh.Vertices.data(), vertexBytes);
+            }
+            else
+            {
+                encodeVertices(mesh, attributes, format, header, storage.data() + header.vertexOffset);
+            }
+            if (header.indexType == GL_UNSIGNED_SHORT)
+            {
+                uint16_t* indices = (uint16_t*)(storage.data() + header.indexOffset);
+                for (size_t i = 0; i < mesh.Indices.size(); i++)
+                {
+                    indices[i] = (uint16_t)mesh.Indices[i];
+                }
+            }
+            else
+            {
+                std::memcpy(storage.data() + header.indexOffset, mesh.Indices.data(), indexBytes);
+            }
+            contents = ByteSpan(storage);
+            return true;
+        }
+
+        // Save the file, replacing any file at path only once it is complete.
+        bool write(const std::string& path) const
+        {
+            if (!isOpen())
+            {
+                return false;
+            }
+            if (!writeFileAtomically(path, contents))
+            {
+                std::cout << "ERROR::MESH_FILE::WRITE_FAILED " << path << std::endl;
+                return false;
+            }
+            return true;
+        }
+
+        void close()
+        {
+            mappedFile.close();
+            storage.clear();
+            contents = ByteSpan();
+        }
+
+        bool isOpen() const
+        {
+            return !contents.empty();
+        }
+
+        // True if the data is mapped from a file rather than built in memory by assign().
+        bool isMapped() const
+        {
+            return mappedFile.isOpen();
+        }
+
+        const MeshFileHeader& header() const
+        {
+            return *(const MeshFileHeader*)contents.data();
+        }
+
+        ByteSpan vertexData() const
+        {
+            return ByteSpan(contents.data() + header().vertexOffset, (size_t)(header().vertexCount * header().stride));
+        }
+
+        ByteSpan indexData() const
+        {
+            return ByteSpan(contents.data() + header().indexOffset, (size_t)(header().indexCount * indexSize(header().indexType)));
+        }
+
+        // The whole file.
+        ByteSpan bytes() const
+        {
+            return contents;
+        }
+
+        static size_t indexSize(uint32_t indexType)
+        {
+            return indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+        }
+
+        // Bytes taken by an attribute, or 0 for types and component counts a mesh file cannot hold.
+        static size_t attributeSize(uint32_t type, uint32_t components)
+        {
+            if (components < 1 || components > 4)
+            {
+                return 0;
+            }
+            if (type == GL_INT_2_10_10_10_REV || type == GL_UNSIGNED_INT_2_10_10_10_REV)
+            {
+                return components == 4 ? 4 : 0;
+            }
+            return componentSize(type) * components;
+        }
+
+        // Bytes per component of an attribute type, or 0 for types a mesh file cannot hold.
+        static size_t componentSize(uint32_t type)
+        {
+            switch (type)
+            {
+                case GL_BYTE:
+                case GL_UNSIGNED_BYTE:
+                    return 1;
+                case GL_SHORT:
+                case GL_UNSIGNED_SHORT:
+                case GL_HALF_FLOAT:
+                    return 2;
+                case GL_INT:
+                case GL_UNSIGNED_INT:
+                case GL_FLOAT:
+                    return 4;
+            }
+            return 0;
+        }
+
+    private:
+        MappedFile mappedFile;
+        std::vector<unsigned char> storage;
+        // The mapping or the storage, whichever holds the file.
+        ByteSpan contents;
+
+        enum AttributeEncoding { ENCODE_FLOAT, ENCODE_POSITION, ENCODE_NORMAL };
+
+        static AttributeEncoding encoding(const VertexAttribute& attribute)
+        {
+            if (attribute.components != 3)
+            {
+                return ENCODE_FLOAT;
+            }
+            return attribute.location == 0 ? ENCODE_POSITION : attribute.location == 1 ? ENCODE_NORMAL : ENCODE_FLOAT;
+        }
+
+        // Write every vertex attribute by attribute at the offsets chosen by assign().
+        static void encodeVertices(const Mesh& mesh, const std::vector<VertexAttribute>& attributes, VertexFormat format, const MeshFileHeader& header, unsigned char* out)
+        {
+            for (size_t v = 0; v < mesh.vertexCount(); v++, out += header.stride)
+            {
+                const float* vertex = &mesh.Vertices[v * mesh.Stride];
+                for (size_t i = 0; i < attributes.size(); i++)
+                {
+                    const float* value = vertex + attributes[i].offset;
+                    unsigned char* target = out + header.attributes[i].offset;
+                    switch (encoding(attributes[i]))
+                    {
+                        case ENCODE_POSITION:
+                            VertexQuantizer::encodePosition(format.position, value, header.positionScale, header.positionOffset, target);
+                            break;
+                        case ENCODE_NORMAL:
+                            VertexQuantizer::encodeNormal(format.normal, value, target);
+                            break;
+                        case ENCODE_FLOAT:
+                            std::memcpy(target, value, attributes[i].components * sizeof(float));
+                            break;
+                    }
+                }
+            }
+        }
+
+        static uint64_t align(uint64_t offset)
+        {
+            return (offset + DATA_ALIGNMENT - 1) & ~(uint64_t)(DATA_ALIGNMENT - 1);
+        }
+
+        // Check that the header describes data inside the file. Sizes are compared by division so no product can overflow.
+        static bool validate(const ByteSpan& bytes)
+        {
+            if (bytes.size() < sizeof(MeshFileHeader))
+            {
+                return false;
+            }
+            const MeshFileHeader& header = *(const MeshFileHeader*)bytes.data();
+            if (header.magic != MAGIC || header.version != VERSION || header.stride == 0 || header.attributeCount == 0 || header.attributeCount > MAX_ATTRIBUTES
+                || (header.indexType != GL_UNSIGNED_SHORT && header.indexType != GL_UNSIGNED_INT) || header.indexCount == 0 || header.indexCount % 3 != 0
+                || header.vertexCount == 0 || header.vertexCount > UINT32_MAX || (header.indexType == GL_UNSIGNED_SHORT && header.vertexCount > 0x10000))
+            {
+                return false;
+            }
+            if (header.positionFormat > POSITION_SNORM16 || header.normalFormat > NORMAL_INT_2_10_10_10)
+            {
+                return false;
+            }
+            for (uint32_t i = 0; i < header.attributeCount; i++)
+            {
+                const MeshFileAttribute& attribute = header.attributes[i];
+                size_t size = attributeSize(attribute.type, attribute.components);
+                if (size == 0 || attribute.offset > header.stride || size > header.stride - attribute.offset)
+                {
+                    return false;
+                }
+            }
+            size_t length = bytes.size();
+            if (!(header.vertexOffset >= sizeof(MeshFileHeader) && header.vertexOffset <= length && header.vertexCount <= (length - header.vertexOffset) / header.stride
+                && header.indexOffset >= sizeof(MeshFileHeader) && header.indexOffset <= length && header.indexCount <= (length - header.indexOffset) / indexSize(header.indexType)
+                && header.indexOffset % indexSize(header.indexType) == 0))
+            {
+                return false;
+            }
+            const unsigned char* indices = bytes.data() + header.indexOffset;
+            if (header.indexType == GL_UNSIGNED_SHORT)
+            {
+                return indicesInRange((const uint16_t*)indices, header.indexCount, header.vertexCount);
+            }
+            return indicesInRange((const uint32_t*)indices, header.indexCount, header.vertexCount);
+        }
+
+        // One pass over the index data at open; the branch-free maximum keeps it at memory speed.
+        template <typename Index>
+        static bool indicesInRange(const Index* indices, uint64_t count, uint64_t vertexCount)
+        {
+            Index largest = 0;
+            for (uint64_t i = 0; i < count; i++)
+            {
+                largest = std::max(largest, indices[i]);
+            }
+            return largest < vertexCount;
+        }
+};
+
+// The GL buffers of a mesh file and the vertex layout read from its header.
+class GpuMesh
+{
+    public:
+        // GL objects, 0 until upload() is called.
+        unsigned int VBO;
+        unsigned int EBO;
+        GLenum IndexType;
+        GLsizei IndexCount;
+        // Bytes per vertex.
+        GLsizei Stride;
+        std::vector<MeshFileAttribute> Attributes;
+        // Ranges of shared arena pages holding the buffers when uploaded into arenas. VBO and EBO are then the pages.
+        ArenaGeometry Geometry;
+
+        GpuMesh() : VBO(0), EBO(0), IndexType(GL_UNSIGNED_INT), IndexCount(0), Stride(0)
+        {
+        }
+
+        // Returns true if the context can read every attribute type of the file. Packed 2_10_10_10 attributes need GL 3.3.
+        static bool isSupported(const MeshFileHeader& header)
+        {
+            for (uint32_t i = 0; i < header.attributeCount; i++)
+            {
+                uint32_t type = header.attributes[i].type;
+                if ((type == GL_INT_2_10_10_10_REV || type == GL_UNSIGNED_INT_2_10_10_10_REV) && !(GLEW_VERSION_3_3 || GLEW_ARB_vertex_type_2_10_10_10_rev))
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        // Upload into ranges of shared arena pages, straight from the file's bytes. Identical data already in an arena is shared.
+        void upload(const MeshFile& file, BufferArena& vertexArena, BufferArena& indexArena)
+        {
+            readLayout(file.header());
+            ByteSpan vertices = file.vertexData();
+            ByteSpan indices = file.indexData();
+            Geometry.upload(vertexArena, vertices.data(), vertices.size(), Stride, indexArena, indices.data(), indices.size(), MeshFile::indexSize(IndexType));
+            VBO = Geometry.vertexBuffer();
+            EBO = Geometry.indexBuffer();
+        }
+
+        // Create the vertex and index buffers straight from the file's bytes, usually its mapping.
+        void upload(const MeshFile& file)
+        {
+            readLayout(file.header());
+            ByteSpan vertices = file.vertexData();
+            glGenBuffers(1, &VBO);
+            glBindBuffer(GL_ARRAY_BUFFER, VBO);
+            glBufferData(GL_ARRAY_BUFFER, vertices.size(), vertices.data(), GL_STATIC_DRAW);
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+            // The element buffer binding is part of VAO state, so only bind it while no VAO is bound.
+            ByteSpan indices = file.indexData();
+            glStateCache().bindVertexArray(0);
+            glGenBuffers(1, &EBO);
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size(), indices.data(), GL_STATIC_DRAW);
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+        }
+
+        // Delete the GL buffers, or give the arena ranges back. Vertex arrays made from this mesh must not be drawn afterwards.
+        void release()
+        {
+            if (Geometry.isUploaded())
+            {
+                Geometry.release();
+            }
+            else
+            {
+                glDeleteBuffers(1, &VBO);
+                glDeleteBuffers(1, &EBO);
+            }
+            VBO = 0;
+            EBO = 0;
+        }
+
+        // Make a vertex array with every attribute of the file's layout.
+        unsigned int createVertexArray() const
+        {
+            unsigned int vertexArray;
+            glGenVertexArrays(1, &vertexArray);
+            glStateCache().bindVertexArray(vertexArray);
+            glBindBuffer(GL_ARRAY_BUFFER, VBO);
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+            for (const MeshFileAttribute& attribute : Attributes)
+            {
+                glVertexAttribPointer(attribute.location, (GLint)attribute.components, attribute.type, attribute.normalized ? GL_TRUE : GL_FALSE, Stride, (void*)(uintptr_t)attribute.offset);
+                glEnableVertexAttribArray(attribute.location);
+            }
+            glStateCache().bindVertexArray(0);
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+            return vertexArray;
+        }
+
+        // Draw the mesh with the currently bound vertex array.
+        void draw() const
+        {
+            if (Geometry.isUploaded())
+            {
+                Geometry.draw(IndexCount, IndexType);
+                return;
+            }
+            glDrawElements(GL_TRIANGLES, IndexCount, IndexType, (void*)0);
+        }
+
+    private:
+        void readLayout(const MeshFileHeader& header)
+        {
+            IndexType = header.indexType;
+            IndexCount = (GLsizei)header.indexCount;
+            Stride = (GLsizei)header.stride;
+            Attributes.assign(header.attributes, header.attributes + header.attributeCount);
+        }
+};
+#endif
@@ -0,0 +1,1182 @@
+#ifndef MESH_IMPORTER_H
+#define MESH_IMPORTER_H
+
+#include <string>
+#include <vector>
+#include <iostream>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <filesystem>
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+#include <cctype>
+#include <cmath>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "mesh.h"
+#include "mesh_optimizer.h"
+#include "mapped_file.h"
+#include "number_parser.h"
+#include "json.h"
+#include "parallel_for.h"
+
+// How MeshImporter builds a mesh.
+struct MeshImportOptions
+{
+    // Threads that parse and convert, including the calling one.
+    unsigned int threads = std::max(1u, std::thread::hardware_concurrency());
+    // Reorder triangles for the vertex cache and vertices for fetch locality with MeshOptimizer.
+    bool optimize = true;
+};
+
+// Size, speed and extent of one import.
+struct MeshImportStats
+{
+    // Bytes parsed: the OBJ file, or the glTF file and the external buffers it uses.
+    size_t fileBytes = 0;
+    // Time from opening the file to an indexed, interleaved mesh, and time spent in MeshOptimizer afterwards.
+    double importMs = 0.0;
+    double optimizeMs = 0.0;
+    size_t vertexCount = 0;
+    size_t triangleCount = 0;
+    glm::vec3 boundsMin = glm::vec3(0.0f);
+    glm::vec3 boundsMax = glm::vec3(0.0f);
+
+    double megabytesPerSecond() const
+    {
+        return importMs > 0.0 ? fileBytes / 1048576.0 * 1000.0 / importMs : 0.0;
+    }
+
+    void print(std::ostream& out, const std::string& label) const
+    {
+        out << label << ": " << vertexCount << " vertices, " << triangleCount << " triangles, " << fileBytes << " bytes imported in "
+            << importMs << " ms (" << megabytesPerSecond() << " MB/s), optimized in " << optimizeMs << " ms" << std::endl;
+    }
+};
+
+// Imports OBJ and glTF 2.0 (.gltf and .glb) files into an indexed Mesh of interleaved position, normal and texture
+// coordinate, VERTEX_STRIDE floats per vertex, ready for upload().
+// OBJ files are mapped and split into line-aligned chunks that are parsed on all threads with NumberParser, then merged:
+// indices are resolved, identical position/texcoord/normal corners become one vertex and faces are fanned into triangles.
+// glTF buffers are mapped or read from the .glb in place, and every primitive of every node in the scene is transformed
+// into the one mesh, split into blocks converted in parallel. Missing normals are generated: smooth for OBJ, flat for
+// glTF as its specification asks.
+class MeshImporter
+{
+    public:
+        static constexpr unsigned int VERTEX_STRIDE = 8;
+        static constexpr unsigned int POSITION_OFFSET = 0;
+        static constexpr unsigned int NORMAL_OFFSET = 3;
+        static constexpr unsigned int TEXCOORD_OFFSET = 6;
+
+        // Layout of the imported vertices: position at location 0, normal at 1 and texture coordinate at 2.
+        static std::vector<VertexAttribute> vertexAttributes()
+        {
+            return { { 0, 3, POSITION_OFFSET }, { 1, 3, NORMAL_OFFSET }, { 2, 2, TEXCOORD_OFFSET } };
+        }
+
+        // Import a file chosen by its extension. Returns false, printing why, if it cannot be read or is malformed.
+        static bool import(const std::string& path, Mesh& mesh, const MeshImportOptions& options = MeshImportOptions(), MeshImportStats* stats = NULL)
+        {
+            MeshImportStats result;
+            auto start = std::chrono::steady_clock::now();
+            mesh = Mesh();
+            mesh.Stride = VERTEX_STRIDE;
+
+            std::string extension = std::filesystem::path(path).extension().string();
+            std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+            unsigned int threads = std::max(1u, options.threads);
+            bool imported;
+            if (extension == ".obj")
+            {
+                imported = importObj(path, mesh, threads, result);
+            }
+            else if (extension == ".gltf" || extension == ".glb")
+            {
+                imported = importGltf(path, mesh, threads, result);
+            }
+            else
+            {
+                std::cout << "ERROR::MESH_IMPORTER::UNSUPPORTED_FORMAT " << path << std::endl;
+                return false;
+            }
+            if (imported && mesh.Indices.empty())
+            {
+                std::cout << "ERROR::MESH_IMPORTER::NO_TRIANGLES " << path << std::endl;
+                imported = false;
+            }
+            if (!imported)
+            {
+                mesh = Mesh();
+                return false;
+            }
+            computeBounds(mesh, threads, result);
+            result.vertexCount = mesh.vertexCount();
+            result.triangleCount = mesh.Indices.size() / 3;
+            result.importMs = elapsedMs(start);
+
+            if (options.optimize && !mesh.Indices.empty())
+            {
+                auto optimizeStart = std::chrono::steady_clock::now();
+                mesh.Indices = MeshOptimizer::optimizeVertexCache(mesh.Indices, mesh.vertexCount());
+                MeshOptimizer::optimizeVertexFetch(mesh.Indices, mesh.Vertices, VERTEX_STRIDE);
+                result.vertexCount = mesh.vertexCount();
+                result.optimizeMs = elapsedMs(optimizeStart);
+            }
+            if (stats)
+            {
+                *stats = result;
+            }
+            return true;
+        }
+
+    private:
+        static constexpr uint32_t NONE = 0xFFFFFFFFu;
+        // OBJ text per chunk: small enough that a chunk's corner table stays in cache, large enough to keep the merge of
+        // corners shared across chunk boundaries rare.
+        static constexpr size_t CHUNK_BYTES = 1 << 20;
+        // Vertices or triangles per parallel block when converting.
+        static constexpr size_t BLOCK_SIZE = 65536;
+
+        static double elapsedMs(std::chrono::steady_clock::time_point start)
+        {
+            return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        }
+
+        static void computeBounds(const Mesh& mesh, unsigned int threads, MeshImportStats& stats)
+        {
+            size_t vertexCount = mesh.vertexCount();
+            size_t blockCount = (vertexCount + BLOCK_SIZE - 1) / BLOCK_SIZE;
+            std::vector<glm::vec3> blockMin(blockCount, glm::vec3(INFINITY)), blockMax(blockCount, glm::vec3(-INFINITY));
+            parallelFor(threads, blockCount, [&](size_t block)
+            {
+                size_t end = std::min(vertexCount, (block + 1) * BLOCK_SIZE);
+                for (size_t v = block * BLOCK_SIZE; v < end; v++)
+                {
+                    glm::vec3 position = glm::make_vec3(&mesh.Vertices[v * VERTEX_STRIDE + POSITION_OFFSET]);
+                    blockMin[block] = glm::min(blockMin[block], position);
+                    blockMax[block] = glm::max(blockMax[block], position);
+                }
+            });
+            stats.boundsMin = glm::vec3(blockCount ? INFINITY : 0.0f);
+            stats.boundsMax = glm::vec3(blockCount ? -INFINITY : 0.0f);
+            for (size_t block = 0; block < blockCount; block++)
+            {
+                stats.boundsMin = glm::min(stats.boundsMin, blockMin[block]);
+                stats.boundsMax = glm::max(stats.boundsMax, blockMax[block]);
+            }
+        }
+
+        // One face corner. While a chunk is parsed, a positive value is the file's 1-based index, 0 is a missing
+        // texcoord or normal, and a negative value is a relative index already counted from the chunk's first element and
+        // offset by RELATIVE, because the number of elements in earlier chunks is not known yet. Resolving turns them
+        // all into 0-based indices with NONE for missing attributes.
+        struct ObjCorner
+        {
+            uint32_t position;
+            uint32_t texcoord;
+            uint32_t normal;
+
+            bool operator==(const ObjCorner& other) const
+            {
+                return position == other.position && texcoord == other.texcoord && normal == other.normal;
+            }
+        };
+
+        static constexpr int64_t RELATIVE = (int64_t)1 << 30;
+
+        struct ObjChunk
+        {
+            const char* begin;
+            const char* end;
+            std::vector<float> positions;
+            std::vector<float> texcoords;
+            std::vector<float> normals;
+            // Three corners per triangle.
+            std::vector<ObjCorner> corners;
+            // Corners merged into unique vertices: the chunk's unique corners in first-use order and, for each of them,
+            // the mesh vertex it became.
+            std::vector<ObjCorner> uniqueCorners;
+            std::vector<uint32_t> vertexIds;
+            // Elements and corners in earlier chunks.
+            size_t positionBase;
+            size_t texcoordBase;
+            size_t normalBase;
+            size_t cornerBase;
+            bool malformed;
+            bool outOfRange;
+            bool missingNormals;
+        };
+
+        // Open-addressing map from corners to dense ids, kept at most half full.
+        class CornerTable
+        {
+            public:
+                explicit CornerTable(size_t expected) : slots(tableSize(expected), NONE)
+                {
+                }
+
+                // Returns the id of corner, adding it to corners if it is new.
+                uint32_t insert(const ObjCorner& corner, std::vector<ObjCorner>& corners)
+                {
+                    if ((corners.size() + 1) * 2 > slots.size())
+                    {
+                        grow(corners);
+                    }
+                    size_t mask = slots.size() - 1;
+                    size_t slot = hash(corner) & mask;
+                    while (slots[slot] != NONE && !(corners[slots[slot]] == corner))
+                    {
+                        slot = (slot + 1) & mask;
+                    }
+                    if (slots[slot] == NONE)
+                    {
+                        slots[slot] = (uint32_t)corners.size();
+                        corners.push_back(corner);
+                    }
+                    return slots[slot];
+                }
+
+            private:
+                std::vector<uint32_t> slots;
+
+                static size_t tableSize(size_t expected)
+                {
+                    size_t size = 16;
+                    while (size < expected * 2)
+                    {
+                        size *= 2;
+                    }
+                    return size;
+                }
+
+                static size_t hash(const ObjCorner& corner)
+                {
+                    uint64_t hash = corner.position * 0x9E3779B97F4A7C15ull;
+                    hash ^= (hash >> 32) ^ corner.texcoord * 0xC2B2AE3D27D4EB4Full;
+                    hash ^= (hash >> 29) ^ corner.normal * 0x165667B19E3779F9ull;
+                    return (size_t)(hash ^ (hash >> 32));
+                }
+
+                void grow(const std::vector<ObjCorner>& corners)
+                {
+                    slots.assign(slots.size() * 2, NONE);
+                    size_t mask = slots.size() - 1;
+                    for (size_t id = 0; id < corners.size(); id++)
+                    {
+                        size_t slot = hash(corners[id]) & mask;
+                        while (slots[slot] != NONE)
+                        {
+                            slot = (slot + 1) & mask;
+                        }
+                        slots[slot] = (uint32_t)id;
+                    }
+                }
+        };
+
+        static bool isBlank(char c)
+        {
+            return c == ' ' || c == '\t' || c == '\r';
+        }
+
+        static void skipBlanks(const char*& p, const char* end)
+        {
+            while (p < end && isBlank(*p))
+            {
+                p++;
+            }
+        }
+
+        static bool readFloats(const char*& p, const char* end, float* values, int count)
+        {
+            for (int i = 0; i < count; i++)
+            {
+                skipBlanks(p, end);
+                if (!NumberParser::parseFloat(p, end, values[i]))
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        // Read one index of a face corner, encoded as described at ObjCorner. localCount is the number of elements of its
+        // kind parsed so far in this chunk.
+        static bool readIndex(const char*& p, const char* end, size_t localCount, uint32_t& index)
+        {
+            int64_t value;
+            if (!NumberParser::parseInt(p, end, value) || value == 0 || value >= RELATIVE || value < -RELATIVE)
+            {
+                return false;
+            }
+            index = value > 0 ? (uint32_t)value : (uint32_t)(int32_t)((int64_t)localCount + value - RELATIVE);
+            return true;
+        }
+
+        static void parseObjChunk(ObjChunk& chunk)
+        {
+            const char* p = chunk.begin;
+            const char* end = chunk.end;
+            while (p < end && !chunk.malformed)
+            {
+                const char* lineEnd = (const char*)memchr(p, '\n', (size_t)(end - p));
+                lineEnd = lineEnd ? lineEnd : end;
+                skipBlanks(p, lineEnd);
+                if (lineEnd - p >= 2 && p[0] == 'v' && isBlank(p[1]))
+                {
+                    // Extra values such as w or vertex colors are ignored.
+                    float position[3];
+                    p += 2;
+                    chunk.malformed = !readFloats(p, lineEnd, position, 3);
+                    chunk.positions.insert(chunk.positions.end(), position, position + 3);
+                }
+                else if (lineEnd - p >= 3 && p[0] == 'v' && p[1] == 'n' && isBlank(p[2]))
+                {
+                    float normal[3];
+                    p += 3;
+                    chunk.malformed = !readFloats(p, lineEnd, normal, 3);
+                    chunk.normals.insert(chunk.normals.end(), normal, normal + 3);
+                }
+                else if (lineEnd - p >= 3 && p[0] == 'v' && p[1] == 't' && isBlank(p[2]))
+                {
+                    // v is optional.
+                    float texcoord[2] = { 0.0f, 0.0f };
+                    p += 3;
+                    chunk.malformed = !readFloats(p, lineEnd, texcoord, 1);
+                    readFloats(p, lineEnd, texcoord + 1, 1);
+                    chunk.texcoords.insert(chunk.texcoords.end(), texcoord, texcoord + 2);
+                }
+                else if (lineEnd - p >= 2 && p[0] == 'f' && isBlank(p[1]))
+                {
+                    p += 2;
+                    parseObjFace(chunk, p, lineEnd);
+                }
+                // Groups, materials, smoothing groups, lines and points do not change the geometry.
+                p = lineEnd + 1;
+            }
+        }
+
+        // Fan a face of any number of v, v/t, v//n or v/t/n corners into triangles.
+        static void parseObjFace(ObjChunk& chunk, const char*& p, const char* end)
+        {
+            ObjCorner first = {}, previous = {};
+            size_t cornerCount = 0;
+            while (true)
+            {
+                skipBlanks(p, end);
+                if (p >= end || *p == '#')
+                {
+                    break;
+                }
+                ObjCorner corner = { 0, 0, 0 };
+                if (!readIndex(p, end, chunk.positions.size() / 3, corner.position))
+                {
+                    chunk.malformed = true;
+                    return;
+                }
+                if (p < end && *p == '/')
+                {
+                    p++;
+                    if (p < end && *p != '/' && !readIndex(p, end, chunk.texcoords.size() / 2, corner.texcoord))
+                    {
+                        chunk.malformed = true;
+                        return;
+                    }
+                    if (p < end && *p == '/')
+                    {
+                        p++;
+                        if (!readIndex(p, end, chunk.normals.size() / 3, corner.normal))
+                        {
+                            chunk.malformed = true;
+                            return;
+                        }
+                    }
+                }
+                if (cornerCount == 0)
+                {
+                    first = corner;
+                }
+                else if (cornerCount >= 2)
+                {
+                    chunk.corners.push_back(first);
+                    chunk.corners.push_back(previous);
+                    chunk.corners.push_back(corner);
+                }
+                previous = corner;
+                cornerCount++;
+            }
+        }
+
+        // Turn a parsed index into a 0-based one. Returns false if it lies outside the file's elements.
+        static bool resolveIndex(uint32_t& index, size_t base, size_t total, bool optional)
+        {
+            if (index == 0)
+            {
+                index = NONE;
+                return optional;
+            }
+            int64_t value = (int32_t)index < 0 ? (int64_t)base + (int64_t)(int32_t)index + RELATIVE : (int64_t)index - 1;
+            if (value < 0 || value >= (int64_t)total)
+            {
+                return false;
+            }
+            index = (uint32_t)value;
+            return true;
+        }
+
+        static bool importObj(const std::string& path, Mesh& mesh, unsigned int threads, MeshImportStats& stats)
+        {
+            MappedFile file;
+            if (!file.open(path))
+            {
+                std::cout << "ERROR::MESH_IMPORTER::NOT_OPENED " << path << std::endl;
+                return false;
+            }
+            stats.fileBytes = file.size();
+            const char* text = (const char*)file.data();
+            const char* textEnd = text + file.size();
+
+            // Split at line starts. Threads take chunks as they finish, so uneven lines balance out.
+            size_t chunkCount = std::max<size_t>(1, file.size() / CHUNK_BYTES);
+            std::vector<ObjChunk> chunks(chunkCount);
+            const char* chunkStart = text;
+            for (size_t c = 0; c < chunkCount; c++)
+            {
+                const char* chunkEnd = c + 1 == chunkCount ? textEnd : text + file.size() / chunkCount * (c + 1);
+                chunkEnd = std::max(chunkEnd, chunkStart);
+                const char* newline = (const char*)memchr(chunkEnd, '\n', (size_t)(textEnd - chunkEnd));
+                chunkEnd = c + 1 == chunkCount || !newline ? textEnd : newline + 1;
+                chunks[c].begin = chunkStart;
+                chunks[c].end = chunkEnd;
+                chunks[c].malformed = false;
+                chunks[c].outOfRange = false;
+                chunks[c].missingNormals = false;
+                chunkStart = chunkEnd;
+            }
+            parallelFor(threads, chunkCount, [&chunks](size_t c) { parseObjChunk(chunks[c]); });
+
+            size_t positionCount = 0, texcoordCount = 0, normalCount = 0, cornerCount = 0;
+            for (ObjChunk& chunk : chunks)
+            {
+                if (chunk.malformed)
+                {
+                    std::cout << "ERROR::MESH_IMPORTER::OBJ_MALFORMED " << path << " near byte " << (chunk.begin - text) << std::endl;
+                    return false;
+                }
+                chunk.positionBase = positionCount;
+                chunk.texcoordBase = texcoordCount;
+                chunk.normalBase = normalCount;
+                chunk.cornerBase = cornerCount;
+                positionCount += chunk.positions.size() / 3;
+                texcoordCount += chunk.texcoords.size() / 2;
+                normalCount += chunk.normals.size() / 3;
+                cornerCount += chunk.corners.size();
+            }
+            if (positionCount >= (size_t)RELATIVE || cornerCount >= NONE)
+            {
+                std::cout << "ERROR::MESH_IMPORTER::OBJ_TOO_LARGE " << path << std::endl;
+                return false;
+            }
+
+            // Resolve indices now that every chunk's counts are known and merge corners within each chunk. The chunk's
+            // local vertex numbers go straight into the index buffer and are renumbered below.
+            mesh.Indices.resize(cornerCount);
+            parallelFor(threads, chunkCount, [&](size_t c)
+            {
+                ObjChunk& chunk = chunks[c];
+                // Most corners that share a position share its texcoord and normal too, so the chunk has about as many
+                // vertices as its largest element list.
+                CornerTable table(std::max(chunk.positions.size() / 3, std::max(chunk.texcoords.size() / 2, chunk.normals.size() / 3)));
+                unsigned int* indices = mesh.Indices.data() + chunk.cornerBase;
+                for (size_t i = 0; i < chunk.corners.size(); i++)
+                {
+                    ObjCorner corner = chunk.corners[i];
+                    if (!resolveIndex(corner.position, chunk.positionBase, positionCount, false) || !resolveIndex(corner.texcoord, chunk.texcoordBase, texcoordCount, true)
+                        || !resolveIndex(corner.normal, chunk.normalBase, normalCount, true))
+                    {
+                        chunk.outOfRange = true;
+                        return;
+                    }
+                    chunk.missingNormals |= corner.normal == NONE;
+                    indices[i] = table.insert(corner, chunk.uniqueCorners);
+                }
+                std::vector<ObjCorner>().swap(chunk.corners);
+            });
+            bool missingNormals = false;
+            for (const ObjChunk& chunk : chunks)
+            {
+                if (chunk.outOfRange)
+                {
+                    std::cout << "ERROR::MESH_IMPORTER::INDEX_OUT_OF_RANGE " << path << std::endl;
+                    return false;
+                }
+                missingNormals |= chunk.missingNormals;
+            }
+
+            // Merge the chunks' unique corners into mesh vertices. Only corners shared across chunk boundaries collide, so
+            // this serial pass sees each vertex about once instead of once per face that uses it.
+            std::vector<ObjCorner> vertices;
+            CornerTable table(positionCount);
+            for (ObjChunk& chunk : chunks)
+            {
+                chunk.vertexIds.resize(chunk.uniqueCorners.size());
+                for (size_t i = 0; i < chunk.uniqueCorners.size(); i++)
+                {
+                    chunk.vertexIds[i] = table.insert(chunk.uniqueCorners[i], vertices);
+                }
+            }
+            parallelFor(threads, chunkCount, [&](size_t c)
+            {
+                const ObjChunk& chunk = chunks[c];
+                size_t end = c + 1 < chunkCount ? chunks[c + 1].cornerBase : cornerCount;
+                for (size_t i = chunk.cornerBase; i < end; i++)
+                {
+                    mesh.Indices[i] = chunk.vertexIds[mesh.Indices[i]];
+                }
+            });
+
+            // Gather every chunk's elements into single arrays the corners index.
+            std::vector<float> positions(positionCount * 3), texcoords(texcoordCount * 2), normals(normalCount * 3);
+            parallelFor(threads, chunkCount, [&](size_t c)
+            {
+                const ObjChunk& chunk = chunks[c];
+                std::copy(chunk.positions.begin(), chunk.positions.end(), positions.begin() + chunk.positionBase * 3);
+                std::copy(chunk.texcoords.begin(), chunk.texcoords.end(), texcoords.begin() + chunk.texcoordBase * 2);
+                std::copy(chunk.normals.begin(), chunk.normals.end(), normals.begin() + chunk.normalBase * 3);
+            });
+            chunks.clear();
+
+            // Corners without a normal get the area-weighted average of the faces around their position, so faces that
+            // only differ in texture coordinates still shade smoothly across the seam.
+            std::vector<float> smoothNormals;
+            if (missingNormals)
+            {
+                smoothNormals.assign(positionCount * 3, 0.0f);
+                for (size_t i = 0; i + 2 < mesh.Indices.size(); i += 3)
+                {
+                    uint32_t a = vertices[mesh.Indices[i]].position, b = vertices[mesh.Indices[i + 1]].position, c = vertices[mesh.Indices[i + 2]].position;
+                    glm::vec3 pa = glm::make_vec3(&positions[a * 3]), pb = glm::make_vec3(&positions[b * 3]), pc = glm::make_vec3(&positions[c * 3]);
+                    glm::vec3 normal = glm::cross(pb - pa, pc - pa);
+                    for (uint32_t corner : { a, b, c })
+                    {
+                        smoothNormals[corner * 3] += normal.x;
+                        smoothNormals[corner * 3 + 1] += normal.y;
+                        smoothNormals[corner * 3 + 2] += normal.z;
+                    }
+                }
+            }
+
+            mesh.Vertices.resize(vertices.size() * VERTEX_STRIDE);
+            size_t blockCount = (vertices.size() + BLOCK_SIZE - 1) / BLOCK_SIZE;
+            parallelFor(threads, blockCount, [&](size_t block)
+            {
+                size_t end = std::min(vertices.size(), (block + 1) * BLOCK_SIZE);
+                for (size_t v = block * BLOCK_SIZE; v < end; v++)
+                {
+                    const ObjCorner& corner = vertices[v];
+                    float* vertex = &mesh.Vertices[v * VERTEX_STRIDE];
+                    memcpy(vertex + POSITION_OFFSET, &positions[corner.position * 3], 3 * sizeof(float));
+                    if (corner.normal != NONE)
+                    {
+                        memcpy(vertex + NORMAL_OFFSET, &normals[corner.normal * 3], 3 * sizeof(float));
+                    }
+                    else
+                    {
+                        glm::vec3 normal = glm::make_vec3(&smoothNormals[corner.position * 3]);
+                        float length = glm::length(normal);
+                        normal = length > 0.0f ? normal / length : glm::vec3(0.0f, 0.0f, 1.0f);
+                        memcpy(vertex + NORMAL_OFFSET, glm::value_ptr(normal), 3 * sizeof(float));
+                    }
+                    vertex[TEXCOORD_OFFSET] = corner.texcoord != NONE ? texcoords[corner.texcoord * 2] : 0.0f;
+                    vertex[TEXCOORD_OFFSET + 1] = corner.texcoord != NONE ? texcoords[corner.texcoord * 2 + 1] : 0.0f;
+                }
+            });
+            return true;
+        }
+
+        // Elements of a glTF accessor inside a mapped or decoded buffer. data is NULL for accessors without a buffer
+        // view, which read as zeros.
+        struct GltfAccessor
+        {
+            const unsigned char* data = NULL;
+            size_t count = 0;
+            size_t stride = 0;
+            int componentType = 0;
+            int components = 0;
+            bool normalized = false;
+        };
+
+        // One primitive placed in the mesh by one node.
+        struct GltfDraw
+        {
+            GltfAccessor positions;
+            GltfAccessor normals;
+            GltfAccessor texcoords;
+            GltfAccessor indices;
+            bool hasNormals;
+            bool hasTexcoords;
+            bool hasIndices;
+            glm::mat4 transform;
+            glm::mat3 normalTransform;
+            // Mirroring transforms reverse the winding, so such draws swap two corners of every triangle back.
+            bool flipWinding;
+            size_t vertexCount;
+            size_t indexCount;
+            size_t firstVertex;
+            size_t firstIndex;
+        };
+
+        // A range of one draw converted by one task: vertices, or triangles for indices and flat-shaded draws.
+        struct GltfTask
+        {
+            size_t draw;
+            size_t begin;
+            size_t end;
+            bool indices;
+        };
+
+        // Everything that keeps the buffers of a glTF file alive while it is converted.
+        struct GltfFile
+        {
+            MappedFile file;
+            JsonValue json;
+            std::vector<MappedFile> mappedBuffers;
+            std::vector<std::vector<unsigned char>> decodedBuffers;
+            std::vector<ByteSpan> buffers;
+        };
+
+        static bool importGltf(const std::string& path, Mesh& mesh, unsigned int threads, MeshImportStats& stats)
+        {
+            GltfFile gltf;
+            if (!gltf.file.open(path))
+            {
+                std::cout << "ERROR::MESH_IMPORTER::NOT_OPENED " << path << std::endl;
+                return false;
+            }
+            stats.fileBytes = gltf.file.size();
+            if (!loadGltf(path, gltf, stats))
+            {
+                return false;
+            }
+            const JsonValue& json = gltf.json;
+            const JsonValue& required = json["extensionsRequired"];
+            if (required.size() > 0)
+            {
+                // Compressed geometry such as Draco or meshopt would need its decoder.
+                std::cout << "ERROR::MESH_IMPORTER::GLTF_EXTENSION_REQUIRED " << required[0].string << " " << path << std::endl;
+                return false;
+            }
+
+            std::vector<GltfDraw> draws;
+            if (!collectDraws(gltf, draws))
+            {
+                std::cout << "ERROR::MESH_IMPORTER::GLTF_MALFORMED " << path << std::endl;
+                return false;
+            }
+
+            // Place every draw in the mesh and split it into blocks so one large primitive still uses every thread.
+            size_t vertexCount = 0, indexCount = 0;
+            std::vector<GltfTask> tasks;
+            for (size_t d = 0; d < draws.size(); d++)
+            {
+                GltfDraw& draw = draws[d];
+                draw.firstVertex = vertexCount;
+                draw.firstIndex = indexCount;
+                vertexCount += draw.vertexCount;
+                indexCount += draw.indexCount;
+                if (draw.hasNormals)
+                {
+                    for (size_t v = 0; v < draw.vertexCount; v += BLOCK_SIZE)
+                    {
+                        tasks.push_back({ d, v, std::min(draw.vertexCount, v + BLOCK_SIZE), false });
+                    }
+                }
+                for (size_t t = 0; t < draw.indexCount / 3; t += BLOCK_SIZE)
+                {
+                    tasks.push_back({ d, t, std::min(draw.indexCount / 3, t + BLOCK_SIZE), true });
+                }
+            }
+            if (vertexCount >= NONE)
+            {
+                std::cout << "ERROR::MESH_IMPORTER::GLTF_TOO_LARGE " << path << std::endl;
+                return false;
+            }
+            mesh.Vertices.resize(vertexCount * VERTEX_STRIDE);
+            mesh.Indices.resize(indexCount);
+            std::atomic<bool> outOfRange(false);
+            parallelFor(threads, tasks.size(), [&](size_t t)
+            {
+                const GltfTask& task = tasks[t];
+                const GltfDraw& draw = draws[task.draw];
+                if (!task.indices)
+                {
+                    for (size_t v = task.begin; v < task.end; v++)
+                    {
+                        writeGltfVertex(draw, v, &mesh.Vertices[(draw.firstVertex + v) * VERTEX_STRIDE]);
+                    }
+                    return;
+                }
+                for (size_t triangle = task.begin; triangle < task.end; triangle++)
+                {
+                    uint32_t corners[3];
+                    for (int k = 0; k < 3; k++)
+                    {
+                        corners[k] = draw.hasIndices ? readGltfIndex(draw.indices, triangle * 3 + k) : (uint32_t)(triangle * 3 + k);
+                        if (corners[k] >= draw.positions.count)
+                        {
+                            outOfRange = true;
+                            return;
+                        }
+                    }
+                    if (draw.flipWinding)
+                    {
+                        std::swap(corners[1], corners[2]);
+                    }
+                    unsigned int* indices = &mesh.Indices[draw.firstIndex + triangle * 3];
+                    if (draw.hasNormals)
+                    {
+                        for (int k = 0; k < 3; k++)
+                        {
+                            indices[k] = (unsigned int)(draw.firstVertex + corners[k]);
+                        }
+                        continue;
+                    }
+                    // Without normals every triangle gets its own three vertices sharing the face normal.
+                    float* vertices[3];
+                    for (int k = 0; k < 3; k++)
+                    {
+                        indices[k] = (unsigned int)(draw.firstVertex + triangle * 3 + k);
+                        vertices[k] = &mesh.Vertices[indices[k] * VERTEX_STRIDE];
+                        writeGltfVertex(draw, corners[k], vertices[k]);
+                    }
+                    glm::vec3 a = glm::make_vec3(vertices[0]), b = glm::make_vec3(vertices[1]), c = glm::make_vec3(vertices[2]);
+                    glm::vec3 normal = glm::cross(b - a, c - a);
+                    float length = glm::length(normal);
+                    normal = length > 0.0f ? normal / length : glm::vec3(0.0f, 0.0f, 1.0f);
+                    for (int k = 0; k < 3; k++)
+                    {
+                        memcpy(vertices[k] + NORMAL_OFFSET, glm::value_ptr(normal), 3 * sizeof(float));
+                    }
+                }
+            });
+            if (outOfRange)
+            {
+                std::cout << "ERROR::MESH_IMPORTER::INDEX_OUT_OF_RANGE " << path << std::endl;
+                return false;
+            }
+            return true;
+        }
+
+        // Parse the JSON of a .gltf or .glb and find every buffer: the .glb's binary chunk, a base64 data URI or a mapped
+        // file next to the .gltf.
+        static bool loadGltf(const std::string& path, GltfFile& gltf, MeshImportStats& stats)
+        {
+            const unsigned char* bytes = gltf.file.data();
+            size_t size = gltf.file.size();
+            const unsigned char* jsonText = bytes;
+            size_t jsonSize = size;
+            ByteSpan binaryChunk;
+            if (size >= 12 && memcmp(bytes, "glTF", 4) == 0)
+            {
+                uint32_t header[3], chunk[2];
+                memcpy(header, bytes, sizeof(header));
+                if (header[1] != 2 || header[2] > size || header[2] < 20)
+                {
+                    std::cout << "ERROR::MESH_IMPORTER::GLTF_MALFORMED " << path << std::endl;
+                    return false;
+                }
+                size = header[2];
+                memcpy(chunk, bytes + 12, sizeof(chunk));
+                if (chunk[1] != 0x4E4F534A || chunk[0] > size - 20)
+                {
+                    std::cout << "ERROR::MESH_IMPORTER::GLTF_MALFORMED " << path << std::endl;
+                    return false;
+                }
+                jsonText = bytes + 20;
+                jsonSize = chunk[0];
+                size_t binaryOffset = 20 + ((jsonSize + 3) & ~(size_t)3);
+                if (binaryOffset + 8 <= size)
+                {
+                    memcpy(chunk, bytes + binaryOffset, sizeof(chunk));
+                    if (chunk[1] == 0x004E4942 && chunk[0] <= size - binaryOffset - 8)
+                    {
+                        binaryChunk = ByteSpan(bytes + binaryOffset + 8, chunk[0]);
+                    }
+                }
+            }
+            if (!JsonParser::parse((const char*)jsonText, jsonSize, gltf.json))
+            {
+                std::cout << "ERROR::MESH_IMPORTER::GLTF_MALFORMED " << path << std::endl;
+                return false;
+            }
+
+            const JsonValue& buffers = gltf.json["buffers"];
+            std::filesystem::path directory = std::filesystem::path(path).parent_path();
+            gltf.buffers.resize(buffers.size());
+            for (size_t i = 0; i < buffers.size(); i++)
+            {
+                const JsonValue& buffer = buffers[i];
+                int64_t byteLength = buffer["byteLength"].integerOr(-1);
+                const JsonValue& uri = buffer["uri"];
+                ByteSpan contents;
+                if (uri.type != JsonValue::STRING)
+                {
+                    // Only the first buffer of a .glb may omit its URI.
+                    contents = i == 0 ? binaryChunk : ByteSpan();
+                }
+                else if (uri.string.compare(0, 5, "data:") == 0)
+                {
+                    size_t comma = uri.string.find(',');
+                    gltf.decodedBuffers.emplace_back();
+                    if (comma != std::string::npos && uri.string.rfind(";base64", comma) != std::string::npos
+                        && decodeBase64(uri.string.data() + comma + 1, uri.string.size() - comma - 1, gltf.decodedBuffers.back()))
+                    {
+                        contents = gltf.decodedBuffers.back();
+                    }
+                }
+                else
+                {
+                    std::string bufferPath = (directory / decodeUri(uri.string)).string();
+                    gltf.mappedBuffers.emplace_back();
+                    if (gltf.mappedBuffers.back().open(bufferPath))
+                    {
+                        contents = gltf.mappedBuffers.back().bytes();
+                        stats.fileBytes += contents.size();
+                    }
+                }
+                if (byteLength < 0 || contents.size() < (size_t)byteLength)
+                {
+                    std::cout << "ERROR::MESH_IMPORTER::GLTF_BUFFER_NOT_READ " << i << " " << path << std::endl;
+                    return false;
+                }
+                gltf.buffers[i] = ByteSpan(contents.data(), (size_t)byteLength);
+            }
+            return true;
+        }
+
+        // Walk the default scene, or every root node without one, and list its triangle primitives with their world transforms.
+        static bool collectDraws(const GltfFile& gltf, std::vector<GltfDraw>& draws)
+        {
+            const JsonValue& json = gltf.json;
+            const JsonValue& nodes = json["nodes"];
+            std::vector<int64_t> roots;
+            const JsonValue& scene = json["scenes"][(size_t)json["scene"].integerOr(0)];
+            if (!scene.isNull())
+            {
+                for (size_t i = 0; i < scene["nodes"].size(); i++)
+                {
+                    roots.push_back(scene["nodes"][i].integerOr(-1));
+                }
+            }
+            else
+            {
+                std::vector<bool> isChild(nodes.size(), false);
+                for (size_t n = 0; n < nodes.size(); n++)
+                {
+                    const JsonValue& children = nodes[n]["children"];
+                    for (size_t i = 0; i < children.size(); i++)
+                    {
+                        size_t child = (size_t)children[i].integerOr(-1);
+                        if (child < nodes.size())
+                        {
+                            isChild[child] = true;
+                        }
+                    }
+                }
+                for (size_t n = 0; n < nodes.size(); n++)
+                {
+                    if (!isChild[n])
+                    {
+                        roots.push_back((int64_t)n);
+                    }
+                }
+            }
+            for (int64_t root : roots)
+            {
+                if (!collectNode(gltf, root, glm::mat4(1.0f), 0, draws))
+                {
+                    return false;
+                }
+            }
+            // A file of bare meshes without nodes still has geometry worth showing.
+            if (nodes.size() == 0)
+            {
+                for (size_t m = 0; m < json["meshes"].size(); m++)
+                {
+                    if (!collectMesh(gltf, json["meshes"][m], glm::mat4(1.0f), draws))
+                    {
+                        return false;
+                    }
+                }
+            }
+            return true;
+        }
+
+        static bool collectNode(const GltfFile& gltf, int64_t index, const glm::mat4& parent, int depth, std::vector<GltfDraw>& draws)
+        {
+            const JsonValue& node = gltf.json["nodes"][(size_t)index];
+            // Node graphs must be trees; the depth limit stops cycles in malformed files.
+            if (index < 0 || node.isNull() || depth > 64)
+            {
+                return false;
+            }
+            glm::mat4 local(1.0f);
+            const JsonValue& matrix = node["matrix"];
+            if (matrix.size() == 16)
+            {
+                for (int i = 0; i < 16; i++)
+                {
+                    local[i / 4][i % 4] = (float)matrix[i].numberOr(0.0);
+                }
+            }
+            else
+            {
+                const JsonValue& t = node["translation"];
+                const JsonValue& r = node["rotation"];
+                const JsonValue& s = node["scale"];
+                glm::vec3 translation((float)t[0].numberOr(0.0), (float)t[1].numberOr(0.0), (float)t[2].numberOr(0.0));
+                glm::quat rotation((float)r[3].numberOr(1.0), (float)r[0].numberOr(0.0), (float)r[1].numberOr(0.0), (float)r[2].numberOr(0.0));
+                glm::vec3 scale((float)s[0].numberOr(1.0), (float)s[1].numberOr(1.0), (float)s[2].numberOr(1.0));
+                local = glm::translate(glm::mat4(1.0f), translation) * glm::mat4_cast(rotation) * glm::scale(glm::mat4(1.0f), scale);
+            }
+            glm::mat4 world = parent * local;
+            int64_t meshIndex = node["mesh"].integerOr(-1);
+            if (meshIndex >= 0 && !collectMesh(gltf, gltf.json["meshes"][(size_t)meshIndex], world, draws))
+            {
+                return false;
+            }
+            const JsonValue& children = node["children"];
+            for (size_t i = 0; i < children.size(); i++)
+            {
+                if (!collectNode(gltf, children[i].integerOr(-1), world, depth + 1, draws))
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        static bool collectMesh(const GltfFile& gltf, const JsonValue& mesh, const glm::mat4& transform, std::vector<GltfDraw>& draws)
+        {
+            const JsonValue& primitives = mesh["primitives"];
+            if (mesh.isNull() || primitives.size() == 0)
+            {
+                return false;
+            }
+            for (size_t p = 0; p < primitives.size(); p++)
+            {
+                const JsonValue& primitive = primitives[p];
+                // Points, lines and strips have no place in a triangle list.
+                if (primitive["mode"].integerOr(4) != 4)
+                {
+                    continue;
+                }
+                const JsonValue& attributes = primitive["attributes"];
+                GltfDraw draw;
+                if (!readAccessor(gltf, attributes["POSITION"].integerOr(-1), draw.positions) || draw.positions.components != 3 || draw.positions.componentType != FLOAT)
+                {
+                    return false;
+                }
+                draw.hasNormals = !attributes["NORMAL"].isNull();
+                if (draw.hasNormals && (!readAccessor(gltf, attributes["NORMAL"].integerOr(-1), draw.normals) || draw.normals.components != 3 || draw.normals.count != draw.positions.count))
+                {
+                    return false;
+                }
+                draw.hasTexcoords = !attributes["TEXCOORD_0"].isNull();
+                if (draw.hasTexcoords && (!readAccessor(gltf, attributes["TEXCOORD_0"].integerOr(-1), draw.texcoords) || draw.texcoords.components != 2 || draw.texcoords.count != draw.positions.count))
+                {
+                    return false;
+                }
+                draw.hasIndices = !primitive["indices"].isNull();
+                if (draw.hasIndices && (!readAccessor(gltf, primitive["indices"].integerOr(-1), draw.indices) || draw.indices.components != 1 || !draw.indices.data
+                    || (draw.indices.componentType != UNSIGNED_BYTE && draw.indices.componentType != UNSIGNED_SHORT && draw.indices.componentType != UNSIGNED_INT)))
+                {
+                    return false;
+                }
+                draw.transform = transform;
+                draw.normalTransform = glm::transpose(glm::inverse(glm::mat3(transform)));
+                draw.flipWinding = glm::determinant(glm::mat3(transform)) < 0.0f;
+                draw.indexCount = (draw.hasIndices ? draw.indices.count : draw.positions.count) / 3 * 3;
+                draw.vertexCount = draw.hasNormals ? draw.positions.count : draw.indexCount;
+                draws.push_back(draw);
+            }
+            return true;
+        }
+
+        static constexpr int BYTE = 5120;
+        static constexpr int UNSIGNED_BYTE = 5121;
+        static constexpr int SHORT = 5122;
+        static constexpr int UNSIGNED_SHORT = 5123;
+        static constexpr int UNSIGNED_INT = 5125;
+        static constexpr int FLOAT = 5126;
+
+        // Look up an accessor and check that every element it reads lies inside its buffer view and buffer.
+        static bool readAccessor(const GltfFile& gltf, int64_t index, GltfAccessor& accessor)
+        {
+            const JsonValue& json = gltf.json["accessors"][(size_t)index];
+            if (index < 0 || json.isNull() || !json["sparse"].isNull())
+            {
+                return false;
+            }
+            accessor.componentType = (int)json["componentType"].integerOr(0);
+            int componentSize = accessor.componentType == BYTE || accessor.componentType == UNSIGNED_BYTE ? 1
+                : accessor.componentType == SHORT || accessor.componentType == UNSIGNED_SHORT ? 2
+                : accessor.componentType == UNSIGNED_INT || accessor.componentType == FLOAT ? 4 : 0;
+            const std::string& type = json["type"].string;
+            accessor.components = type == "SCALAR" ? 1 : type == "VEC2" ? 2 : type == "VEC3" ? 3 : type == "VEC4" ? 4 : 0;
+            accessor.normalized = json["normalized"].boolean;
+            int64_t count = json["count"].integerOr(-1);
+            if (componentSize == 0 || accessor.components == 0 || count < 0)
+            {
+                return false;
+            }
+            accessor.count = (size_t)count;
+            size_t elementSize = (size_t)componentSize * accessor.components;
+            if (json["bufferView"].isNull())
+            {
+                accessor.data = NULL;
+                return true;
+            }
+            const JsonValue& view = gltf.json["bufferViews"][(size_t)json["bufferView"].integerOr(-1)];
+            int64_t buffer = view["buffer"].integerOr(-1);
+            int64_t viewOffset = view["byteOffset"].integerOr(0);
+            int64_t viewLength = view["byteLength"].integerOr(-1);
+            int64_t stride = view["byteStride"].integerOr((int64_t)elementSize);
+            int64_t offset = json["byteOffset"].integerOr(0);
+            if (view.isNull() || buffer < 0 || (size_t)buffer >= gltf.buffers.size() || viewOffset < 0 || viewLength < 0 || offset < 0 || stride < (int64_t)elementSize
+                || (uint64_t)viewOffset + (uint64_t)viewLength > gltf.buffers[(size_t)buffer].size())
+            {
+                return false;
+            }
+            if (accessor.count > 0 && (uint64_t)offset + (uint64_t)stride * (accessor.count - 1) + elementSize > (uint64_t)viewLength)
+            {
+                return false;
+            }
+            accessor.data = gltf.buffers[(size_t)buffer].data() + viewOffset + offset;
+            accessor.stride = (size_t)stride;
+            return true;
+        }
+
+        // Read up to four components of an element as floats, applying normalization for integer types.
+        static void readGltfElement(const GltfAccessor& accessor, size_t index, float* values)
+        {
+            if (!accessor.data)
+            {
+                std::fill(values, values + accessor.components, 0.0f);
+                return;
+            }
+            const unsigned char* element = accessor.data + index * accessor.stride;
+            if (accessor.componentType == FLOAT)
+            {
+                memcpy(values, element, accessor.components * sizeof(float));
+                return;
+            }
+            for (int i = 0; i < accessor.components; i++)
+            {
+                float value;
+                switch (accessor.componentType)
+                {
+                    case BYTE: { int8_t v; memcpy(&v, element + i, 1); value = accessor.normalized ? std::max(v / 127.0f, -1.0f) : v; break; }
+                    case UNSIGNED_BYTE: { uint8_t v = element[i]; value = accessor.normalized ? v / 255.0f : v; break; }
+                    case SHORT: { int16_t v; memcpy(&v, element + i * 2, 2); value = accessor.normalized ? std::max(v / 32767.0f, -1.0f) : v; break; }
+                    case UNSIGNED_SHORT: { uint16_t v; memcpy(&v, element + i * 2, 2); value = accessor.normalized ? v / 65535.0f : v; break; }
+                    default: { uint32_t v; memcpy(&v, element + i * 4, 4); value = (float)v; break; }
+                }
+                values[i] = value;
+            }
+        }
+
+        static uint32_t readGltfIndex(const GltfAccessor& accessor, size_t index)
+        {
+            const unsigned char* element = accessor.data + index * accessor.stride;
+            if (accessor.componentType == UNSIGNED_BYTE)
+            {
+                return element[0];
+            }
+            if (accessor.componentType == UNSIGNED_SHORT)
+            {
+                uint16_t value;
+                memcpy(&value, element, sizeof(value));
+                return value;
+            }
+            uint32_t value;
+            memcpy(&value, element, sizeof(value));
+            return value;
+        }
+
+        // Transform one vertex of a draw into the interleaved layout. Normals are left to the caller when the draw has none.
+        static void writeGltfVertex(const GltfDraw& draw, size_t index, float* vertex)
+        {
+            float values[3];
+            readGltfElement(draw.positions, index, values);
+            glm::vec3 position = glm::vec3(draw.transform * glm::vec4(glm::make_vec3(values), 1.0f));
+            memcpy(vertex + POSITION_OFFSET, glm::value_ptr(position), 3 * sizeof(float));
+            if (draw.hasNormals)
+            {
+                readGltfElement(draw.normals, index, values);
+                glm::vec3 normal = draw.normalTransform * glm::make_vec3(values);
+                float length = glm::length(normal);
+                normal = length > 0.0f ? normal / length : glm::vec3(0.0f, 0.0f, 1.0f);
+                memcpy(vertex + NORMAL_OFFSET, glm::value_ptr(normal), 3 * sizeof(float));
+            }
+            vertex[TEXCOORD_OFFSET] = 0.0f;
+            vertex[TEXCOORD_OFFSET + 1] = 0.0f;
+            if (draw.hasTexcoords)
+            {
+                readGltfElement(draw.texcoords, index, vertex + TEXCOORD_OFFSET);
+            }
+        }
+
+        static bool decodeBase64(const char* text, size_t length, std::vector<unsigned char>& bytes)
+        {
+            bytes.clear();
+            bytes.reserve(length / 4 * 3);
+            uint32_t bits = 0;
+            int bitCount = 0;
+            for (size_t i = 0; i < length && text[i] != '='; i++)
+            {
+                char c = text[i];
+                int value = c >= 'A' && c <= 'Z' ? c - 'A' : c >= 'a' && c <= 'z' ? c - 'a' + 26 : c >= '0' && c <= '9' ? c - '0' + 52 : c == '+' ? 62 : c == '/' ? 63 : -1;
+                if (value < 0)
+                {
+                    return false;
+                }
+                bits = (bits << 6) | (uint32_t)value;
+                bitCount += 6;
+                if (bitCount >= 8)
+                {
+                    bitCount -= 8;
+                    bytes.push_back((unsigned char)(bits >> bitCount));
+                }
+            }
+            return true;
+        }
+
+        // Undo percent-encoding in a relative URI, such as %20 for a space in a buffer's file name.
+        static std::string decodeUri(const std::string& uri)
+        {
+            std::string path;
+            for (size_t i = 0; i < uri.size(); i++)
+            {
+                unsigned int code;
+                if (uri[i] == '%' && i + 2 < uri.size() && std::sscanf(uri.c_str() + i + 1, "%2x", &code) == 1)
+                {
+                    path += (char)code;
+                    i += 2;
+                }
+                else
+                {
+                    path += uri[i];
+                }
+            }
+            return path;
+        }
+};
+#endif
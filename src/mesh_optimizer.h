@@ -0,0 +1,229 @@
+#ifndef MESH_OPTIMIZER_H
+#define MESH_OPTIMIZER_H
+
+#include <vector>
+#include <cstdint>
+#include <cstring>
+
+// CPU passes that turn unindexed triangle lists into compact indexed meshes that are cheap for the GPU to transform and fetch.
+// Vertices are interleaved arrays of floats with a fixed number of floats per vertex.
+class MeshOptimizer
+{
+    public:
+        // Size of the post-transform vertex cache assumed by optimizeVertexCache() and the ACMR statistics.
+        static constexpr unsigned int DEFAULT_CACHE_SIZE = 16;
+
+        // Merge bit-identical vertices of an unindexed triangle list. Fills vertices with the unique vertices and returns one index per input vertex.
+        static std::vector<unsigned int> weld(const float* data, size_t vertexCount, unsigned int stride, std::vector<float>& vertices)
+        {
+            std::vector<unsigned int> indices(vertexCount);
+            vertices.clear();
+
+            // Open-addressing table of unique vertex indices, at most half full.
+            size_t tableSize = 1;
+            while (tableSize < vertexCount * 2)
+            {
+                tableSize *= 2;
+            }
+            std::vector<unsigned int> table(tableSize, EMPTY);
+
+            for (size_t i = 0; i < vertexCount; i++)
+            {
+                const float* vertex = data + i * stride;
+                size_t slot = hashVertex(vertex, stride) & (tableSize - 1);
+                while (table[slot] != EMPTY && memcmp(&vertices[table[slot] * stride], vertex, stride * sizeof(float)) != 0)
+                {
+                    slot = (slot + 1) & (tableSize - 1);
+                }
+                if (table[slot] == EMPTY)
+                {
+                    table[slot] = (unsigned int)(vertices.size() / stride);
+                    vertices.insert(vertices.end(), vertex, vertex + stride);
+                }
+                indices[i] = table[slot];
+            }
+            return indices;
+        }
+
+        // Reorder triangles for post-transform cache locality with Tipsify (Sander, Nehab and Barczak 2007).
+        // Linear in the number of triangles, which matters for large imported meshes.
+        static std::vector<unsigned int> optimizeVertexCache(const std::vector<unsigned int>& indices, size_t vertexCount, unsigned int cacheSize = DEFAULT_CACHE_SIZE)
+        {
+            size_t triangleCount = indices.size() / 3;
+            std::vector<unsigned int> output;
+            output.reserve(triangleCount * 3);
+            if (triangleCount == 0)
+            {
+                return output;
+            }
+
+            // Triangles around each vertex, stored as one flat array with offsets.
+            std::vector<unsigned int> liveTriangles(vertexCount, 0);
+            for (unsigned int index : indices)
+            {
+                liveTriangles[index]++;
+            }
+            std::vector<unsigned int> adjacencyOffset(vertexCount + 1, 0);
+            for (size_t v = 0; v < vertexCount; v++)
+            {
+                adjacencyOffset[v + 1] = adjacencyOffset[v] + liveTriangles[v];
+            }
+            std::vector<unsigned int> adjacency(indices.size());
+            std::vector<unsigned int> fill(adjacencyOffset.begin(), adjacencyOffset.end() - 1);
+            for (size_t t = 0; t < triangleCount; t++)
+            {
+                for (int k = 0; k < 3; k++)
+                {
+                    adjacency[fill[indices[t * 3 + k]]++] = (unsigned int)t;
+                }
+            }
+
+            std::vector<unsigned int> cacheTime(vertexCount, 0);
+            std::vector<bool> emitted(triangleCount, false);
+            std::vector<unsigned int> deadEnd;
+            std::vector<unsigned int> candidates;
+            unsigned int time = cacheSize + 1;
+            size_t cursor = 0;
+            int fanning = 0;
+
+            while (fanning >= 0)
+            {
+                // Emit every remaining triangle around the fanning vertex.
+                candidates.clear();
+                for (unsigned int a = adjacencyOffset[fanning]; a < adjacencyOffset[fanning + 1]; a++)
+                {
+                    unsigned int t = adjacency[a];
+                    if (emitted[t])
+                    {
+                        continue;
+                    }
+                    for (int k = 0; k < 3; k++)
+                    {
+                        unsigned int v = indices[t * 3 + k];
+                        output.push_back(v);
+                        deadEnd.push_back(v);
+                        candidates.push_back(v);
+                        liveTriangles[v]--;
+                        if (time - cacheTime[v] > cacheSize)
+                        {
+                            cacheTime[v] = time++;
+                        }
+                    }
+                    emitted[t] = true;
+                }
+
+                // Continue with the candidate that will still be in the cache and has the most work left.
+                int next = -1;
+                int best = -1;
+                for (unsigned int v : candidates)
+                {
+                    if (liveTriangles[v] == 0)
+                    {
+                        continue;
+                    }
+                    int priority = 0;
+                    if (time - cacheTime[v] + 2 * liveTriangles[v] <= cacheSize)
+                    {
+                        priority = (int)(time - cacheTime[v]);
+                    }
+                    if (priority > best)
+                    {
+                        best = priority;
+                        next = (int)v;
+                    }
+                }
+                if (next == -1)
+                {
+                    next = skipDeadEnd(liveTriangles, deadEnd, cursor);
+                }
+                fanning = next;
+            }
+            return output;
+        }
+
+        // Renumber vertices in the order they are first referenced so the vertex fetch walks memory linearly. Unreferenced vertices are dropped.
+        static void optimizeVertexFetch(std::vector<unsigned int>& indices, std::vector<float>& vertices, unsigned int stride)
+        {
+            size_t vertexCount = vertices.size() / stride;
+            std::vector<unsigned int> remap(vertexCount, EMPTY);
+            std::vector<float> reordered;
+            reordered.reserve(vertices.size());
+
+            unsigned int next = 0;
+            for (unsigned int& index : indices)
+            {
+                if (remap[index] == EMPTY)
+                {
+                    remap[index] = next++;
+                    reordered.insert(reordered.end(), vertices.begin() + index * stride, vertices.begin() + (index + 1) * stride);
+                }
+                index = remap[index];
+            }
+            vertices.swap(reordered);
+        }
+
+        // Average cache miss ratio: vertices transformed per triangle with a FIFO cache. 3.0 is the worst case, ~0.5 the best for regular meshes.
+        static float computeACMR(const std::vector<unsigned int>& indices, size_t vertexCount, unsigned int cacheSize = DEFAULT_CACHE_SIZE)
+        {
+            if (indices.size() < 3)
+            {
+                return 0.0f;
+            }
+
+            // A vertex is in the FIFO if it entered less than cacheSize misses ago.
+            std::vector<size_t> entered(vertexCount, 0);
+            std::vector<bool> seen(vertexCount, false);
+            size_t misses = 0;
+            for (unsigned int index : indices)
+            {
+                if (!seen[index] || misses - entered[index] >= cacheSize)
+                {
+                    seen[index] = true;
+                    entered[index] = misses;
+                    misses++;
+                }
+            }
+            return (float)misses / (float)(indices.size() / 3);
+        }
+
+    private:
+        static constexpr unsigned int EMPTY = 0xFFFFFFFFu;
+
+        static uint64_t hashVertex(const float* vertex, unsigned int stride)
+        {
+            // Mix whole 32-bit words; bytes are too slow for large meshes.
+            uint64_t hash = 14695981039346656037ull;
+            for (unsigned int i = 0; i < stride; i++)
+            {
+                uint32_t bits;
+                memcpy(&bits, &vertex[i], sizeof(bits));
+                hash = (hash ^ bits) * 1099511628211ull;
+                hash ^= hash >> 29;
+            }
+            return hash;
+        }
+
+        // Pick a new fanning vertex after a dead end: first a recently used vertex, then any vertex with live triangles.
+        static int skipDeadEnd(const std::vector<unsigned int>& liveTriangles, std::vector<unsigned int>& deadEnd, size_t& cursor)
+        {
+            while (!deadEnd.empty())
+            {
+                unsigned int v = deadEnd.back();
+                deadEnd.pop_back();
+                if (liveTriangles[v] > 0)
+                {
+                    return (int)v;
+                }
+            }
+            while (cursor < liveTriangles.size())
+            {
+                if (liveTriangles[cursor] > 0)
+                {
+                    return (int)cursor;
+                }
+                cursor++;
+            }
+            return -1;
+        }
+};
+#endif
@@ -0,0 +1,71 @@
+#ifndef MIP_CHAIN_H
+#define MIP_CHAIN_H
+
+#include <vector>
+#include <cstddef>
+
+// One mip level, as a range of MipChain::Data.
+struct MipLevel
+{
+    int width;
+    int height;
+    size_t offset;
+    size_t size;
+};
+
+// Every level of a 2D texture in one buffer, ready to upload level by level.
+// Format is the pixel format of uncompressed 8-bit data, with rows padded to 4 bytes as GL_UNPACK_ALIGNMENT 4 expects,
+// or 0 for block-compressed data uploaded with glCompressedTexImage2D.
+struct MipChain
+{
+    GLenum InternalFormat;
+    GLenum Format;
+    int Width;
+    int Height;
+    std::vector<MipLevel> Levels;
+    std::vector<unsigned char> Data;
+
+    bool isCompressed() const
+    {
+        return Format == 0;
+    }
+};
+
+// Channels of an uncompressed pixel format: GL_RED, GL_RG, GL_RGB or GL_RGBA.
+inline int formatChannels(GLenum format)
+{
+    return format == GL_RED ? 1 : format == GL_RG ? 2 : format == GL_RGB ? 3 : 4;
+}
+
+// Pixel format for 1 to 4 channels of 8-bit data, as stb_image returns them.
+inline GLenum channelFormat(int channels)
+{
+    const GLenum formats[] = { GL_RED, GL_RG, GL_RGB, GL_RGBA };
+    return formats[channels - 1];
+}
+
+// Bytes in one row of uncompressed pixels, padded to 4.
+inline size_t rowBytes(int width, int channels)
+{
+    return ((size_t)width * channels + 3) & ~(size_t)3;
+}
+
+// Upload every level of a chain to the texture bound to GL_TEXTURE_2D. data is the start of the chain, or an offset
+// into the bound pixel unpack buffer. Limits sampling to the levels present.
+inline void uploadMipChain(const MipChain& chain, const unsigned char* data)
+{
+    for (size_t level = 0; level < chain.Levels.size(); level++)
+    {
+        const MipLevel& range = chain.Levels[level];
+        if (chain.isCompressed())
+        {
+            glCompressedTexImage2D(GL_TEXTURE_2D, (GLint)level, chain.InternalFormat, range.width, range.height, 0, (GLsizei)range.size, data + range.offset);
+        }
+        else
+        {
+            glTexImage2D(GL_TEXTURE_2D, (GLint)level, chain.InternalFormat, range.width, range.height, 0, chain.Format, GL_UNSIGNED_BYTE, data + range.offset);
+        }
+    }
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)chain.Levels.size() - 1);
+}
+#endif
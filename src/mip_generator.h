@@ -0,0 +1,396 @@
+#ifndef MIP_GENERATOR_H
+#define MIP_GENERATOR_H
+
+#include <vector>
+#include <thread>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+#include "mip_chain.h"
+#include "parallel_for.h"
+
+enum MipFilter
+{
+    // Average of each 2x2 block.
+    MIP_FILTER_BOX,
+    // Kaiser-windowed sinc over 8x8 source pixels. Keeps more detail than the box filter, with slight ringing at hard edges.
+    MIP_FILTER_KAISER
+};
+
+struct MipOptions
+{
+    MipFilter filter = MIP_FILTER_BOX;
+    // Color channels hold sRGB values and are filtered in linear space, so dark and bright detail average to the right
+    // brightness. Alpha is always linear.
+    bool srgb = true;
+    // Scale the alpha of each level so the same fraction of texels passes an alpha test at this cutoff as in level 0,
+    // and alpha-tested cutouts such as foliage do not thin out with distance. 0 turns it off.
+    float alphaCutoff = 0.0f;
+};
+
+// Builds full mip chains on the CPU, so they can be cached with the image instead of being rebuilt by
+// glGenerateMipmap on every load. Levels are filtered from the previous level in floating point, one pixel per SSE
+// register, with the rows of each level split across threads.
+class MipGenerator
+{
+    public:
+        unsigned int Threads;
+        MipOptions Options;
+
+        // 0 threads uses every core.
+        MipGenerator(unsigned int threads = 0, MipOptions options = MipOptions())
+            : Threads(threads > 0 ? threads : std::max(1u, std::thread::hardware_concurrency())), Options(options)
+        {
+        }
+
+        // Build every level of an image with 1 to 4 interleaved 8-bit channels and unpadded rows. Level 0 is the image itself.
+        void generate(const unsigned char* pixels, int width, int height, int channels, MipChain& chain) const
+        {
+            chain.InternalFormat = channelFormat(channels);
+            chain.Format = chain.InternalFormat;
+            chain.Width = width;
+            chain.Height = height;
+            chain.Levels.clear();
+            size_t size = 0;
+            for (int levelWidth = width, levelHeight = height; ; levelWidth = std::max(1, levelWidth / 2), levelHeight = std::max(1, levelHeight / 2))
+            {
+                size_t levelSize = rowBytes(levelWidth, channels) * levelHeight;
+                chain.Levels.push_back({ levelWidth, levelHeight, size, levelSize });
+                size += levelSize;
+                if (levelWidth == 1 && levelHeight == 1)
+                {
+                    break;
+                }
+            }
+            chain.Data.assign(size, 0);
+            for (int y = 0; y < height; y++)
+            {
+                memcpy(&chain.Data[y * rowBytes(width, channels)], pixels + (size_t)y * width * channels, (size_t)width * channels);
+            }
+
+            // Which of the four float lanes hold sRGB color and which holds alpha.
+            bool srgb[4] = { false, false, false, false };
+            int alpha = channels == 2 ? 1 : channels == 4 ? 3 : -1;
+            for (int c = 0; c < (channels >= 3 ? 3 : 1) && Options.srgb; c++)
+            {
+                srgb[c] = true;
+            }
+
+            std::vector<float> current = decode(chain, 0, channels, srgb);
+            float coverage = alpha >= 0 && Options.alphaCutoff > 0.0f ? alphaCoverage(current, alpha, 1.0f) : 0.0f;
+            for (size_t level = 1; level < chain.Levels.size(); level++)
+            {
+                const MipLevel& previous = chain.Levels[level - 1];
+                std::vector<float> next = Options.filter == MIP_FILTER_KAISER ? downsampleKaiser(current, previous.width, previous.height) : downsampleBox(current, previous.width, previous.height);
+                float alphaScale = coverage > 0.0f ? coverageScale(next, alpha, coverage) : 1.0f;
+                encode(next, chain, level, channels, srgb, alpha, alphaScale);
+                // Later levels are built from the unscaled alpha, so scaling errors do not compound.
+                current.swap(next);
+            }
+        }
+
+    private:
+        // One RGBA pixel of a float image, in an SSE register where available.
+#if defined(__SSE2__) || defined(_M_X64)
+        typedef __m128 Pixel;
+
+        static Pixel load(const float* p)
+        {
+            return _mm_loadu_ps(p);
+        }
+
+        static void store(float* p, Pixel value)
+        {
+            _mm_storeu_ps(p, value);
+        }
+
+        static Pixel add(Pixel a, Pixel b)
+        {
+            return _mm_add_ps(a, b);
+        }
+
+        static Pixel scale(Pixel a, float s)
+        {
+            return _mm_mul_ps(a, _mm_set1_ps(s));
+        }
+
+        static Pixel zero()
+        {
+            return _mm_setzero_ps();
+        }
+
+        static Pixel saturate(Pixel a)
+        {
+            return _mm_min_ps(_mm_max_ps(a, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+        }
+#else
+        struct Pixel
+        {
+            float v[4];
+        };
+
+        static Pixel load(const float* p)
+        {
+            Pixel value;
+            memcpy(value.v, p, sizeof(value.v));
+            return value;
+        }
+
+        static void store(float* p, Pixel value)
+        {
+            memcpy(p, value.v, sizeof(value.v));
+        }
+
+        static Pixel add(Pixel a, Pixel b)
+        {
+            for (int c = 0; c < 4; c++)
+            {
+                a.v[c] += b.v[c];
+            }
+            return a;
+        }
+
+        static Pixel scale(Pixel a, float s)
+        {
+            for (int c = 0; c < 4; c++)
+            {
+                a.v[c] *= s;
+            }
+            return a;
+        }
+
+        static Pixel zero()
+        {
+            Pixel value = { { 0.0f, 0.0f, 0.0f, 0.0f } };
+            return value;
+        }
+
+        static Pixel saturate(Pixel a)
+        {
+            for (int c = 0; c < 4; c++)
+            {
+                a.v[c] = std::min(std::max(a.v[c], 0.0f), 1.0f);
+            }
+            return a;
+        }
+#endif
+
+        // Conversion tables between 8-bit sRGB and linear values. Linear to sRGB is indexed by the value times 4095.
+        struct SrgbTables
+        {
+            float toLinear[256];
+            unsigned char fromLinear[4096];
+
+            SrgbTables()
+            {
+                for (int i = 0; i < 256; i++)
+                {
+                    float value = i / 255.0f;
+                    toLinear[i] = value <= 0.04045f ? value / 12.92f : powf((value + 0.055f) / 1.055f, 2.4f);
+                }
+                for (int i = 0; i < 4096; i++)
+                {
+                    float value = i / 4095.0f;
+                    float encoded = value <= 0.0031308f ? value * 12.92f : 1.055f * powf(value, 1.0f / 2.4f) - 0.055f;
+                    fromLinear[i] = (unsigned char)(encoded * 255.0f + 0.5f);
+                }
+            }
+        };
+
+        static const SrgbTables& srgbTables()
+        {
+            static const SrgbTables tables;
+            return tables;
+        }
+
+        // Float RGBA copy of a level, with sRGB channels converted to linear. Unused lanes are 0.
+        std::vector<float> decode(const MipChain& chain, size_t level, int channels, const bool srgb[4]) const
+        {
+            const MipLevel& range = chain.Levels[level];
+            const SrgbTables& tables = srgbTables();
+            std::vector<float> image((size_t)range.width * range.height * 4, 0.0f);
+            parallelFor(Threads, range.height, [&](size_t y)
+            {
+                const unsigned char* row = &chain.Data[range.offset + y * rowBytes(range.width, channels)];
+                float* out = &image[y * range.width * 4];
+                for (int x = 0; x < range.width; x++)
+                {
+                    for (int c = 0; c < channels; c++)
+                    {
+                        unsigned char value = row[x * channels + c];
+                        out[x * 4 + c] = srgb[c] ? tables.toLinear[value] : value / 255.0f;
+                    }
+                }
+            });
+            return image;
+        }
+
+        // Write a float level into the chain, converting back to sRGB and scaling alpha.
+        void encode(const std::vector<float>& image, MipChain& chain, size_t level, int channels, const bool srgb[4], int alpha, float alphaScale) const
+        {
+            const MipLevel& range = chain.Levels[level];
+            const SrgbTables& tables = srgbTables();
+            parallelFor(Threads, range.height, [&](size_t y)
+            {
+                const float* in = &image[y * range.width * 4];
+                unsigned char* row = &chain.Data[range.offset + y * rowBytes(range.width, channels)];
+                for (int x = 0; x < range.width; x++)
+                {
+                    for (int c = 0; c < channels; c++)
+                    {
+                        float value = std::min(std::max(in[x * 4 + c] * (c == alpha ? alphaScale : 1.0f), 0.0f), 1.0f);
+                        row[x * channels + c] = srgb[c] ? tables.fromLinear[(int)(value * 4095.0f + 0.5f)] : (unsigned char)(value * 255.0f + 0.5f);
+                    }
+                }
+            });
+        }
+
+        // Average 2x2 pixels. Odd edges repeat their last row or column.
+        std::vector<float> downsampleBox(const std::vector<float>& image, int width, int height) const
+        {
+            int nextWidth = std::max(1, width / 2);
+            int nextHeight = std::max(1, height / 2);
+            std::vector<float> next((size_t)nextWidth * nextHeight * 4);
+            parallelFor(Threads, nextHeight, [&](size_t y)
+            {
+                const float* row0 = &image[(size_t)std::min((int)y * 2, height - 1) * width * 4];
+                const float* row1 = &image[(size_t)std::min((int)y * 2 + 1, height - 1) * width * 4];
+                float* out = &next[y * nextWidth * 4];
+                for (int x = 0; x < nextWidth; x++)
+                {
+                    int x0 = std::min(x * 2, width - 1) * 4;
+                    int x1 = std::min(x * 2 + 1, width - 1) * 4;
+                    Pixel sum = add(add(load(row0 + x0), load(row0 + x1)), add(load(row1 + x0), load(row1 + x1)));
+                    store(out + x * 4, scale(sum, 0.25f));
+                }
+            });
+            return next;
+        }
+
+        // Eight taps of a sinc low-pass at half the source rate, windowed by a Kaiser window (alpha 4) two target pixels wide.
+        static const float* kaiserWeights()
+        {
+            struct Weights
+            {
+                float taps[8];
+
+                Weights()
+                {
+                    auto bessel = [](float x)
+                    {
+                        // Zeroth-order modified Bessel function of the first kind, by its power series.
+                        float sum = 1.0f, term = 1.0f;
+                        for (int k = 1; k < 16; k++)
+                        {
+                            term *= (x / (2.0f * k)) * (x / (2.0f * k));
+                            sum += term;
+                        }
+                        return sum;
+                    };
+                    const float PI = 3.14159265f;
+                    const float ALPHA = 4.0f;
+                    float total = 0.0f;
+                    for (int k = 0; k < 8; k++)
+                    {
+                        // Distance from the target pixel center, in target pixels.
+                        float u = (k - 3.5f) / 2.0f;
+                        float sinc = sinf(PI * u) / (PI * u);
+                        float window = bessel(ALPHA * sqrtf(1.0f - (u / 2.0f) * (u / 2.0f))) / bessel(ALPHA);
+                        taps[k] = sinc * window;
+                        total += taps[k];
+                    }
+                    for (int k = 0; k < 8; k++)
+                    {
+                        taps[k] /= total;
+                    }
+                }
+            };
+            static const Weights weights;
+            return weights.taps;
+        }
+
+        // Separable Kaiser filter: a horizontal pass into a half-width image, then a vertical pass. Edges are clamped.
+        std::vector<float> downsampleKaiser(const std::vector<float>& image, int width, int height) const
+        {
+            const float* taps = kaiserWeights();
+            int nextWidth = std::max(1, width / 2);
+            int nextHeight = std::max(1, height / 2);
+            std::vector<float> horizontal((size_t)nextWidth * height * 4);
+            parallelFor(Threads, height, [&](size_t y)
+            {
+                const float* row = &image[y * width * 4];
+                float* out = &horizontal[y * nextWidth * 4];
+                for (int x = 0; x < nextWidth; x++)
+                {
+                    Pixel sum = zero();
+                    for (int k = 0; k < 8; k++)
+                    {
+                        int source = std::min(std::max(x * 2 - 3 + k, 0), width - 1);
+                        sum = add(sum, scale(load(row + source * 4), taps[k]));
+                    }
+                    store(out + x * 4, sum);
+                }
+            });
+
+            std::vector<float> next((size_t)nextWidth * nextHeight * 4);
+            parallelFor(Threads, nextHeight, [&](size_t y)
+            {
+                float* out = &next[y * nextWidth * 4];
+                const float* rows[8];
+                for (int k = 0; k < 8; k++)
+                {
+                    rows[k] = &horizontal[(size_t)std::min(std::max((int)y * 2 - 3 + k, 0), height - 1) * nextWidth * 4];
+                }
+                for (int x = 0; x < nextWidth; x++)
+                {
+                    Pixel sum = zero();
+                    for (int k = 0; k < 8; k++)
+                    {
+                        sum = add(sum, scale(load(rows[k] + x * 4), taps[k]));
+                    }
+                    // The negative lobes can overshoot near hard edges.
+                    store(out + x * 4, saturate(sum));
+                }
+            });
+            return next;
+        }
+
+        // Fraction of pixels whose scaled alpha passes the cutoff.
+        float alphaCoverage(const std::vector<float>& image, int alpha, float alphaScale) const
+        {
+            size_t passed = 0;
+            for (size_t i = alpha; i < image.size(); i += 4)
+            {
+                passed += image[i] * alphaScale > Options.alphaCutoff;
+            }
+            return (float)passed / (image.size() / 4);
+        }
+
+        // Alpha scale that brings the coverage of a level closest to the coverage of level 0.
+        float coverageScale(const std::vector<float>& image, int alpha, float coverage) const
+        {
+            float low = 0.0f, high = 4.0f;
+            for (int iteration = 0; iteration < 12; iteration++)
+            {
+                float middle = (low + high) * 0.5f;
+                if (alphaCoverage(image, alpha, middle) < coverage)
+                {
+                    low = middle;
+                }
+                else
+                {
+                    high = middle;
+                }
+            }
+            // Coverage jumps where many texels share an alpha value, so pick whichever side of the jump is closer.
+            float lowError = fabsf(alphaCoverage(image, alpha, low) - coverage);
+            float highError = fabsf(alphaCoverage(image, alpha, high) - coverage);
+            return lowError < highError ? low : high;
+        }
+};
+#endif
@@ -0,0 +1,137 @@
+#ifndef NUMBER_PARSER_H
+#define NUMBER_PARSER_H
+
+#include <cstdint>
+#include <cmath>
+
+// Decimal number parsing for text asset formats. Unlike strtod, sscanf and iostreams these ignore the C locale, so a
+// decimal comma locale cannot break an import, and they work on unterminated text such as a mapped file.
+class NumberParser
+{
+    public:
+        static bool isDigit(char c)
+        {
+            return (unsigned char)(c - '0') < 10;
+        }
+
+        // Parse a number such as -12, 3.5, .5 or 1e-3 at text, stopping at end. Advances text past it and returns true, or
+        // returns false and leaves text alone if there is no number. Digits past the 19th only scale the result, which is far
+        // more precision than a float or glTF needs.
+        static bool parseDouble(const char*& text, const char* end, double& value)
+        {
+            const char* p = text;
+            bool negative = false;
+            if (p < end && (*p == '-' || *p == '+'))
+            {
+                negative = *p == '-';
+                p++;
+            }
+            uint64_t mantissa = 0;
+            int digits = 0;
+            int exponent = 0;
+            bool any = false;
+            for (; p < end && isDigit(*p); p++)
+            {
+                any = true;
+                if (digits < 19)
+                {
+                    mantissa = mantissa * 10 + (uint64_t)(*p - '0');
+                    digits += mantissa != 0;
+                }
+                else
+                {
+                    exponent++;
+                }
+            }
+            if (p < end && *p == '.')
+            {
+                for (p++; p < end && isDigit(*p); p++)
+                {
+                    any = true;
+                    if (digits < 19)
+                    {
+                        mantissa = mantissa * 10 + (uint64_t)(*p - '0');
+                        digits += mantissa != 0;
+                        exponent--;
+                    }
+                }
+            }
+            if (!any)
+            {
+                return false;
+            }
+            if (p < end && (*p == 'e' || *p == 'E'))
+            {
+                const char* q = p + 1;
+                bool negativeExponent = false;
+                if (q < end && (*q == '-' || *q == '+'))
+                {
+                    negativeExponent = *q == '-';
+                    q++;
+                }
+                if (q < end && isDigit(*q))
+                {
+                    int written = 0;
+                    for (; q < end && isDigit(*q); q++)
+                    {
+                        written = written < 100000 ? written * 10 + (*q - '0') : written;
+                    }
+                    exponent += negativeExponent ? -written : written;
+                    p = q;
+                }
+            }
+            double result = (double)mantissa;
+            if (mantissa != 0 && exponent != 0)
+            {
+                result = exponent > 0 ? result * powerOfTen(exponent) : result / powerOfTen(-exponent);
+            }
+            value = negative ? -result : result;
+            text = p;
+            return true;
+        }
+
+        static bool parseFloat(const char*& text, const char* end, float& value)
+        {
+            double result;
+            if (!parseDouble(text, end, result))
+            {
+                return false;
+            }
+            value = (float)result;
+            return true;
+        }
+
+        // Parse an optionally signed decimal integer. Values beyond the range of int64_t saturate.
+        static bool parseInt(const char*& text, const char* end, int64_t& value)
+        {
+            const char* p = text;
+            bool negative = false;
+            if (p < end && (*p == '-' || *p == '+'))
+            {
+                negative = *p == '-';
+                p++;
+            }
+            if (p == end || !isDigit(*p))
+            {
+                return false;
+            }
+            uint64_t result = 0;
+            for (; p < end && isDigit(*p); p++)
+            {
+                result = result < 100000000000000000ull ? result * 10 + (uint64_t)(*p - '0') : INT64_MAX;
+            }
+            result = result > (uint64_t)INT64_MAX ? (uint64_t)INT64_MAX : result;
+            value = negative ? -(int64_t)result : (int64_t)result;
+            text = p;
+            return true;
+        }
+
+    private:
+        static double powerOfTen(int exponent)
+        {
+            // Powers up to 1e22 are exact in a double, so scaling a mantissa below 2^53 by them rounds once.
+            static const double exact[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+            return exponent <= 22 ? exact[exponent] : std::pow(10.0, exponent);
+        }
+};
+#endif
@@ -0,0 +1,40 @@
+#ifndef PARALLEL_FOR_H
+#define PARALLEL_FOR_H
+
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+
+// Call function(i) for every i below count on up to threadCount threads, including the calling one.
+// Threads claim the next index from a shared counter, so uneven work balances out without a scheduler.
+template <typename Function>
+void parallelFor(unsigned int threadCount, size_t count, Function function)
+{
+    std::atomic<size_t> next(0);
+    auto work = [&]()
+    {
+        for (size_t i = next++; i < count; i = next++)
+        {
+            function(i);
+        }
+    };
+    std::vector<std::thread> helpers;
+    for (size_t t = 1; t < std::min((size_t)threadCount, count); t++)
+    {
+        helpers.emplace_back(work);
+    }
+    work();
+    for (std::thread& helper : helpers)
+    {
+        helper.join();
+    }
+}
+
+// parallelFor behind a C callback, for libraries that take a parallel loop as run(user, count, task, arg), such as
+// stbi_set_jpeg_parallel. user points to the unsigned int thread count.
+inline void parallelForCallback(void* user, int count, void (*task)(void* arg, int index), void* arg)
+{
+    parallelFor(*(unsigned int*)user, (size_t)count, [task, arg](size_t i) { task(arg, (int)i); });
+}
+#endif
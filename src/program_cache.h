@@ -0,0 +1,172 @@
+#ifndef PROGRAM_CACHE_H
+#define PROGRAM_CACHE_H
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iostream>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+
+#include "mapped_file.h"
+
+// Stores linked program binaries on disk so later launches can skip compiling and linking GLSL.
+class ProgramBinaryCache
+{
+    public:
+        // Directory holding the cache entries. An empty directory disables the cache.
+        std::string Directory;
+
+        // Number of programs loaded from the cache and number that had to be compiled.
+        unsigned int Hits;
+        unsigned int Misses;
+
+        ProgramBinaryCache(const std::string& directory = "") : Directory(directory), Hits(0), Misses(0)
+        {
+        }
+
+        // Returns true if the directory is set and the driver can save and restore program binaries.
+        bool enabled() const
+        {
+            if (Directory.empty() || !(GLEW_VERSION_4_1 || GLEW_ARB_get_program_binary))
+            {
+                return false;
+            }
+            int formats = 0;
+            glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+            return formats > 0;
+        }
+
+        // Builds a cache key from the program sources, the injected defines and the driver strings.
+        static uint64_t makeKey(const std::vector<std::string>& sources, const std::string& defines)
+        {
+            uint64_t hash = 14695981039346656037ull;
+            for (const std::string& source : sources)
+            {
+                hash = hashBytes(hash, source.data(), source.size());
+                hash = hashBytes(hash, "\0", 1);
+            }
+            hash = hashBytes(hash, defines.data(), defines.size());
+
+            // A driver update or another GPU invalidates every binary.
+            const GLenum strings[] = { GL_VENDOR, GL_RENDERER, GL_VERSION };
+            for (GLenum name : strings)
+            {
+                const char* value = (const char*)glGetString(name);
+                if (value)
+                {
+                    hash = hashBytes(hash, value, std::char_traits<char>::length(value));
+                }
+            }
+            return hash;
+        }
+
+        // Creates a program from the cached binary for key. Returns 0 if there is no usable entry.
+        unsigned int load(uint64_t key)
+        {
+            std::ifstream file(entryPath(key), std::ios::binary);
+            if (!file)
+            {
+                Misses++;
+                return 0;
+            }
+
+            EntryHeader header;
+            std::vector<char> binary;
+            if (file.read((char*)&header, sizeof(header)) && header.magic == MAGIC && header.version == VERSION && header.key == key)
+            {
+                binary.resize(header.length);
+                file.read(binary.data(), header.length);
+            }
+            file.close();
+
+            unsigned int program = 0;
+            if (!binary.empty() && file)
+            {
+                program = glCreateProgram();
+                glProgramBinary(program, header.format, binary.data(), (GLsizei)binary.size());
+
+                // The driver rejects binaries it can no longer use. Drop the entry and recompile.
+                int success;
+                glGetProgramiv(program, GL_LINK_STATUS, &success);
+                if (!success)
+                {
+                    glDeleteProgram(program);
+                    program = 0;
+                }
+            }
+
+            if (program == 0)
+            {
+                std::remove(entryPath(key).c_str());
+                Misses++;
+                return 0;
+            }
+            Hits++;
+            return program;
+        }
+
+        // Writes the binary of a linked program to the cache. The program must have been linked with GL_PROGRAM_BINARY_RETRIEVABLE_HINT set.
+        void store(unsigned int program, uint64_t key)
+        {
+            int length = 0;
+            glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+            if (length <= 0)
+            {
+                return;
+            }
+
+            EntryHeader header;
+            std::vector<char> binary(length);
+            header.magic = MAGIC;
+            header.version = VERSION;
+            header.key = key;
+            glGetProgramBinary(program, length, NULL, &header.format, binary.data());
+            header.length = (uint32_t)length;
+
+            // Threads and processes sharing the directory may store the same entry; each replaces it whole.
+            std::error_code error;
+            std::filesystem::create_directories(Directory, error);
+            std::string path = entryPath(key);
+            bool written = writeFileAtomically(path, [&](std::ostream& file)
+            {
+                file.write((const char*)&header, sizeof(header));
+                file.write(binary.data(), binary.size());
+            });
+            if (!written)
+            {
+                std::cout << "ERROR::PROGRAM_CACHE::WRITE_FAILED " << path << std::endl;
+            }
+        }
+
+    private:
+        static constexpr uint32_t MAGIC = 0x42505243; // "CRPB"
+        static constexpr uint32_t VERSION = 1;
+
+        struct EntryHeader
+        {
+            uint32_t magic;
+            uint32_t version;
+            uint64_t key;
+            GLenum format;
+            uint32_t length;
+        };
+
+        static uint64_t hashBytes(uint64_t hash, const char* data, size_t size)
+        {
+            for (size_t i = 0; i < size; i++)
+            {
+                hash = (hash ^ (uint8_t)data[i]) * 1099511628211ull;
+            }
+            return hash;
+        }
+
+        std::string entryPath(uint64_t key) const
+        {
+            char name[32];
+            std::snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long)key);
+            return Directory + "/" + name;
+        }
+};
+#endif
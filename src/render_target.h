@@ -0,0 +1,65 @@
+#ifndef RENDER_TARGET_H
+#define RENDER_TARGET_H
+
+#include <vector>
+#include <iostream>
+
+// Framebuffer object with an RGBA8 color and a 24-bit depth renderbuffer, for rendering without a window.
+class RenderTarget
+{
+    public:
+        unsigned int FBO;
+        unsigned int Width;
+        unsigned int Height;
+
+        RenderTarget(unsigned int width, unsigned int height) : Width(width), Height(height)
+        {
+            glGenRenderbuffers(2, renderbuffers);
+            glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[0]);
+            glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+            glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[1]);
+            glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+            glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+            glGenFramebuffers(1, &FBO);
+            glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+            glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, renderbuffers[0]);
+            glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, renderbuffers[1]);
+            if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            {
+                std::cout << "ERROR::RENDER_TARGET::INCOMPLETE " << width << "x" << height << std::endl;
+            }
+            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        }
+
+        ~RenderTarget()
+        {
+            glDeleteFramebuffers(1, &FBO);
+            glDeleteRenderbuffers(2, renderbuffers);
+        }
+
+        RenderTarget(const RenderTarget&) = delete;
+        RenderTarget& operator=(const RenderTarget&) = delete;
+
+        // Draw into this target until another framebuffer is bound.
+        void bind() const
+        {
+            glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+            glViewport(0, 0, Width, Height);
+        }
+
+        // Copy the color buffer to pixels as tightly packed RGB rows, bottom row first. Waits for rendering to finish.
+        void readPixels(std::vector<unsigned char>& pixels) const
+        {
+            pixels.resize((size_t)Width * Height * 3);
+            glBindFramebuffer(GL_READ_FRAMEBUFFER, FBO);
+            glPixelStorei(GL_PACK_ALIGNMENT, 1);
+            glReadPixels(0, 0, Width, Height, GL_RGB, GL_UNSIGNED_BYTE, pixels.data());
+            glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+        }
+
+    private:
+        // Color and depth.
+        unsigned int renderbuffers[2];
+};
+#endif
@@ -0,0 +1,204 @@
+#ifndef SCENE_H
+#define SCENE_H
+
+#include <string>
+#include <chrono>
+#include <algorithm>
+#include <cmath>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "shader.h"
+#include "shader_variants.h"
+#include "camera.h"
+#include "cube.h"
+#include "mesh.h"
+#include "mesh_file.h"
+#include "frame_data.h"
+#include "instancing.h"
+
+// Prehashed uniform names used in the render loop.
+constexpr UniformName U_OBJECT_COLOR("objectColor");
+constexpr UniformName U_MODEL("model");
+constexpr UniformName U_NORMAL_MATRIX("normalMatrix");
+
+// The lit cube, or an imported model in its place, and its light source, with every GL object they need. Used by the window
+// and by headless rendering. Must be destroyed while its context is still current.
+class Scene
+{
+    public:
+        glm::vec3 LightPos;
+
+        // Time spent building the programs in the constructor.
+        double ShaderStartupMs;
+
+        // Cube mesh statistics before and after indexing and optimization.
+        MeshStats CubeStatsBefore;
+        MeshStats CubeStatsAfter;
+
+        // Shared pages holding the vertices and indices of every mesh. Their stats() report memory use on demand.
+        BufferArena VertexBuffers;
+        BufferArena IndexBuffers;
+
+        // Build programs, buffers and vertex arrays in the current context. Shader paths are relative to shaderDirectory.
+        // A model mesh file, if given, is uploaded from its mapping and drawn instead of the lit cube, scaled to the cube's size.
+        // Its vertex layout and shader variant follow the vertex format recorded in the file.
+        Scene(ProgramBinaryCache* programCache, ShaderWatcher* watcher, const std::string& shaderDirectory = "../shaders", const MeshFile* model = NULL)
+            : LightPos(1.2f, 1.0f, 2.0f), shaderVariants(programCache, watcher), modelShader(NULL), modelVertexArray(0), modelTransform(1.0f), modelNormalMatrix(1.0f)
+        {
+            // Materials used by the scene.
+            ShaderVariant litMaterial = { shaderDirectory + "/basic_lighting_vertex_shader.txt", shaderDirectory + "/basic_lighting_fragment_shader.txt", { "SPECULAR_STRENGTH 0.5", "SHININESS 32.0" } };
+            ShaderVariant lightCubeMaterial = { shaderDirectory + "/light_cube_vertex_shader.txt", shaderDirectory + "/light_cube_fragment_shader.txt", {} };
+            ShaderVariant modelMaterial = litMaterial;
+            bool drawModel = model && model->isOpen();
+            if (drawModel && !GpuMesh::isSupported(model->header()))
+            {
+                std::cout << "ERROR::SCENE::UNSUPPORTED_VERTEX_FORMAT drawing the cube instead" << std::endl;
+                drawModel = false;
+            }
+            if (drawModel && model->header().normalFormat == NORMAL_OCTAHEDRAL)
+            {
+                modelMaterial.defines.push_back("OCTAHEDRAL_NORMALS");
+            }
+
+            // Build the programs needed by the first frame in one batch so the driver can compile them in parallel.
+            // Variants requested later compile on first use.
+            auto shaderStart = std::chrono::steady_clock::now();
+            shaderVariants.prepare({ litMaterial, lightCubeMaterial, modelMaterial });
+            litShader = &shaderVariants.get(litMaterial);
+            lightCubeShader = &shaderVariants.get(lightCubeMaterial);
+            modelShader = &shaderVariants.get(modelMaterial);
+            ShaderStartupMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - shaderStart).count();
+
+            // Build an indexed cube: weld the duplicated corners and optimize the order for the vertex cache.
+            cubeMesh = Mesh::fromTriangles(CUBE_VERTICES, CUBE_VERTEX_COUNT, 6, &CubeStatsBefore, &CubeStatsAfter);
+
+            // Upload the cube once; both vertex arrays read from the same buffers.
+            cubeMesh.upload(VertexBuffers, IndexBuffers);
+
+            // Create a vertex array with position and normal attributes.
+            vertexArrayObject = cubeMesh.createVertexArray({ { 0, 3, 0 }, { 1, 3, 3 } });
+
+            // Create a vertex array for the light cube, which only needs positions.
+            lightVertexArrayObject = cubeMesh.createVertexArray({ { 0, 3, 0 } });
+
+            if (drawModel)
+            {
+                modelMesh.upload(*model, VertexBuffers, IndexBuffers);
+                modelVertexArray = modelMesh.createVertexArray();
+
+                // Quantized positions are expanded by the model matrix, which leaves the normals alone.
+                const MeshFileHeader& header = model->header();
+                glm::mat4 world = fitToCube(header);
+                glm::mat4 dequantization = glm::translate(glm::mat4(1.0f), glm::make_vec3(header.positionOffset)) * glm::scale(glm::mat4(1.0f), glm::make_vec3(header.positionScale));
+                modelTransform = world * dequantization;
+                modelNormalMatrix = normalMatrix(world);
+            }
+
+            frameData.lightColor = glm::vec4(1.0f, 1.0f, 1.0f, 0.0f);
+        }
+
+        ~Scene()
+        {
+            glStateCache().bindVertexArray(0);
+            glDeleteVertexArrays(1, &vertexArrayObject);
+            glDeleteVertexArrays(1, &lightVertexArrayObject);
+            cubeMesh.release();
+            if (modelVertexArray)
+            {
+                glDeleteVertexArrays(1, &modelVertexArray);
+                modelMesh.release();
+            }
+        }
+
+        Scene(const Scene&) = delete;
+        Scene& operator=(const Scene&) = delete;
+
+        // Draw one frame into the bound framebuffer.
+        void render(Camera& camera, float aspect)
+        {
+            // Enable depth testing.
+            glEnable(GL_DEPTH_TEST);
+
+            // Set default pixel color.
+            glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
+
+            // Clear color an depth buffer.
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+            // Define view and projection transformations and upload them with the lighting data in one call.
+            frameData.projection = glm::perspective(glm::radians(camera.Zoom), aspect, 0.1f, 100.0f);
+            frameData.view = camera.GetViewMatrix();
+            frameData.lightPos = glm::vec4(LightPos, 1.0f);
+            frameData.viewPos = glm::vec4(camera.Position, 1.0f);
+            frameUniformBuffer.update(frameData);
+
+            // Activate shader program.
+            Shader* objectShader = modelVertexArray ? modelShader : litShader;
+            objectShader->use();
+            objectShader->setVec3(U_OBJECT_COLOR, 1.0f, 0.5f, 0.31f);
+
+            // Define world transformation.
+            glm::mat4 model = modelVertexArray ? modelTransform : glm::mat4(1.0f);
+            objectShader->setMat4(U_MODEL, model);
+            objectShader->setMat3(U_NORMAL_MATRIX, modelVertexArray ? modelNormalMatrix : normalMatrix(model));
+
+            // Render an object.
+            if (modelVertexArray)
+            {
+                glStateCache().bindVertexArray(modelVertexArray);
+                modelMesh.draw();
+            }
+            else
+            {
+                glStateCache().bindVertexArray(vertexArrayObject);
+                cubeMesh.draw();
+            }
+
+            // Draw light cube.
+            lightCubeShader->use();
+            model = glm::mat4(1.0f);
+            model = glm::translate(model, LightPos);
+            model = glm::scale(model, glm::vec3(0.2f));
+            lightCubeShader->setMat4(U_MODEL, model);
+
+            glStateCache().bindVertexArray(lightVertexArrayObject);
+            cubeMesh.draw();
+        }
+
+    private:
+        // Every program permutation is compiled once and owned by the variant cache.
+        ShaderVariantCache shaderVariants;
+        Shader* litShader;
+        Shader* lightCubeShader;
+        // The lit material with the defines the model's vertex format needs.
+        Shader* modelShader;
+
+        Mesh cubeMesh;
+        unsigned int vertexArrayObject;
+        unsigned int lightVertexArrayObject;
+
+        // Imported model drawn instead of the cube, 0 without one.
+        GpuMesh modelMesh;
+        unsigned int modelVertexArray;
+        glm::mat4 modelTransform;
+        glm::mat3 modelNormalMatrix;
+
+        // Uniform buffer shared by all programs for per-frame camera and lighting data.
+        FrameUniformBuffer frameUniformBuffer;
+        FrameData frameData;
+
+        // Center a mesh on the origin and scale its largest side to 1, the size of the cube it replaces.
+        static glm::mat4 fitToCube(const MeshFileHeader& header)
+        {
+            glm::vec3 lower = glm::make_vec3(header.boundsMin);
+            glm::vec3 upper = glm::make_vec3(header.boundsMax);
+            glm::vec3 size = upper - lower;
+            float extent = std::max(size.x, std::max(size.y, size.z));
+            float scale = extent > 0.0f ? 1.0f / extent : 1.0f;
+            return glm::scale(glm::mat4(1.0f), glm::vec3(scale)) * glm::translate(glm::mat4(1.0f), -(lower + upper) * 0.5f);
+        }
+};
+#endif
@@ -5,256 +5,469 @@
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+#include "program_cache.h"
+#include "frame_data.h"
+#include "gl_state.h"
+#include "shader_preprocessor.h"
+#include "texture_cache.h"
 
 using namespace std;  
 
+// Hash a uniform name with 32-bit FNV-1a. Usable in constant expressions so handles can be built at compile time.
+constexpr uint32_t hashUniformName(const char* name, uint32_t hash = 2166136261u)
+{
+    return *name ? hashUniformName(name + 1, (hash ^ (uint8_t)*name) * 16777619u) : hash;
+}
+
+// Prehashed handle to a uniform. Declare handles as constexpr to hash the name at compile time.
+struct UniformName
+{
+    uint32_t hash;
+
+    constexpr UniformName(const char* name) : hash(hashUniformName(name)) {}
+};
+
 class Shader
 {
     public:
         unsigned int ID;
 
-        Shader(const char* vertexPath, const char* fragmentPath)
-        {
-            // Retrieve the vertex and fragment source code from file paths.
-            string vertexCode;
-            string fragmentCode;
-            ifstream vShaderFile;
-            ifstream fShaderFile;
-
-            // Ensure ifstream objects can throw exceptions.
-            vShaderFile.exceptions (ifstream::failbit | ifstream::badbit);
-            fShaderFile.exceptions (ifstream::failbit | ifstream::badbit);
+        // Source files the program was built from.
+        string VertexPath;
+        string FragmentPath;
 
-            try 
-            {
-                // Open files.
-                vShaderFile.open(vertexPath);
-                fShaderFile.open(fragmentPath);
-                stringstream vShaderStream, fShaderStream;
-
-                // Read files' buffer contents into streams.
-                vShaderStream << vShaderFile.rdbuf();
-                fShaderStream << fShaderFile.rdbuf();
-
-                // Close file handlers.
-                vShaderFile.close();
-                fShaderFile.close();
-
-                // Convert stream into string.
-                vertexCode = vShaderStream.str();
-                fragmentCode = fShaderStream.str();
-            }
-            catch (ifstream::failure& e)
-            {
-                cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << endl;
-            }
+        // Defines injected into both stages, e.g. "SHININESS 64".
+        vector<string> Defines;
 
-            const char* vShaderCode = vertexCode.c_str();
-            const char * fShaderCode = fragmentCode.c_str();
+        // Every file read to build the program, including #include files.
+        vector<string> Dependencies;
 
-            // Compile shaders.
-            unsigned int vertex, fragment;
+        // Texture bound to unit 0 by use(), or NULL.
+        const Texture* Image = NULL;
 
-            // Create a vertex shader to calculate 3D coordinates.
-            vertex = glCreateShader(GL_VERTEX_SHADER);
-            // Attach vertex shader definition.
-            glShaderSource(vertex, 1, &vShaderCode, NULL);
-            // Compile vertex shader.
-            glCompileShader(vertex);
-            // Check for shader compile errors.
-            checkCompileErrors(vertex, "VERTEX");
+        // A program whose shaders were handed to the driver but whose status has not been checked yet.
+        struct PendingProgram
+        {
+            unsigned int program;
+            unsigned int vertex;
+            unsigned int fragment;
+        };
 
-            // Create a fragment shader to calculate color output of pixels.
-            fragment = glCreateShader(GL_FRAGMENT_SHADER);
-            // Attach vertex shader definition.
-            glShaderSource(fragment, 1, &fShaderCode, NULL);
-            // Compile vertex shader.
-            glCompileShader(fragment);
-            // Check for shader compile errors.
-            checkCompileErrors(fragment, "FRAGMENT");
+        // Create an empty shader with no program. Used by ShaderBatch.
+        Shader() : ID(0)
+        {
+        }
 
-            // Create a shader program to link multiple shaders.
-            ID = glCreateProgram();
-            glAttachShader(ID, vertex);
-            glAttachShader(ID, fragment);
-            glLinkProgram(ID);
-            // Check for shader program linking errors.
-            checkCompileErrors(ID, "PROGRAM");
+        Shader(const char* vertexPath, const char* fragmentPath, ProgramBinaryCache* cache = NULL, const vector<string> &defines = vector<string>()) : VertexPath(vertexPath), FragmentPath(fragmentPath), Defines(defines)
+        {
+            // Retrieve the vertex and fragment source code from file paths.
+            string vertexCode, fragmentCode;
+            loadSources(vertexCode, fragmentCode, &Dependencies);
 
-            // Delete linked shaders.
-            glDeleteShader(vertex);
-            glDeleteShader(fragment);
+            // Build the program, or restore it from the binary cache.
+            ID = buildProgram(vertexCode, fragmentCode, cache);
+            // Cache the locations of all active uniforms.
+            loadUniforms();
         }
 
-        Shader(const char* vertexPath, const char* fragmentPath, const char* texturePath)
+        // Build a program that samples one image on texture unit 0. The image is loaded through the texture cache,
+        // so programs using the same file share one texture; a placeholder is bound until it has been uploaded.
+        Shader(const char* vertexPath, const char* fragmentPath, const char* texturePath, TextureCache& textures, ProgramBinaryCache* cache = NULL) : VertexPath(vertexPath), FragmentPath(fragmentPath)
         {
             // Retrieve the vertex and fragment source code from file paths.
-            string vertexCode;
-            string fragmentCode;
-            ifstream vShaderFile;
-            ifstream fShaderFile;
+            string vertexCode, fragmentCode;
+            loadSources(vertexCode, fragmentCode, &Dependencies);
 
-            // Ensure ifstream objects can throw exceptions.
-            vShaderFile.exceptions (ifstream::failbit | ifstream::badbit);
-            fShaderFile.exceptions (ifstream::failbit | ifstream::badbit);
+            // Build the program, or restore it from the binary cache.
+            ID = buildProgram(vertexCode, fragmentCode, cache);
+            // Cache the locations of all active uniforms.
+            loadUniforms();
 
-            try 
-            {
-                // Open files.
-                vShaderFile.open(vertexPath);
-                fShaderFile.open(fragmentPath);
-                stringstream vShaderStream, fShaderStream;
-
-                // Read files' buffer contents into streams.
-                vShaderStream << vShaderFile.rdbuf();
-                fShaderStream << fShaderFile.rdbuf();
-
-                // Close file handlers.
-                vShaderFile.close();
-                fShaderFile.close();
-
-                // Convert stream into string.
-                vertexCode = vShaderStream.str();
-                fragmentCode = fShaderStream.str();
-            }
-            catch (ifstream::failure& e)
-            {
-                cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << endl;
-            }
+            // Request the texture.
+            Image = &textures.get(texturePath);
+        }
 
+        // Read and preprocess both stages with this shader's defines. Safe to call from any thread.
+        bool loadSources(string &vertexCode, string &fragmentCode, vector<string>* dependencies = NULL) const
+        {
+            vertexCode = ShaderPreprocessor::process(VertexPath, Defines, dependencies);
+            fragmentCode = ShaderPreprocessor::process(FragmentPath, Defines, dependencies);
+            return !vertexCode.empty() && !fragmentCode.empty();
+        }
+
+        // Hand vertex and fragment sources to the driver and start linking without waiting for the result.
+        static PendingProgram submitProgram(const string &vertexCode, const string &fragmentCode, bool retrievable = false)
+        {
             const char* vShaderCode = vertexCode.c_str();
             const char * fShaderCode = fragmentCode.c_str();
 
-            // Compile shaders.
-            unsigned int vertex, fragment;
+            PendingProgram pending;
 
             // Create a vertex shader to calculate 3D coordinates.
-            vertex = glCreateShader(GL_VERTEX_SHADER);
+            pending.vertex = glCreateShader(GL_VERTEX_SHADER);
             // Attach vertex shader definition.
-            glShaderSource(vertex, 1, &vShaderCode, NULL);
+            glShaderSource(pending.vertex, 1, &vShaderCode, NULL);
             // Compile vertex shader.
-            glCompileShader(vertex);
-            // Check for shader compile errors.
-            checkCompileErrors(vertex, "VERTEX");
+            glCompileShader(pending.vertex);
 
             // Create a fragment shader to calculate color output of pixels.
-            fragment = glCreateShader(GL_FRAGMENT_SHADER);
-            // Attach vertex shader definition.
-            glShaderSource(fragment, 1, &fShaderCode, NULL);
-            // Compile vertex shader.
-            glCompileShader(fragment);
-            // Check for shader compile errors.
-            checkCompileErrors(fragment, "FRAGMENT");
-
-            // Create a texture.
-            unsigned int texture;
-            glGenTextures(1, &texture);
-            glBindTexture(GL_TEXTURE_2D, texture);
-            // Set the texture wrapping parameters.
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-            // Set texture filtering parameters.
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-            // Load image, create texture and generate mipmaps.
-            int width, height, nrChannels;
-            unsigned char *data = stbi_load(texturePath, &width, &height, &nrChannels, 0);
-            if (data)
+            pending.fragment = glCreateShader(GL_FRAGMENT_SHADER);
+            // Attach fragment shader definition.
+            glShaderSource(pending.fragment, 1, &fShaderCode, NULL);
+            // Compile fragment shader.
+            glCompileShader(pending.fragment);
+
+            // Create a shader program to link multiple shaders.
+            pending.program = glCreateProgram();
+            glAttachShader(pending.program, pending.vertex);
+            glAttachShader(pending.program, pending.fragment);
+            if (retrievable)
             {
-                glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-                glGenerateMipmap(GL_TEXTURE_2D);
+                // Ask the driver to keep the binary around so it can be saved.
+                glProgramParameteri(pending.program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
             }
-            else
+            glLinkProgram(pending.program);
+            return pending;
+        }
+
+        // Returns true if querying the status of a submitted program will not block.
+        static bool isProgramReady(const PendingProgram &pending)
+        {
+            if (!GLEW_KHR_parallel_shader_compile && !GLEW_ARB_parallel_shader_compile)
             {
-                cout << "Failed to load texture." << endl;
+                return true;
             }
-            stbi_image_free(data);
-
-            // Bind texture.
-            glBindTexture(GL_TEXTURE_2D, texture);
+            int complete;
+            glGetProgramiv(pending.program, GL_COMPLETION_STATUS_KHR, &complete);
+            return complete != 0;
+        }
 
-            // Create a shader program to link multiple shaders.
-            ID = glCreateProgram();
-            glAttachShader(ID, vertex);
-            glAttachShader(ID, fragment);
-            glLinkProgram(ID);
+        // Check compile and link status of a submitted program and release its shaders. On failure the program is deleted and set to 0.
+        static bool finishProgram(PendingProgram &pending)
+        {
+            // Check for shader compile errors.
+            bool success = checkCompileErrors(pending.vertex, "VERTEX");
+            success = checkCompileErrors(pending.fragment, "FRAGMENT") && success;
             // Check for shader program linking errors.
-            checkCompileErrors(ID, "PROGRAM");
+            success = checkCompileErrors(pending.program, "PROGRAM") && success;
 
             // Delete linked shaders.
-            glDeleteShader(vertex);
-            glDeleteShader(fragment);
+            glDeleteShader(pending.vertex);
+            glDeleteShader(pending.fragment);
+            if (!success)
+            {
+                glDeleteProgram(pending.program);
+                pending.program = 0;
+            }
+            return success;
+        }
+
+        // Replace the program with a newly linked one, e.g. after a hot reload.
+        void swapProgram(unsigned int program)
+        {
+            glStateCache().forgetProgram(ID);
+            glDeleteProgram(ID);
+            ID = program;
+            // Cache the locations of all active uniforms.
+            loadUniforms();
         }
 
         void use()
         {
             // Activate shader program.
-            glUseProgram(ID);
+            glStateCache().useProgram(ID);
+
+            // Bind texture. The ID changes from the placeholder to the image once it is uploaded.
+            if (Image)
+            {
+                glStateCache().bindTexture(0, Image->ID);
+            }
         }
 
-        // Utility uniform functions.
-        void setBool(const string &name, bool value) const
+        // Return the cached location of a uniform, or -1 if it is not active in this program.
+        int getUniformLocation(UniformName name) const
+        {
+            const UniformLocation* entry = findUniform(name);
+            return entry ? entry->location : -1;
+        }
+
+        // Utility uniform functions. A value equal to the last one sent to this program is not sent again.
+        // The program must be in use when they are called.
+        void setBool(UniformName name, bool value) const
         {         
-            glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value); 
+            setInt(name, (int)value);
         }
 
-        void setInt(const string &name, int value) const
+        void setInt(UniformName name, int value) const
         { 
-            glUniform1i(glGetUniformLocation(ID, name.c_str()), value); 
+            int location = changedUniform(name, &value, sizeof(value));
+            if (location >= 0)
+            {
+                glUniform1i(location, value);
+            }
         }
 
-        void setFloat(const string &name, float value) const
+        void setFloat(UniformName name, float value) const
         { 
-            glUniform1f(glGetUniformLocation(ID, name.c_str()), value); 
+            int location = changedUniform(name, &value, sizeof(value));
+            if (location >= 0)
+            {
+                glUniform1f(location, value);
+            }
         }
 
-        void setVec2(const string &name, const glm::vec2 &value) const
+        void setVec2(UniformName name, const glm::vec2 &value) const
         { 
-            glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
+            int location = changedUniform(name, &value[0], sizeof(glm::vec2));
+            if (location >= 0)
+            {
+                glUniform2fv(location, 1, &value[0]);
+            }
         }
 
-        void setVec2(const string &name, float x, float y) const
+        void setVec2(UniformName name, float x, float y) const
         { 
-            glUniform2f(glGetUniformLocation(ID, name.c_str()), x, y); 
+            setVec2(name, glm::vec2(x, y));
         }
 
-        void setVec3(const string &name, const glm::vec3 &value) const
+        void setVec3(UniformName name, const glm::vec3 &value) const
         { 
-            glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
+            int location = changedUniform(name, &value[0], sizeof(glm::vec3));
+            if (location >= 0)
+            {
+                glUniform3fv(location, 1, &value[0]);
+            }
         }
         
-        void setVec3(const string &name, float x, float y, float z) const
+        void setVec3(UniformName name, float x, float y, float z) const
         { 
-            glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z); 
+            setVec3(name, glm::vec3(x, y, z));
         }
 
-        void setVec4(const string &name, const glm::vec4 &value) const
+        void setVec4(UniformName name, const glm::vec4 &value) const
         { 
-            glUniform4fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
+            int location = changedUniform(name, &value[0], sizeof(glm::vec4));
+            if (location >= 0)
+            {
+                glUniform4fv(location, 1, &value[0]);
+            }
         }
 
-        void setVec4(const string &name, float x, float y, float z, float w) const
+        void setVec4(UniformName name, float x, float y, float z, float w) const
         { 
-            glUniform4f(glGetUniformLocation(ID, name.c_str()), x, y, z, w); 
+            setVec4(name, glm::vec4(x, y, z, w));
         }
 
-        void setMat2(const string &name, const glm::mat2 &mat) const
+        void setMat2(UniformName name, const glm::mat2 &mat) const
         {
-            glUniformMatrix2fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+            int location = changedUniform(name, &mat[0][0], sizeof(glm::mat2));
+            if (location >= 0)
+            {
+                glUniformMatrix2fv(location, 1, GL_FALSE, &mat[0][0]);
+            }
         }
 
-        void setMat3(const string &name, const glm::mat3 &mat) const
+        void setMat3(UniformName name, const glm::mat3 &mat) const
         {
-            glUniformMatrix3fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+            int location = changedUniform(name, &mat[0][0], sizeof(glm::mat3));
+            if (location >= 0)
+            {
+                glUniformMatrix3fv(location, 1, GL_FALSE, &mat[0][0]);
+            }
         }
 
-        void setMat4(const string &name, const glm::mat4 &mat) const
+        void setMat4(UniformName name, const glm::mat4 &mat) const
         {
-            glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+            int location = changedUniform(name, &mat[0][0], sizeof(glm::mat4));
+            if (location >= 0)
+            {
+                glUniformMatrix4fv(location, 1, GL_FALSE, &mat[0][0]);
+            }
         }
     
     private:
-        void checkCompileErrors(unsigned int shader, string type)
+        friend class ShaderBatch;
+
+        // Compile and link a program from vertex and fragment sources, reusing a cached binary when one matches.
+        unsigned int buildProgram(const string &vertexCode, const string &fragmentCode, ProgramBinaryCache* cache)
+        {
+            bool useCache = cache != NULL && cache->enabled();
+            uint64_t key = 0;
+            if (useCache)
+            {
+                key = ProgramBinaryCache::makeKey({vertexCode, fragmentCode}, ShaderPreprocessor::definesKey(Defines));
+                unsigned int program = cache->load(key);
+                if (program != 0)
+                {
+                    return program;
+                }
+            }
+
+            PendingProgram pending = submitProgram(vertexCode, fragmentCode, useCache);
+            if (finishProgram(pending) && useCache)
+            {
+                cache->store(pending.program, key);
+            }
+            return pending.program;
+        }
+
+        struct UniformLocation
+        {
+            uint32_t hash;
+            int location;
+            // Slot in uniformValues holding the last value sent, or -1 if the type is not shadowed.
+            int slot;
+        };
+
+        // Active uniform locations sorted by name hash.
+        vector<UniformLocation> uniformLocations;
+
+        // Last value sent for each shadowed uniform, UNIFORM_SLOT_SIZE bytes per slot, and whether it has been sent at all.
+        static constexpr size_t UNIFORM_SLOT_SIZE = sizeof(float) * 16;
+        mutable vector<unsigned char> uniformValues;
+        mutable vector<bool> uniformValueSet;
+
+        const UniformLocation* findUniform(UniformName name) const
+        {
+            auto it = lower_bound(uniformLocations.begin(), uniformLocations.end(), name.hash,
+                [](const UniformLocation &entry, uint32_t hash) { return entry.hash < hash; });
+            if (it == uniformLocations.end() || it->hash != name.hash)
+            {
+                return NULL;
+            }
+            return &*it;
+        }
+
+        // Compare a value with the shadow copy of a uniform. Returns the location to send it to, or -1 if the call can be skipped.
+        int changedUniform(UniformName name, const void* value, size_t size) const
+        {
+            StateCounters& counters = glStateCache().Uniforms;
+            const UniformLocation* entry = findUniform(name);
+            if (entry == NULL)
+            {
+                // Not active in this program, so there is no call to make; only redundant writes count as skipped.
+                return -1;
+            }
+            if (entry->slot >= 0 && size <= UNIFORM_SLOT_SIZE)
+            {
+                unsigned char* shadow = &uniformValues[entry->slot * UNIFORM_SLOT_SIZE];
+                if (uniformValueSet[entry->slot] && memcmp(shadow, value, size) == 0)
+                {
+                    counters.skipped++;
+                    return -1;
+                }
+                memcpy(shadow, value, size);
+                uniformValueSet[entry->slot] = true;
+            }
+            counters.issued++;
+            return entry->location;
+        }
+
+        // Types whose values fit a shadow slot.
+        static bool isShadowedType(GLenum type)
+        {
+            switch (type)
+            {
+                case GL_FLOAT: case GL_FLOAT_VEC2: case GL_FLOAT_VEC3: case GL_FLOAT_VEC4:
+                case GL_INT: case GL_BOOL: case GL_SAMPLER_2D:
+                case GL_FLOAT_MAT2: case GL_FLOAT_MAT3: case GL_FLOAT_MAT4:
+                    return true;
+                default:
+                    return false;
+            }
+        }
+
+        // Add a uniform to the table, with a slot for the last value sent if its type has one. Freshly linked programs
+        // hold unknown defaults, so no slot starts out set.
+        void addUniform(const string &name, int location, GLenum type)
+        {
+            int slot = -1;
+            if (isShadowedType(type))
+            {
+                slot = (int)uniformValueSet.size();
+                uniformValueSet.push_back(false);
+                uniformValues.resize(uniformValueSet.size() * UNIFORM_SLOT_SIZE);
+            }
+            uniformLocations.push_back({hashUniformName(name.c_str()), location, slot});
+        }
+
+        // Query every active uniform once after linking and store its location in a flat table. Also binds the FrameData block.
+        void loadUniforms()
+        {
+            uniformLocations.clear();
+            uniformValues.clear();
+            uniformValueSet.clear();
+
+            int count = 0;
+            int maxLength = 0;
+            glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &count);
+            glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+            vector<char> name(maxLength > 0 ? maxLength : 1);
+
+            for (int i = 0; i < count; i++)
+            {
+                int size;
+                GLenum type;
+                glGetActiveUniform(ID, (GLuint)i, (GLsizei)name.size(), NULL, &size, &type, name.data());
+                int location = glGetUniformLocation(ID, name.data());
+                if (location < 0)
+                {
+                    // Uniforms inside blocks have no location.
+                    continue;
+                }
+
+                // Arrays are reported as "name[0]"; register them under their base name as well, and every other
+                // element under its own name with its own location.
+                string baseName(name.data());
+                addUniform(baseName, location, type);
+                size_t bracket = baseName.find('[');
+                if (bracket != string::npos)
+                {
+                    baseName.resize(bracket);
+                    uniformLocations.push_back({hashUniformName(baseName.c_str()), location, uniformLocations.back().slot});
+                    for (int element = 1; element < size; element++)
+                    {
+                        string elementName = baseName + "[" + to_string(element) + "]";
+                        int elementLocation = glGetUniformLocation(ID, elementName.c_str());
+                        if (elementLocation >= 0)
+                        {
+                            addUniform(elementName, elementLocation, type);
+                        }
+                    }
+                }
+            }
+
+            sort(uniformLocations.begin(), uniformLocations.end(),
+                [](const UniformLocation &a, const UniformLocation &b) { return a.hash < b.hash; });
+            for (size_t i = 1; i < uniformLocations.size(); i++)
+            {
+                if (uniformLocations[i].hash == uniformLocations[i - 1].hash && uniformLocations[i].location != uniformLocations[i - 1].location)
+                {
+                    cout << "ERROR::SHADER::UNIFORM_HASH_COLLISION in program " << ID << endl;
+                }
+            }
+
+            // Attach the shared FrameData block to its fixed binding point.
+            unsigned int blockIndex = glGetUniformBlockIndex(ID, "FrameData");
+            if (blockIndex != GL_INVALID_INDEX)
+            {
+                int blockSize = 0;
+                glGetActiveUniformBlockiv(ID, blockIndex, GL_UNIFORM_BLOCK_DATA_SIZE, &blockSize);
+                if (blockSize != (int)sizeof(FrameData))
+                {
+                    cout << "ERROR::SHADER::FRAME_DATA_SIZE_MISMATCH " << blockSize << " != " << sizeof(FrameData) << endl;
+                }
+                glUniformBlockBinding(ID, blockIndex, FRAME_DATA_BINDING);
+            }
+        }
+
+        // Print the info log if compiling or linking failed. Returns true on success.
+        static bool checkCompileErrors(unsigned int shader, string type)
         {
             int success;
             char infoLog[1024];
@@ -276,6 +489,7 @@ class Shader
                     cout << "ERROR::PROGRAM_LINKING_ERROR of type: " << type << "\n" << infoLog << "\n" << endl;
                 }
             }
+            return success != 0;
         }
 
 };
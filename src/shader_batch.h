@@ -0,0 +1,108 @@
+#ifndef SHADER_BATCH_H
+#define SHADER_BATCH_H
+
+#include <string>
+#include <vector>
+#include <future>
+
+#include "shader.h"
+
+// Builds several programs at once. Sources are read on worker threads and every program is handed to the driver
+// before any compile or link status is queried, so the driver can compile them concurrently.
+class ShaderBatch
+{
+    public:
+        ShaderBatch(ProgramBinaryCache* cache = NULL) : cache(cache)
+        {
+        }
+
+        // Queue a program and return its index in the vector returned by build().
+        size_t add(const char* vertexPath, const char* fragmentPath, const std::vector<std::string>& defines = std::vector<std::string>())
+        {
+            Shader shader;
+            shader.VertexPath = vertexPath;
+            shader.FragmentPath = fragmentPath;
+            shader.Defines = defines;
+            shaders.push_back(shader);
+            return shaders.size() - 1;
+        }
+
+        // Compile and link all queued programs.
+        std::vector<Shader> build()
+        {
+            // Read and preprocess every program's sources on a worker thread.
+            std::vector<std::future<Sources>> sources;
+            for (Shader& shader : shaders)
+            {
+                sources.push_back(std::async(std::launch::async, [&shader]()
+                {
+                    Sources result;
+                    shader.loadSources(result.vertexCode, result.fragmentCode, &result.dependencies);
+                    return result;
+                }));
+            }
+
+            // Let the driver use as many compiler threads as it likes.
+            if (GLEW_KHR_parallel_shader_compile)
+            {
+                glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+            }
+            else if (GLEW_ARB_parallel_shader_compile)
+            {
+                glMaxShaderCompilerThreadsARB(0xFFFFFFFF);
+            }
+
+            // Submit every program as soon as its sources are in, without waiting on the compiler.
+            bool useCache = cache != NULL && cache->enabled();
+            std::vector<Shader::PendingProgram> pending(shaders.size());
+            std::vector<uint64_t> keys(shaders.size(), 0);
+            for (size_t i = 0; i < shaders.size(); i++)
+            {
+                pending[i].program = 0;
+
+                Sources result = sources[i].get();
+                shaders[i].Dependencies = result.dependencies;
+                if (useCache)
+                {
+                    keys[i] = ProgramBinaryCache::makeKey({result.vertexCode, result.fragmentCode}, ShaderPreprocessor::definesKey(shaders[i].Defines));
+                    shaders[i].ID = cache->load(keys[i]);
+                }
+                if (shaders[i].ID == 0)
+                {
+                    pending[i] = Shader::submitProgram(result.vertexCode, result.fragmentCode, useCache);
+                }
+            }
+
+            // Query the results only after everything has been submitted.
+            for (size_t i = 0; i < shaders.size(); i++)
+            {
+                if (pending[i].program != 0)
+                {
+                    if (Shader::finishProgram(pending[i]) && useCache)
+                    {
+                        cache->store(pending[i].program, keys[i]);
+                    }
+                    shaders[i].ID = pending[i].program;
+                }
+                // Cache the locations of all active uniforms.
+                shaders[i].loadUniforms();
+            }
+
+            std::vector<Shader> built;
+            built.swap(shaders);
+            return built;
+        }
+
+    private:
+        struct Sources
+        {
+            std::string vertexCode;
+            std::string fragmentCode;
+            std::vector<std::string> dependencies;
+        };
+
+        ProgramBinaryCache* cache;
+        // Queued programs, not built yet.
+        std::vector<Shader> shaders;
+};
+#endif
@@ -0,0 +1,142 @@
+#ifndef SHADER_PREPROCESSOR_H
+#define SHADER_PREPROCESSOR_H
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <algorithm>
+#include <string_view>
+
+#include "asset_archive.h"
+
+// Resolves #include "file" directives and injects #define lines into GLSL sources before they are handed to the driver.
+class ShaderPreprocessor
+{
+    public:
+        // Load a shader file, inline its includes and add one "#define <entry>" line per define right after #version.
+        // Every file read, the shader itself first, is appended to dependencies.
+        // Files come from the mounted asset archive when it has them, unless looseFiles asks for the copies on disk, e.g. after an edit.
+        static std::string process(const std::string& path, const std::vector<std::string>& defines, std::vector<std::string>* dependencies = NULL, bool looseFiles = false)
+        {
+            std::vector<std::string> included;
+            std::string source;
+            if (!expand(path, included, 0, looseFiles, source))
+            {
+                return std::string();
+            }
+            if (dependencies)
+            {
+                dependencies->insert(dependencies->end(), included.begin(), included.end());
+            }
+            return injectDefines(source, defines);
+        }
+
+        // Join a define set into a single key. The order of the defines does not matter.
+        static std::string definesKey(std::vector<std::string> defines)
+        {
+            std::sort(defines.begin(), defines.end());
+            std::string key;
+            for (const std::string& define : defines)
+            {
+                key += define;
+                key += '\n';
+            }
+            return key;
+        }
+
+    private:
+        static constexpr int MAX_INCLUDE_DEPTH = 16;
+
+        static std::string directoryOf(const std::string& path)
+        {
+            size_t slash = path.find_last_of("/\\");
+            return slash == std::string::npos ? std::string() : path.substr(0, slash + 1);
+        }
+
+        // Append the contents of path to output with its includes expanded. Each file is included only once.
+        static bool expand(const std::string& path, std::vector<std::string>& included, int depth, bool looseFiles, std::string& output)
+        {
+            if (depth > MAX_INCLUDE_DEPTH)
+            {
+                std::cout << "ERROR::SHADER::INCLUDE_TOO_DEEP " << path << std::endl;
+                return false;
+            }
+            if (std::find(included.begin(), included.end(), path) != included.end())
+            {
+                return true;
+            }
+            included.push_back(path);
+
+            std::vector<unsigned char> storage;
+            ByteSpan contents;
+            bool found = looseFiles ? AssetArchive::readFile(path, storage, contents) : assetArchive().read(path, storage, contents);
+            if (!found)
+            {
+                std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ " << path << std::endl;
+                return false;
+            }
+
+            std::string_view text((const char*)contents.data(), contents.size());
+            int lineNumber = 0;
+            for (size_t lineStart = 0; lineStart < text.size();)
+            {
+                size_t lineEnd = std::min(text.find('\n', lineStart), text.size());
+                std::string_view line = text.substr(lineStart, lineEnd - lineStart);
+                lineStart = lineEnd + 1;
+                lineNumber++;
+                size_t start = line.find_first_not_of(" \t");
+                if (start != std::string::npos && line.compare(start, 8, "#include") == 0)
+                {
+                    size_t open = line.find('"', start + 8);
+                    size_t close = open == std::string::npos ? std::string::npos : line.find('"', open + 1);
+                    if (close == std::string::npos)
+                    {
+                        std::cout << "ERROR::SHADER::MALFORMED_INCLUDE " << path << ":" << lineNumber << std::endl;
+                        return false;
+                    }
+                    output += "#line 1\n";
+                    if (!expand(directoryOf(path) + std::string(line.substr(open + 1, close - open - 1)), included, depth + 1, looseFiles, output))
+                    {
+                        return false;
+                    }
+                    // Keep compiler messages pointing at the right line of this file.
+                    output += "#line " + std::to_string(lineNumber + 1) + "\n";
+                    continue;
+                }
+                output += line;
+                output += '\n';
+            }
+            return true;
+        }
+
+        // #version has to stay the first statement, so defines go right after it.
+        static std::string injectDefines(const std::string& source, const std::vector<std::string>& defines)
+        {
+            if (defines.empty())
+            {
+                return source;
+            }
+
+            std::string block;
+            for (const std::string& define : defines)
+            {
+                block += "#define " + define + "\n";
+            }
+
+            size_t version = source.find("#version");
+            if (version == std::string::npos)
+            {
+                return block + "#line 1\n" + source;
+            }
+            size_t lineEnd = source.find('\n', version);
+            if (lineEnd == std::string::npos)
+            {
+                return source + "\n" + block;
+            }
+            int nextLine = (int)std::count(source.begin(), source.begin() + lineEnd, '\n') + 2;
+            return source.substr(0, lineEnd + 1) + block + "#line " + std::to_string(nextLine) + "\n" + source.substr(lineEnd + 1);
+        }
+};
+#endif
@@ -0,0 +1,107 @@
+#ifndef SHADER_VARIANTS_H
+#define SHADER_VARIANTS_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include <algorithm>
+
+#include "shader.h"
+#include "shader_batch.h"
+#include "shader_watcher.h"
+
+// Describes one permutation of a program: its source files and the defines injected into them.
+struct ShaderVariant
+{
+    std::string vertexPath;
+    std::string fragmentPath;
+    std::vector<std::string> defines;
+};
+
+// Owns every compiled permutation, keyed by source set and define set, so each one is compiled only once.
+// Variants are built lazily the first time a material asks for them, or ahead of time in one batch with prepare().
+class ShaderVariantCache
+{
+    public:
+        ShaderVariantCache(ProgramBinaryCache* cache = NULL, ShaderWatcher* watcher = NULL) : cache(cache), watcher(watcher)
+        {
+        }
+
+        ~ShaderVariantCache()
+        {
+            for (auto& entry : variants)
+            {
+                if (watcher)
+                {
+                    watcher->unwatch(*entry.second);
+                }
+                glStateCache().forgetProgram(entry.second->ID);
+                glDeleteProgram(entry.second->ID);
+            }
+        }
+
+        // Return the program for a variant, compiling it now if this is the first request. The reference stays valid for the life of the cache.
+        Shader& get(const ShaderVariant& variant)
+        {
+            std::string key = makeKey(variant);
+            auto it = variants.find(key);
+            if (it != variants.end())
+            {
+                return *it->second;
+            }
+
+            std::unique_ptr<Shader> shader(new Shader(variant.vertexPath.c_str(), variant.fragmentPath.c_str(), cache, variant.defines));
+            return insert(key, std::move(shader));
+        }
+
+        // Compile all variants that are not built yet in one parallel batch.
+        void prepare(const std::vector<ShaderVariant>& list)
+        {
+            ShaderBatch batch(cache);
+            std::vector<std::string> keys;
+            for (const ShaderVariant& variant : list)
+            {
+                std::string key = makeKey(variant);
+                if (variants.count(key) == 0 && std::find(keys.begin(), keys.end(), key) == keys.end())
+                {
+                    batch.add(variant.vertexPath.c_str(), variant.fragmentPath.c_str(), variant.defines);
+                    keys.push_back(key);
+                }
+            }
+
+            std::vector<Shader> built = batch.build();
+            for (size_t i = 0; i < built.size(); i++)
+            {
+                insert(keys[i], std::unique_ptr<Shader>(new Shader(built[i])));
+            }
+        }
+
+        // Number of distinct programs compiled so far.
+        size_t size() const
+        {
+            return variants.size();
+        }
+
+    private:
+        ProgramBinaryCache* cache;
+        ShaderWatcher* watcher;
+        std::unordered_map<std::string, std::unique_ptr<Shader>> variants;
+
+        static std::string makeKey(const ShaderVariant& variant)
+        {
+            return variant.vertexPath + '\n' + variant.fragmentPath + '\n' + ShaderPreprocessor::definesKey(variant.defines);
+        }
+
+        Shader& insert(const std::string& key, std::unique_ptr<Shader> shader)
+        {
+            Shader& result = *shader;
+            variants[key] = std::move(shader);
+            if (watcher)
+            {
+                watcher->watch(result);
+            }
+            return result;
+        }
+};
+#endif
@@ -0,0 +1,281 @@
+#ifndef SHADER_WATCHER_H
+#define SHADER_WATCHER_H
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <iostream>
+
+#include "shader.h"
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+// Watches a shader directory on a background thread and hot-reloads the programs built from edited files.
+// Sources are read and preprocessed on the watcher thread. Programs are compiled and swapped on the GL thread in update(), called once per frame.
+// Watched shaders must outlive the watcher or be removed with unwatch().
+class ShaderWatcher
+{
+    public:
+        ShaderWatcher(const std::string& directory) : running(false), inotifyFd(-1), watchFd(-1)
+        {
+#ifdef __linux__
+            inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+            if (inotifyFd >= 0)
+            {
+                // Editors either write in place or write a temporary file and rename it over the original.
+                watchFd = inotify_add_watch(inotifyFd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+            }
+            if (watchFd < 0)
+            {
+                std::cout << "ERROR::SHADER_WATCHER::CANNOT_WATCH " << directory << std::endl;
+                return;
+            }
+            running = true;
+            worker = std::thread(&ShaderWatcher::watchLoop, this);
+#else
+            std::cout << "Shader hot-reload is only supported on Linux." << std::endl;
+#endif
+        }
+
+        ~ShaderWatcher()
+        {
+            running = false;
+            if (worker.joinable())
+            {
+                worker.join();
+            }
+#ifdef __linux__
+            if (inotifyFd >= 0)
+            {
+                close(inotifyFd);
+            }
+#endif
+            for (Compiling& entry : compiling)
+            {
+                discard(entry.pending);
+            }
+        }
+
+        // Register a shader to be rebuilt when one of its source or include files changes.
+        void watch(Shader& shader)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            shaders.push_back({&shader, shader.VertexPath, shader.FragmentPath, shader.Defines, shader.Dependencies});
+        }
+
+        // Stop watching a shader, e.g. before it is destroyed. Call on the GL thread.
+        void unwatch(Shader& shader)
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                shaders.erase(std::remove_if(shaders.begin(), shaders.end(), [&shader](const Watched& watched) { return watched.shader == &shader; }), shaders.end());
+                ready.erase(std::remove_if(ready.begin(), ready.end(), [&shader](const Reload& reload) { return reload.shader == &shader; }), ready.end());
+            }
+            for (size_t i = 0; i < compiling.size();)
+            {
+                if (compiling[i].shader == &shader)
+                {
+                    discard(compiling[i].pending);
+                    compiling.erase(compiling.begin() + i);
+                }
+                else
+                {
+                    i++;
+                }
+            }
+        }
+
+        // Submit reloaded sources to the driver and swap in programs that finished linking. Call at a frame boundary on the GL thread.
+        void update()
+        {
+            std::deque<Reload> reloads;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                reloads.swap(ready);
+            }
+
+            for (Reload& reload : reloads)
+            {
+                // A newer edit supersedes a build that is still in flight for the same shader.
+                for (size_t i = 0; i < compiling.size(); i++)
+                {
+                    if (compiling[i].shader == reload.shader)
+                    {
+                        discard(compiling[i].pending);
+                        compiling.erase(compiling.begin() + i);
+                        break;
+                    }
+                }
+                compiling.push_back({reload.shader, Shader::submitProgram(reload.vertexCode, reload.fragmentCode)});
+            }
+
+            // Only look at programs the driver has finished so the loop never waits on the compiler.
+            for (size_t i = 0; i < compiling.size();)
+            {
+                Compiling& entry = compiling[i];
+                if (!Shader::isProgramReady(entry.pending))
+                {
+                    i++;
+                    continue;
+                }
+
+                if (Shader::finishProgram(entry.pending))
+                {
+                    entry.shader->swapProgram(entry.pending.program);
+                    std::cout << "Reloaded " << entry.shader->FragmentPath << std::endl;
+                }
+                else
+                {
+                    std::cout << "Reload failed, keeping the last good program for " << entry.shader->FragmentPath << std::endl;
+                }
+                compiling.erase(compiling.begin() + i);
+            }
+        }
+
+    private:
+        // Copies of what the watcher thread needs, so it never touches a Shader that may be going away.
+        struct Watched
+        {
+            Shader* shader;
+            std::string vertexPath;
+            std::string fragmentPath;
+            std::vector<std::string> defines;
+            // Files the shader was built from. Refreshed on every reload since includes may change.
+            std::vector<std::string> files;
+        };
+
+        struct Reload
+        {
+            Shader* shader;
+            std::string vertexCode;
+            std::string fragmentCode;
+        };
+
+        struct Compiling
+        {
+            Shader* shader;
+            Shader::PendingProgram pending;
+        };
+
+        std::atomic<bool> running;
+        int inotifyFd;
+        int watchFd;
+        std::thread worker;
+
+        // Guards shaders and ready.
+        std::mutex mutex;
+        std::vector<Watched> shaders;
+        std::deque<Reload> ready;
+
+        // Only touched on the GL thread.
+        std::vector<Compiling> compiling;
+
+        static void discard(const Shader::PendingProgram& pending)
+        {
+            glDeleteShader(pending.vertex);
+            glDeleteShader(pending.fragment);
+            glDeleteProgram(pending.program);
+        }
+
+        static std::string fileName(const std::string& path)
+        {
+            size_t slash = path.find_last_of("/\\");
+            return slash == std::string::npos ? path : path.substr(slash + 1);
+        }
+
+        static bool dependsOn(const Watched& watched, const std::vector<std::string>& changed)
+        {
+            for (const std::string& file : watched.files)
+            {
+                if (std::find(changed.begin(), changed.end(), fileName(file)) != changed.end())
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+#ifdef __linux__
+        void watchLoop()
+        {
+            alignas(struct inotify_event) char buffer[4096];
+            while (running)
+            {
+                // Wake up regularly so the destructor does not have to wait for a file event.
+                pollfd fds = { inotifyFd, POLLIN, 0 };
+                if (poll(&fds, 1, 100) <= 0)
+                {
+                    continue;
+                }
+
+                // Collect every file named in this batch of events once.
+                std::vector<std::string> changed;
+                ssize_t length;
+                while ((length = read(inotifyFd, buffer, sizeof(buffer))) > 0)
+                {
+                    for (char* ptr = buffer; ptr < buffer + length;)
+                    {
+                        const struct inotify_event* event = (const struct inotify_event*)ptr;
+                        if (event->len > 0)
+                        {
+                            std::string name(event->name);
+                            if (std::find(changed.begin(), changed.end(), name) == changed.end())
+                            {
+                                changed.push_back(name);
+                            }
+                        }
+                        ptr += sizeof(struct inotify_event) + event->len;
+                    }
+                }
+
+                std::vector<Watched> affected;
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    for (const Watched& watched : shaders)
+                    {
+                        if (dependsOn(watched, changed))
+                        {
+                            affected.push_back(watched);
+                        }
+                    }
+                }
+
+                // Read and preprocess the sources here so the render thread only has to hand them to the driver.
+                // The edits are on disk, so the asset archive's copies are skipped.
+                for (const Watched& watched : affected)
+                {
+                    Reload reload;
+                    reload.shader = watched.shader;
+                    std::vector<std::string> files;
+                    reload.vertexCode = ShaderPreprocessor::process(watched.vertexPath, watched.defines, &files, true);
+                    reload.fragmentCode = ShaderPreprocessor::process(watched.fragmentPath, watched.defines, &files, true);
+                    if (reload.vertexCode.empty() || reload.fragmentCode.empty())
+                    {
+                        continue;
+                    }
+
+                    // Queue the reload only if the shader was not unwatched in the meantime.
+                    std::lock_guard<std::mutex> lock(mutex);
+                    for (Watched& current : shaders)
+                    {
+                        if (current.shader == watched.shader)
+                        {
+                            current.files = files;
+                            ready.push_back(std::move(reload));
+                            break;
+                        }
+                    }
+                }
+            }
+        }
+#endif
+};
+#endif
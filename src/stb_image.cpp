@@ -0,0 +1,3 @@
+// The stb_image implementation, compiled once. Everything else includes stb_image.h for the declarations only.
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
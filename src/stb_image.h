@@ -238,6 +238,13 @@ RECENT REVISION HISTORY:
 // (at least this is true for iOS and Android). Therefore, the NEON support is
 // toggled by a build flag: define STBI_NEON to get NEON loops.
 //
+// On x64 the JPEG decoder also has AVX2 versions of the IDCT (two blocks at a
+// time), the YCbCr-to-RGB conversion and the 2x chroma upsamplers. They are
+// compiled without any extra compiler flags and chosen at run time when the
+// CPU supports AVX2; their output is bit-identical to the SSE2/C kernels.
+// Define STBI_NO_AVX2 to leave them out, or call stbi_set_jpeg_avx2(0) to
+// switch to the SSE2 kernels at run time.
+//
 // If for some reason you do not want to use any of SIMD code, or if
 // you have issues compiling it, you can disable it entirely by
 // defining STBI_NO_SIMD.
@@ -491,6 +498,30 @@ STBIDEF void stbi_set_flip_vertically_on_load(int flag_true_if_should_flip);
 // calling it will fail to link if your compiler doesn't
 STBIDEF void stbi_set_flip_vertically_on_load_thread(int flag_true_if_should_flip);
 
+// decode JPEGs at 1/2, 1/4 or 1/8 of their size by passing 2, 4 or 8; 1 decodes at full size.
+// each 8x8 block goes through a reduced IDCT of its lowest frequencies, so most of the IDCT,
+// upsampling and color conversion work is skipped. the decoded size is (size + scale - 1) / scale;
+// stbi_info still reports the full size. other formats are not affected.
+STBIDEF void stbi_set_jpeg_scale_on_load(int scale);
+
+// as above, but only applies to images loaded on the thread that calls the function
+STBIDEF void stbi_set_jpeg_scale_on_load_thread(int scale);
+
+// use the AVX2 JPEG kernels when the CPU has AVX2 (the default), or the SSE2 ones if 0 is passed.
+// the decoded pixels are the same either way; this is for comparing and benchmarking the kernels.
+STBIDEF void stbi_set_jpeg_avx2(int flag_true_if_should_use_avx2);
+
+// decode the restart intervals of large baseline JPEGs on several threads. stb_image starts
+// no threads itself: run must call task(arg, i) for every i in [0, count), concurrently if it
+// can, and return once all calls have returned. only JPEGs loaded from memory whose scans
+// are split by restart markers are decoded this way, into the same pixels as decoding them
+// serially. passing NULL (the default) decodes serially.
+typedef void stbi_parallel_run(void *user, int count, void (*task)(void *arg, int index), void *arg);
+STBIDEF void stbi_set_jpeg_parallel(stbi_parallel_run *run, void *user);
+
+// as above, but only applies to images loaded on the thread that calls the function
+STBIDEF void stbi_set_jpeg_parallel_thread(stbi_parallel_run *run, void *user);
+
 // ZLIB client - used by PNG, available for other purposes
 
 STBIDEF char *stbi_zlib_decode_malloc_guesssize(const char *buffer, int len, int initial_size, int *outlen);
@@ -741,6 +772,38 @@ static int stbi__sse2_available(void)
 #endif
 #endif
 
+// AVX2 kernels for the jpeg decoder, picked at run time so the rest of the
+// library still only needs SSE2. x64 only; 64-bit MinGW is left out because
+// GCC there doesn't keep the stack 32-byte aligned when spilling ymm registers.
+#if defined(STBI_SSE2) && defined(STBI__X64_TARGET) && !defined(STBI_NO_AVX2) && !defined(STBI_NO_JPEG) && !defined(__MINGW32__) \
+   && (defined(__clang__) || (defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))) || (defined(_MSC_VER) && _MSC_VER >= 1800))
+#define STBI_AVX2
+#include <immintrin.h>
+
+#if defined(__GNUC__) || defined(__clang__)
+// compile just the kernels for AVX2, without -mavx2 for the whole file
+#define STBI__AVX2_TARGET __attribute__((target("avx2")))
+static int stbi__avx2_available(void)
+{
+   // also checks that the OS saves the ymm registers
+   return __builtin_cpu_supports("avx2");
+}
+#else
+#define STBI__AVX2_TARGET
+static int stbi__avx2_available(void)
+{
+   int info[4];
+   __cpuid(info,0);
+   if (info[0] < 7) return 0;
+   __cpuid(info,1);
+   // OSXSAVE and AVX, and the OS saves the xmm and ymm state
+   if ((info[2] & 0x18000000) != 0x18000000 || (_xgetbv(0) & 6) != 6) return 0;
+   __cpuidex(info,7,0);
+   return (info[1] >> 5) & 1;
+}
+#endif
+#endif
+
 // ARM NEON
 #if defined(STBI_NO_SIMD) && defined(STBI_NEON)
 #undef STBI_NEON
@@ -1080,6 +1143,74 @@ STBIDEF void stbi_set_flip_vertically_on_load_thread(int flag_true_if_should_fli
                                          : stbi__vertically_flip_on_load_global)
 #endif // STBI_THREAD_LOCAL
 
+static int stbi__jpeg_avx2_enabled = 1;
+
+STBIDEF void stbi_set_jpeg_avx2(int flag_true_if_should_use_avx2)
+{
+   stbi__jpeg_avx2_enabled = flag_true_if_should_use_avx2;
+}
+
+static stbi_parallel_run *stbi__jpeg_parallel_run_global = NULL;
+static void *stbi__jpeg_parallel_user_global = NULL;
+
+STBIDEF void stbi_set_jpeg_parallel(stbi_parallel_run *run, void *user)
+{
+   stbi__jpeg_parallel_run_global = run;
+   stbi__jpeg_parallel_user_global = user;
+}
+
+#ifndef STBI_THREAD_LOCAL
+#define stbi__jpeg_parallel_run   stbi__jpeg_parallel_run_global
+#define stbi__jpeg_parallel_user  stbi__jpeg_parallel_user_global
+#else
+static STBI_THREAD_LOCAL stbi_parallel_run *stbi__jpeg_parallel_run_local;
+static STBI_THREAD_LOCAL void *stbi__jpeg_parallel_user_local;
+static STBI_THREAD_LOCAL int stbi__jpeg_parallel_set;
+
+STBIDEF void stbi_set_jpeg_parallel_thread(stbi_parallel_run *run, void *user)
+{
+   stbi__jpeg_parallel_run_local = run;
+   stbi__jpeg_parallel_user_local = user;
+   stbi__jpeg_parallel_set = 1;
+}
+
+#define stbi__jpeg_parallel_run   (stbi__jpeg_parallel_set            \
+                                   ? stbi__jpeg_parallel_run_local   \
+                                   : stbi__jpeg_parallel_run_global)
+#define stbi__jpeg_parallel_user  (stbi__jpeg_parallel_set            \
+                                   ? stbi__jpeg_parallel_user_local  \
+                                   : stbi__jpeg_parallel_user_global)
+#endif // STBI_THREAD_LOCAL
+
+// log2 of the jpeg scale denominator
+static int stbi__jpeg_scale_shift_global = 0;
+
+static int stbi__jpeg_scale_to_shift(int scale)
+{
+   return scale >= 8 ? 3 : scale >= 4 ? 2 : scale >= 2 ? 1 : 0;
+}
+
+STBIDEF void stbi_set_jpeg_scale_on_load(int scale)
+{
+   stbi__jpeg_scale_shift_global = stbi__jpeg_scale_to_shift(scale);
+}
+
+#ifndef STBI_THREAD_LOCAL
+#define stbi__jpeg_scale_shift  stbi__jpeg_scale_shift_global
+#else
+static STBI_THREAD_LOCAL int stbi__jpeg_scale_shift_local, stbi__jpeg_scale_shift_set;
+
+STBIDEF void stbi_set_jpeg_scale_on_load_thread(int scale)
+{
+   stbi__jpeg_scale_shift_local = stbi__jpeg_scale_to_shift(scale);
+   stbi__jpeg_scale_shift_set = 1;
+}
+
+#define stbi__jpeg_scale_shift  (stbi__jpeg_scale_shift_set       \
+                                 ? stbi__jpeg_scale_shift_local  \
+                                 : stbi__jpeg_scale_shift_global)
+#endif // STBI_THREAD_LOCAL
+
 static void *stbi__load_main(stbi__context *s, int *x, int *y, int *comp, int req_comp, stbi__result_info *ri, int bpc)
 {
    memset(ri, 0, sizeof(*ri)); // make sure it's initialized if we add new fields
@@ -1932,11 +2063,25 @@ typedef struct
 
    int scan_n, order[4];
    int restart_interval, todo;
+   int scale_shift; // each 8x8 block decodes to (8 >> scale_shift)^2 pixels
+
+   // stbi_set_jpeg_parallel callback for decoding restart intervals concurrently
+   stbi_parallel_run *parallel_run;
+   void *parallel_user;
 
 // kernels
    void (*idct_block_kernel)(stbi_uc *out, int out_stride, short data[64]);
    void (*YCbCr_to_RGB_kernel)(stbi_uc *out, const stbi_uc *y, const stbi_uc *pcb, const stbi_uc *pcr, int count, int step);
    stbi_uc *(*resample_row_hv_2_kernel)(stbi_uc *out, stbi_uc *in_near, stbi_uc *in_far, int w, int hs);
+   stbi_uc *(*resample_row_h_2_kernel)(stbi_uc *out, stbi_uc *in_near, stbi_uc *in_far, int w, int hs);
+   stbi_uc *(*resample_row_v_2_kernel)(stbi_uc *out, stbi_uc *in_near, stbi_uc *in_far, int w, int hs);
+
+   // idct kernel for two blocks at once, or NULL. with it, each block waits in
+   // idct_pending_* until a second one comes along (see stbi__jpeg_idct)
+   void (*idct_block2_kernel)(stbi_uc *out0, int out0_stride, short data0[64], stbi_uc *out1, int out1_stride, short data1[64]);
+   STBI_SIMD_ALIGN(short, idct_pending_data[64]);
+   stbi_uc *idct_pending_out;
+   int      idct_pending_stride;
 } stbi__jpeg;
 
 static int stbi__build_huffman(stbi__huffman *h, int *count)
@@ -2630,6 +2775,196 @@ static void stbi__idct_simd(stbi_uc *out, int out_stride, short data[64])
 
 #endif // STBI_SSE2
 
+#ifdef STBI_AVX2
+// avx2 version of stbi__idct_simd. a single 8x8 block doesn't fill 256-bit
+// registers without cross-lane shuffles, so this runs the same sse2 code on
+// two blocks at once, one per 128-bit lane: every step is the lane-wise
+// equivalent of the sse2 one, so both blocks come out bit-identical to it.
+static STBI__AVX2_TARGET void stbi__idct_avx2(stbi_uc *out0, int out0_stride, short data0[64], stbi_uc *out1, int out1_stride, short data1[64])
+{
+   __m256i row0, row1, row2, row3, row4, row5, row6, row7;
+   __m256i tmp;
+
+   // dot product constant: even elems=x, odd elems=y
+   #define dct_const(x,y)  _mm256_set1_epi32((int) (((unsigned int) (y) << 16) | ((x) & 0xffff)))
+
+   // out(0) = c0[even]*x + c0[odd]*y   (c0, x, y 16-bit, out 32-bit)
+   // out(1) = c1[even]*x + c1[odd]*y
+   #define dct_rot(out0,out1, x,y,c0,c1) \
+      __m256i c0##lo = _mm256_unpacklo_epi16((x),(y)); \
+      __m256i c0##hi = _mm256_unpackhi_epi16((x),(y)); \
+      __m256i out0##_l = _mm256_madd_epi16(c0##lo, c0); \
+      __m256i out0##_h = _mm256_madd_epi16(c0##hi, c0); \
+      __m256i out1##_l = _mm256_madd_epi16(c0##lo, c1); \
+      __m256i out1##_h = _mm256_madd_epi16(c0##hi, c1)
+
+   // out = in << 12  (in 16-bit, out 32-bit)
+   #define dct_widen(out, in) \
+      __m256i out##_l = _mm256_srai_epi32(_mm256_unpacklo_epi16(_mm256_setzero_si256(), (in)), 4); \
+      __m256i out##_h = _mm256_srai_epi32(_mm256_unpackhi_epi16(_mm256_setzero_si256(), (in)), 4)
+
+   // wide add
+   #define dct_wadd(out, a, b) \
+      __m256i out##_l = _mm256_add_epi32(a##_l, b##_l); \
+      __m256i out##_h = _mm256_add_epi32(a##_h, b##_h)
+
+   // wide sub
+   #define dct_wsub(out, a, b) \
+      __m256i out##_l = _mm256_sub_epi32(a##_l, b##_l); \
+      __m256i out##_h = _mm256_sub_epi32(a##_h, b##_h)
+
+   // butterfly a/b, add bias, then shift by "s" and pack
+   #define dct_bfly32o(out0, out1, a,b,bias,s) \
+      { \
+         __m256i abiased_l = _mm256_add_epi32(a##_l, bias); \
+         __m256i abiased_h = _mm256_add_epi32(a##_h, bias); \
+         dct_wadd(sum, abiased, b); \
+         dct_wsub(dif, abiased, b); \
+         out0 = _mm256_packs_epi32(_mm256_srai_epi32(sum_l, s), _mm256_srai_epi32(sum_h, s)); \
+         out1 = _mm256_packs_epi32(_mm256_srai_epi32(dif_l, s), _mm256_srai_epi32(dif_h, s)); \
+      }
+
+   // 8-bit interleave step (for transposes)
+   #define dct_interleave8(a, b) \
+      tmp = a; \
+      a = _mm256_unpacklo_epi8(a, b); \
+      b = _mm256_unpackhi_epi8(tmp, b)
+
+   // 16-bit interleave step (for transposes)
+   #define dct_interleave16(a, b) \
+      tmp = a; \
+      a = _mm256_unpacklo_epi16(a, b); \
+      b = _mm256_unpackhi_epi16(tmp, b)
+
+   #define dct_pass(bias,shift) \
+      { \
+         /* even part */ \
+         dct_rot(t2e,t3e, row2,row6, rot0_0,rot0_1); \
+         __m256i sum04 = _mm256_add_epi16(row0, row4); \
+         __m256i dif04 = _mm256_sub_epi16(row0, row4); \
+         dct_widen(t0e, sum04); \
+         dct_widen(t1e, dif04); \
+         dct_wadd(x0, t0e, t3e); \
+         dct_wsub(x3, t0e, t3e); \
+         dct_wadd(x1, t1e, t2e); \
+         dct_wsub(x2, t1e, t2e); \
+         /* odd part */ \
+         dct_rot(y0o,y2o, row7,row3, rot2_0,rot2_1); \
+         dct_rot(y1o,y3o, row5,row1, rot3_0,rot3_1); \
+         __m256i sum17 = _mm256_add_epi16(row1, row7); \
+         __m256i sum35 = _mm256_add_epi16(row3, row5); \
+         dct_rot(y4o,y5o, sum17,sum35, rot1_0,rot1_1); \
+         dct_wadd(x4, y0o, y4o); \
+         dct_wadd(x5, y1o, y5o); \
+         dct_wadd(x6, y2o, y5o); \
+         dct_wadd(x7, y3o, y4o); \
+         dct_bfly32o(row0,row7, x0,x7,bias,shift); \
+         dct_bfly32o(row1,row6, x1,x6,bias,shift); \
+         dct_bfly32o(row2,row5, x2,x5,bias,shift); \
+         dct_bfly32o(row3,row4, x3,x4,bias,shift); \
+      }
+
+   // row r of data0 in the low lane, row r of data1 in the high lane
+   #define dct_load(r) \
+      _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i *) (data0 + (r)*8))), \
+                              _mm_loadu_si128((const __m128i *) (data1 + (r)*8)), 1)
+
+   // store two output rows of each block
+   #define dct_store2(p) \
+      _mm_storel_epi64((__m128i *) out0, _mm256_castsi256_si128(p)); out0 += out0_stride; \
+      _mm_storel_epi64((__m128i *) out0, _mm256_castsi256_si128(_mm256_shuffle_epi32(p, 0x4e))); out0 += out0_stride; \
+      _mm_storel_epi64((__m128i *) out1, _mm256_extracti128_si256(p, 1)); out1 += out1_stride; \
+      _mm_storel_epi64((__m128i *) out1, _mm256_extracti128_si256(_mm256_shuffle_epi32(p, 0x4e), 1)); out1 += out1_stride
+
+   __m256i rot0_0 = dct_const(stbi__f2f(0.5411961f), stbi__f2f(0.5411961f) + stbi__f2f(-1.847759065f));
+   __m256i rot0_1 = dct_const(stbi__f2f(0.5411961f) + stbi__f2f( 0.765366865f), stbi__f2f(0.5411961f));
+   __m256i rot1_0 = dct_const(stbi__f2f(1.175875602f) + stbi__f2f(-0.899976223f), stbi__f2f(1.175875602f));
+   __m256i rot1_1 = dct_const(stbi__f2f(1.175875602f), stbi__f2f(1.175875602f) + stbi__f2f(-2.562915447f));
+   __m256i rot2_0 = dct_const(stbi__f2f(-1.961570560f) + stbi__f2f( 0.298631336f), stbi__f2f(-1.961570560f));
+   __m256i rot2_1 = dct_const(stbi__f2f(-1.961570560f), stbi__f2f(-1.961570560f) + stbi__f2f( 3.072711026f));
+   __m256i rot3_0 = dct_const(stbi__f2f(-0.390180644f) + stbi__f2f( 2.053119869f), stbi__f2f(-0.390180644f));
+   __m256i rot3_1 = dct_const(stbi__f2f(-0.390180644f), stbi__f2f(-0.390180644f) + stbi__f2f( 1.501321110f));
+
+   // rounding biases in column/row passes, see stbi__idct_block for explanation.
+   __m256i bias_0 = _mm256_set1_epi32(512);
+   __m256i bias_1 = _mm256_set1_epi32(65536 + (128<<17));
+
+   // load
+   row0 = dct_load(0);
+   row1 = dct_load(1);
+   row2 = dct_load(2);
+   row3 = dct_load(3);
+   row4 = dct_load(4);
+   row5 = dct_load(5);
+   row6 = dct_load(6);
+   row7 = dct_load(7);
+
+   // column pass
+   dct_pass(bias_0, 10);
+
+   {
+      // 16bit 8x8 transpose pass 1
+      dct_interleave16(row0, row4);
+      dct_interleave16(row1, row5);
+      dct_interleave16(row2, row6);
+      dct_interleave16(row3, row7);
+
+      // transpose pass 2
+      dct_interleave16(row0, row2);
+      dct_interleave16(row1, row3);
+      dct_interleave16(row4, row6);
+      dct_interleave16(row5, row7);
+
+      // transpose pass 3
+      dct_interleave16(row0, row1);
+      dct_interleave16(row2, row3);
+      dct_interleave16(row4, row5);
+      dct_interleave16(row6, row7);
+   }
+
+   // row pass
+   dct_pass(bias_1, 17);
+
+   {
+      // pack
+      __m256i p0 = _mm256_packus_epi16(row0, row1); // a0a1a2a3...a7b0b1b2b3...b7
+      __m256i p1 = _mm256_packus_epi16(row2, row3);
+      __m256i p2 = _mm256_packus_epi16(row4, row5);
+      __m256i p3 = _mm256_packus_epi16(row6, row7);
+
+      // 8bit 8x8 transpose pass 1
+      dct_interleave8(p0, p2); // a0e0a1e1...
+      dct_interleave8(p1, p3); // c0g0c1g1...
+
+      // transpose pass 2
+      dct_interleave8(p0, p1); // a0c0e0g0...
+      dct_interleave8(p2, p3); // b0d0f0h0...
+
+      // transpose pass 3
+      dct_interleave8(p0, p2); // a0b0c0d0...
+      dct_interleave8(p1, p3); // a4b4c4d4...
+
+      // store
+      dct_store2(p0);
+      dct_store2(p2);
+      dct_store2(p1);
+      dct_store2(p3);
+   }
+
+#undef dct_const
+#undef dct_rot
+#undef dct_widen
+#undef dct_wadd
+#undef dct_wsub
+#undef dct_bfly32o
+#undef dct_interleave8
+#undef dct_interleave16
+#undef dct_pass
+#undef dct_load
+#undef dct_store2
+}
+#endif // STBI_AVX2
+
 #ifdef STBI_NEON
 
 // NEON integer IDCT. should produce bit-identical
@@ -2857,6 +3192,82 @@ static stbi_uc stbi__get_marker(stbi__jpeg *j)
 // of the components is specified by order[]
 #define STBI__RESTART(x)     ((x) >= 0xd0 && (x) <= 0xd7)
 
+// reduced idct for decoding at 1/2 and 1/4 scale: the lowest n x n frequencies of the
+// block are evaluated at the centers of the n x n output pixels. the tables hold
+// C(u) * cos((2x+1) u pi / 2n) / 2 scaled by 4096, with C(0) = 1/sqrt(2)
+static const int stbi__idct4_table[16] = {
+   1448,  1892,  1448,   784,
+   1448,   784, -1448, -1892,
+   1448,  -784, -1448,  1892,
+   1448, -1892,  1448,  -784,
+};
+
+static const int stbi__idct2_table[4] = {
+   1448,  1448,
+   1448, -1448,
+};
+
+static void stbi__idct_block_scaled(stbi_uc *out, int out_stride, short data[64], int n)
+{
+   int i,j,k,tmp[16];
+   const int *table = n == 4 ? stbi__idct4_table : stbi__idct2_table;
+   if (n == 1) {
+      // only the DC term is left; it is 8x the block average
+      out[0] = stbi__clamp(((data[0] + 4) >> 3) + 128);
+      return;
+   }
+   // columns, keeping 4 fractional bits. real coefficients stay far below
+   // 1 << 18 here; clamping crafted ones keeps the row sums inside an int
+   for (j=0; j < n; ++j) {
+      for (i=0; i < n; ++i) {
+         int sum = 128;
+         for (k=0; k < n; ++k)
+            sum += table[j*n+k] * data[k*8+i];
+         sum >>= 8;
+         tmp[j*n+i] = sum < -(1 << 18) ? -(1 << 18) : sum > (1 << 18) ? (1 << 18) : sum;
+      }
+   }
+   // rows, adding the level shift and rounding
+   for (j=0; j < n; ++j, out += out_stride) {
+      for (i=0; i < n; ++i) {
+         int sum = (128 << 16) + (1 << 15);
+         for (k=0; k < n; ++k)
+            sum += table[i*n+k] * tmp[j*n+k];
+         out[i] = stbi__clamp(sum >> 16);
+      }
+   }
+}
+
+// idct block (bx,by) of component n into its pixels. with a two-block kernel
+// the block is copied aside and only transformed together with the next one,
+// so stbi__jpeg_idct_flush has to run before the pixels are read
+static void stbi__jpeg_idct(stbi__jpeg *z, int n, int bx, int by, short data[64])
+{
+   int size = 8 >> z->scale_shift;
+   stbi_uc *out = z->img_comp[n].data + z->img_comp[n].w2*by*size + bx*size;
+   if (z->scale_shift != 0)
+      stbi__idct_block_scaled(out, z->img_comp[n].w2, data, size);
+   else if (!z->idct_block2_kernel)
+      z->idct_block_kernel(out, z->img_comp[n].w2, data);
+   else if (z->idct_pending_out) {
+      z->idct_block2_kernel(z->idct_pending_out, z->idct_pending_stride, z->idct_pending_data, out, z->img_comp[n].w2, data);
+      z->idct_pending_out = NULL;
+   } else {
+      memcpy(z->idct_pending_data, data, sizeof(z->idct_pending_data));
+      z->idct_pending_out = out;
+      z->idct_pending_stride = z->img_comp[n].w2;
+   }
+}
+
+// transform the block left waiting by stbi__jpeg_idct, if any
+static void stbi__jpeg_idct_flush(stbi__jpeg *z)
+{
+   if (z->idct_pending_out) {
+      z->idct_block_kernel(z->idct_pending_out, z->idct_pending_stride, z->idct_pending_data);
+      z->idct_pending_out = NULL;
+   }
+}
+
 // after a restart interval, stbi__jpeg_reset the entropy decoder and
 // the dc prediction
 static void stbi__jpeg_reset(stbi__jpeg *j)
@@ -2872,68 +3283,186 @@ static void stbi__jpeg_reset(stbi__jpeg *j)
    // since we don't even allow 1<<30 pixels
 }
 
-static int stbi__parse_entropy_coded_data(stbi__jpeg *z)
+// number of MCUs in the current scan
+static int stbi__jpeg_scan_mcus(stbi__jpeg *z)
 {
+   if (z->scan_n == 1) {
+      // non-interleaved data has one block per MCU, and as many blocks as
+      // the component has "pixels", independent of interleaved MCU blocking
+      int n = z->order[0];
+      return ((z->img_comp[n].x+7) >> 3) * ((z->img_comp[n].y+7) >> 3);
+   }
+   return z->img_mcu_x * z->img_mcu_y;
+}
+
+// decode baseline MCUs first..first+count-1 of the current scan, in scanline
+// order, starting with the entropy decoder reset
+static int stbi__jpeg_decode_mcus(stbi__jpeg *z, int first, int count)
+{
+   int m;
    stbi__jpeg_reset(z);
-   if (!z->progressive) {
-      if (z->scan_n == 1) {
-         int i,j;
-         STBI_SIMD_ALIGN(short, data[64]);
-         int n = z->order[0];
-         // non-interleaved data, we just need to process one block at a time,
-         // in trivial scanline order
-         // number of blocks to do just depends on how many actual "pixels" this
-         // component has, independent of interleaved MCU blocking and such
-         int w = (z->img_comp[n].x+7) >> 3;
-         int h = (z->img_comp[n].y+7) >> 3;
-         for (j=0; j < h; ++j) {
-            for (i=0; i < w; ++i) {
-               int ha = z->img_comp[n].ha;
-               if (!stbi__jpeg_decode_block(z, data, z->huff_dc+z->img_comp[n].hd, z->huff_ac+ha, z->fast_ac[ha], n, z->dequant[z->img_comp[n].tq])) return 0;
-               z->idct_block_kernel(z->img_comp[n].data+z->img_comp[n].w2*j*8+i*8, z->img_comp[n].w2, data);
-               // every data block is an MCU, so countdown the restart interval
-               if (--z->todo <= 0) {
-                  if (z->code_bits < 24) stbi__grow_buffer_unsafe(z);
-                  // if it's NOT a restart, then just bail, so we get corrupt data
-                  // rather than no data
-                  if (!STBI__RESTART(z->marker)) return 1;
-                  stbi__jpeg_reset(z);
-               }
-            }
+   if (z->scan_n == 1) {
+      STBI_SIMD_ALIGN(short, data[64]);
+      int n = z->order[0];
+      // non-interleaved data, we just need to process one block at a time,
+      // in trivial scanline order
+      int w = (z->img_comp[n].x+7) >> 3;
+      for (m=first; m < first+count; ++m) {
+         int ha = z->img_comp[n].ha;
+         if (!stbi__jpeg_decode_block(z, data, z->huff_dc+z->img_comp[n].hd, z->huff_ac+ha, z->fast_ac[ha], n, z->dequant[z->img_comp[n].tq])) return 0;
+         stbi__jpeg_idct(z, n, m % w, m / w, data);
+         // every data block is an MCU, so countdown the restart interval
+         if (--z->todo <= 0) {
+            if (z->code_bits < 24) stbi__grow_buffer_unsafe(z);
+            // if it's NOT a restart, then just bail, so we get corrupt data
+            // rather than no data
+            if (!STBI__RESTART(z->marker)) return 1;
+            stbi__jpeg_reset(z);
          }
-         return 1;
-      } else { // interleaved
-         int i,j,k,x,y;
-         STBI_SIMD_ALIGN(short, data[64]);
-         for (j=0; j < z->img_mcu_y; ++j) {
-            for (i=0; i < z->img_mcu_x; ++i) {
-               // scan an interleaved mcu... process scan_n components in order
-               for (k=0; k < z->scan_n; ++k) {
-                  int n = z->order[k];
-                  // scan out an mcu's worth of this component; that's just determined
-                  // by the basic H and V specified for the component
-                  for (y=0; y < z->img_comp[n].v; ++y) {
-                     for (x=0; x < z->img_comp[n].h; ++x) {
-                        int x2 = (i*z->img_comp[n].h + x)*8;
-                        int y2 = (j*z->img_comp[n].v + y)*8;
-                        int ha = z->img_comp[n].ha;
-                        if (!stbi__jpeg_decode_block(z, data, z->huff_dc+z->img_comp[n].hd, z->huff_ac+ha, z->fast_ac[ha], n, z->dequant[z->img_comp[n].tq])) return 0;
-                        z->idct_block_kernel(z->img_comp[n].data+z->img_comp[n].w2*y2+x2, z->img_comp[n].w2, data);
-                     }
-                  }
-               }
-               // after all interleaved components, that's an interleaved MCU,
-               // so now count down the restart interval
-               if (--z->todo <= 0) {
-                  if (z->code_bits < 24) stbi__grow_buffer_unsafe(z);
-                  if (!STBI__RESTART(z->marker)) return 1;
-                  stbi__jpeg_reset(z);
+      }
+      return 1;
+   } else { // interleaved
+      int k,x,y;
+      STBI_SIMD_ALIGN(short, data[64]);
+      for (m=first; m < first+count; ++m) {
+         int i = m % z->img_mcu_x;
+         int j = m / z->img_mcu_x;
+         // scan an interleaved mcu... process scan_n components in order
+         for (k=0; k < z->scan_n; ++k) {
+            int n = z->order[k];
+            // scan out an mcu's worth of this component; that's just determined
+            // by the basic H and V specified for the component
+            for (y=0; y < z->img_comp[n].v; ++y) {
+               for (x=0; x < z->img_comp[n].h; ++x) {
+                  int x2 = (i*z->img_comp[n].h + x);
+                  int y2 = (j*z->img_comp[n].v + y);
+                  int ha = z->img_comp[n].ha;
+                  if (!stbi__jpeg_decode_block(z, data, z->huff_dc+z->img_comp[n].hd, z->huff_ac+ha, z->fast_ac[ha], n, z->dequant[z->img_comp[n].tq])) return 0;
+                  stbi__jpeg_idct(z, n, x2, y2, data);
                }
             }
          }
-         return 1;
+         // after all interleaved components, that's an interleaved MCU,
+         // so now count down the restart interval
+         if (--z->todo <= 0) {
+            if (z->code_bits < 24) stbi__grow_buffer_unsafe(z);
+            if (!STBI__RESTART(z->marker)) return 1;
+            stbi__jpeg_reset(z);
+         }
       }
+      return 1;
+   }
+}
+
+// chunks of restart intervals handed to the stbi_set_jpeg_parallel callback
+typedef struct
+{
+   stbi__jpeg *z;
+   stbi_uc **start;     // entropy-coded data of each chunk
+   char *ok;            // result of each chunk
+   int mcus_per_chunk;
+   int mcus;
+} stbi__jpeg_chunks;
+
+// the fewest MCUs worth giving a chunk of their own, and the most chunks
+#define STBI__JPEG_CHUNK_MCUS  512
+#define STBI__JPEG_MAX_CHUNKS  256
+
+static void stbi__jpeg_decode_chunk(void *arg, int index)
+{
+   stbi__jpeg_chunks *c = (stbi__jpeg_chunks *) arg;
+   int first = index * c->mcus_per_chunk;
+   int count = c->mcus - first < c->mcus_per_chunk ? c->mcus - first : c->mcus_per_chunk;
+   stbi__context s;
+   // a copy of the tables and component layout with its own entropy decoder;
+   // the chunks write disjoint blocks of the component buffers
+   stbi__jpeg *z = (stbi__jpeg *) stbi__malloc(sizeof(stbi__jpeg));
+   c->ok[index] = 0;
+   if (!z) return;
+   *z = *c->z;
+   stbi__start_mem(&s, c->start[index], (int) (c->z->s->img_buffer_end - c->start[index]));
+   z->s = &s;
+   c->ok[index] = (char) stbi__jpeg_decode_mcus(z, first, count);
+   stbi__jpeg_idct_flush(z);
+   STBI_FREE(z);
+}
+
+// decode a baseline scan with restart markers through the stbi_set_jpeg_parallel
+// callback: find where each restart interval starts, then decode runs of them
+// concurrently. returns -1 if the scan can't be split, having read nothing
+static int stbi__jpeg_parse_parallel(stbi__jpeg *z)
+{
+   stbi__jpeg_chunks c;
+   stbi_uc *p, *end = z->s->img_buffer_end;
+   int intervals, per_chunk, chunks, interval, i, result = 1;
+   unsigned char marker = STBI__MARKER_none;
+
+   // the whole scan has to be in memory to be split up
+   if (!z->parallel_run || !z->restart_interval || z->s->io.read) return -1;
+   c.mcus = stbi__jpeg_scan_mcus(z);
+   intervals = (c.mcus + z->restart_interval - 1) / z->restart_interval;
+   per_chunk = (STBI__JPEG_CHUNK_MCUS + z->restart_interval - 1) / z->restart_interval;
+   if (per_chunk < (intervals + STBI__JPEG_MAX_CHUNKS - 1) / STBI__JPEG_MAX_CHUNKS)
+      per_chunk = (intervals + STBI__JPEG_MAX_CHUNKS - 1) / STBI__JPEG_MAX_CHUNKS;
+   chunks = (intervals + per_chunk - 1) / per_chunk;
+   if (chunks < 2) return -1;
+
+   c.z = z;
+   c.mcus_per_chunk = per_chunk * z->restart_interval;
+   c.start = (stbi_uc **) stbi__malloc_mad2(chunks, (int) sizeof(stbi_uc *), 0);
+   c.ok = (char *) stbi__malloc(chunks);
+   if (!c.start || !c.ok) {
+      STBI_FREE(c.start);
+      STBI_FREE(c.ok);
+      return -1;
+   }
+
+   // find the restart markers, and the marker that ends the scan
+   c.start[0] = z->s->img_buffer;
+   interval = 1;
+   for (p = z->s->img_buffer; p < end; ) {
+      if (*p++ != 0xff) continue;
+      while (p < end && *p == 0xff) ++p; // fill bytes
+      if (p == end) break;
+      if (*p == 0) { ++p; continue; }    // stuffed 0xff data byte
+      if (!STBI__RESTART(*p)) {
+         marker = *p++;
+         break;
+      }
+      ++p;
+      if (interval % per_chunk == 0 && interval / per_chunk < chunks)
+         c.start[interval / per_chunk] = p;
+      ++interval;
+   }
+   // with more or fewer restart markers than the image needs, the serial
+   // decoder decides what to make of the data
+   if (interval != intervals) {
+      STBI_FREE(c.start);
+      STBI_FREE(c.ok);
+      return -1;
+   }
+
+   z->parallel_run(z->parallel_user, chunks, stbi__jpeg_decode_chunk, &c);
+   for (i=0; i < chunks; ++i)
+      if (!c.ok[i]) result = 0;
+   STBI_FREE(c.start);
+   STBI_FREE(c.ok);
+   if (!result) return stbi__err("bad restart interval", "Corrupt JPEG");
+
+   // carry on after the scan, as if decoded serially
+   z->s->img_buffer = p;
+   z->marker = marker;
+   return 1;
+}
+
+static int stbi__parse_entropy_coded_data(stbi__jpeg *z)
+{
+   if (!z->progressive) {
+      int result = stbi__jpeg_parse_parallel(z);
+      if (result >= 0) return result;
+      return stbi__jpeg_decode_mcus(z, 0, stbi__jpeg_scan_mcus(z));
    } else {
+      stbi__jpeg_reset(z);
       if (z->scan_n == 1) {
          int i,j;
          int n = z->order[0];
@@ -2996,6 +3525,22 @@ static int stbi__parse_entropy_coded_data(stbi__jpeg *z)
    }
 }
 
+// move past a scan without decoding it, stopping at the first marker that is not a restart
+static void stbi__jpeg_skip_entropy_coded_data(stbi__jpeg *z)
+{
+   while (!stbi__at_eof(z->s)) {
+      int x = stbi__get8(z->s);
+      if (x == 0xff) {
+         while (x == 0xff)
+            x = stbi__get8(z->s); // consume repeated 0xff fill bytes
+         if (x != 0 && !STBI__RESTART(x)) {
+            z->marker = (unsigned char) x;
+            return;
+         }
+      }
+   }
+}
+
 static void stbi__jpeg_dequantize(short *data, stbi__uint16 *dequant)
 {
    int i;
@@ -3015,10 +3560,11 @@ static void stbi__jpeg_finish(stbi__jpeg *z)
             for (i=0; i < w; ++i) {
                short *data = z->img_comp[n].coeff + 64 * (i + j * z->img_comp[n].coeff_w);
                stbi__jpeg_dequantize(data, z->dequant[z->img_comp[n].tq]);
-               z->idct_block_kernel(z->img_comp[n].data+z->img_comp[n].w2*j*8+i*8, z->img_comp[n].w2, data);
+               stbi__jpeg_idct(z, n, i, j, data);
             }
          }
       }
+      stbi__jpeg_idct_flush(z);
    }
 }
 
@@ -3247,8 +3793,9 @@ static int stbi__process_frame_header(stbi__jpeg *z, int scan)
       //
       // img_mcu_x, img_mcu_y: <=17 bits; comp[i].h and .v are <=4 (checked earlier)
       // so these muls can't overflow with 32-bit ints (which we require)
-      z->img_comp[i].w2 = z->img_mcu_x * z->img_comp[i].h * 8;
-      z->img_comp[i].h2 = z->img_mcu_y * z->img_comp[i].v * 8;
+      // when decoding at reduced scale each block is (8 >> scale_shift) pixels wide
+      z->img_comp[i].w2 = (z->img_mcu_x * z->img_comp[i].h * 8) >> z->scale_shift;
+      z->img_comp[i].h2 = (z->img_mcu_y * z->img_comp[i].v * 8) >> z->scale_shift;
       z->img_comp[i].coeff = 0;
       z->img_comp[i].raw_coeff = 0;
       z->img_comp[i].linebuf = NULL;
@@ -3258,10 +3805,10 @@ static int stbi__process_frame_header(stbi__jpeg *z, int scan)
       // align blocks for idct using mmx/sse
       z->img_comp[i].data = (stbi_uc*) (((size_t) z->img_comp[i].raw_data + 15) & ~15);
       if (z->progressive) {
-         // w2, h2 are multiples of 8 (see above)
-         z->img_comp[i].coeff_w = z->img_comp[i].w2 / 8;
-         z->img_comp[i].coeff_h = z->img_comp[i].h2 / 8;
-         z->img_comp[i].raw_coeff = stbi__malloc_mad3(z->img_comp[i].w2, z->img_comp[i].h2, sizeof(short), 15);
+         // w2, h2 are multiples of the block size (see above)
+         z->img_comp[i].coeff_w = z->img_comp[i].w2 >> (3 - z->scale_shift);
+         z->img_comp[i].coeff_h = z->img_comp[i].h2 >> (3 - z->scale_shift);
+         z->img_comp[i].raw_coeff = stbi__malloc_mad3(z->img_comp[i].coeff_w * 8, z->img_comp[i].coeff_h * 8, sizeof(short), 15);
          if (z->img_comp[i].raw_coeff == NULL)
             return stbi__free_jpeg_components(z, i+1, stbi__err("outofmem", "Out of memory"));
          z->img_comp[i].coeff = (short*) (((size_t) z->img_comp[i].raw_coeff + 15) & ~15);
@@ -3318,7 +3865,11 @@ static int stbi__decode_jpeg_image(stbi__jpeg *j)
    while (!stbi__EOI(m)) {
       if (stbi__SOS(m)) {
          if (!stbi__process_scan_header(j)) return 0;
-         if (!stbi__parse_entropy_coded_data(j)) return 0;
+         if (j->progressive && j->spec_start > 0 && j->scale_shift == 3) {
+            // at 1/8 scale only the DC terms are used, so AC scans are skipped
+            stbi__jpeg_skip_entropy_coded_data(j);
+         } else if (!stbi__parse_entropy_coded_data(j)) return 0;
+         stbi__jpeg_idct_flush(j);
          if (j->marker == STBI__MARKER_none ) {
             // handle 0s at the end of image data from IP Kamera 9060
             while (!stbi__at_eof(j->s)) {
@@ -3542,6 +4093,134 @@ static stbi_uc *stbi__resample_row_hv_2_simd(stbi_uc *out, stbi_uc *in_near, stb
 }
 #endif
 
+#ifdef STBI_AVX2
+// avx2 versions of the 2x upsamplers, 16 input pixels at a time. the filter
+// sums stay in 16 bits and never exceed 255 once descaled, so each pair of
+// output pixels is stored as one 16-bit word, even | (odd << 8), which keeps
+// the results in order without a cross-lane pack.
+static STBI__AVX2_TARGET stbi_uc *stbi__resample_row_hv_2_avx2(stbi_uc *out, stbi_uc *in_near, stbi_uc *in_far, int w, int hs)
+{
+   // need to generate 2x2 samples for every one in input
+   int i=0,t0,t1;
+
+   if (w == 1) {
+      out[0] = out[1] = stbi__div4(3*in_near[0] + in_far[0] + 2);
+      return out;
+   }
+
+   t1 = 3*in_near[0] + in_far[0];
+   // as stbi__resample_row_hv_2_simd, but with 16 pixels per group
+   for (; i < ((w-1) & ~15); i += 16) {
+      // vertical pass, 3*x + y = 4*x + (y - x)
+      __m256i farw  = _mm256_cvtepu8_epi16(_mm_loadu_si128((__m128i *) (in_far + i)));
+      __m256i nearw = _mm256_cvtepu8_epi16(_mm_loadu_si128((__m128i *) (in_near + i)));
+      __m256i diff  = _mm256_sub_epi16(farw, nearw);
+      __m256i nears = _mm256_slli_epi16(nearw, 2);
+      __m256i curr  = _mm256_add_epi16(nears, diff); // current row
+
+      // "prev" and "next" are the current row shifted by one pixel, which
+      // has to carry a pixel across the 128-bit lanes; the pixels from
+      // outside this group are inserted at the ends.
+      __m256i lo   = _mm256_permute2x128_si256(curr, curr, 0x08); // [0, curr.lo]
+      __m256i hi   = _mm256_permute2x128_si256(curr, curr, 0x81); // [curr.hi, 0]
+      __m256i prev = _mm256_insert_epi16(_mm256_alignr_epi8(curr, lo, 14), t1, 0);
+      __m256i next = _mm256_insert_epi16(_mm256_alignr_epi8(hi, curr, 2), 3*in_near[i+16] + in_far[i+16], 15);
+
+      // horizontal filter, polyphase
+      // even pixels = 3*cur + prev = cur*4 + (prev - cur)
+      // odd  pixels = 3*cur + next = cur*4 + (next - cur)
+      __m256i bias = _mm256_set1_epi16(8);
+      __m256i curs = _mm256_slli_epi16(curr, 2);
+      __m256i prvd = _mm256_sub_epi16(prev, curr);
+      __m256i nxtd = _mm256_sub_epi16(next, curr);
+      __m256i curb = _mm256_add_epi16(curs, bias);
+      __m256i even = _mm256_srli_epi16(_mm256_add_epi16(prvd, curb), 4);
+      __m256i odd  = _mm256_srli_epi16(_mm256_add_epi16(nxtd, curb), 4);
+
+      // interleave even and odd pixels and write output
+      _mm256_storeu_si256((__m256i *) (out + i*2), _mm256_or_si256(even, _mm256_slli_epi16(odd, 8)));
+
+      // "previous" value for next iter
+      t1 = 3*in_near[i+15] + in_far[i+15];
+   }
+
+   t0 = t1;
+   t1 = 3*in_near[i] + in_far[i];
+   out[i*2] = stbi__div16(3*t1 + t0 + 8);
+
+   for (++i; i < w; ++i) {
+      t0 = t1;
+      t1 = 3*in_near[i]+in_far[i];
+      out[i*2-1] = stbi__div16(3*t0 + t1 + 8);
+      out[i*2  ] = stbi__div16(3*t1 + t0 + 8);
+   }
+   out[w*2-1] = stbi__div4(t1+2);
+
+   STBI_NOTUSED(hs);
+
+   return out;
+}
+
+static STBI__AVX2_TARGET stbi_uc *stbi__resample_row_h_2_avx2(stbi_uc *out, stbi_uc *in_near, stbi_uc *in_far, int w, int hs)
+{
+   // need to generate two samples horizontally for every one in input
+   int i;
+   stbi_uc *input = in_near;
+
+   if (w == 1) {
+      // if only one sample, can't do any interpolation
+      out[0] = out[1] = input[0];
+      return out;
+   }
+
+   out[0] = input[0];
+   out[1] = stbi__div4(input[0]*3 + input[1] + 2);
+   // groups of 16 for as long as input[i+16] exists
+   for (i=1; i+16 < w; i += 16) {
+      __m256i prev = _mm256_cvtepu8_epi16(_mm_loadu_si128((__m128i *) (input + i - 1)));
+      __m256i curr = _mm256_cvtepu8_epi16(_mm_loadu_si128((__m128i *) (input + i)));
+      __m256i next = _mm256_cvtepu8_epi16(_mm_loadu_si128((__m128i *) (input + i + 1)));
+      __m256i n    = _mm256_add_epi16(_mm256_add_epi16(_mm256_slli_epi16(curr, 1), curr), _mm256_set1_epi16(2));
+      __m256i even = _mm256_srli_epi16(_mm256_add_epi16(n, prev), 2);
+      __m256i odd  = _mm256_srli_epi16(_mm256_add_epi16(n, next), 2);
+      _mm256_storeu_si256((__m256i *) (out + i*2), _mm256_or_si256(even, _mm256_slli_epi16(odd, 8)));
+   }
+   for (; i < w-1; ++i) {
+      int n = 3*input[i]+2;
+      out[i*2+0] = stbi__div4(n+input[i-1]);
+      out[i*2+1] = stbi__div4(n+input[i+1]);
+   }
+   out[i*2+0] = stbi__div4(input[w-2]*3 + input[w-1] + 2);
+   out[i*2+1] = input[w-1];
+
+   STBI_NOTUSED(in_far);
+   STBI_NOTUSED(hs);
+
+   return out;
+}
+
+static STBI__AVX2_TARGET stbi_uc *stbi__resample_row_v_2_avx2(stbi_uc *out, stbi_uc *in_near, stbi_uc *in_far, int w, int hs)
+{
+   // need to generate two samples vertically for every one in input
+   int i;
+   __m256i bias = _mm256_set1_epi16(2);
+   STBI_NOTUSED(hs);
+   for (i=0; i+31 < w; i += 32) {
+      __m256i near0 = _mm256_cvtepu8_epi16(_mm_loadu_si128((__m128i *) (in_near + i)));
+      __m256i near1 = _mm256_cvtepu8_epi16(_mm_loadu_si128((__m128i *) (in_near + i + 16)));
+      __m256i far0  = _mm256_cvtepu8_epi16(_mm_loadu_si128((__m128i *) (in_far + i)));
+      __m256i far1  = _mm256_cvtepu8_epi16(_mm_loadu_si128((__m128i *) (in_far + i + 16)));
+      __m256i out0  = _mm256_srli_epi16(_mm256_add_epi16(_mm256_add_epi16(_mm256_slli_epi16(near0, 1), near0), _mm256_add_epi16(far0, bias)), 2);
+      __m256i out1  = _mm256_srli_epi16(_mm256_add_epi16(_mm256_add_epi16(_mm256_slli_epi16(near1, 1), near1), _mm256_add_epi16(far1, bias)), 2);
+      // packus works per lane, so put the 64-bit halves back in order
+      _mm256_storeu_si256((__m256i *) (out + i), _mm256_permute4x64_epi64(_mm256_packus_epi16(out0, out1), 0xd8));
+   }
+   for (; i < w; ++i)
+      out[i] = stbi__div4(3*in_near[i] + in_far[i] + 2);
+   return out;
+}
+#endif
+
 static stbi_uc *stbi__resample_row_generic(stbi_uc *out, stbi_uc *in_near, stbi_uc *in_far, int w, int hs)
 {
    // resample with nearest-neighbor
@@ -3716,12 +4395,108 @@ static void stbi__YCbCr_to_RGB_simd(stbi_uc *out, stbi_uc const *y, stbi_uc cons
 }
 #endif
 
+#ifdef STBI_AVX2
+// avx2 version of stbi__YCbCr_to_RGB_simd, 16 pixels at a time, for both
+// step 4 and step 3 (plain RGB output, the default for color JPEGs).
+static STBI__AVX2_TARGET void stbi__YCbCr_to_RGB_avx2(stbi_uc *out, stbi_uc const *y, stbi_uc const *pcb, stbi_uc const *pcr, int count, int step)
+{
+   int i = 0;
+
+   if (step == 4 || step == 3) {
+      __m256i cr_const0 = _mm256_set1_epi16(   (short) ( 1.40200f*4096.0f+0.5f));
+      __m256i cr_const1 = _mm256_set1_epi16( - (short) ( 0.71414f*4096.0f+0.5f));
+      __m256i cb_const0 = _mm256_set1_epi16( - (short) ( 0.34414f*4096.0f+0.5f));
+      __m256i cb_const1 = _mm256_set1_epi16(   (short) ( 1.77200f*4096.0f+0.5f));
+      __m256i c_bias = _mm256_set1_epi16(128);
+      __m256i y_bias = _mm256_set1_epi16(8);
+      __m256i xw = _mm256_set1_epi16(255); // alpha channel
+
+      // byte shuffles that interleave 16 r, g and b values into 48 bytes of RGB
+      __m128i r_shuf0 = _mm_setr_epi8( 0,-1,-1, 1,-1,-1, 2,-1,-1, 3,-1,-1, 4,-1,-1, 5);
+      __m128i g_shuf0 = _mm_setr_epi8(-1, 0,-1,-1, 1,-1,-1, 2,-1,-1, 3,-1,-1, 4,-1,-1);
+      __m128i b_shuf0 = _mm_setr_epi8(-1,-1, 0,-1,-1, 1,-1,-1, 2,-1,-1, 3,-1,-1, 4,-1);
+      __m128i r_shuf1 = _mm_setr_epi8(-1,-1, 6,-1,-1, 7,-1,-1, 8,-1,-1, 9,-1,-1,10,-1);
+      __m128i g_shuf1 = _mm_setr_epi8( 5,-1,-1, 6,-1,-1, 7,-1,-1, 8,-1,-1, 9,-1,-1,10);
+      __m128i b_shuf1 = _mm_setr_epi8(-1, 5,-1,-1, 6,-1,-1, 7,-1,-1, 8,-1,-1, 9,-1,-1);
+      __m128i r_shuf2 = _mm_setr_epi8(-1,11,-1,-1,12,-1,-1,13,-1,-1,14,-1,-1,15,-1,-1);
+      __m128i g_shuf2 = _mm_setr_epi8(-1,-1,11,-1,-1,12,-1,-1,13,-1,-1,14,-1,-1,15,-1);
+      __m128i b_shuf2 = _mm_setr_epi8(10,-1,-1,11,-1,-1,12,-1,-1,13,-1,-1,14,-1,-1,15);
+
+      for (; i+15 < count; i += 16) {
+         // load, widening to short
+         __m256i yw  = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *) (y+i)));
+         __m256i crb = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *) (pcr+i)));
+         __m256i cbb = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *) (pcb+i)));
+
+         // the same words the sse2 unpacks make: y*16 + 8, and (c - 128) << 8
+         __m256i yws = _mm256_add_epi16(_mm256_slli_epi16(yw, 4), y_bias);
+         __m256i crw = _mm256_slli_epi16(_mm256_sub_epi16(crb, c_bias), 8);
+         __m256i cbw = _mm256_slli_epi16(_mm256_sub_epi16(cbb, c_bias), 8);
+
+         // color transform
+         __m256i cr0 = _mm256_mulhi_epi16(cr_const0, crw);
+         __m256i cb0 = _mm256_mulhi_epi16(cb_const0, cbw);
+         __m256i cb1 = _mm256_mulhi_epi16(cbw, cb_const1);
+         __m256i cr1 = _mm256_mulhi_epi16(crw, cr_const1);
+         __m256i rws = _mm256_add_epi16(cr0, yws);
+         __m256i gwt = _mm256_add_epi16(cb0, yws);
+         __m256i bws = _mm256_add_epi16(yws, cb1);
+         __m256i gws = _mm256_add_epi16(gwt, cr1);
+
+         // descale
+         __m256i rw = _mm256_srai_epi16(rws, 4);
+         __m256i bw = _mm256_srai_epi16(bws, 4);
+         __m256i gw = _mm256_srai_epi16(gws, 4);
+
+         if (step == 4) {
+            // back to byte and transpose as in the sse2 version, which
+            // leaves pixels 0-3 and 8-11 in o0, 4-7 and 12-15 in o1
+            __m256i brb = _mm256_packus_epi16(rw, bw);
+            __m256i gxb = _mm256_packus_epi16(gw, xw);
+            __m256i t0 = _mm256_unpacklo_epi8(brb, gxb);
+            __m256i t1 = _mm256_unpackhi_epi8(brb, gxb);
+            __m256i o0 = _mm256_unpacklo_epi16(t0, t1);
+            __m256i o1 = _mm256_unpackhi_epi16(t0, t1);
+
+            // store
+            _mm256_storeu_si256((__m256i *) (out + 0), _mm256_permute2x128_si256(o0, o1, 0x20));
+            _mm256_storeu_si256((__m256i *) (out + 32), _mm256_permute2x128_si256(o0, o1, 0x31));
+            out += 64;
+         } else {
+            // back to byte, with all 16 of r and b in one lane each
+            __m256i rb = _mm256_permute4x64_epi64(_mm256_packus_epi16(rw, bw), 0xd8);
+            __m256i gg = _mm256_permute4x64_epi64(_mm256_packus_epi16(gw, gw), 0xd8);
+            __m128i r = _mm256_castsi256_si128(rb);
+            __m128i g = _mm256_castsi256_si128(gg);
+            __m128i b = _mm256_extracti128_si256(rb, 1);
+
+            // interleave and store
+            __m128i o0 = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(r, r_shuf0), _mm_shuffle_epi8(g, g_shuf0)), _mm_shuffle_epi8(b, b_shuf0));
+            __m128i o1 = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(r, r_shuf1), _mm_shuffle_epi8(g, g_shuf1)), _mm_shuffle_epi8(b, b_shuf1));
+            __m128i o2 = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(r, r_shuf2), _mm_shuffle_epi8(g, g_shuf2)), _mm_shuffle_epi8(b, b_shuf2));
+            _mm_storeu_si128((__m128i *) (out + 0), o0);
+            _mm_storeu_si128((__m128i *) (out + 16), o1);
+            _mm_storeu_si128((__m128i *) (out + 32), o2);
+            out += 48;
+         }
+      }
+   }
+
+   stbi__YCbCr_to_RGB_row(out, y+i, pcb+i, pcr+i, count-i, step);
+}
+#endif
+
 // set up the kernels
 static void stbi__setup_jpeg(stbi__jpeg *j)
 {
+   j->scale_shift = 0;
    j->idct_block_kernel = stbi__idct_block;
    j->YCbCr_to_RGB_kernel = stbi__YCbCr_to_RGB_row;
    j->resample_row_hv_2_kernel = stbi__resample_row_hv_2;
+   j->resample_row_h_2_kernel = stbi__resample_row_h_2;
+   j->resample_row_v_2_kernel = stbi__resample_row_v_2;
+   j->idct_block2_kernel = NULL;
+   j->idct_pending_out = NULL;
 
 #ifdef STBI_SSE2
    if (stbi__sse2_available()) {
@@ -3731,6 +4506,16 @@ static void stbi__setup_jpeg(stbi__jpeg *j)
    }
 #endif
 
+#ifdef STBI_AVX2
+   if (stbi__jpeg_avx2_enabled && stbi__avx2_available()) {
+      j->idct_block2_kernel = stbi__idct_avx2;
+      j->YCbCr_to_RGB_kernel = stbi__YCbCr_to_RGB_avx2;
+      j->resample_row_hv_2_kernel = stbi__resample_row_hv_2_avx2;
+      j->resample_row_h_2_kernel = stbi__resample_row_h_2_avx2;
+      j->resample_row_v_2_kernel = stbi__resample_row_v_2_avx2;
+   }
+#endif
+
 #ifdef STBI_NEON
    j->idct_block_kernel = stbi__idct_simd;
    j->YCbCr_to_RGB_kernel = stbi__YCbCr_to_RGB_simd;
@@ -3772,6 +4557,17 @@ static stbi_uc *load_jpeg_image(stbi__jpeg *z, int *out_x, int *out_y, int *comp
    // load a jpeg image from whichever source, but leave in YCbCr format
    if (!stbi__decode_jpeg_image(z)) { stbi__cleanup_jpeg(z); return NULL; }
 
+   // from here on the image and its components have their reduced size
+   if (z->scale_shift) {
+      int k, scale = 1 << z->scale_shift;
+      z->s->img_x = (z->s->img_x + scale-1) >> z->scale_shift;
+      z->s->img_y = (z->s->img_y + scale-1) >> z->scale_shift;
+      for (k=0; k < z->s->img_n; ++k) {
+         z->img_comp[k].x = (z->img_comp[k].x + scale-1) >> z->scale_shift;
+         z->img_comp[k].y = (z->img_comp[k].y + scale-1) >> z->scale_shift;
+      }
+   }
+
    // determine actual number of components to generate
    n = req_comp ? req_comp : z->s->img_n >= 3 ? 3 : 1;
 
@@ -3807,8 +4603,8 @@ static stbi_uc *load_jpeg_image(stbi__jpeg *z, int *out_x, int *out_y, int *comp
          r->line0   = r->line1 = z->img_comp[k].data;
 
          if      (r->hs == 1 && r->vs == 1) r->resample = resample_row_1;
-         else if (r->hs == 1 && r->vs == 2) r->resample = stbi__resample_row_v_2;
-         else if (r->hs == 2 && r->vs == 1) r->resample = stbi__resample_row_h_2;
+         else if (r->hs == 1 && r->vs == 2) r->resample = z->resample_row_v_2_kernel;
+         else if (r->hs == 2 && r->vs == 1) r->resample = z->resample_row_h_2_kernel;
          else if (r->hs == 2 && r->vs == 2) r->resample = z->resample_row_hv_2_kernel;
          else                               r->resample = stbi__resample_row_generic;
       }
@@ -3927,6 +4723,9 @@ static void *stbi__jpeg_load(stbi__context *s, int *x, int *y, int *comp, int re
    STBI_NOTUSED(ri);
    j->s = s;
    stbi__setup_jpeg(j);
+   j->scale_shift = stbi__jpeg_scale_shift;
+   j->parallel_run = stbi__jpeg_parallel_run;
+   j->parallel_user = stbi__jpeg_parallel_user;
    result = load_jpeg_image(j, x,y,comp,req_comp);
    STBI_FREE(j);
    return result;
@@ -0,0 +1,615 @@
+#ifndef TEXTURE_CACHE_H
+#define TEXTURE_CACHE_H
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <unordered_map>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <chrono>
+#include <filesystem>
+#include <cstdio>
+
+#include "gl_state.h"
+#include "texture_streamer.h"
+#include "compressed_texture.h"
+#include "mip_generator.h"
+#include "block_compressor.h"
+#include "image_writer.h"
+#include "asset_archive.h"
+#include "stb_image.h"
+
+// A texture owned by a TextureCache. ID names a shared placeholder until the image has been decoded and uploaded,
+// so it can be bound every frame from the first request on.
+struct Texture
+{
+    std::string Path;
+    unsigned int ID;
+    int Width;
+    int Height;
+    // True once ID names the real image.
+    bool Ready;
+    // True if the file could not be read or decoded. ID stays the placeholder.
+    bool Failed;
+    // True if the texture is block-compressed, from a KTX or DDS file or by Compress.
+    bool Compressed;
+};
+
+// Loads each image once and shares the GL texture between every user. Files are deduplicated by path and by content,
+// so copies of the same image under different names also share one texture.
+// Files are read and decoded on a pool of worker threads; update() uploads finished images on the GL thread within a
+// per-frame byte budget so loading never stalls a frame for long. Workers also build the mip chain of each image, so
+// the driver never has to, and write it into a ring of mapped pixel unpack buffers; the GL thread only issues GPU-side
+// copies and never touches pixel data itself. The ring is created by the first update() that has an image waiting for
+// it, with slots sized to the largest image waiting then.
+// A KTX or DDS file next to an image (wall.ktx for wall.jpg) is preferred over the image: its mip chain is uploaded as
+// is, without decoding. If the driver does not support its format, the image is decoded instead. Requesting a .ktx or
+// .dds path directly falls back to an image with the same name the same way.
+// Files are looked up in the mounted asset archive first and decoded straight from its mapping.
+class TextureCache
+{
+    public:
+        // Bytes of texture data uploaded per update() call. At least one image is uploaded per call.
+        size_t UploadBudget;
+
+        // Requests answered from an existing entry, and files whose contents matched an already loaded file.
+        unsigned int Hits;
+        unsigned int ContentDuplicates;
+
+        // How mip chains of decoded images are filtered. Set before the first get(), like Compress and CacheDirectory.
+        MipOptions Mips;
+
+        // Block-compress decoded images after building their mip chains, if the driver supports the format.
+        // Compressing is slow, so it is best combined with a CacheDirectory.
+        bool Compress;
+
+        // Where decoded images are kept with their mip chains as <key>.ktx, so later runs skip decoding, filtering and
+        // compressing. The key covers the file contents and the settings above. Empty rebuilds them on every run.
+        std::string CacheDirectory;
+
+        // Nothing is created until the first get(), so a cache that is never asked for a texture costs no threads or GL
+        // objects. 0 threads picks one less than the number of cores. 0 streaming slots uploads from client memory on the
+        // GL thread instead of through pixel unpack buffers.
+        TextureCache(unsigned int threadCount = 0, size_t uploadBudget = 8 * 1024 * 1024, unsigned int streamingSlots = 4)
+            : UploadBudget(uploadBudget), Hits(0), ContentDuplicates(0), Compress(false), placeholder(0), threadCount(threadCount), streamingSlots(streamingSlots), inFlight(0), streamRequest(0), running(true)
+        {
+        }
+
+        ~TextureCache()
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                running = false;
+            }
+            wake.notify_all();
+            streamerReady.notify_all();
+            if (streamer)
+            {
+                streamer->close();
+            }
+            for (std::thread& worker : workers)
+            {
+                worker.join();
+            }
+            for (Decoded& image : decoded)
+            {
+                delete image.chain;
+            }
+            for (auto& entry : textures)
+            {
+                if (entry.second->owner == NULL && entry.second->texture.Ready)
+                {
+                    glStateCache().forgetTexture(entry.second->texture.ID);
+                    glDeleteTextures(1, &entry.second->texture.ID);
+                }
+            }
+            if (placeholder)
+            {
+                glStateCache().forgetTexture(placeholder);
+                glDeleteTextures(1, &placeholder);
+            }
+        }
+
+        TextureCache(const TextureCache&) = delete;
+        TextureCache& operator=(const TextureCache&) = delete;
+
+        // Return the texture for an image file and start loading it if this is the first request. Call on the GL thread.
+        // The reference stays valid for the life of the cache.
+        const Texture& get(const std::string& path)
+        {
+            auto it = textures.find(path);
+            if (it != textures.end())
+            {
+                Hits++;
+                return it->second->texture;
+            }
+
+            if (workers.empty())
+            {
+                start();
+            }
+
+            std::unique_ptr<Entry> entry(new Entry());
+            entry->texture.Path = path;
+            entry->texture.ID = placeholder;
+            entry->texture.Width = 0;
+            entry->texture.Height = 0;
+            entry->texture.Ready = false;
+            entry->texture.Failed = false;
+            entry->texture.Compressed = false;
+            entry->owner = NULL;
+            Entry* request = entry.get();
+            textures[path] = std::move(entry);
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                jobs.push_back(request);
+                inFlight++;
+            }
+            wake.notify_one();
+            return request->texture;
+        }
+
+        // Upload images that finished decoding, up to UploadBudget bytes. Call once per frame on the GL thread.
+        void update()
+        {
+            if (streamer)
+            {
+                streamer->recycle();
+            }
+            else if (streamingSlots > 0)
+            {
+                createStreamer();
+            }
+            size_t uploaded = 0;
+            while (uploaded == 0 || uploaded < UploadBudget)
+            {
+                Decoded image;
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    if (decoded.empty())
+                    {
+                        break;
+                    }
+                    image = decoded.front();
+                    decoded.pop_front();
+                }
+                uploaded += upload(image);
+            }
+            resolveDuplicates();
+        }
+
+        // Block until every requested image is uploaded or has failed, e.g. before rendering frames that must not show placeholders.
+        void finish()
+        {
+            while (true)
+            {
+                {
+                    // Wake up regularly even without results: workers may be waiting for streaming slots that only update() recycles.
+                    std::unique_lock<std::mutex> lock(mutex);
+                    done.wait_for(lock, std::chrono::milliseconds(1), [this]() { return !decoded.empty() || inFlight == 0; });
+                    if (decoded.empty() && inFlight == 0)
+                    {
+                        break;
+                    }
+                }
+                update();
+            }
+        }
+
+        // Name of the texture shown while images are loading, or 0 before the first get().
+        unsigned int placeholderID() const
+        {
+            return placeholder;
+        }
+
+        // Pixel unpack buffer ring used for uploads, or NULL before the first streamed image or when uploading from client memory.
+        const TextureStreamer* streaming() const
+        {
+            return streamer.get();
+        }
+
+    private:
+        struct Entry
+        {
+            Texture texture;
+            // Entry with the same file contents whose GL texture this one shares, or NULL.
+            Entry* owner;
+        };
+
+        // Entry that first loaded some file contents, with the file they came from and their size.
+        struct ContentOwner
+        {
+            Entry* entry;
+            std::string path;
+            size_t size;
+        };
+
+        struct Decoded
+        {
+            Entry* entry;
+            // Every level of the texture, or NULL if it could not be loaded. Data is empty when it was written to slot.
+            MipChain* chain;
+            bool streamed;
+            TextureStreamer::Slot slot;
+        };
+
+        unsigned int placeholder;
+        unsigned int threadCount;
+        unsigned int streamingSlots;
+        std::unique_ptr<TextureStreamer> streamer;
+        std::unordered_map<std::string, std::unique_ptr<Entry>> textures;
+        // Entries waiting for their owner to finish uploading.
+        std::vector<Entry*> duplicates;
+
+        // Shared with the decode threads.
+        std::mutex mutex;
+        std::condition_variable wake;
+        std::condition_variable done;
+        std::condition_variable streamerReady;
+        std::deque<Entry*> jobs;
+        std::deque<Decoded> decoded;
+        // Owners by hash of their file contents. Colliding contents that differ each get their own owner.
+        std::unordered_map<uint64_t, std::vector<ContentOwner>> contentOwners;
+        // Requests not yet handed back through decoded.
+        unsigned int inFlight;
+        // Largest chain a worker is waiting to stream while there is no ring yet, in bytes.
+        size_t streamRequest;
+        bool running;
+        std::vector<std::thread> workers;
+
+        // Create the placeholder texture and start the decode threads.
+        void start()
+        {
+            placeholder = createPlaceholder();
+            unsigned int count = threadCount ? threadCount : std::max(1u, std::thread::hardware_concurrency() - 1);
+            for (unsigned int i = 0; i < count; i++)
+            {
+                workers.emplace_back(&TextureCache::decodeLoop, this);
+            }
+        }
+
+        // Create the streaming ring once a worker has an image for it, and wake the workers waiting for it.
+        void createStreamer()
+        {
+            size_t slotSize;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                slotSize = streamRequest;
+            }
+            if (slotSize == 0)
+            {
+                return;
+            }
+            // Round up to whole megabytes so later images of about the same size fit too.
+            const size_t granularity = 1024 * 1024;
+            slotSize = (slotSize + granularity - 1) / granularity * granularity;
+            std::unique_ptr<TextureStreamer> ring(new TextureStreamer(streamingSlots, slotSize));
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                streamer = std::move(ring);
+            }
+            streamerReady.notify_all();
+        }
+
+        // Block a worker until the streaming ring exists, asking for slots of at least size bytes. Returns false if the
+        // cache is shutting down.
+        bool waitForStreamer(size_t size)
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            if (!streamer)
+            {
+                streamRequest = std::max(streamRequest, size);
+                streamerReady.wait(lock, [this]() { return !running || streamer; });
+            }
+            return running;
+        }
+
+        // Grey checkerboard, so missing textures are easy to spot.
+        static unsigned int createPlaceholder()
+        {
+            const unsigned char pixels[] = { 160, 160, 160, 96, 96, 96, 96, 96, 96, 160, 160, 160 };
+            unsigned int texture;
+            glGenTextures(1, &texture);
+            glStateCache().bindTexture(0, texture);
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, 2, 2, 0, GL_RGB, GL_UNSIGNED_BYTE, pixels);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+            return texture;
+        }
+
+        static uint64_t hashBytes(const ByteSpan& bytes)
+        {
+            uint64_t hash = 14695981039346656037ull;
+            for (unsigned char byte : bytes)
+            {
+                hash = (hash ^ byte) * 1099511628211ull;
+            }
+            return hash;
+        }
+
+        // Pick the container and the image to load for a requested path. Either is left empty if there is none.
+        // If the asset archive has the requested file, it is taken to hold every sibling too, so the file system is not searched.
+        static void findSources(const std::string& path, std::string& compressedPath, std::string& imagePath)
+        {
+            static const std::vector<const char*> containers = { ".ktx", ".dds" };
+            static const std::vector<const char*> images = { ".png", ".jpg", ".jpeg", ".tga", ".bmp" };
+            const AssetArchive& archive = assetArchive();
+            ByteSpan contents;
+            bool packed = archive.find(path, contents);
+            std::filesystem::path requested(path);
+            std::error_code error;
+            bool container = CompressedTextureLoader::isContainer(path);
+            (container ? compressedPath : imagePath) = path;
+            std::string& sibling = container ? imagePath : compressedPath;
+            for (const char* extension : container ? images : containers)
+            {
+                std::filesystem::path candidate = requested;
+                candidate.replace_extension(extension);
+                if (packed ? archive.find(candidate.string(), contents) : std::filesystem::is_regular_file(candidate, error))
+                {
+                    sibling = candidate.string();
+                    return;
+                }
+            }
+        }
+
+        // Record the entry as the owner of the contents of the file at path. Returns true if another entry already
+        // owns the same bytes, in which case the entry will share that entry's texture. A matching hash and size is
+        // confirmed by comparing against the owner's file, so a hash collision never shows the wrong image.
+        bool claimContent(Entry* entry, const std::string& path, const ByteSpan& bytes, uint64_t hash)
+        {
+            std::vector<ContentOwner> candidates;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                auto owners = contentOwners.find(hash);
+                if (owners != contentOwners.end())
+                {
+                    candidates = owners->second;
+                }
+            }
+
+            // Compare outside the lock; the owner's file is mapped from the archive or read again.
+            std::vector<unsigned char> storage;
+            ByteSpan contents;
+            for (const ContentOwner& candidate : candidates)
+            {
+                if (candidate.size == bytes.size() && assetArchive().read(candidate.path, storage, contents) && contents.size() == bytes.size() &&
+                    std::memcmp(contents.data(), bytes.data(), bytes.size()) == 0)
+                {
+                    entry->owner = candidate.entry;
+                    return true;
+                }
+            }
+
+            // An identical file claimed by another worker meanwhile only costs a second copy of the texture.
+            std::lock_guard<std::mutex> lock(mutex);
+            contentOwners[hash].push_back({ entry, path, bytes.size() });
+            return false;
+        }
+
+        // Parse a container into image.chain. Returns false if it is malformed or the driver cannot sample its format.
+        static bool loadContainer(const std::string& path, const ByteSpan& bytes, Decoded& image)
+        {
+            std::unique_ptr<MipChain> chain(new MipChain());
+            if (!CompressedTextureLoader::parse(path, bytes, *chain))
+            {
+                return false;
+            }
+            if (chain->isCompressed() && !CompressedTextureLoader::isSupported(chain->InternalFormat))
+            {
+                std::cout << "ERROR::TEXTURE::COMPRESSED_FORMAT_NOT_SUPPORTED " << path << std::endl;
+                return false;
+            }
+            image.chain = chain.release();
+            return true;
+        }
+
+        // Decode an image and build its mip chain, compressed if Compress is set. Returns NULL if it cannot be decoded.
+        MipChain* buildChain(const ByteSpan& bytes) const
+        {
+            int width, height, channels;
+            unsigned char* pixels = stbi_load_from_memory(bytes.data(), (int)bytes.size(), &width, &height, &channels, 0);
+            if (!pixels)
+            {
+                return NULL;
+            }
+            // The decode threads already work on separate images, so each image is filtered and compressed on one thread.
+            std::unique_ptr<MipChain> chain(new MipChain());
+            MipGenerator(1, Mips).generate(pixels, width, height, channels, *chain);
+            stbi_image_free(pixels);
+
+            BlockFormat format = BlockCompressor::formatForChannels(channels);
+            if (Compress && CompressedTextureLoader::isSupported(BlockCompressor::glFormat(format)))
+            {
+                std::unique_ptr<MipChain> compressed(new MipChain());
+                BlockCompressor(1).compress(*chain, format, *compressed);
+                chain.swap(compressed);
+            }
+            return chain.release();
+        }
+
+        // Path of the cached chain of an image with this content hash, or empty without a cache directory.
+        std::string cachePath(uint64_t hash) const
+        {
+            if (CacheDirectory.empty())
+            {
+                return "";
+            }
+            // Chains built with other settings are different files.
+            uint64_t settings[4] = { (uint64_t)Mips.filter, (uint64_t)Mips.srgb, (uint64_t)(Mips.alphaCutoff * 65536.0f), (uint64_t)Compress };
+            std::vector<unsigned char> key((const unsigned char*)&hash, (const unsigned char*)(&hash + 1));
+            key.insert(key.end(), (const unsigned char*)settings, (const unsigned char*)(settings + 4));
+            char name[24];
+            std::snprintf(name, sizeof(name), "/%016llx.ktx", (unsigned long long)hashBytes(key));
+            return CacheDirectory + name;
+        }
+
+        // Write a chain to the cache. writeKTX() replaces the file whole, so readers never see a partial file.
+        static void saveChain(const MipChain& chain, const std::string& path)
+        {
+            std::error_code error;
+            std::filesystem::create_directories(std::filesystem::path(path).parent_path(), error);
+            writeKTX(path, chain);
+        }
+
+        // Worker thread: read, deduplicate by content and decode one request at a time.
+        void decodeLoop()
+        {
+            // Files outside the asset archive are read into these; files inside it are used in place.
+            std::vector<unsigned char> storage;
+            std::vector<unsigned char> cachedStorage;
+            ByteSpan bytes;
+            ByteSpan cached;
+            while (true)
+            {
+                Entry* entry;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    wake.wait(lock, [this]() { return !running || !jobs.empty(); });
+                    if (!running)
+                    {
+                        return;
+                    }
+                    entry = jobs.front();
+                    jobs.pop_front();
+                }
+
+                Decoded image = { entry, NULL, false, { 0, NULL } };
+                std::string compressedPath;
+                std::string imagePath;
+                findSources(entry->texture.Path, compressedPath, imagePath);
+                bool loaded = false;
+                if (!compressedPath.empty() && assetArchive().read(compressedPath, storage, bytes))
+                {
+                    loaded = claimContent(entry, compressedPath, bytes, hashBytes(bytes)) || loadContainer(compressedPath, bytes, image);
+                }
+                if (!loaded && !imagePath.empty() && assetArchive().read(imagePath, storage, bytes))
+                {
+                    uint64_t hash = hashBytes(bytes);
+                    if (!claimContent(entry, imagePath, bytes, hash))
+                    {
+                        std::string cachedPath = cachePath(hash);
+                        if (cachedPath.empty() || !AssetArchive::readFile(cachedPath, cachedStorage, cached) || !loadContainer(cachedPath, cached, image))
+                        {
+                            image.chain = buildChain(bytes);
+                            if (image.chain && !cachedPath.empty())
+                            {
+                                saveChain(*image.chain, cachedPath);
+                            }
+                        }
+                    }
+                }
+
+                // Move the chain into a mapped unpack buffer while still on the worker. Chains larger than a slot stay in client memory.
+                if (image.chain && streamingSlots > 0 && !waitForStreamer(image.chain->Data.size()))
+                {
+                    delete image.chain;
+                    return;
+                }
+                if (image.chain && streamer && image.chain->Data.size() <= streamer->SlotSize)
+                {
+                    if (!streamer->acquire(image.slot))
+                    {
+                        delete image.chain;
+                        return;
+                    }
+                    memcpy(image.slot.memory, image.chain->Data.data(), image.chain->Data.size());
+                    std::vector<unsigned char>().swap(image.chain->Data);
+                    image.streamed = true;
+                }
+
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    decoded.push_back(image);
+                    inFlight--;
+                }
+                done.notify_all();
+            }
+        }
+
+        // Create the GL texture for a loaded chain. Returns the number of bytes uploaded.
+        size_t upload(const Decoded& image)
+        {
+            Texture& texture = image.entry->texture;
+            if (image.entry->owner)
+            {
+                ContentDuplicates++;
+                duplicates.push_back(image.entry);
+                return 0;
+            }
+            if (!image.chain)
+            {
+                std::cout << "ERROR::TEXTURE::LOAD_FAILED " << texture.Path << std::endl;
+                texture.Failed = true;
+                return 0;
+            }
+
+            const MipChain& chain = *image.chain;
+            unsigned int id;
+            glGenTextures(1, &id);
+            glStateCache().bindTexture(0, id);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, chain.Levels.size() > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            if (image.streamed)
+            {
+                streamer->upload(image.slot, chain);
+            }
+            else
+            {
+                uploadMipChain(chain, chain.Data.data());
+            }
+            size_t size = 0;
+            for (const MipLevel& level : chain.Levels)
+            {
+                size += level.size;
+            }
+
+            texture.ID = id;
+            texture.Width = chain.Width;
+            texture.Height = chain.Height;
+            texture.Compressed = chain.isCompressed();
+            texture.Ready = true;
+            delete image.chain;
+            return size;
+        }
+
+        // Point duplicates at their owner's texture once the owner is done.
+        void resolveDuplicates()
+        {
+            for (size_t i = 0; i < duplicates.size();)
+            {
+                Entry* entry = duplicates[i];
+                const Texture& owner = entry->owner->texture;
+                if (owner.Ready || owner.Failed)
+                {
+                    entry->texture.ID = owner.ID;
+                    entry->texture.Width = owner.Width;
+                    entry->texture.Height = owner.Height;
+                    entry->texture.Ready = owner.Ready;
+                    entry->texture.Failed = owner.Failed;
+                    entry->texture.Compressed = owner.Compressed;
+                    duplicates[i] = duplicates.back();
+                    duplicates.pop_back();
+                }
+                else
+                {
+                    i++;
+                }
+            }
+        }
+};
+#endif
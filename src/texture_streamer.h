@@ -0,0 +1,215 @@
+#ifndef TEXTURE_STREAMER_H
+#define TEXTURE_STREAMER_H
+
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <iostream>
+
+#include "mip_chain.h"
+
+// Ring of pixel unpack buffers for uploading textures without stalling the GL thread.
+// The GL thread maps free slots and hands their memory to worker threads, which write pixels straight into it.
+// A filled slot is turned into a texture with an asynchronous copy on the GPU, and a fence marks when the slot can be
+// mapped again. With ARB_buffer_storage the slots stay persistently mapped; otherwise they are mapped and unmapped per use.
+class TextureStreamer
+{
+    public:
+        // Handle to a mapped slot. Memory holds SlotSize bytes that stay writable until the slot is uploaded or released.
+        struct Slot
+        {
+            unsigned int index;
+            unsigned char* memory;
+        };
+
+        // Largest image, in bytes, that fits in one slot. Bigger images have to be uploaded from client memory.
+        size_t SlotSize;
+
+        // Number of uploads through the ring and number of times recycle() found a slot still in use by the GPU.
+        unsigned long Uploads;
+        unsigned long BusySlots;
+
+        TextureStreamer(unsigned int slotCount, size_t slotSize) : SlotSize(slotSize), Uploads(0), BusySlots(0), open(true)
+        {
+            persistent = GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage;
+            slots.resize(slotCount);
+            for (unsigned int i = 0; i < slotCount; i++)
+            {
+                SlotState& slot = slots[i];
+                glGenBuffers(1, &slot.buffer);
+                glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.buffer);
+                if (persistent)
+                {
+                    GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+                    glBufferStorage(GL_PIXEL_UNPACK_BUFFER, slotSize, NULL, flags);
+                    slot.memory = (unsigned char*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, slotSize, flags);
+                }
+                else
+                {
+                    glBufferData(GL_PIXEL_UNPACK_BUFFER, slotSize, NULL, GL_STREAM_DRAW);
+                    slot.memory = NULL;
+                }
+                slot.fence = 0;
+                slot.state = SLOT_IDLE;
+            }
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            recycle();
+        }
+
+        ~TextureStreamer()
+        {
+            close();
+            for (SlotState& slot : slots)
+            {
+                if (slot.fence)
+                {
+                    glDeleteSync(slot.fence);
+                }
+                if (slot.memory)
+                {
+                    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.buffer);
+                    glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+                }
+                glDeleteBuffers(1, &slot.buffer);
+            }
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        }
+
+        TextureStreamer(const TextureStreamer&) = delete;
+        TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+        // Make slots whose uploads the GPU has finished available again. Call on the GL thread, e.g. once per frame.
+        void recycle()
+        {
+            std::vector<unsigned int> ready;
+            for (unsigned int i = 0; i < slots.size(); i++)
+            {
+                SlotState& slot = slots[i];
+                if (slot.state != SLOT_UPLOADING && slot.state != SLOT_IDLE)
+                {
+                    continue;
+                }
+                if (slot.fence)
+                {
+                    if (glClientWaitSync(slot.fence, 0, 0) == GL_TIMEOUT_EXPIRED)
+                    {
+                        BusySlots++;
+                        continue;
+                    }
+                    glDeleteSync(slot.fence);
+                    slot.fence = 0;
+                }
+                if (!persistent)
+                {
+                    // Invalidate so the driver can hand out fresh memory instead of synchronizing.
+                    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.buffer);
+                    slot.memory = (unsigned char*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, SlotSize, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+                    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+                }
+                if (!slot.memory)
+                {
+                    std::cout << "ERROR::TEXTURE_STREAMER::MAP_FAILED" << std::endl;
+                    continue;
+                }
+                slot.state = SLOT_AVAILABLE;
+                ready.push_back(i);
+            }
+            if (!ready.empty())
+            {
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    available.insert(available.end(), ready.begin(), ready.end());
+                }
+                wake.notify_all();
+            }
+        }
+
+        // Wait for a mapped slot. Safe to call from any thread. Returns false if the streamer was closed while waiting.
+        // The GL thread has to keep calling recycle() for slots to come back.
+        bool acquire(Slot& slot)
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [this]() { return !open || !available.empty(); });
+            if (!open)
+            {
+                return false;
+            }
+            slot.index = available.front();
+            slot.memory = slots[slot.index].memory;
+            available.pop_front();
+            return true;
+        }
+
+        // Fill every level of the texture bound to GL_TEXTURE_2D from a slot holding chain.Data, then recycle the slot
+        // once the GPU has read it. Call on the GL thread.
+        void upload(const Slot& slot, const MipChain& chain)
+        {
+            SlotState& state = slots[slot.index];
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, state.buffer);
+            if (!persistent)
+            {
+                glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+                state.memory = NULL;
+            }
+            // Pixel pointers are offsets into the bound unpack buffer.
+            uploadMipChain(chain, NULL);
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            state.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+            state.state = SLOT_UPLOADING;
+            Uploads++;
+        }
+
+        // Return a slot without uploading it. Safe to call from any thread.
+        void release(const Slot& slot)
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                available.push_back(slot.index);
+            }
+            wake.notify_one();
+        }
+
+        // Wake every thread waiting in acquire() and make further calls fail. Call before joining the workers.
+        void close()
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                open = false;
+            }
+            wake.notify_all();
+        }
+
+        bool isPersistent() const
+        {
+            return persistent;
+        }
+
+    private:
+        enum SlotStateKind
+        {
+            // Not mapped yet.
+            SLOT_IDLE,
+            // Mapped and waiting in available, or handed out by acquire().
+            SLOT_AVAILABLE,
+            // Copy to a texture issued; fence pending.
+            SLOT_UPLOADING
+        };
+
+        struct SlotState
+        {
+            unsigned int buffer;
+            unsigned char* memory;
+            GLsync fence;
+            SlotStateKind state;
+        };
+
+        bool persistent;
+        std::vector<SlotState> slots;
+
+        std::mutex mutex;
+        std::condition_variable wake;
+        std::deque<unsigned int> available;
+        bool open;
+};
+#endif
@@ -0,0 +1,208 @@
+#ifndef VERTEX_QUANTIZER_H
+#define VERTEX_QUANTIZER_H
+
+#include <string>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+
+enum PositionFormat
+{
+    // Three floats, 12 bytes.
+    POSITION_FLOAT,
+    // Half floats of the position relative to the center of the bounds, scaled to [-1, 1]. 8 bytes with padding.
+    POSITION_HALF,
+    // 16-bit integers spanning the bounds, 8 bytes with padding. They are read as plain integers and normalized by the
+    // dequantization transform, so the result does not depend on which signed normalization rule the GL version uses.
+    POSITION_SNORM16
+};
+
+enum NormalFormat
+{
+    // Three floats, 12 bytes.
+    NORMAL_FLOAT,
+    // Two snorm16 coordinates on an octahedron unfolded onto a square, 4 bytes. Decoded in the vertex shader.
+    NORMAL_OCTAHEDRAL,
+    // Three 10-bit snorm components in a GL_INT_2_10_10_10_REV word, 4 bytes. Decoded by the vertex fetch.
+    NORMAL_INT_2_10_10_10
+};
+
+// How a mesh file stores its positions and normals. Other attributes stay as floats.
+struct VertexFormat
+{
+    PositionFormat position = POSITION_FLOAT;
+    NormalFormat normal = NORMAL_FLOAT;
+
+    // Set a field from its name as printed by positionName() and normalName(). Returns false for an unknown name.
+    bool setPosition(const std::string& name)
+    {
+        for (int format = POSITION_FLOAT; format <= POSITION_SNORM16; format++)
+        {
+            if (name == positionName((PositionFormat)format))
+            {
+                position = (PositionFormat)format;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool setNormal(const std::string& name)
+    {
+        for (int format = NORMAL_FLOAT; format <= NORMAL_INT_2_10_10_10; format++)
+        {
+            if (name == normalName((NormalFormat)format))
+            {
+                normal = (NormalFormat)format;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    static const char* positionName(PositionFormat format)
+    {
+        const char* names[] = { "float", "half", "snorm16" };
+        return names[format];
+    }
+
+    static const char* normalName(NormalFormat format)
+    {
+        const char* names[] = { "float", "octahedral", "2_10_10_10" };
+        return names[format];
+    }
+};
+
+// Packs positions and normals into the compact formats of VertexFormat. Positions are quantized against the bounds of
+// the mesh and the matching dequantization transform, position = stored * scale + offset, is folded into the model
+// matrix at draw time, so it costs nothing per vertex.
+class VertexQuantizer
+{
+    public:
+        // Stored position to model space for a mesh with the given bounds.
+        static void dequantization(PositionFormat format, const float boundsMin[3], const float boundsMax[3], float scale[3], float offset[3])
+        {
+            for (int axis = 0; axis < 3; axis++)
+            {
+                float center = (boundsMin[axis] + boundsMax[axis]) * 0.5f;
+                float halfExtent = (boundsMax[axis] - boundsMin[axis]) * 0.5f;
+                // A flat axis still needs a scale that can be inverted.
+                halfExtent = halfExtent > 0.0f ? halfExtent : 1.0f;
+                scale[axis] = format == POSITION_FLOAT ? 1.0f : format == POSITION_HALF ? halfExtent : halfExtent / 32767.0f;
+                offset[axis] = format == POSITION_FLOAT ? 0.0f : center;
+            }
+        }
+
+        // Write one position in the given format at out: 12 bytes for floats, 8 otherwise.
+        static void encodePosition(PositionFormat format, const float* position, const float scale[3], const float offset[3], unsigned char* out)
+        {
+            if (format == POSITION_FLOAT)
+            {
+                std::memcpy(out, position, 3 * sizeof(float));
+                return;
+            }
+            uint16_t packed[4] = { 0, 0, 0, 0 };
+            for (int axis = 0; axis < 3; axis++)
+            {
+                float value = (position[axis] - offset[axis]) / scale[axis];
+                if (format == POSITION_HALF)
+                {
+                    packed[axis] = toHalf(value);
+                }
+                else
+                {
+                    packed[axis] = (uint16_t)(int16_t)std::lround(std::min(std::max(value, -32767.0f), 32767.0f));
+                }
+            }
+            std::memcpy(out, packed, sizeof(packed));
+        }
+
+        // Write one unit normal in the given format at out: 12 bytes for floats, 4 otherwise.
+        static void encodeNormal(NormalFormat format, const float* normal, unsigned char* out)
+        {
+            if (format == NORMAL_FLOAT)
+            {
+                std::memcpy(out, normal, 3 * sizeof(float));
+                return;
+            }
+            float length = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+            float n[3] = { 0.0f, 0.0f, 1.0f };
+            for (int axis = 0; length > 0.0f && axis < 3; axis++)
+            {
+                n[axis] = normal[axis] / length;
+            }
+            if (format == NORMAL_INT_2_10_10_10)
+            {
+                uint32_t packed = 0;
+                for (int axis = 0; axis < 3; axis++)
+                {
+                    packed |= ((uint32_t)std::lround(n[axis] * 511.0f) & 0x3FF) << (axis * 10);
+                }
+                std::memcpy(out, &packed, sizeof(packed));
+                return;
+            }
+
+            // Project onto the octahedron |x| + |y| + |z| = 1 and fold the lower half over the diagonals.
+            float sum = std::fabs(n[0]) + std::fabs(n[1]) + std::fabs(n[2]);
+            float u = n[0] / sum, v = n[1] / sum;
+            if (n[2] < 0.0f)
+            {
+                float foldedU = (1.0f - std::fabs(v)) * (u >= 0.0f ? 1.0f : -1.0f);
+                float foldedV = (1.0f - std::fabs(u)) * (v >= 0.0f ? 1.0f : -1.0f);
+                u = foldedU;
+                v = foldedV;
+            }
+            int16_t packed[2] = { (int16_t)std::lround(u * 32767.0f), (int16_t)std::lround(v * 32767.0f) };
+            std::memcpy(out, packed, sizeof(packed));
+        }
+
+        static size_t positionBytes(PositionFormat format)
+        {
+            return format == POSITION_FLOAT ? 3 * sizeof(float) : 4 * sizeof(uint16_t);
+        }
+
+        static size_t normalBytes(NormalFormat format)
+        {
+            return format == NORMAL_FLOAT ? 3 * sizeof(float) : sizeof(uint32_t);
+        }
+
+        // IEEE half float nearest to value, rounding ties to even. Overflow saturates to infinity.
+        static uint16_t toHalf(float value)
+        {
+            uint32_t bits;
+            std::memcpy(&bits, &value, sizeof(bits));
+            uint32_t sign = (bits >> 16) & 0x8000;
+            uint32_t magnitude = bits & 0x7FFFFFFF;
+            if (magnitude >= 0x7F800000)
+            {
+                return (uint16_t)(sign | (magnitude > 0x7F800000 ? 0x7E00 : 0x7C00));
+            }
+            if (magnitude >= 0x477FF000)
+            {
+                return (uint16_t)(sign | 0x7C00);
+            }
+            if (magnitude < 0x38800000)
+            {
+                // Subnormal half: align the mantissa, with its implicit bit, to the half's lowest exponent and round.
+                if (magnitude < 0x33000000)
+                {
+                    return (uint16_t)sign;
+                }
+                uint32_t exponent = magnitude >> 23;
+                uint32_t mantissa = (magnitude & 0x7FFFFF) | 0x800000;
+                uint32_t shift = 126 - exponent;
+                uint32_t half = mantissa >> shift;
+                uint32_t rest = mantissa & ((1u << shift) - 1);
+                uint32_t halfway = 1u << (shift - 1);
+                half += rest > halfway || (rest == halfway && (half & 1));
+                return (uint16_t)(sign | half);
+            }
+            // Rebias the exponent and round the 13 dropped mantissa bits; a carry moves into the exponent correctly.
+            uint32_t half = (magnitude - 0x38000000) >> 13;
+            uint32_t rest = magnitude & 0x1FFF;
+            half += rest > 0x1000 || (rest == 0x1000 && (half & 1));
+            return (uint16_t)(sign | half);
+        }
+};
+#endif
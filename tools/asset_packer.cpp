@@ -0,0 +1,58 @@
+/*
+ * Packs asset directories into one archive that Clean memory-maps when started with --assets, instead of opening every
+ * shader and texture on its own. Each file is stored under its path relative to ROOT, so packing src/shaders and src/textures with
+ * ROOT src gives entries like "shaders/basic_vertex_shader.txt", found at run time as "../shaders/..." with the
+ * archive at ../assets.pak. Built and run by the cook_assets target.
+ *
+ * Usage: asset_packer OUTPUT.pak ROOT DIRECTORY...
+ */
+
+#include <cstdio>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <filesystem>
+
+#include "asset_archive.h"
+
+int main(int argc, char* argv[])
+{
+    if (argc < 4)
+    {
+        std::cerr << "Usage: " << argv[0] << " OUTPUT.pak ROOT DIRECTORY..." << std::endl;
+        return -1;
+    }
+    auto start = std::chrono::steady_clock::now();
+
+    std::filesystem::path root(argv[2]);
+    std::vector<AssetArchive::Source> sources;
+    size_t bytes = 0;
+    for (int i = 3; i < argc; i++)
+    {
+        std::error_code error;
+        for (std::filesystem::recursive_directory_iterator it(root / argv[i], error), end; !error && it != end; it.increment(error))
+        {
+            if (!it->is_regular_file())
+            {
+                continue;
+            }
+            std::filesystem::path relative = it->path().lexically_relative(root);
+            sources.push_back({ relative.generic_string(), it->path().string() });
+            bytes += (size_t)it->file_size();
+        }
+        if (error)
+        {
+            std::cerr << "Cannot read " << (root / argv[i]).string() << ": " << error.message() << std::endl;
+            return 1;
+        }
+    }
+
+    if (!AssetArchive::write(argv[1], sources))
+    {
+        return 1;
+    }
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::printf("Packed %zu files (%.1f KB) into %s in %.1f ms\n", sources.size(), bytes / 1024.0, argv[1], ms);
+    return 0;
+}
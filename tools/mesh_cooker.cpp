@@ -0,0 +1,98 @@
+/*
+ * Imports an OBJ or glTF file and writes it as a .mesh file, the binary format Clean maps and uploads without parsing.
+ * Clean builds the same files in ../mesh_cache on its own; cooking them ahead of time lets a shipped build skip the
+ * first import as well. Pass the result to Clean with --mesh FILE.mesh.
+ *
+ * Positions and normals are stored as floats unless --position-format or --normal-format pick a quantized format; the
+ * file records the format, so Clean sets up the vertex arrays and the shader for it on its own.
+ *
+ * Usage: mesh_cooker [--threads N] [--no-optimize] [--position-format float|half|snorm16]
+ *                    [--normal-format float|octahedral|2_10_10_10] INPUT.obj|.gltf|.glb OUTPUT.mesh
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+#include <iostream>
+#include <string>
+
+#define GLEW_STATIC 1
+#include <GL/glew.h>
+
+#include "mesh_importer.h"
+#include "mesh_file.h"
+
+static int usage(const char* program)
+{
+    std::cerr << "Usage: " << program << " [--threads N] [--no-optimize] [--position-format float|half|snorm16] [--normal-format float|octahedral|2_10_10_10] INPUT.obj|.gltf|.glb OUTPUT.mesh" << std::endl;
+    return -1;
+}
+
+int main(int argc, char* argv[])
+{
+    MeshImportOptions options;
+    VertexFormat format;
+    std::string input, output;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string argument = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (argument == "--threads" && hasValue)
+        {
+            options.threads = (unsigned int)atoi(argv[++i]);
+        }
+        else if (argument == "--no-optimize")
+        {
+            options.optimize = false;
+        }
+        else if (argument == "--position-format" && hasValue)
+        {
+            if (!format.setPosition(argv[++i]))
+            {
+                return usage(argv[0]);
+            }
+        }
+        else if (argument == "--normal-format" && hasValue)
+        {
+            if (!format.setNormal(argv[++i]))
+            {
+                return usage(argv[0]);
+            }
+        }
+        else if (input.empty())
+        {
+            input = argument;
+        }
+        else if (output.empty())
+        {
+            output = argument;
+        }
+        else
+        {
+            return usage(argv[0]);
+        }
+    }
+    if (input.empty() || output.empty())
+    {
+        return usage(argv[0]);
+    }
+
+    Mesh mesh;
+    MeshImportStats stats;
+    if (!MeshImporter::import(input, mesh, options, &stats))
+    {
+        return -1;
+    }
+    stats.print(std::cout, input);
+
+    auto start = std::chrono::steady_clock::now();
+    MeshFile file;
+    if (!file.assign(mesh, MeshImporter::vertexAttributes(), format) || !file.write(output))
+    {
+        return -1;
+    }
+    double writeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::printf("%s: %zu bytes (%u bytes per vertex with %s positions and %s normals, %zu-bit indices) written in %.1f ms\n", output.c_str(), file.bytes().size(),
+        file.header().stride, VertexFormat::positionName(format.position), VertexFormat::normalName(format.normal), MeshFile::indexSize(file.header().indexType) * 8, writeMs);
+    return 0;
+}
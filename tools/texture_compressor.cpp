@@ -0,0 +1,142 @@
+/*
+ * Compresses an image into a KTX file with a full mip chain. TextureCache loads wall.ktx in place of wall.jpg, so the
+ * image is never decoded at run time. Prints the time taken and the PSNR of the result.
+ *
+ * The format defaults to the one matching the channels of the image: BC4 for grey, BC5 for grey and alpha, BC1 for
+ * RGB and BC3 for RGBA. Mip levels are filtered in linear space unless --linear says the color channels already are
+ * linear data, such as normal maps. --alpha-cutoff keeps the coverage of alpha-tested textures at that cutoff.
+ *
+ * Usage: texture_compressor [--format auto|bc1|bc3|bc4|bc5] [--quality fast|normal|high] [--filter box|kaiser]
+ *                           [--linear] [--alpha-cutoff A] [--threads N] [--no-mipmaps] INPUT OUTPUT.ktx
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+#include <iostream>
+#include <string>
+
+#define GLEW_STATIC 1
+#include <GL/glew.h>
+
+#include "stb_image.h"
+#include "mip_generator.h"
+#include "block_compressor.h"
+#include "image_writer.h"
+
+static int usage(const char* program)
+{
+    std::cerr << "Usage: " << program << " [--format auto|bc1|bc3|bc4|bc5] [--quality fast|normal|high] [--filter box|kaiser] [--linear] [--alpha-cutoff A] [--threads N] [--no-mipmaps] INPUT OUTPUT.ktx" << std::endl;
+    return -1;
+}
+
+int main(int argc, char* argv[])
+{
+    std::string formatName = "auto";
+    std::string qualityName = "normal";
+    unsigned int threads = 0;
+    bool mipmaps = true;
+    MipOptions mipOptions;
+    std::string filterName = "box";
+    std::string input, output;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string argument = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (argument == "--format" && hasValue)
+        {
+            formatName = argv[++i];
+        }
+        else if (argument == "--quality" && hasValue)
+        {
+            qualityName = argv[++i];
+        }
+        else if (argument == "--threads" && hasValue)
+        {
+            threads = (unsigned int)atoi(argv[++i]);
+        }
+        else if (argument == "--filter" && hasValue)
+        {
+            filterName = argv[++i];
+        }
+        else if (argument == "--linear")
+        {
+            mipOptions.srgb = false;
+        }
+        else if (argument == "--alpha-cutoff" && hasValue)
+        {
+            mipOptions.alphaCutoff = (float)atof(argv[++i]);
+        }
+        else if (argument == "--no-mipmaps")
+        {
+            mipmaps = false;
+        }
+        else if (input.empty())
+        {
+            input = argument;
+        }
+        else if (output.empty())
+        {
+            output = argument;
+        }
+        else
+        {
+            return usage(argv[0]);
+        }
+    }
+
+    const char* qualities[] = { "fast", "normal", "high" };
+    const char* formats[] = { "bc1", "bc3", "bc4", "bc5" };
+    int quality = -1, format = -1;
+    for (int i = 0; i < 3; i++)
+    {
+        quality = qualityName == qualities[i] ? i : quality;
+    }
+    for (int i = 0; i < 4; i++)
+    {
+        format = formatName == formats[i] ? i : format;
+    }
+    mipOptions.filter = filterName == "kaiser" ? MIP_FILTER_KAISER : MIP_FILTER_BOX;
+    if (input.empty() || output.empty() || quality < 0 || (format < 0 && formatName != "auto") || (filterName != "box" && filterName != "kaiser"))
+    {
+        return usage(argv[0]);
+    }
+
+    int width, height, channels;
+    unsigned char* pixels = stbi_load(input.c_str(), &width, &height, &channels, 0);
+    if (!pixels)
+    {
+        std::cerr << "Failed to load " << input << ": " << stbi_failure_reason() << std::endl;
+        return -1;
+    }
+    BlockFormat blockFormat = format < 0 ? BlockCompressor::formatForChannels(channels) : (BlockFormat)format;
+
+    auto mipStart = std::chrono::steady_clock::now();
+    MipGenerator generator(threads, mipOptions);
+    MipChain chain;
+    generator.generate(pixels, width, height, channels, chain);
+    stbi_image_free(pixels);
+    if (!mipmaps)
+    {
+        chain.Levels.resize(1);
+        chain.Data.resize(chain.Levels[0].size);
+    }
+    double mipMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - mipStart).count();
+
+    BlockCompressor compressor(threads, (CompressionQuality)quality);
+    MipChain texture;
+    CompressionStats stats;
+    compressor.compress(chain, blockFormat, texture, &stats);
+    if (!writeKTX(output, texture))
+    {
+        return -1;
+    }
+
+    std::printf("%s: %dx%d, %d channels -> %s %s, %zu levels, %zu bytes (%.1fx smaller than RGBA8 with mipmaps)\n",
+        input.c_str(), width, height, channels, formats[blockFormat], qualities[quality], texture.Levels.size(), texture.Data.size(),
+        (double)width * height * 4 * (mipmaps ? 4.0 / 3.0 : 1.0) / texture.Data.size());
+    std::printf("Mip chain (%s, %s) in %.1f ms\n", filterName.c_str(), mipOptions.srgb ? "sRGB" : "linear", mipMs);
+    std::printf("%zu blocks in %.1f ms on %u threads (%.1f Mpixel/s), PSNR %.2f dB\n",
+        stats.Blocks, stats.Milliseconds, compressor.Threads, stats.Blocks * 16 / stats.Milliseconds / 1000.0, stats.Psnr);
+    return 0;
+}